@@ -0,0 +1,1691 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "btree.h"
+#include "betree.h"
+#include "lsm.h"
+#include "hashindex.h"
+#include "compositeindex.h"
+#include "page.h"
+#include "filescan.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string benchRelationName = "benchRel";
+const int benchKeys = 100000;
+const int benchRelationSize = 200000;
+const int benchIngestKeys = 400000;
+
+// This is the structure for tuples in the base relation, as in main.cpp
+
+typedef struct tuple {
+	int i;
+	double d;
+	char s[64];
+} RECORD;
+
+BufMgr * bufMgr = new BufMgr(100);
+
+// -----------------------------------------------------------------------------
+// Forward declarations
+// -----------------------------------------------------------------------------
+
+double elapsedMs(std::chrono::steady_clock::time_point start);
+void removeIfExists(const std::string & name);
+void createEmptyRelation();
+void createRandomRelation(int relationSize, int groups = 0);
+void benchInsertBatch();
+void benchParallelBuild();
+void benchRandomIngest();
+template <class IndexType>
+void runRandomIngest(const std::string & name, const std::vector<int> & keys);
+template <class IndexType>
+void removeIndex(const std::string & indexName);
+void benchPointLookup();
+void benchRangeCount();
+void benchDescendingTopN();
+void benchInList();
+void benchCoveringScan();
+void benchCompositePrefix();
+void benchStatsEstimate();
+void benchCompaction();
+void benchNodeLayout();
+void benchCompressedLeaves();
+void benchLeafSearch();
+void benchAsyncIO();
+void benchMissCost();
+void benchDirectIO();
+void benchHugePages();
+void benchMmapIndex();
+void benchFileFrames();
+void benchWriteBack();
+void benchVictims();
+void benchRingScan();
+void benchResize();
+std::size_t residentPages(const std::string & name);
+
+int main(int argc, char **argv)
+{
+  // Run every benchmark unless the name of one is given on the command line.
+  std::string which = argc > 1 ? argv[1] : "all";
+
+  if(which == "all" || which == "insertBatch")
+    benchInsertBatch();
+  if(which == "all" || which == "parallelBuild")
+    benchParallelBuild();
+  if(which == "all" || which == "randomIngest")
+    benchRandomIngest();
+  if(which == "all" || which == "pointLookup")
+    benchPointLookup();
+  if(which == "all" || which == "rangeCount")
+    benchRangeCount();
+  if(which == "all" || which == "descendingTopN")
+    benchDescendingTopN();
+  if(which == "all" || which == "inList")
+    benchInList();
+  if(which == "all" || which == "coveringScan")
+    benchCoveringScan();
+  if(which == "all" || which == "compositePrefix")
+    benchCompositePrefix();
+  if(which == "all" || which == "statsEstimate")
+    benchStatsEstimate();
+  if(which == "all" || which == "compaction")
+    benchCompaction();
+  if(which == "all" || which == "nodeLayout")
+    benchNodeLayout();
+  if(which == "all" || which == "compressedLeaves")
+    benchCompressedLeaves();
+  if(which == "all" || which == "leafSearch")
+    benchLeafSearch();
+  if(which == "all" || which == "asyncIO")
+    benchAsyncIO();
+  if(which == "all" || which == "missCost")
+    benchMissCost();
+  if(which == "all" || which == "directIO")
+    benchDirectIO();
+  if(which == "all" || which == "hugePages")
+    benchHugePages();
+  if(which == "all" || which == "mmapIndex")
+    benchMmapIndex();
+  if(which == "all" || which == "fileFrames")
+    benchFileFrames();
+  if(which == "all" || which == "writeBack")
+    benchWriteBack();
+  if(which == "all" || which == "victims")
+    benchVictims();
+  if(which == "all" || which == "ringScan")
+    benchRingScan();
+  if(which == "all" || which == "resize")
+    benchResize();
+
+  removeIfExists(benchRelationName);
+  return 0;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void removeIfExists(const std::string & name)
+{
+  try
+  {
+    File::remove(name);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+}
+
+// The index constructor scans the base relation, so an empty relation gives us an empty index.
+void createEmptyRelation()
+{
+  removeIfExists(benchRelationName);
+  PageFile emptyFile = PageFile::create(benchRelationName);
+}
+
+// Fill the relation with the keys 0 .. relationSize - 1 in random order. If groups is given,
+// the integer field holds the key modulo groups instead, so that it has duplicates.
+void createRandomRelation(int relationSize, int groups)
+{
+  removeIfExists(benchRelationName);
+  PageFile relation = PageFile::create(benchRelationName);
+
+  std::vector<int> keys(relationSize);
+  for(int i = 0; i < relationSize; i++)
+  {
+    keys[i] = i;
+  }
+  srandom(1);
+  for(int i = relationSize - 1; i > 0; i--)
+  {
+    std::swap(keys[i], keys[random() % (i + 1)]);
+  }
+
+  RECORD record;
+  memset(&record, ' ', sizeof(record));
+  PageId new_page_number;
+  Page new_page = relation.allocatePage(new_page_number);
+  for(int i = 0; i < relationSize; i++)
+  {
+    record.i = groups > 0 ? keys[i] % groups : keys[i];
+    record.d = keys[i];
+    std::string new_data(reinterpret_cast<char*>(&record), sizeof(record));
+    try
+    {
+      new_page.insertRecord(new_data);
+    }
+    catch(InsufficientSpaceException e)
+    {
+      relation.writePage(new_page_number, new_page);
+      new_page = relation.allocatePage(new_page_number);
+      new_page.insertRecord(new_data);
+    }
+  }
+  relation.writePage(new_page_number, new_page);
+}
+
+// -----------------------------------------------------------------------------
+// benchInsertBatch
+// -----------------------------------------------------------------------------
+
+void benchInsertBatch()
+{
+  std::cout << "insertEntry vs insertBatch, " << benchKeys << " random keys" << std::endl;
+
+  std::vector<int> keys(benchKeys);
+  std::vector<RecordId> rids(benchKeys);
+  for(int i = 0; i < benchKeys; i++)
+  {
+    keys[i] = i;
+    rids[i].page_number = i / 50 + 1;
+    rids[i].slot_number = i % 50 + 1;
+  }
+  srandom(1);
+  for(int i = benchKeys - 1; i > 0; i--)
+  {
+    std::swap(keys[i], keys[random() % (i + 1)]);
+  }
+
+  // batch size 0 stands for single key inserts through insertEntry
+  int batchSizes[] = {0, 16, 128, 1024, 8192, benchKeys};
+  for(unsigned int b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+  {
+    createEmptyRelation();
+    std::string indexName;
+    double ms;
+    {
+      BTreeIndex index(benchRelationName, indexName, bufMgr, 0, INTEGER);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      if(batchSizes[b] == 0)
+      {
+        for(int i = 0; i < benchKeys; i++)
+          index.insertEntry(&keys[i], rids[i]);
+      }
+      else
+      {
+        for(int done = 0; done < benchKeys; done += batchSizes[b])
+          index.insertBatch(&keys[done], &rids[done], std::min(batchSizes[b], benchKeys - done));
+      }
+      ms = elapsedMs(start);
+    }
+    removeIfExists(indexName);
+
+    if(batchSizes[b] == 0)
+      std::cout << "  insertEntry\t\t";
+    else
+      std::cout << "  insertBatch(" << batchSizes[b] << ")\t";
+    std::cout << ms << " ms, " << (long)(benchKeys / (ms / 1000.0)) << " keys/s" << std::endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// benchParallelBuild
+// -----------------------------------------------------------------------------
+
+void benchParallelBuild()
+{
+  std::cout << "index build over " << benchRelationSize << " random tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  // 0 threads stands for the original insertEntry loop of the constructor
+  int maxThreads = std::max(4, (int) std::thread::hardware_concurrency());
+  std::vector<int> threadCounts(1, 0);
+  for(int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    threadCounts.push_back(threads);
+  }
+
+  double oneThreadMs = 0;
+  for(unsigned int t = 0; t < threadCounts.size(); t++)
+  {
+    IndexOptions options;
+    options.buildThreads = threadCounts[t];
+    std::string indexName;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+    }
+    double ms = elapsedMs(start);
+    removeIfExists(indexName);
+
+    if(threadCounts[t] == 0)
+    {
+      std::cout << "  insertEntry loop\t" << ms << " ms" << std::endl;
+      continue;
+    }
+    if(threadCounts[t] == 1)
+    {
+      oneThreadMs = ms;
+    }
+    std::cout << "  " << threadCounts[t] << " thread(s)\t\t" << ms << " ms, speedup " << oneThreadMs / ms << std::endl;
+  }
+  std::cout << "  (hardware threads: " << std::thread::hardware_concurrency() << ")" << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+// benchRandomIngest
+// -----------------------------------------------------------------------------
+
+void benchRandomIngest()
+{
+  std::cout << "random ingest of " << benchIngestKeys << " keys, then 1000 point lookups and a full scan" << std::endl;
+
+  std::vector<int> keys(benchIngestKeys);
+  for(int i = 0; i < benchIngestKeys; i++)
+  {
+    keys[i] = i;
+  }
+  srandom(1);
+  for(int i = benchIngestKeys - 1; i > 0; i--)
+  {
+    std::swap(keys[i], keys[random() % (i + 1)]);
+  }
+
+  runRandomIngest<BTreeIndex>("BTreeIndex", keys);
+  runRandomIngest<BeTreeIndex>("BeTreeIndex", keys);
+  runRandomIngest<LSMTreeIndex>("LSMTreeIndex", keys);
+}
+
+// Most index kinds live in a single file, the LSM tree has a file per run besides.
+template <class IndexType>
+void removeIndex(const std::string & indexName)
+{
+  removeIfExists(indexName);
+}
+
+template <>
+void removeIndex<LSMTreeIndex>(const std::string & indexName)
+{
+  LSMTreeIndex::remove(indexName);
+}
+
+template <class IndexType>
+void runRandomIngest(const std::string & name, const std::vector<int> & keys)
+{
+  createEmptyRelation();
+  std::string indexName;
+  {
+    IndexType index(benchRelationName, indexName, bufMgr, 0, INTEGER);
+    RecordId rid;
+    rid.page_number = 1;
+    rid.slot_number = 1;
+
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(unsigned int i = 0; i < keys.size(); i++)
+    {
+      index.insertEntry(&keys[i], rid);
+    }
+    double insertMs = elapsedMs(start);
+    BufStats insertStats = bufMgr->getBufStats();
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < 1000; i++)
+    {
+      int key = keys[i];
+      index.startScan(&key, GTE, &key, LTE);
+      index.scanNext(rid);
+      index.endScan();
+    }
+    double lookupMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    int low = 0;
+    int high = keys.size();
+    int found = 0;
+    index.startScan(&low, GTE, &high, LT);
+    try
+    {
+      while(1)
+      {
+        index.scanNext(rid);
+        found++;
+      }
+    }
+    catch(IndexScanCompletedException e)
+    {
+    }
+    index.endScan();
+    double scanMs = elapsedMs(start);
+
+    std::cout << "  " << name << "\tinsert " << insertMs << " ms, " << (long)(keys.size() / (insertMs / 1000.0)) << " keys/s, "
+              << insertStats.diskreads << " page reads, " << insertStats.diskwrites << " page writes" << std::endl;
+    std::cout << "  \t\t1000 lookups " << lookupMs << " ms, full scan " << scanMs << " ms (" << found << " entries)" << std::endl;
+  }
+  removeIndex<IndexType>(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchPointLookup
+// -----------------------------------------------------------------------------
+
+void benchPointLookup()
+{
+  const int lookups = 100000;
+  std::cout << lookups << " random equality lookups over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::vector<int> keys(lookups);
+  srandom(2);
+  for(int i = 0; i < lookups; i++)
+  {
+    keys[i] = random() % benchRelationSize;
+  }
+
+  std::string indexName;
+  {
+    IndexOptions options;
+    options.buildThreads = 1;
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RecordId rid;
+    for(int i = 0; i < lookups; i++)
+    {
+      index.startScan(&keys[i], GTE, &keys[i], LTE);
+      index.scanNext(rid);
+      index.endScan();
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  BTreeIndex\t" << ms << " ms, " << (double) bufMgr->getBufStats().diskreads / lookups << " page reads per lookup" << std::endl;
+  }
+  removeIfExists(indexName);
+
+  {
+    HashIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER);
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<RecordId> rids;
+    for(int i = 0; i < lookups; i++)
+    {
+      rids.clear();
+      index.lookup(&keys[i], rids);
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  HashIndex\t" << ms << " ms, " << (double) bufMgr->getBufStats().diskreads / lookups << " page reads per lookup" << std::endl;
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchRangeCount
+// -----------------------------------------------------------------------------
+
+void benchRangeCount()
+{
+  const int ranges = 200;
+  std::cout << ranges << " random range counts over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::vector<int> lows(ranges);
+  std::vector<int> highs(ranges);
+  srandom(3);
+  for(int i = 0; i < ranges; i++)
+  {
+    lows[i] = random() % benchRelationSize;
+    highs[i] = lows[i] + random() % (benchRelationSize - lows[i]);
+  }
+
+  std::string indexName;
+  {
+    IndexOptions options;
+    options.buildThreads = 1;
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+
+    // count by scanning every entry of the range
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long long scanned = 0;
+    RecordId rid;
+    for(int i = 0; i < ranges; i++)
+    {
+      index.startScan(&lows[i], GTE, &highs[i], LTE);
+      try
+      {
+        while(1)
+        {
+          index.scanNext(rid);
+          scanned++;
+        }
+      }
+      catch(IndexScanCompletedException e)
+      {
+      }
+      index.endScan();
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  scan	\t" << ms << " ms, " << bufMgr->getBufStats().accesses << " page accesses, " << scanned << " entries" << std::endl;
+
+    // count from the entry counts of the subtrees on the two boundary paths
+    bufMgr->clearBufStats();
+    start = std::chrono::steady_clock::now();
+    long long counted = 0;
+    for(int i = 0; i < ranges; i++)
+    {
+      counted += index.countRange(&lows[i], GTE, &highs[i], LTE);
+    }
+    ms = elapsedMs(start);
+    std::cout << "  countRange\t" << ms << " ms, " << bufMgr->getBufStats().accesses << " page accesses, " << counted << " entries" << std::endl;
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchDescendingTopN
+// -----------------------------------------------------------------------------
+
+void benchDescendingTopN()
+{
+  const int queries = 200;
+  const int topN = 100;
+  std::cout << queries << " queries for the " << topN << " largest keys below a random bound over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::vector<int> highs(queries);
+  srandom(4);
+  for(int i = 0; i < queries; i++)
+  {
+    highs[i] = topN + random() % (benchRelationSize - topN);
+  }
+
+  std::string indexName;
+  {
+    IndexOptions options;
+    options.buildThreads = 1;
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+    const int low = 0;
+    RecordId rid;
+
+    // scan the whole range in ascending order and keep the last N entries
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < queries; i++)
+    {
+      std::vector<RecordId> last(topN);
+      int found = 0;
+      index.startScan(&low, GTE, &highs[i], LT);
+      try
+      {
+        while(1)
+        {
+          index.scanNext(last[found % topN]);
+          found++;
+        }
+      }
+      catch(IndexScanCompletedException e)
+      {
+      }
+      index.endScan();
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  ascending\t" << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads" << std::endl;
+
+    // read only the first N entries of a descending scan
+    bufMgr->clearBufStats();
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < queries; i++)
+    {
+      index.startScan(&low, GTE, &highs[i], LT, DESCENDING);
+      for(int n = 0; n < topN; n++)
+      {
+        index.scanNext(rid);
+      }
+      index.endScan();
+    }
+    ms = elapsedMs(start);
+    std::cout << "  descending\t" << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads" << std::endl;
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchInList
+// -----------------------------------------------------------------------------
+
+void benchInList()
+{
+  const int inListKeys = 20000;
+  std::cout << "IN-list of " << inListKeys << " sorted random keys over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::vector<int> keys(inListKeys);
+  srandom(5);
+  for(int i = 0; i < inListKeys; i++)
+  {
+    keys[i] = random() % benchRelationSize;
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::string indexName;
+  {
+    IndexOptions options;
+    options.buildThreads = 1;
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+    RecordId rid;
+
+    // one scan per key, each descending from the root
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < keys.size(); i++)
+    {
+      index.startScan(&keys[i], GTE, &keys[i], LTE);
+      index.scanNext(rid);
+      index.endScan();
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  startScan per key\t" << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads" << std::endl;
+
+    // one multi-range scan over all the keys
+    std::vector<ScanRange> ranges;
+    for(std::size_t i = 0; i < keys.size(); i++)
+    {
+      ranges.push_back(ScanRange(keys[i]));
+    }
+    bufMgr->clearBufStats();
+    start = std::chrono::steady_clock::now();
+    index.startMultiScan(ranges);
+    try
+    {
+      while(1)
+      {
+        index.scanNext(rid);
+      }
+    }
+    catch(IndexScanCompletedException e)
+    {
+    }
+    index.endScan();
+    ms = elapsedMs(start);
+    std::cout << "  startMultiScan\t" << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads" << std::endl;
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchCoveringScan
+// -----------------------------------------------------------------------------
+
+void benchCoveringScan()
+{
+  const int scanKeys = 20000;
+  std::cout << "Range scan of " << scanKeys << " keys reading the double field, " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+  PageFile relation(benchRelationName, false);
+  int low = benchRelationSize / 4;
+  int high = low + scanKeys;
+
+  for(int covering = 0; covering < 2; covering++)
+  {
+    std::string indexName;
+    {
+      IndexOptions options;
+      options.buildThreads = 1;
+      if(covering)
+      {
+        options.includes.push_back(IncludeAttr(offsetof(RECORD, d), DOUBLE));
+      }
+      BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+      RecordId rid;
+      double sum = 0;
+
+      bufMgr->clearBufStats();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      index.startScan(&low, GTE, &high, LT);
+      try
+      {
+        while(1)
+        {
+          if(covering)
+          {
+            // the value comes from the leaf page
+            double d;
+            index.scanNext(rid, &d);
+            sum += d;
+          }
+          else
+          {
+            // the value comes from the record in the base relation
+            index.scanNext(rid);
+            Page * page;
+            bufMgr->readPage(&relation, rid.page_number, page);
+            sum += reinterpret_cast<const RECORD*>(page->getRecord(rid).data())->d;
+            bufMgr->unPinPage(&relation, rid.page_number, false);
+          }
+        }
+      }
+      catch(IndexScanCompletedException e)
+      {
+      }
+      index.endScan();
+      double ms = elapsedMs(start);
+      std::cout << (covering ? "  covering index\t" : "  index + heap fetch\t") << ms << " ms, "
+                << bufMgr->getBufStats().diskreads << " page reads (sum " << sum << ")" << std::endl;
+    }
+    removeIfExists(indexName);
+  }
+  bufMgr->flushFile(&relation);
+}
+
+// -----------------------------------------------------------------------------
+// benchCompositePrefix
+// -----------------------------------------------------------------------------
+
+void benchCompositePrefix()
+{
+  const int groups = 100;
+  const int group = 42;
+  const double highD = 20000;
+  std::cout << "Integer field = " << group << " and double field < " << highD << ", " << groups << " groups over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize, groups);
+  PageFile relation(benchRelationName, false);
+
+  std::vector<KeyAttr> keyAttrs;
+  keyAttrs.push_back(KeyAttr(offsetof(RECORD, i), INTEGER));
+  keyAttrs.push_back(KeyAttr(offsetof(RECORD, d), DOUBLE));
+  std::string indexName;
+  {
+    CompositeBTreeIndex index(benchRelationName, indexName, bufMgr, keyAttrs);
+    RecordId rid;
+    char low[sizeof(int) + sizeof(double)];
+    char high[sizeof(int) + sizeof(double)];
+    double lowD = 0;
+    memcpy(low, &group, sizeof(int));
+    memcpy(low + sizeof(int), &lowD, sizeof(double));
+    memcpy(high, &group, sizeof(int));
+    memcpy(high + sizeof(int), &highD, sizeof(double));
+
+    // bound the first attribute only, as a single attribute index would, and filter the records
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int found = 0;
+    index.startScan(low, GTE, high, LTE, 1);
+    try
+    {
+      while(1)
+      {
+        index.scanNext(rid);
+        Page * page;
+        bufMgr->readPage(&relation, rid.page_number, page);
+        if(reinterpret_cast<const RECORD*>(page->getRecord(rid).data())->d < highD)
+        {
+          found++;
+        }
+        bufMgr->unPinPage(&relation, rid.page_number, false);
+      }
+    }
+    catch(IndexScanCompletedException e)
+    {
+    }
+    index.endScan();
+    double ms = elapsedMs(start);
+    std::cout << "  prefix + filter\t" << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads, " << found << " found" << std::endl;
+
+    // bound both attributes
+    bufMgr->clearBufStats();
+    start = std::chrono::steady_clock::now();
+    found = 0;
+    index.startScan(low, GTE, high, LT, 2);
+    try
+    {
+      while(1)
+      {
+        index.scanNext(rid);
+        found++;
+      }
+    }
+    catch(IndexScanCompletedException e)
+    {
+    }
+    index.endScan();
+    ms = elapsedMs(start);
+    std::cout << "  composite range\t" << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads, " << found << " found" << std::endl;
+  }
+  removeIfExists(indexName);
+  bufMgr->flushFile(&relation);
+}
+
+// -----------------------------------------------------------------------------
+// benchStatsEstimate
+// -----------------------------------------------------------------------------
+
+void benchStatsEstimate()
+{
+  const int ranges = 200;
+  std::cout << ranges << " random range estimates over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::vector<int> lows(ranges);
+  std::vector<int> highs(ranges);
+  srandom(3);
+  for(int i = 0; i < ranges; i++)
+  {
+    lows[i] = random() % benchRelationSize;
+    highs[i] = lows[i] + random() % (benchRelationSize - lows[i]);
+  }
+
+  std::string indexName;
+  {
+    IndexOptions options;
+    options.buildThreads = 1;
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+
+    // count exactly from the entry counts of the subtrees
+    bufMgr->clearBufStats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<long long> counts(ranges);
+    for(int i = 0; i < ranges; i++)
+    {
+      counts[i] = index.countRange(&lows[i], GTE, &highs[i], LTE);
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  countRange\t" << ms << " ms, " << bufMgr->getBufStats().accesses << " page accesses" << std::endl;
+
+    // estimate from the histogram kept in memory
+    bufMgr->clearBufStats();
+    start = std::chrono::steady_clock::now();
+    double error = 0;
+    for(int i = 0; i < ranges; i++)
+    {
+      double estimate = index.estimateRange(&lows[i], GTE, &highs[i], LTE);
+      error += std::fabs(estimate - counts[i]) / (counts[i] + 1);
+    }
+    ms = elapsedMs(start);
+    std::cout << "  estimateRange\t" << ms << " ms, " << bufMgr->getBufStats().accesses << " page accesses, "
+              << 100 * error / ranges << "% mean relative error" << std::endl;
+
+    IndexStatistics stats;
+    index.getStatistics(stats);
+    std::cout << "  " << stats.distinctKeys << " distinct keys estimated, " << stats.leafCount << " leaves, height "
+              << stats.height << ", fill factor " << stats.fillFactor << std::endl;
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchCompaction
+// -----------------------------------------------------------------------------
+
+void benchCompaction()
+{
+  std::cout << "Full range scan before and after compacting an index built by inserts over " << benchRelationSize << " tuples" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::string indexName;
+  {
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER);
+    IndexStatistics stats;
+    for(int round = 0; round < 2; round++)
+    {
+      if(round == 1)
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int unused = index.compact();
+        std::cout << "  compact\t" << elapsedMs(start) << " ms, " << unused << " pages of the old tree left unused" << std::endl;
+      }
+      index.getStatistics(stats);
+      bufMgr->clearBufStats();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      int low = 0;
+      int high = benchRelationSize;
+      int found = 0;
+      RecordId rid;
+      index.startScan(&low, GTE, &high, LT);
+      try
+      {
+        while(1)
+        {
+          index.scanNext(rid);
+          found++;
+        }
+      }
+      catch(IndexScanCompletedException e)
+      {
+      }
+      index.endScan();
+      double ms = elapsedMs(start);
+      std::cout << (round == 0 ? "  before\t" : "  after\t\t") << ms << " ms, " << bufMgr->getBufStats().diskreads << " page reads, "
+                << stats.leafCount << " leaves, fill factor " << stats.fillFactor << ", " << found << " found" << std::endl;
+    }
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchNodeLayout
+// -----------------------------------------------------------------------------
+
+void benchNodeLayout()
+{
+  const int keys = 2000000;
+  const int lookups = 1000000;
+  std::cout << lookups << " random equality lookups over " << keys << " inserted keys, index held in the buffer pool" << std::endl;
+  createEmptyRelation();
+  // a buffer pool of its own, which holds every page of the index, so that
+  // the lookups measure the search within the pages
+  BufMgr * pool = new BufMgr(8192);
+
+  std::vector<int> batch(keys);
+  std::vector<RecordId> rids(keys);
+  for(int i = 0; i < keys; i++)
+  {
+    batch[i] = i;
+    rids[i].page_number = 1;
+    rids[i].slot_number = 1;
+  }
+  std::vector<int> probes(lookups);
+  srandom(6);
+  for(int i = 0; i < lookups; i++)
+  {
+    probes[i] = random() % keys;
+  }
+
+  const NodeLayout layouts[] = {SORTED_KEYS, KEY_BLOCKS};
+  const char * names[] = {"SORTED_KEYS", "KEY_BLOCKS"};
+  for(int l = 0; l < 2; l++)
+  {
+    std::string indexName;
+    {
+      IndexOptions options;
+      options.nodeLayout = layouts[l];
+      BTreeIndex index(benchRelationName, indexName, pool, offsetof(RECORD, i), INTEGER, options);
+      for(int i = 0; i < keys; i += 10000)
+      {
+        index.insertBatch(&batch[i], &rids[i], 10000);
+      }
+      IndexStatistics stats;
+      index.getStatistics(stats);
+
+      pool->clearBufStats();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      RecordId rid;
+      for(int i = 0; i < lookups; i++)
+      {
+        index.startScan(&probes[i], GTE, &probes[i], LTE);
+        index.scanNext(rid);
+        index.endScan();
+      }
+      double ms = elapsedMs(start);
+      std::cout << "  " << names[l] << "\t" << ms * 1e6 / lookups << " ns per lookup, height " << stats.height << ", "
+                << pool->getBufStats().diskreads << " page reads" << std::endl;
+    }
+    removeIfExists(indexName);
+  }
+  delete pool;
+}
+
+// -----------------------------------------------------------------------------
+// benchCompressedLeaves
+// -----------------------------------------------------------------------------
+
+void benchCompressedLeaves()
+{
+  std::cout << "Full range scan of an index built bottom up over " << benchRelationSize << " tuples, with and without compressed leaves" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  const char * names[] = {"plain", "compressed"};
+  for(int c = 0; c < 2; c++)
+  {
+    std::string indexName;
+    {
+      IndexOptions options;
+      options.buildThreads = 2;
+      options.compressLeaves = (c == 1);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+      double buildMs = elapsedMs(start);
+      IndexStatistics stats;
+      index.getStatistics(stats);
+
+      bufMgr->clearBufStats();
+      start = std::chrono::steady_clock::now();
+      int low = 0;
+      int high = benchRelationSize;
+      int found = 0;
+      RecordId rid;
+      index.startScan(&low, GTE, &high, LT);
+      try
+      {
+        while(1)
+        {
+          index.scanNext(rid);
+          found++;
+        }
+      }
+      catch(IndexScanCompletedException e)
+      {
+      }
+      index.endScan();
+      double ms = elapsedMs(start);
+      std::cout << "  " << names[c] << "\tbuild " << buildMs << " ms, scan " << ms << " ms, " << bufMgr->getBufStats().diskreads
+                << " page reads, " << stats.leafCount << " leaves, " << found << " found" << std::endl;
+    }
+    removeIfExists(indexName);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// benchLeafSearch
+// -----------------------------------------------------------------------------
+
+void benchLeafSearch()
+{
+  const int keys = 1000000;
+  const int lookups = 1000000;
+  std::cout << lookups << " random equality lookups over " << keys << " inserted keys, binary against interpolation search in the leaves" << std::endl;
+  createEmptyRelation();
+  BufMgr * pool = new BufMgr(8192);
+
+  std::vector<RecordId> rids(keys);
+  for(int i = 0; i < keys; i++)
+  {
+    rids[i].page_number = 1;
+    rids[i].slot_number = 1;
+  }
+  std::vector<int> probes(lookups);
+  srandom(7);
+  for(int i = 0; i < lookups; i++)
+  {
+    probes[i] = random() % keys;
+  }
+
+  // sequential ids, and clusters of 64 keys far from each other
+  const char * sets[] = {"uniform", "clustered"};
+  const LeafSearch searches[] = {BINARY_SEARCH, INTERPOLATION_SEARCH};
+  const char * names[] = {"BINARY_SEARCH", "INTERPOLATION_SEARCH"};
+  for(int k = 0; k < 2; k++)
+  {
+    std::vector<int> batch(keys);
+    for(int i = 0; i < keys; i++)
+    {
+      batch[i] = (k == 0) ? i : i / 64 * 10000 + i % 64;
+    }
+    std::vector<int> probeKeys(lookups);
+    for(int i = 0; i < lookups; i++)
+    {
+      probeKeys[i] = batch[probes[i]];
+    }
+    std::string indexName;
+    {
+      BTreeIndex index(benchRelationName, indexName, pool, offsetof(RECORD, i), INTEGER);
+      for(int i = 0; i < keys; i += 10000)
+      {
+        index.insertBatch(&batch[i], &rids[i], 10000);
+      }
+    }
+    for(int s = 0; s < 2; s++)
+    {
+      // the search is not kept in the index file, so the same file is opened with each
+      IndexOptions options;
+      options.leafSearch = searches[s];
+      BTreeIndex index(benchRelationName, indexName, pool, offsetof(RECORD, i), INTEGER, options);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      RecordId rid;
+      for(int i = 0; i < lookups; i++)
+      {
+        index.startScan(&probeKeys[i], GTE, &probeKeys[i], LTE);
+        index.scanNext(rid);
+        index.endScan();
+      }
+      double ms = elapsedMs(start);
+      std::cout << "  " << sets[k] << "\t" << names[s] << "\t" << ms * 1e6 / lookups << " ns per lookup" << std::endl;
+    }
+    removeIfExists(indexName);
+  }
+  delete pool;
+}
+
+// -----------------------------------------------------------------------------
+// benchAsyncIO
+// -----------------------------------------------------------------------------
+
+void benchAsyncIO()
+{
+  const int pages = 8192;
+  const int batchSize = 64;
+  std::cout << "Random page reads in batches of " << batchSize << " and write-back of " << pages
+            << " pages of a BlobFile in the page cache, for each IOEngine backend" << std::endl;
+  const std::string blobName = benchRelationName + ".io";
+  removeIfExists(blobName);
+  std::vector<PageId> pageNos(pages);
+  {
+    BlobFile blob(blobName, true);
+    const PageId first = blob.allocatePageRange(pages);
+    Page page;
+    for(int i = 0; i < pages; i++)
+    {
+      pageNos[i] = first + i;
+      blob.writePage(pageNos[i], page);
+    }
+  }
+  srandom(8);
+  for(int i = pages - 1; i > 0; i--)
+  {
+    std::swap(pageNos[i], pageNos[random() % (i + 1)]);
+  }
+
+  const IOBackend backends[] = {IO_SYNC, IO_THREADS, IO_URING};
+  const char * names[] = {"IO_SYNC", "IO_THREADS", "IO_URING"};
+  for(int b = 0; b < 3; b++)
+  {
+    IOOptions options;
+    options.backend = backends[b];
+    BufMgr * pool = new BufMgr(pages + batchSize, options);
+    BlobFile blob(blobName, false);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Page *> read;
+    for(int i = 0; i < pages; i += batchSize)
+    {
+      std::vector<PageId> batch(pageNos.begin() + i, pageNos.begin() + i + batchSize);
+      pool->readPages(&blob, batch, read);
+      for(int j = 0; j < batchSize; j++)
+      {
+        pool->unPinPage(&blob, batch[j], true);
+      }
+    }
+    double readMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    pool->flushFile(&blob);
+    double writeMs = elapsedMs(start);
+    IOStats & stats = pool->getIOStats();
+    std::cout << "  " << names[b] << (pool->getIOBackend() == backends[b] ? "" : " (fell back)") << "\tread " << readMs << " ms, p50 "
+              << IOStats::percentile(stats.readLatency, 0.5) << " us, p99 " << IOStats::percentile(stats.readLatency, 0.99)
+              << " us; write-back " << writeMs << " ms, p50 " << IOStats::percentile(stats.writeLatency, 0.5) << " us; "
+              << stats.submits << " submits" << std::endl;
+    delete pool;
+  }
+  removeIfExists(blobName);
+}
+
+// -----------------------------------------------------------------------------
+// benchMissCost
+// -----------------------------------------------------------------------------
+
+void benchMissCost()
+{
+  const int misses = 100000;
+  std::cout << "CPU time per page read in random order from a PageFile and a BlobFile in the page cache: returned by value and"
+            << " copied into a frame, read in place, and BufMgr misses through a pool of 8 frames, clean and dirty" << std::endl;
+  createRandomRelation(50000);
+  const std::string blobName = benchRelationName + ".miss";
+  removeIfExists(blobName);
+  const PageId blobPages = 4096;
+  {
+    BlobFile blob(blobName, true);
+    const PageId first = blob.allocatePageRange(blobPages);
+    Page page;
+    for(PageId i = 0; i < blobPages; i++)
+    {
+      blob.writePage(first + i, page);
+    }
+  }
+
+  PageFile relation = PageFile::open(benchRelationName);
+  BlobFile * blob = new BlobFile(blobName, false);
+  File * files[] = {&relation, blob};
+  const char * names[] = {"PageFile", "BlobFile"};
+  for(int f = 0; f < 2; f++)
+  {
+    File * file = files[f];
+    std::vector<PageId> pageNos;
+    for(PageId pageNo = file->getFirstPageNo(); pageNo < file->getNumPages(); pageNo++)
+    {
+      pageNos.push_back(pageNo);
+    }
+    srandom(9);
+    std::vector<PageId> order(misses);
+    for(int i = 0; i < misses; i++)
+    {
+      order[i] = pageNos[random() % pageNos.size()];
+    }
+
+    Page * frame = new Page();
+    std::clock_t start = std::clock();
+    for(int i = 0; i < misses; i++)
+    {
+      *frame = file->readPage(order[i]);
+    }
+    double valueUs = (std::clock() - start) * 1e6 / CLOCKS_PER_SEC / misses;
+
+    start = std::clock();
+    for(int i = 0; i < misses; i++)
+    {
+      file->readPageInto(order[i], *frame);
+    }
+    double inPlaceUs = (std::clock() - start) * 1e6 / CLOCKS_PER_SEC / misses;
+    delete frame;
+
+    double poolUs[2];
+    for(int dirty = 0; dirty < 2; dirty++)
+    {
+      BufMgr * pool = new BufMgr(8);
+      start = std::clock();
+      for(int i = 0; i < misses; i++)
+      {
+        Page * page;
+        pool->readPage(file, order[i], page);
+        pool->unPinPage(file, order[i], dirty == 1);
+      }
+      poolUs[dirty] = (std::clock() - start) * 1e6 / CLOCKS_PER_SEC / misses;
+      pool->flushFile(file);
+      delete pool;
+    }
+    std::cout << "  " << names[f] << "	by value " << valueUs << " us, in place " << inPlaceUs << " us, BufMgr clean "
+              << poolUs[0] << " us, dirty " << poolUs[1] << " us" << std::endl;
+  }
+  delete blob;
+  removeIfExists(blobName);
+}
+
+// -----------------------------------------------------------------------------
+// benchDirectIO
+// -----------------------------------------------------------------------------
+
+// Number of pages of the page cache of the kernel which hold the file.
+std::size_t residentPages(const std::string & name)
+{
+  int fd = open(name.c_str(), O_RDONLY);
+  off_t size = lseek(fd, 0, SEEK_END);
+  std::size_t pageSize = sysconf(_SC_PAGESIZE);
+  std::size_t count = (size + pageSize - 1) / pageSize;
+  void * map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  std::vector<unsigned char> resident(count);
+  mincore(map, size, &resident[0]);
+  munmap(map, size);
+  close(fd);
+  std::size_t pages = 0;
+  for(std::size_t i = 0; i < count; i++)
+  {
+    pages += resident[i] & 1;
+  }
+  return pages * pageSize / 1024;
+}
+
+void benchDirectIO()
+{
+  const int pages = 8192;
+  std::cout << "Random reads of all " << pages << " pages of a BlobFile through a pool holding them all, with buffered and with direct"
+            << " I/O, and the KB of the file then in the page cache of the kernel as well" << std::endl;
+  const std::string blobName = benchRelationName + ".direct";
+  const char * names[] = {"buffered", "direct"};
+  for(int direct = 0; direct < 2; direct++)
+  {
+    removeIfExists(blobName);
+    std::vector<PageId> pageNos(pages);
+    {
+      BlobFile blob = BlobFile::create(blobName, direct == 1);
+      const PageId first = blob.allocatePageRange(pages);
+      Page page;
+      for(int i = 0; i < pages; i++)
+      {
+        pageNos[i] = first + i;
+        blob.writePage(pageNos[i], page);
+      }
+    }
+    srandom(10);
+    for(int i = pages - 1; i > 0; i--)
+    {
+      std::swap(pageNos[i], pageNos[random() % (i + 1)]);
+    }
+    // start from an empty page cache
+    int fd = open(blobName.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+
+    BlobFile blob = BlobFile::open(blobName, direct == 1);
+    BufMgr * pool = new BufMgr(pages + 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(&blob, pageNos[i], page);
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  " << names[direct] << (blob.directIO() == (direct == 1) ? "" : " (fell back)") << "	" << ms << " ms, "
+              << residentPages(blobName) << " KB in the page cache for " << pages * Page::SIZE / 1024 << " KB in the pool" << std::endl;
+    pool->flushFile(&blob);
+    delete pool;
+  }
+  removeIfExists(blobName);
+}
+
+// -----------------------------------------------------------------------------
+// benchHugePages
+// -----------------------------------------------------------------------------
+
+void benchHugePages()
+{
+  const std::uint32_t frames = 65536;
+  const int touches = 20000000;
+  std::cout << "Buffer pool of " << frames << " frames for each kind of pages: construction with and without pre-faulting by 4"
+            << " threads, then " << touches << " reads of a word of a random frame" << std::endl;
+  const HugePages kinds[] = {HUGEPAGES_NONE, HUGEPAGES_TRANSPARENT, HUGEPAGES_HUGETLB};
+  const char * names[] = {"none", "transparent", "hugetlb"};
+  const char * obtained[] = {"none", "transparent", "hugetlb"};
+  for(int k = 0; k < 3; k++)
+  {
+    for(int prefault = 0; prefault < 2; prefault++)
+    {
+      PoolOptions poolOptions;
+      poolOptions.hugePages = kinds[k];
+      poolOptions.prefaultThreads = prefault ? 4 : 0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      BufMgr * pool = new BufMgr(frames, IOOptions(), poolOptions);
+      double constructMs = elapsedMs(start);
+
+      // the frames not pre-faulted are faulted in by the first touch
+      start = std::chrono::steady_clock::now();
+      for(std::uint32_t i = 0; i < frames; i++)
+      {
+        memset(reinterpret_cast<char *>(&pool->bufPool[i]), 0, Page::SIZE);
+      }
+      double firstTouchMs = elapsedMs(start);
+
+      srandom(11);
+      std::vector<std::uint32_t> offsets(1 << 20);
+      for(std::size_t i = 0; i < offsets.size(); i++)
+      {
+        offsets[i] = random() % (frames * (Page::SIZE / sizeof(int)));
+      }
+      const int * words = reinterpret_cast<const int *>(pool->bufPool);
+      long sum = 0;
+      start = std::chrono::steady_clock::now();
+      for(int i = 0; i < touches; i++)
+      {
+        sum += words[offsets[i & (offsets.size() - 1)] + i % 7];
+      }
+      double touchMs = elapsedMs(start);
+      std::cout << "  " << names[k] << "\t" << (prefault ? "pre-faulted" : "lazy") << "\tgot " << obtained[pool->getPoolPages()] << ", "
+                << pool->getHugePageBytes() / (1 << 20) << " MB in huge pages; construction " << constructMs << " ms, first touch "
+                << firstTouchMs << " ms, " << touchMs * 1e6 / touches << " ns per random read" << (sum == 1 ? " " : "") << std::endl;
+      delete pool;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+// benchMmapIndex
+// -----------------------------------------------------------------------------
+
+void benchMmapIndex()
+{
+  const int lookups = 20000;
+  std::cout << lookups << " random equality lookups over " << benchRelationSize << " tuples, with the index file read into the"
+            << " pool and mapped: cold, from an empty page cache, then warm" << std::endl;
+  createRandomRelation(benchRelationSize);
+
+  std::vector<int> keys(lookups);
+  srandom(12);
+  for(int i = 0; i < lookups; i++)
+  {
+    keys[i] = random() % benchRelationSize;
+  }
+
+  std::string indexName;
+  {
+    IndexOptions options;
+    options.buildThreads = 1;
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+  }
+  const char * names[] = {"BlobFile", "MmapFile"};
+  for(int mapped = 0; mapped < 2; mapped++)
+  {
+    // start from an empty page cache
+    int fd = open(indexName.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+
+    IndexOptions options;
+    options.mmapIndex = (mapped == 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BTreeIndex index(benchRelationName, indexName, bufMgr, offsetof(RECORD, i), INTEGER, options);
+    double openMs = elapsedMs(start);
+    double ms[2];
+    for(int pass = 0; pass < 2; pass++)
+    {
+      bufMgr->clearBufStats();
+      start = std::chrono::steady_clock::now();
+      RecordId rid;
+      for(int i = 0; i < lookups; i++)
+      {
+        index.startScan(&keys[i], GTE, &keys[i], LTE);
+        index.scanNext(rid);
+        index.endScan();
+      }
+      ms[pass] = elapsedMs(start);
+    }
+    std::cout << "  " << names[mapped] << "\topen " << openMs << " ms, cold " << ms[0] * 1000 / lookups << " us, warm "
+              << ms[1] * 1000 / lookups << " us per lookup, " << (double) bufMgr->getBufStats().diskreads / lookups
+              << " page reads per warm lookup into the pool" << std::endl;
+  }
+  removeIfExists(indexName);
+}
+
+// -----------------------------------------------------------------------------
+// benchFileFrames
+// -----------------------------------------------------------------------------
+
+void benchFileFrames()
+{
+  const std::uint32_t frames = 1 << 18;
+  const int files = 200;
+  const int pages = 4;
+  std::cout << "flushFile of " << files << " BlobFiles of " << pages << " dirty pages each, in a pool of " << frames
+            << " frames" << std::endl;
+  BufMgr * pool = new BufMgr(frames, IOOptions(), PoolOptions());
+  std::vector<BlobFile *> blobs;
+  for(int f = 0; f < files; f++)
+  {
+    std::ostringstream name;
+    name << benchRelationName << ".frames" << f;
+    removeIfExists(name.str());
+    blobs.push_back(new BlobFile(name.str(), true));
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(blobs[f], pageNo, page);
+      pool->unPinPage(blobs[f], pageNo, true);
+    }
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int f = 0; f < files; f++)
+  {
+    pool->flushFile(blobs[f]);
+  }
+  double ms = elapsedMs(start);
+  std::cout << "  " << ms * 1000 / files << " us per flushFile" << std::endl;
+  delete pool;
+  for(int f = 0; f < files; f++)
+  {
+    std::string name = blobs[f]->filename();
+    delete blobs[f];
+    removeIfExists(name);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// benchWriteBack
+// -----------------------------------------------------------------------------
+
+void benchWriteBack()
+{
+  const int pages = 32768;
+  std::cout << "flushFile and fdatasync of a BlobFile of " << pages << " pages with all of them and a random half of them"
+            << " dirtied in random order, and " << pages << " dirty pages evicted through a pool of 1024 frames" << std::endl;
+  const std::string blobName = benchRelationName + ".writeback";
+  removeIfExists(blobName);
+  BlobFile * blob = new BlobFile(blobName, true);
+  std::vector<PageId> pageNos(pages);
+  {
+    const PageId first = blob->allocatePageRange(pages);
+    Page page;
+    for(int i = 0; i < pages; i++)
+    {
+      pageNos[i] = first + i;
+      blob->writePage(pageNos[i], page);
+    }
+  }
+  srandom(13);
+  const char * names[] = {"all dirty", "half dirty"};
+  BufMgr * pool = new BufMgr(pages + 1);
+  for(int half = 0; half < 2; half++)
+  {
+    std::vector<PageId> order(pageNos);
+    for(int i = pages - 1; i > 0; i--)
+    {
+      std::swap(order[i], order[random() % (i + 1)]);
+    }
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(blob, order[i], page);
+      const bool dirty = !half || random() % 2;
+      if(dirty)
+      {
+        reinterpret_cast<int *>(page)[0] = i;
+      }
+      pool->unPinPage(blob, order[i], dirty);
+    }
+    pool->getIOStats().clear();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pool->flushFile(blob);
+    fdatasync(blob->descriptor());
+    double ms = elapsedMs(start);
+    std::cout << "  " << names[half] << "\t" << ms << " ms, " << pool->getIOStats().writes << " writes" << std::endl;
+  }
+  delete pool;
+
+  pool = new BufMgr(1024);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i = 0; i < pages; i++)
+  {
+    Page * page;
+    pool->readPage(blob, pageNos[i], page);
+    reinterpret_cast<int *>(page)[1] = i;
+    pool->unPinPage(blob, pageNos[i], true);
+  }
+  pool->flushFile(blob);
+  fdatasync(blob->descriptor());
+  double ms = elapsedMs(start);
+  std::cout << "  evicted\t" << ms << " ms, " << pool->getIOStats().writes << " writes" << std::endl;
+  delete pool;
+  delete blob;
+  removeIfExists(blobName);
+}
+
+// -----------------------------------------------------------------------------
+// benchVictims
+// -----------------------------------------------------------------------------
+
+void benchVictims()
+{
+  const std::uint32_t frames = 4096;
+  const int pages = 16384;
+  const int reads = 400000;
+  std::cout << reads << " random reads of the " << pages << " pages of a BlobFile through a pool of " << frames
+            << " frames, and the frames swept per eviction" << std::endl;
+  const std::string blobName = benchRelationName + ".victims";
+  removeIfExists(blobName);
+  BlobFile * blob = new BlobFile(blobName, true);
+  std::vector<PageId> pageNos(pages);
+  {
+    const PageId first = blob->allocatePageRange(pages);
+    Page page;
+    for(int i = 0; i < pages; i++)
+    {
+      pageNos[i] = first + i;
+      blob->writePage(pageNos[i], page);
+    }
+  }
+  srandom(14);
+  std::vector<PageId> order(reads);
+  for(int i = 0; i < reads; i++)
+  {
+    order[i] = pageNos[random() % pages];
+  }
+  BufMgr * pool = new BufMgr(frames);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i = 0; i < reads; i++)
+  {
+    Page * page;
+    pool->readPage(blob, order[i], page);
+    pool->unPinPage(blob, order[i], i % 8 == 0);
+  }
+  double ms = elapsedMs(start);
+  BufStats & stats = pool->getBufStats();
+  std::cout << "  " << ms * 1000 / reads << " us per read, " << stats.diskreads << " misses, " << stats.sweeps << " sweeps, "
+            << (double) stats.sweptFrames / std::max(stats.evictions, 1) << " frames swept per eviction, longest sweep "
+            << stats.longestSweep << std::endl;
+  pool->flushFile(blob);
+  delete pool;
+  delete blob;
+  removeIfExists(blobName);
+}
+
+// -----------------------------------------------------------------------------
+// benchRingScan
+// -----------------------------------------------------------------------------
+
+void benchRingScan()
+{
+  const std::uint32_t frames = 4096;
+  const int hotPages = 2048;
+  const int scanPages = 32768;
+  std::cout << "Sequential scan of " << scanPages << " pages between two reads of " << hotPages
+            << " hot pages, through a pool of " << frames << " frames, with and without a ring" << std::endl;
+  const std::string blobName = benchRelationName + ".ring";
+  removeIfExists(blobName);
+  BlobFile * blob = new BlobFile(blobName, true);
+  const PageId first = blob->allocatePageRange(hotPages + scanPages);
+  {
+    Page page;
+    for(int i = 0; i < hotPages + scanPages; i++)
+    {
+      blob->writePage(first + i, page);
+    }
+  }
+  for(int withRing = 0; withRing < 2; withRing++)
+  {
+    BufMgr * pool = new BufMgr(frames);
+    BufferAccessStrategy * strategy = withRing ? new BufferAccessStrategy() : NULL;
+    for(int i = 0; i < hotPages; i++)
+    {
+      Page * page;
+      pool->readPage(blob, first + i, page);
+      pool->unPinPage(blob, first + i, false);
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = hotPages; i < hotPages + scanPages; i++)
+    {
+      Page * page;
+      pool->readPage(blob, first + i, page, strategy);
+      pool->unPinPage(blob, first + i, false);
+    }
+    double ms = elapsedMs(start);
+    const int before = pool->getBufStats().diskreads;
+    for(int i = 0; i < hotPages; i++)
+    {
+      Page * page;
+      pool->readPage(blob, first + i, page);
+      pool->unPinPage(blob, first + i, false);
+    }
+    const int misses = pool->getBufStats().diskreads - before;
+    std::cout << "  " << (withRing ? "ring:    " : "no ring: ") << ms << " ms scan, " << misses << " of " << hotPages
+              << " hot pages read again" << std::endl;
+    delete strategy;
+    pool->flushFile(blob);
+    delete pool;
+  }
+  delete blob;
+  removeIfExists(blobName);
+}
+
+// -----------------------------------------------------------------------------
+// benchResize
+// -----------------------------------------------------------------------------
+
+void benchResize()
+{
+  const std::uint32_t frames = 65536;
+  const int pages = 65536;
+  const int reads = 200000;
+  std::cout << "Resizes of a pool holding " << pages << " pages between " << frames / 16 << " and " << frames
+            << " frames, and " << reads << " random reads after each" << std::endl;
+  const std::string blobName = benchRelationName + ".resize";
+  removeIfExists(blobName);
+  BlobFile * blob = new BlobFile(blobName, true);
+  const PageId first = blob->allocatePageRange(pages);
+  {
+    Page page;
+    for(int i = 0; i < pages; i++)
+    {
+      blob->writePage(first + i, page);
+    }
+  }
+  srandom(15);
+  std::vector<PageId> order(reads);
+  for(int i = 0; i < reads; i++)
+  {
+    order[i] = first + random() % pages;
+  }
+  PoolOptions poolOptions;
+  poolOptions.maxFrames = frames;
+  BufMgr * pool = new BufMgr(frames / 16, IOOptions(), poolOptions);
+  const std::uint32_t sizes[] = {frames, frames / 16, frames};
+  for(int s = 0; s < 3; s++)
+  {
+    // every frame holds a page before the resize
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(blob, first + i, page);
+      pool->unPinPage(blob, first + i, false);
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pool->resize(sizes[s]);
+    double resizeMs = elapsedMs(start);
+    const int before = pool->getBufStats().diskreads;
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < reads; i++)
+    {
+      Page * page;
+      pool->readPage(blob, order[i], page);
+      pool->unPinPage(blob, order[i], false);
+    }
+    double ms = elapsedMs(start);
+    std::cout << "  to " << sizes[s] << " frames: " << resizeMs << " ms resize, " << ms * 1000 / reads
+              << " us per read, " << pool->getBufStats().diskreads - before << " misses" << std::endl;
+  }
+  pool->flushFile(blob);
+  delete pool;
+  delete blob;
+  removeIfExists(blobName);
+}
@@ -0,0 +1,643 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "betree.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+// order the messages by key only, the keys are assumed to be unique
+static bool messageKeyLess(const BeMessage & m1, const BeMessage & m2)
+{
+    return m1.key < m2.key;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::BeTreeIndex -- Constructor
+// -----------------------------------------------------------------------------
+/**
+ * Constructor
+ *
+ * Same as the constructor of BTreeIndex, except that the index file name ends
+ * with ".be", so that both kinds of index can exist for the same attribute.
+ * A new tree starts out as a non-leaf root with an empty buffer above one
+ * empty leaf.
+ *
+ * @param relationName The name of the relation on which to build the index.
+ * @param outIndexName The name of the index file
+ * @param bufMgrIn The instance of the global buffer manager.
+ * @param attrByteOffset The byte offset of the attribute in the tuple on which to build the index.
+ * @param attrType The data type of the attribute we are indexing.
+ */
+BeTreeIndex::BeTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+    this -> bufMgr = bufMgrIn;
+    this -> attributeType = attrType;
+    this -> attrByteOffset = attrByteOffset;
+    // as in BTreeIndex, only integer keys are supported for now
+    this -> leafOccupancy = INTARRAYLEAFSIZE;
+
+    // initialize all the variables for the scanning
+    this -> scanExecuting = false;
+    this -> currentPageNum = Page::INVALID_NUMBER;
+    this -> currentPageData = NULL;
+    this -> nextEntry = -1;
+    this -> nextPending = 0;
+    this -> lowValInt = -1;
+    this -> highValInt = -1;
+    this -> lowOp = (Operator)-1;
+    this -> highOp = (Operator)-1;
+
+    // find the index file name
+    std::ostringstream idxStr;
+    idxStr << relationName << '.' << attrByteOffset << ".be";
+    std::string indexName = idxStr.str();
+    outIndexName = indexName;
+
+    // check if the index file is already existing or not
+    if(File::exists(indexName)){
+        this -> file = (File *) new BlobFile(outIndexName, false);
+        PageId metaPageId = 1;
+        Page * metaPage;
+        this -> bufMgr -> readPage(this -> file, metaPageId, metaPage);
+        IndexMetaInfo * metaInfo = (IndexMetaInfo *) metaPage;
+        // check the attribute in the meta page
+        if(!(metaInfo -> relationName == relationName
+           && metaInfo -> attrByteOffset == attrByteOffset
+           && metaInfo -> attrType == attrType)){
+            this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+            throw BadIndexInfoException("Index file exists but values in metapage not match.");
+        }
+        this -> headerPageNum = metaPageId;
+        this -> rootPageNum = metaInfo -> rootPageNo;
+        this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+        return;
+    }
+
+    this -> file = (File *) new BlobFile(outIndexName, true);
+    // create the metadata page
+    PageId metaPageId;
+    Page * metaPage;
+    this -> bufMgr -> allocPage(this -> file, metaPageId, metaPage);
+    IndexMetaInfo * metaInfo = (IndexMetaInfo *) metaPage;
+    strcpy(metaInfo -> relationName, relationName.c_str());
+    metaInfo -> attrByteOffset = attrByteOffset;
+    metaInfo -> attrType = attrType;
+    this -> headerPageNum = metaPageId;
+
+    // create the first leaf
+    PageId leafPageId;
+    Page * leafPage;
+    this -> bufMgr -> allocPage(this -> file, leafPageId, leafPage);
+    ((LeafNodeInt *) leafPage) -> slotTaken = 0;
+    ((LeafNodeInt *) leafPage) -> rightSibPageNo = Page::INVALID_NUMBER;
+    this -> bufMgr -> unPinPage(this -> file, leafPageId, true);
+
+    // create the root on top of it, unlike in BTreeIndex the root is never a
+    // leaf, since the inserts have to be buffered somewhere
+    PageId rootPageId;
+    Page * rootPage;
+    this -> bufMgr -> allocPage(this -> file, rootPageId, rootPage);
+    BeNonLeafNodeInt * root = (BeNonLeafNodeInt *) rootPage;
+    root -> level = 1;
+    root -> slotTaken = 0;
+    root -> messageCount = 0;
+    root -> pageNoArray[0] = leafPageId;
+    this -> bufMgr -> unPinPage(this -> file, rootPageId, true);
+
+    metaInfo -> rootPageNo = rootPageId;
+    this -> rootPageNum = rootPageId;
+    this -> bufMgr -> unPinPage(this -> file, metaPageId, true);
+
+    // scan the relation and insert into the index file
+    FileScan * fileScan = new FileScan(relationName, bufMgrIn);
+    try
+    {
+        RecordId scanRid;
+        while(1)
+        {
+            fileScan -> scanNext(scanRid);
+            std::string recordStr = fileScan -> getRecord();
+            const char *record = recordStr.c_str();
+            int key = *((int *)(record + attrByteOffset));
+            this -> insertEntry(&key, scanRid);
+        }
+    }
+    catch(EndOfFileException e)
+    {
+        // this case means reaching the end of the relation file.
+    }
+    delete fileScan;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::~BeTreeIndex -- destructor
+// -----------------------------------------------------------------------------
+/**
+ * Destructor
+ * End the scan, if any, and flush the index file. The messages still in the
+ * buffers are part of the index file, so nothing has to be pushed down here.
+ */
+BeTreeIndex::~BeTreeIndex()
+{
+    if(this -> scanExecuting) this -> endScan();
+    this -> bufMgr -> flushFile(this -> file);
+    delete this -> file;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+/**
+ * Insert a new entry using the pair <value,rid>.
+ * In the common case this only appends a message to the root page, which
+ * stays in the buffer pool. Only a full root buffer starts a flush.
+ * @param key			A pointer to the value(integer we want to insert)
+ * @param rid			The corresponding record id of the tuple in the base relation
+ **/
+const void BeTreeIndex::insertEntry(const void *key, const RecordId rid)
+{
+    Page * rootPage;
+    this -> bufMgr -> readPage(this -> file, this -> rootPageNum, rootPage);
+    BeNonLeafNodeInt * root = (BeNonLeafNodeInt *) rootPage;
+    if(root -> messageCount < BEBUFFERSIZE){
+        root -> messageArray[root -> messageCount].key = *((int *) key);
+        root -> messageArray[root -> messageCount].rid = rid;
+        root -> messageCount++;
+        this -> bufMgr -> unPinPage(this -> file, this -> rootPageNum, true);
+        return;
+    }
+    this -> bufMgr -> unPinPage(this -> file, this -> rootPageNum, false);
+
+    // the root buffer is full, push the messages down in memory
+    BeNode node;
+    this -> loadNode(this -> rootPageNum, node);
+    BeMessage message;
+    message.key = *((int *) key);
+    message.rid = rid;
+    node.messages.push_back(message);
+    std::vector< PageKeyPair<int> > newSiblings;
+    this -> flushNode(this -> rootPageNum, node, newSiblings);
+    this -> growRoot(newSiblings);
+}
+
+/**
+ * Read a non-leaf node into memory.
+ * @param pid: the page id of the non-leaf node
+ * @param node: returns the in memory copy of the node
+ */
+const void BeTreeIndex::loadNode(const PageId pid, BeNode & node){
+    Page * page;
+    this -> bufMgr -> readPage(this -> file, pid, page);
+    BeNonLeafNodeInt * pageNode = (BeNonLeafNodeInt *) page;
+    node.level = pageNode -> level;
+    node.keys.assign(pageNode -> keyArray, pageNode -> keyArray + pageNode -> slotTaken);
+    node.children.assign(pageNode -> pageNoArray, pageNode -> pageNoArray + pageNode -> slotTaken + 1);
+    node.messages.assign(pageNode -> messageArray, pageNode -> messageArray + pageNode -> messageCount);
+    this -> bufMgr -> unPinPage(this -> file, pid, false);
+}
+
+/**
+ * Write an in memory non-leaf node back into its page. A node holding more
+ * than BEPIVOTSIZE pivots is cut into as few parts as possible, with the
+ * children spread evenly. The first part stays in the page of the node, the
+ * others go into new pages, and each takes the messages of its key range.
+ * The caller has to make sure the node holds at most BEBUFFERSIZE messages.
+ * @param pid: the page id of the non-leaf node
+ * @param node: the in memory node
+ * @param newSiblings: returns the (separator key, page id) pairs of the new right siblings, if the node was split
+ */
+const void BeTreeIndex::storeNode(const PageId pid, BeNode & node, std::vector< PageKeyPair<int> > & newSiblings){
+    int numChildren = node.children.size();
+    int parts = (numChildren + BEPIVOTSIZE) / (BEPIVOTSIZE + 1);
+    if(parts > 1){
+        // the messages are partitioned by key range below
+        std::stable_sort(node.messages.begin(), node.messages.end(), messageKeyLess);
+    }
+    std::size_t firstMessage = 0;
+    for(int part = 0; part < parts; part++){
+        int firstChild = (long) numChildren * part / parts;
+        int lastChild = (long) numChildren * (part + 1) / parts;
+        std::size_t lastMessage = node.messages.size();
+        if(part < parts - 1){
+            lastMessage = firstMessage;
+            while(lastMessage < node.messages.size() && node.messages[lastMessage].key < node.keys[lastChild - 1]){
+                lastMessage++;
+            }
+        }
+
+        PageId partPageId = pid;
+        Page * page;
+        if(part == 0){
+            this -> bufMgr -> readPage(this -> file, pid, page);
+        }
+        else{
+            this -> bufMgr -> allocPage(this -> file, partPageId, page);
+            PageKeyPair<int> sibling;
+            sibling.set(partPageId, node.keys[firstChild - 1]);
+            newSiblings.push_back(sibling);
+        }
+        BeNonLeafNodeInt * pageNode = (BeNonLeafNodeInt *) page;
+        pageNode -> level = node.level;
+        pageNode -> slotTaken = lastChild - firstChild - 1;
+        std::copy(node.keys.begin() + firstChild, node.keys.begin() + lastChild - 1, pageNode -> keyArray);
+        std::copy(node.children.begin() + firstChild, node.children.begin() + lastChild, pageNode -> pageNoArray);
+        pageNode -> messageCount = lastMessage - firstMessage;
+        std::copy(node.messages.begin() + firstMessage, node.messages.begin() + lastMessage, pageNode -> messageArray);
+        this -> bufMgr -> unPinPage(this -> file, partPageId, true);
+        firstMessage = lastMessage;
+    }
+}
+
+/**
+ * Push the messages of a full non-leaf node down to its children, until the
+ * buffer of the node is at most half full. Each round moves the largest batch
+ * of messages going to the same child, so every page touched below takes as
+ * many messages as possible. New children coming from splits below are hooked
+ * in right after the child that was split.
+ * @param pid: the page id of the non-leaf node
+ * @param node: the in memory node holding the full buffer
+ * @param newSiblings: returns the (separator key, page id) pairs of the new right siblings, if the node was split
+ */
+const void BeTreeIndex::flushNode(const PageId pid, BeNode & node, std::vector< PageKeyPair<int> > & newSiblings){
+    // with the messages sorted, each batch is a contiguous range
+    std::stable_sort(node.messages.begin(), node.messages.end(), messageKeyLess);
+    while(node.messages.size() > (std::size_t) BEBUFFERSIZE / 2){
+        // find the child with the largest batch
+        std::size_t bestChild = 0;
+        std::size_t bestBegin = 0;
+        std::size_t bestEnd = 0;
+        std::size_t begin = 0;
+        for(std::size_t child = 0; child < node.children.size(); child++){
+            std::size_t end = begin;
+            while(end < node.messages.size() && (child == node.keys.size() || node.messages[end].key < node.keys[child])){
+                end++;
+            }
+            if(end - begin > bestEnd - bestBegin){
+                bestChild = child;
+                bestBegin = begin;
+                bestEnd = end;
+            }
+            begin = end;
+        }
+        std::vector<BeMessage> batch(node.messages.begin() + bestBegin, node.messages.begin() + bestEnd);
+        node.messages.erase(node.messages.begin() + bestBegin, node.messages.begin() + bestEnd);
+
+        PageId childPageId = node.children[bestChild];
+        std::vector< PageKeyPair<int> > childSiblings;
+        if(node.level == 1){
+            this -> applyToLeaf(childPageId, batch, childSiblings);
+        }
+        else{
+            BeNode child;
+            this -> loadNode(childPageId, child);
+            child.messages.insert(child.messages.end(), batch.begin(), batch.end());
+            if(child.messages.size() > (std::size_t) BEBUFFERSIZE){
+                this -> flushNode(childPageId, child, childSiblings);
+            }
+            else{
+                this -> storeNode(childPageId, child, childSiblings);
+            }
+        }
+        for(std::size_t i = 0; i < childSiblings.size(); i++){
+            node.keys.insert(node.keys.begin() + bestChild + i, childSiblings[i].key);
+            node.children.insert(node.children.begin() + bestChild + 1 + i, childSiblings[i].pageNo);
+        }
+    }
+    this -> storeNode(pid, node, newSiblings);
+}
+
+/**
+ * Apply a batch of messages sorted by key to a leaf node. If the result does
+ * not fit, the entries are spread evenly over leaves filled to about three
+ * quarters, so that the next batches for this key range fit in again.
+ * @param pid: the page id of the leaf node
+ * @param batch: the messages sorted by key
+ * @param newSiblings: returns the (separator key, page id) pairs of the new right siblings, if the leaf node was split
+ */
+const void BeTreeIndex::applyToLeaf(const PageId pid, const std::vector<BeMessage> & batch, std::vector< PageKeyPair<int> > & newSiblings){
+    Page * page;
+    this -> bufMgr -> readPage(this -> file, pid, page);
+    LeafNodeInt * leaf = (LeafNodeInt *) page;
+    int oldCount = leaf -> slotTaken;
+    int total = oldCount + batch.size();
+
+    if(total <= this -> leafOccupancy){
+        // merge from the back, so that no entry is overwritten before it moved
+        int i = oldCount - 1;
+        int j = batch.size() - 1;
+        for(int k = total - 1; j >= 0; k--){
+            if(i >= 0 && leaf -> keyArray[i] > batch[j].key){
+                leaf -> keyArray[k] = leaf -> keyArray[i];
+                leaf -> ridArray[k] = leaf -> ridArray[i];
+                i--;
+            }
+            else{
+                leaf -> keyArray[k] = batch[j].key;
+                leaf -> ridArray[k] = batch[j].rid;
+                j--;
+            }
+        }
+        leaf -> slotTaken = total;
+        this -> bufMgr -> unPinPage(this -> file, pid, true);
+        return;
+    }
+
+    std::vector<int> keys(total);
+    std::vector<RecordId> rids(total);
+    int i = 0;
+    std::size_t j = 0;
+    for(int k = 0; k < total; k++){
+        if(j == batch.size() || (i < oldCount && leaf -> keyArray[i] < batch[j].key)){
+            keys[k] = leaf -> keyArray[i];
+            rids[k] = leaf -> ridArray[i];
+            i++;
+        }
+        else{
+            keys[k] = batch[j].key;
+            rids[k] = batch[j].rid;
+            j++;
+        }
+    }
+
+    int fill = this -> leafOccupancy * 3 / 4;
+    int parts = (total + fill - 1) / fill;
+    PageId lastRightSib = leaf -> rightSibPageNo;
+    PageId partPageId = pid;
+    for(int part = 0; part < parts; part++){
+        int begin = (long) total * part / parts;
+        int end = (long) total * (part + 1) / parts;
+        // allocate the next leaf first, so that this one can link to it
+        PageId nextPageId = lastRightSib;
+        Page * nextPage = NULL;
+        if(part < parts - 1){
+            this -> bufMgr -> allocPage(this -> file, nextPageId, nextPage);
+            PageKeyPair<int> sibling;
+            sibling.set(nextPageId, keys[end]);
+            newSiblings.push_back(sibling);
+        }
+        leaf -> slotTaken = end - begin;
+        std::copy(keys.begin() + begin, keys.begin() + end, leaf -> keyArray);
+        std::copy(rids.begin() + begin, rids.begin() + end, leaf -> ridArray);
+        leaf -> rightSibPageNo = nextPageId;
+        this -> bufMgr -> unPinPage(this -> file, partPageId, true);
+        partPageId = nextPageId;
+        leaf = (LeafNodeInt *) nextPage;
+    }
+}
+
+/**
+ * Put new root nodes on top of the root as long as it keeps splitting up,
+ * and record the final root in the meta page.
+ * @param newSiblings: the (separator key, page id) pairs of the new right siblings of the root
+ */
+const void BeTreeIndex::growRoot(std::vector< PageKeyPair<int> > & newSiblings){
+    if(newSiblings.empty()){
+        return;
+    }
+    while(!newSiblings.empty()){
+        BeNode root;
+        // the children of the new root are the old root and its siblings,
+        // which are never leaves
+        root.level = 0;
+        root.children.push_back(this -> rootPageNum);
+        for(std::size_t i = 0; i < newSiblings.size(); i++){
+            root.keys.push_back(newSiblings[i].key);
+            root.children.push_back(newSiblings[i].pageNo);
+        }
+        newSiblings.clear();
+        PageId newRootPageId;
+        Page * newRootPage;
+        this -> bufMgr -> allocPage(this -> file, newRootPageId, newRootPage);
+        this -> bufMgr -> unPinPage(this -> file, newRootPageId, true);
+        this -> storeNode(newRootPageId, root, newSiblings);
+        this -> rootPageNum = newRootPageId;
+    }
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    ((IndexMetaInfo *) metaPage) -> rootPageNo = this -> rootPageNum;
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::startScan
+// -----------------------------------------------------------------------------
+/**
+ * Begin a filtered scan of the index, with the same arguments and exceptions
+ * as BTreeIndex::startScan.
+ *
+ * The messages of the scan range still sitting in the buffers are collected
+ * from every non-leaf node whose key range overlaps with the scan range, and
+ * sorted. The leaf cursor is put on the first leaf entry satisfying the low
+ * bound. scanNext then merges both.
+ *
+ * @param lowValParm The low value to be tested.
+ * @param lowOpParm The operation to be used in testing the low range.
+ * @param highValParm The high value to be tested.
+ * @param highOpParm The operation to be used in testing the high range.
+ */
+const void BeTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+    if(lowOpParm != GT && lowOpParm != GTE){
+        throw BadOpcodesException();
+    }
+    if(highOpParm != LT && highOpParm != LTE){
+        throw BadOpcodesException();
+    }
+    // If another scan is already executing, that needs to be ended here.
+    if(this -> scanExecuting == true){
+        this -> endScan();
+    }
+    this -> lowValInt = *((int*) lowValParm);
+    this -> highValInt = *((int*) highValParm);
+    if(this -> lowValInt > this -> highValInt){
+        throw BadScanrangeException();
+    }
+    this -> lowOp = lowOpParm;
+    this -> highOp = highOpParm;
+    this -> scanExecuting = true;
+
+    this -> pendingEntries.clear();
+    this -> nextPending = 0;
+    this -> collectPending(this -> rootPageNum);
+    std::sort(this -> pendingEntries.begin(), this -> pendingEntries.end(), messageKeyLess);
+
+    // descend to the leaf which would hold the low value
+    PageId pid = this -> rootPageNum;
+    while(1){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, pid, page);
+        BeNonLeafNodeInt * node = (BeNonLeafNodeInt *) page;
+        int index = std::upper_bound(node -> keyArray, node -> keyArray + node -> slotTaken, this -> lowValInt) - node -> keyArray;
+        PageId child = node -> pageNoArray[index];
+        int level = node -> level;
+        this -> bufMgr -> unPinPage(this -> file, pid, false);
+        pid = child;
+        if(level == 1){
+            break;
+        }
+    }
+    this -> currentPageNum = pid;
+    this -> bufMgr -> readPage(this -> file, pid, this -> currentPageData);
+    this -> nextEntry = -1;
+    this -> advanceLeafCursor();
+    while(this -> currentPageNum != Page::INVALID_NUMBER
+          && !this -> satisfiesLow(((LeafNodeInt *) this -> currentPageData) -> keyArray[this -> nextEntry])){
+        this -> advanceLeafCursor();
+    }
+
+    if(this -> currentPageNum == Page::INVALID_NUMBER && this -> pendingEntries.empty()){
+        this -> endScan();
+        throw NoSuchKeyFoundException();
+    }
+}
+
+/**
+ * Collect the buffered messages satisfying the scan criteria from a non-leaf
+ * node and the non-leaf nodes below it whose key range overlaps with the scan
+ * range. The page is unpinned before going down, so at most one page is pinned.
+ * @param pid: the page id of the non-leaf node
+ */
+const void BeTreeIndex::collectPending(const PageId pid){
+    Page * page;
+    this -> bufMgr -> readPage(this -> file, pid, page);
+    BeNonLeafNodeInt * node = (BeNonLeafNodeInt *) page;
+    for(int i = 0; i < node -> messageCount; i++){
+        int key = node -> messageArray[i].key;
+        if(this -> satisfiesLow(key) && this -> satisfiesHigh(key)){
+            this -> pendingEntries.push_back(node -> messageArray[i]);
+        }
+    }
+    std::vector<PageId> overlapping;
+    if(node -> level == 0){
+        // child i holds the keys in [keyArray[i - 1], keyArray[i])
+        for(int i = 0; i <= node -> slotTaken; i++){
+            if((i == node -> slotTaken || node -> keyArray[i] > this -> lowValInt)
+               && (i == 0 || node -> keyArray[i - 1] <= this -> highValInt)){
+                overlapping.push_back(node -> pageNoArray[i]);
+            }
+        }
+    }
+    this -> bufMgr -> unPinPage(this -> file, pid, false);
+    for(std::size_t i = 0; i < overlapping.size(); i++){
+        this -> collectPending(overlapping[i]);
+    }
+}
+
+bool BeTreeIndex::satisfiesLow(const int key) const{
+    return this -> lowOp == GT ? key > this -> lowValInt : key >= this -> lowValInt;
+}
+
+bool BeTreeIndex::satisfiesHigh(const int key) const{
+    return this -> highOp == LT ? key < this -> highValInt : key <= this -> highValInt;
+}
+
+/**
+ * Move the leaf cursor to the next entry, skipping over empty leaves. The
+ * current leaf is unpinned when the cursor leaves it. The cursor is dropped
+ * once the leaves are used up or its key no longer satisfies the high bound.
+ */
+const void BeTreeIndex::advanceLeafCursor(){
+    this -> nextEntry++;
+    LeafNodeInt * leaf = (LeafNodeInt *) this -> currentPageData;
+    while(this -> nextEntry >= leaf -> slotTaken){
+        PageId rightSibPageNo = leaf -> rightSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        this -> currentPageNum = rightSibPageNo;
+        this -> currentPageData = NULL;
+        this -> nextEntry = 0;
+        if(rightSibPageNo == Page::INVALID_NUMBER){
+            return;
+        }
+        this -> bufMgr -> readPage(this -> file, rightSibPageNo, this -> currentPageData);
+        leaf = (LeafNodeInt *) this -> currentPageData;
+    }
+    if(!this -> satisfiesHigh(leaf -> keyArray[this -> nextEntry])){
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        this -> currentPageNum = Page::INVALID_NUMBER;
+        this -> currentPageData = NULL;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+/**
+ * Fetch the record id of the next index entry that matches the scan, taking
+ * the smaller key of the leaf cursor and the collected messages.
+ * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+ * @throws ScanNotInitializedException If no scan has been initialized.
+ * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+ */
+const void BeTreeIndex::scanNext(RecordId& outRid)
+{
+    if(this -> scanExecuting == false){
+        throw ScanNotInitializedException();
+    }
+    bool leafLeft = this -> currentPageNum != Page::INVALID_NUMBER;
+    bool pendingLeft = this -> nextPending < this -> pendingEntries.size();
+    if(!leafLeft && !pendingLeft){
+        throw IndexScanCompletedException();
+    }
+    if(leafLeft){
+        LeafNodeInt * leaf = (LeafNodeInt *) this -> currentPageData;
+        if(!pendingLeft || leaf -> keyArray[this -> nextEntry] < this -> pendingEntries[this -> nextPending].key){
+            outRid = leaf -> ridArray[this -> nextEntry];
+            this -> advanceLeafCursor();
+            return;
+        }
+    }
+    outRid = this -> pendingEntries[this -> nextPending].rid;
+    this -> nextPending++;
+}
+
+// -----------------------------------------------------------------------------
+// BeTreeIndex::endScan
+// -----------------------------------------------------------------------------
+/**
+ * This method terminates the current scan and unpins the leaf page still
+ * pinned by the scan.
+ * It throws ScanNotInitializedException when called before a successful
+ * startScan call.
+ */
+const void BeTreeIndex::endScan()
+{
+    if(this -> scanExecuting == false){
+        throw ScanNotInitializedException();
+    }
+    if(this -> currentPageNum != Page::INVALID_NUMBER){
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+    }
+    this -> scanExecuting = false;
+    this -> currentPageNum = Page::INVALID_NUMBER;
+    this -> currentPageData = NULL;
+    this -> nextEntry = -1;
+    this -> pendingEntries.clear();
+    this -> nextPending = 0;
+    this -> lowValInt = -1;
+    this -> highValInt = -1;
+    this -> lowOp = (Operator)-1;
+    this -> highOp = (Operator)-1;
+}
+
+}
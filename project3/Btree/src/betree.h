@@ -0,0 +1,337 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief A pending insert stored in the message buffer of a non-leaf node of the B-epsilon tree.
+*/
+struct BeMessage{
+  /**
+   * Key to insert.
+   */
+	int key;
+
+  /**
+   * RecordId to insert with the key.
+   */
+	RecordId rid;
+};
+
+/**
+ * @brief Maximum number of pivot keys in a B-epsilon tree non-leaf node for INTEGER key.
+ * The fanout is kept far below the one of NonLeafNodeInt, so that most of the page is left for the message buffer.
+ */
+const int BEPIVOTSIZE = 64;
+
+/**
+ * @brief Number of messages the buffer of a B-epsilon tree non-leaf node for INTEGER key can hold.
+ */
+//                                          level, slotTaken, messageCount        key                        pageNo
+const int BEBUFFERSIZE = ( Page::SIZE - 3 * sizeof( int ) - BEPIVOTSIZE * sizeof( int ) - ( BEPIVOTSIZE + 1 ) * sizeof( PageId ) ) / sizeof( BeMessage );
+
+/**
+ * @brief Structure for all non-leaf nodes of the B-epsilon tree when the key is of INTEGER type.
+ * The leaf nodes use the same LeafNodeInt structure as BTreeIndex.
+*/
+struct BeNonLeafNodeInt{
+  /**
+   * Level of the node in the tree. As in NonLeafNodeInt, 1 if the children are leaf nodes, otherwise 0.
+   */
+	int level;
+
+  /**
+   * Number of pivot keys taken up in the node.
+   */
+	int slotTaken;
+
+  /**
+   * Number of messages waiting in the buffer of the node.
+   */
+	int messageCount;
+
+  /**
+   * Stores pivot keys.
+   */
+	int keyArray[ BEPIVOTSIZE ];
+
+  /**
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   */
+	PageId pageNoArray[ BEPIVOTSIZE + 1 ];
+
+  /**
+   * Stores the messages not pushed down to the children yet, in the order they arrived.
+   */
+	BeMessage messageArray[ BEBUFFERSIZE ];
+};
+
+/**
+ * @brief In memory copy of a B-epsilon tree non-leaf node. Flushing works on these, since a node may
+ * temporarily hold more pivots or messages than fit into a page before it gets split.
+*/
+struct BeNode{
+  /**
+   * Level of the node in the tree.
+   */
+	int level;
+
+  /**
+   * Pivot keys.
+   */
+	std::vector<int> keys;
+
+  /**
+   * Page numbers of the children, one more than the pivot keys.
+   */
+	std::vector<PageId> children;
+
+  /**
+   * Messages waiting in the buffer of the node.
+   */
+	std::vector<BeMessage> messages;
+};
+
+
+/**
+ * @brief BeTreeIndex class. It implements a write optimized B-epsilon tree index on a single attribute of a
+ * relation, on the same BlobFile and BufMgr substrate as BTreeIndex. Inserts are appended to the message buffer
+ * of the root and pushed down in batches, one child at a time, whenever a buffer fills up. Thus, random inserts
+ * dirty a few pages per batch instead of one random leaf each. Scans merge the leaves with the messages still
+ * buffered on the way to them, which makes them slightly more expensive than the ones of BTreeIndex.
+ * The scan interface is the same as the one of BTreeIndex. This index supports only one scan at a time.
+*/
+class BeTreeIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Page number of root page of the tree inside index file. The root is always a non-leaf node.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records.
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Number of keys in leaf node.
+   */
+	int			leafOccupancy;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Page number of current leaf page being scanned, INVALID_NUMBER once the leaves are used up.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current leaf page being scanned. It stays pinned until the scan moves on or ends.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Index of next entry to be scanned in current leaf page.
+   */
+	int			nextEntry;
+
+  /**
+   * Messages satisfying the scan criteria which are still buffered in non-leaf nodes, sorted by key.
+   */
+	std::vector<BeMessage> pendingEntries;
+
+  /**
+   * Index of next entry to be scanned in pendingEntries.
+   */
+	std::size_t	nextPending;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+    /**
+     * Read a non-leaf node into memory.
+     * @param pid: the page id of the non-leaf node
+     * @param node: returns the in memory copy of the node
+     */
+    const void loadNode(const PageId pid, BeNode & node);
+
+    /**
+     * Write an in memory non-leaf node back into its page. If the node holds more pivots than fit into a page,
+     * it is split up and the parts on the right are written into new pages.
+     * @param pid: the page id of the non-leaf node
+     * @param node: the in memory node
+     * @param newSiblings: returns the (separator key, page id) pairs of the new right siblings, if the node was split
+     */
+    const void storeNode(const PageId pid, BeNode & node, std::vector< PageKeyPair<int> > & newSiblings);
+
+    /**
+     * Push the messages of a full non-leaf node down to its children, largest batch first,
+     * until the buffer of the node is at most half full. The node is written back, split up if needed.
+     * @param pid: the page id of the non-leaf node
+     * @param node: the in memory node holding the full buffer
+     * @param newSiblings: returns the (separator key, page id) pairs of the new right siblings, if the node was split
+     */
+    const void flushNode(const PageId pid, BeNode & node, std::vector< PageKeyPair<int> > & newSiblings);
+
+    /**
+     * Apply a batch of messages sorted by key to a leaf node. The leaf node is split up into as many leaf nodes as needed.
+     * @param pid: the page id of the leaf node
+     * @param batch: the messages sorted by key
+     * @param newSiblings: returns the (separator key, page id) pairs of the new right siblings, if the leaf node was split
+     */
+    const void applyToLeaf(const PageId pid, const std::vector<BeMessage> & batch, std::vector< PageKeyPair<int> > & newSiblings);
+
+    /**
+     * Put new root nodes on top of the root as long as it keeps splitting up.
+     * @param newSiblings: the (separator key, page id) pairs of the new right siblings of the root
+     */
+    const void growRoot(std::vector< PageKeyPair<int> > & newSiblings);
+
+    /**
+     * Collect the buffered messages satisfying the scan criteria from a non-leaf node and the non-leaf nodes below it
+     * whose key range overlaps with the scan range.
+     * @param pid: the page id of the non-leaf node
+     */
+    const void collectPending(const PageId pid);
+
+    /**
+     * Check whether a key satisfies the low bound of the scan.
+     */
+    bool satisfiesLow(const int key) const;
+
+    /**
+     * Check whether a key satisfies the high bound of the scan.
+     */
+    bool satisfiesHigh(const int key) const;
+
+    /**
+     * Move the leaf cursor to the next entry of the leaves, following the right siblings.
+     * Sets currentPageNum to INVALID_NUMBER when the leaves are used up or the high bound is passed.
+     */
+    const void advanceLeafCursor();
+
+ public:
+
+  /**
+   * BeTreeIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   */
+	BeTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+
+  /**
+   * BeTreeIndex Destructor.
+	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * and delete file instance thereby closing the index file. Buffered messages stay in the index file.
+	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
+	 * */
+	~BeTreeIndex();
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+	 * The entry is appended to the message buffer of the root. If the buffer is full, the largest batches of
+	 * messages are pushed down one level, which may in turn fill up the buffers below or split leaf and non-leaf nodes.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Begin a filtered scan of the index. Same as BTreeIndex::startScan. The buffered messages satisfying
+	 * the scan criteria are collected here, and merged with the leaf entries by scanNext.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  NoSuchKeyFoundException If there is no key in the tree that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan, in key order.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+}
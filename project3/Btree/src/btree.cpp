@@ -5,6 +5,8 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <thread>
+#include <cmath>
 #include "btree.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
@@ -16,6 +18,7 @@
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/end_of_file_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/read_only_file_exception.h"
 
 //#define DEBUG
 
@@ -40,12 +43,14 @@ namespace badgerdb
  * @param bufMgrIn The instance of the global buffer manager.
  * @param attrByteOffset The byte offset of the attribute in the tuple on which to build the index.
  * @param attrType The data type of the attribute we are indexing.
+ * @param options The options for building a new index file.
  */
 BTreeIndex::BTreeIndex(const std::string & relationName,
 		std::string & outIndexName,
 		BufMgr *bufMgrIn,
 		const int attrByteOffset,
-		const Datatype attrType)
+		const Datatype attrType,
+		const IndexOptions & options)
 {
     this -> bufMgr = bufMgrIn;
     this -> attributeType = attrType;
@@ -56,17 +61,17 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
     // INTARRAYNONLEAFSIZE from the btree.h
     switch(attrType){
         case INTEGER:
-            this -> nodeOccupancy = (Page::SIZE - sizeof(int) - sizeof(PageId)) / (sizeof(int) + sizeof(PageId));
-            this -> leafOccupancy = (Page::SIZE - sizeof(PageId)) / (sizeof(int) + sizeof(RecordId));
+            this -> nodeOccupancy = (Page::SIZE - 2 * sizeof(int) - sizeof(PageId) - sizeof(int)) / (sizeof(int) + sizeof(PageId) + sizeof(int));
+            this -> leafOccupancy = (Page::SIZE - sizeof(int) - 2 * sizeof(PageId)) / (sizeof(int) + sizeof(RecordId));
             break;
         case DOUBLE:
-            this -> nodeOccupancy = (Page::SIZE - sizeof(double) - sizeof(PageId)) / (sizeof(double) + sizeof(PageId));
-            this -> leafOccupancy = (Page::SIZE - sizeof(PageId)) / (sizeof(double) + sizeof(RecordId));
+            this -> nodeOccupancy = (Page::SIZE - 2 * sizeof(int) - sizeof(PageId) - sizeof(int)) / (sizeof(double) + sizeof(PageId) + sizeof(int));
+            this -> leafOccupancy = (Page::SIZE - sizeof(int) - 2 * sizeof(PageId)) / (sizeof(double) + sizeof(RecordId));
             break;
         case STRING:
             // the size of string record is provided in the instruction file
-            this -> nodeOccupancy = (Page::SIZE - sizeof(char[64]) - sizeof(PageId)) / (sizeof(char[64]) + sizeof(PageId));
-            this -> leafOccupancy = (Page::SIZE - sizeof(PageId)) / (sizeof(char[64]) + sizeof(RecordId));
+            this -> nodeOccupancy = (Page::SIZE - 2 * sizeof(int) - sizeof(PageId) - sizeof(int)) / (sizeof(char[64]) + sizeof(PageId) + sizeof(int));
+            this -> leafOccupancy = (Page::SIZE - sizeof(int) - 2 * sizeof(PageId)) / (sizeof(char[64]) + sizeof(RecordId));
             break;
     }
 
@@ -85,10 +90,16 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
     this -> nextEntry = -1;
     this -> currentPageNum = Page::INVALID_NUMBER;
     this -> currentPageData = NULL;
+    this -> scanViewPageNum = Page::INVALID_NUMBER;
+    this -> leafSearch = options.leafSearch;
     // the enum variable usually starts value from 1. Thus, -1 is an
     // invalid value for enum variable
     this -> lowOp = (Operator)-1;
     this -> highOp = (Operator)-1;
+    this -> scanOrder = ASCENDING;
+    this -> multiRangeScan = false;
+    this -> scanRanges.clear();
+    this -> currentRange = -1;
     
     // find the index file name
     std::ostringstream idxStr;
@@ -99,14 +110,29 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
     
     // check if the index file is already existing or not
     if(File::exists(indexName)){
-        BlobFile* newfile = new BlobFile(outIndexName, false);
-        File * file = (File*) newfile;
+        // a mapped index file is only read, and its pages are not copied
+        // into the buffer pool
+        File * file;
+        if(options.mmapIndex){
+            file = (File*) new MmapFile(outIndexName);
+        }
+        else{
+            file = (File*) new BlobFile(outIndexName, false);
+        }
         // check whether the existing file matching with our input info
         // find the meta page, which is specified to be 1
         PageId metaPageId = 1;
         Page * metaPage;
         this -> bufMgr -> readPage(file, metaPageId, metaPage);
         IndexMetaInfo * metaInfo = (IndexMetaInfo *) metaPage;
+        // the other fields of the meta page, and the nodes, are only read
+        // from a file of the layout of this code
+        if(metaInfo -> formatVersion != INDEXFORMATVERSION){
+            this -> bufMgr -> unPinPage(file, metaPageId, false);
+            this -> bufMgr -> flushFile(file);
+            delete file;
+            throw BadIndexInfoException("Index file exists but its format is not the one of this version.");
+        }
         // check the attribute in the meta page
         if(!(metaInfo -> relationName == relationName
            && metaInfo -> attrByteOffset == attrByteOffset
@@ -114,13 +140,51 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
             this -> bufMgr -> unPinPage(file, metaPageId, false);
             throw BadIndexInfoException("Index file exists but values in metapage not match.");
         }
+        // the included attributes of a covering index are taken from the
+        // meta page. If they are given again, they have to match.
+        std::vector<IncludeAttr> includes;
+        for(int i = 0; i < metaInfo -> includeCount; ++i){
+            includes.push_back(IncludeAttr(metaInfo -> includeOffsets[i], metaInfo -> includeTypes[i]));
+        }
+        bool includesMatch = options.includes.empty() || options.includes.size() == includes.size();
+        for(std::size_t i = 0; includesMatch && i < options.includes.size(); ++i){
+            includesMatch = options.includes[i].attrByteOffset == includes[i].attrByteOffset
+                            && options.includes[i].attrType == includes[i].attrType;
+        }
+        if(!includesMatch){
+            this -> bufMgr -> unPinPage(file, metaPageId, false);
+            // the file is not kept open, so that none of its pages stay in the buffer pool
+            this -> bufMgr -> flushFile(file);
+            delete file;
+            throw BadIndexInfoException("Index file exists but included attributes in metapage not match.");
+        }
+        this -> setIncludes(includes);
+        this -> setNodeLayout(metaInfo -> nodeLayout);
+        this -> compressLeaves = metaInfo -> compressedLeaves;
         this -> headerPageNum = metaPageId;
         this -> rootPageNum = metaInfo -> rootPageNo;
         this -> file = file;
+        // load the statistics, whose tree height also tells whether the
+        // root is a leaf
+        this -> statsPageNum = metaInfo -> statsPageNo;
+        Page * statsPage;
+        this -> bufMgr -> readPage(this -> file, this -> statsPageNum, statsPage);
+        this -> stats = *(IndexStatistics *) statsPage;
+        this -> bufMgr -> unPinPage(this -> file, this -> statsPageNum, false);
+        this -> rootIsLeaf = (this -> stats.height <= 1);
         this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
         return;
     }
     
+    if(options.includes.size() > (std::size_t) MAXINCLUDEATTRS){
+        throw BadIndexInfoException("Too many included attributes.");
+    }
+    if(options.compressLeaves && !options.includes.empty()){
+        throw BadIndexInfoException("Compressed leaves can not hold included attributes.");
+    }
+    this -> setIncludes(options.includes);
+    this -> setNodeLayout(options.nodeLayout);
+    this -> compressLeaves = options.compressLeaves;
     BlobFile* newFile = new BlobFile(outIndexName, true);
     this -> file = (File *) newFile;
     // create the metadata page
@@ -132,8 +196,37 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
     strcpy(metaInfo -> relationName, relationName.c_str());
     metaInfo -> attrByteOffset = attrByteOffset;
     metaInfo -> attrType = attrType;
+    metaInfo -> includeCount = (int) this -> includeAttrs.size();
+    for(std::size_t i = 0; i < this -> includeAttrs.size(); ++i){
+        metaInfo -> includeOffsets[i] = this -> includeAttrs[i].attrByteOffset;
+        metaInfo -> includeTypes[i] = this -> includeAttrs[i].attrType;
+    }
+    metaInfo -> keyCount = 0;
+    metaInfo -> nodeLayout = this -> nodeLayout;
+    metaInfo -> compressedLeaves = this -> compressLeaves;
+    metaInfo -> formatVersion = INDEXFORMATVERSION;
     // assign the meta page id to the private attribute
     this -> headerPageNum = metaPageId;
+    // the statistics page follows the meta page. The statistics start out
+    // as the ones of a tree with a single empty leaf.
+    Page * statsPage;
+    this -> bufMgr -> allocPage(this -> file, this -> statsPageNum, statsPage);
+    metaInfo -> statsPageNo = this -> statsPageNum;
+    memset(&this -> stats, 0, sizeof(IndexStatistics));
+    this -> stats.height = 1;
+    this -> stats.leafCount = 1;
+    *(IndexStatistics *) statsPage = this -> stats;
+    this -> bufMgr -> unPinPage(this -> file, this -> statsPageNum, true);
+    if(options.buildThreads > 0){
+        // build the whole tree bottom up instead, which also sets up the
+        // root page in the meta page
+        this -> bufMgr -> unPinPage(this -> file, metaPageId, true);
+        this -> bulkBuild(relationName, options.buildThreads);
+        if(options.mmapIndex){
+            this -> mapIndexFile();
+        }
+        return;
+    }
     // create the root page and update the attribute for root page
     // update the root page attribute in the metaPage
     PageId rootPageId;
@@ -141,8 +234,16 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
     this -> bufMgr -> allocPage(this -> file, rootPageId, rootPage);
     // initialize value of the vars in the rootPage, which is firstly
     // initialized as a leaf node.
-    ((LeafNodeInt *) rootPage) -> slotTaken = 0;
-    ((LeafNodeInt *) rootPage) -> rightSibPageNo = Page::INVALID_NUMBER;
+    if(this -> compressLeaves){
+        encodeLeaf(NULL, 0, (CompressedLeafInt *) rootPage);
+        ((CompressedLeafInt *) rootPage) -> rightSibPageNo = Page::INVALID_NUMBER;
+        ((CompressedLeafInt *) rootPage) -> leftSibPageNo = Page::INVALID_NUMBER;
+    }
+    else{
+        ((LeafNodeInt *) rootPage) -> slotTaken = 0;
+        ((LeafNodeInt *) rootPage) -> rightSibPageNo = Page::INVALID_NUMBER;
+        ((LeafNodeInt *) rootPage) -> leftSibPageNo = Page::INVALID_NUMBER;
+    }
     this -> bufMgr -> unPinPage(this -> file, rootPageId, true);
     metaInfo -> rootPageNo = rootPageId;
     this -> rootPageNum = rootPageId;
@@ -163,7 +264,7 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
             // as mentioned in the instruction, the data type of key
             // in this assignment will only be integer.
             int key = *((int *)(record + attrByteOffset));
-            this -> insertEntry(&key, scanRid);
+            this -> insertEntry(&key, scanRid, record);
         }
     }
     catch(EndOfFileException e)
@@ -172,9 +273,327 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
         //std::cout << "Read all records" << std::endl;
     }
     delete fileScan;
+    // the histogram bounds are only known once all the keys are in
+    this -> rebuildStatistics();
+    if(options.mmapIndex){
+        this -> mapIndexFile();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bulkBuild
+// -----------------------------------------------------------------------------
+/**
+ * Build a new index file bottom up from the base relation with numThreads threads.
+ * @param relationName The name of the base relation
+ * @param numThreads The number of threads to use
+ */
+const void BTreeIndex::bulkBuild(const std::string & relationName, const int numThreads)
+{
+    // partition the pages of the base relation into one page range per
+    // thread. Page 0 is the file header, so the pages start at 1.
+    // every thread reads its range through a private stream, since the
+    // File objects and the buffer manager are not threadsafe.
+    PageFile relation(relationName, false);
+    PageId numPages = relation.getNumPages();
+    std::vector< std::vector< RIDKeyPair<int> > > runs(numThreads);
+    // the included attribute values of the records of each page range
+    std::vector<IncludedRun> included(numThreads);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < numThreads; ++t){
+        PageId firstPageNo = 1 + (PageId)((std::uint64_t)(numPages - 1) * t / numThreads);
+        PageId lastPageNo = 1 + (PageId)((std::uint64_t)(numPages - 1) * (t + 1) / numThreads);
+        workers.push_back(std::thread(&BTreeIndex::extractSortedRun, &relation, firstPageNo, lastPageNo,
+                                      this -> attrByteOffset, &runs[t], &this -> includeAttrs, &included[t]));
+    }
+    for(int t = 0; t < numThreads; ++t){
+        workers[t].join();
+    }
+
+    // concatenate the sorted runs, remembering where each of them starts
+    std::vector< RIDKeyPair<int> > entries;
+    std::vector<std::size_t> runBegin(1, 0);
+    for(int t = 0; t < numThreads; ++t){
+        entries.insert(entries.end(), runs[t].begin(), runs[t].end());
+        runBegin.push_back(entries.size());
+        std::vector< RIDKeyPair<int> >().swap(runs[t]);
+    }
+    // merge neighbouring runs pairwise until only one run is left. The
+    // merges of one round touch disjoint parts of the vector, so each of
+    // them gets a thread of its own.
+    while(runBegin.size() > 2){
+        std::vector<std::size_t> mergedBegin;
+        std::vector<std::thread> mergers;
+        std::size_t r;
+        for(r = 0; r + 2 < runBegin.size(); r += 2){
+            std::vector< RIDKeyPair<int> >::iterator first = entries.begin() + runBegin[r];
+            std::vector< RIDKeyPair<int> >::iterator middle = entries.begin() + runBegin[r + 1];
+            std::vector< RIDKeyPair<int> >::iterator last = entries.begin() + runBegin[r + 2];
+            mergers.push_back(std::thread([first, middle, last]() { std::inplace_merge(first, middle, last); }));
+            mergedBegin.push_back(runBegin[r]);
+        }
+        if(r + 1 < runBegin.size()){
+            // an odd run out is carried over into the next round as it is
+            mergedBegin.push_back(runBegin[r]);
+        }
+        mergedBegin.push_back(entries.size());
+        for(std::size_t m = 0; m < mergers.size(); ++m){
+            mergers[m].join();
+        }
+        runBegin.swap(mergedBegin);
+    }
 
+    PageId newRootPageNum;
+    bool newRootIsLeaf;
+    this -> bulkLoad(entries, this -> includeAttrs.empty() ? NULL : &included, numThreads, newRootPageNum, newRootIsLeaf);
+    this -> rootPageNum = newRootPageNum;
+    this -> rootIsLeaf = newRootIsLeaf;
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    ((IndexMetaInfo *) metaPage) -> rootPageNo = newRootPageNum;
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
 }
 
+/**
+ * Build a tree from the (key, rid) pairs sorted by key.
+ * @param entries The (key, rid) pairs sorted by key
+ * @param included The included attribute values of the records, NULL if the index is not a covering index
+ * @param numThreads The number of threads formatting the leaf pages
+ * @param newRootPageNum Returns the page id of the root of the new tree
+ * @param newRootIsLeaf Returns whether the root of the new tree is a leaf node
+ * @param fillFactor The fraction of the slots of every page but the last one of each level to fill
+ */
+const void BTreeIndex::bulkLoad(const std::vector< RIDKeyPair<int> > & entries, const std::vector<IncludedRun> * included, const int numThreads,
+                                PageId & newRootPageNum, bool & newRootIsLeaf, const double fillFactor)
+{
+    // the leaf pages are filled up to the fill factor, only the last one
+    // may be filled less. An empty tree still gets one empty leaf page.
+    // leafBegin[leaf] is the index of the first pair of the leaf page.
+    std::vector<std::size_t> leafBegin;
+    if(this -> compressLeaves){
+        // a compressed leaf page takes as many pairs as fit into its words
+        const int words = std::max(4, (int)(COMPRESSEDLEAFWORDS * fillFactor));
+        for(std::size_t first = 0; first < entries.size(); first += packLeaf(&entries[first], entries.size() - first, words)){
+            leafBegin.push_back(first);
+        }
+    }
+    else{
+        const int perLeaf = std::max(1, (int)(this -> leafOccupancy * fillFactor));
+        for(std::size_t first = 0; first < entries.size(); first += perLeaf){
+            leafBegin.push_back(first);
+        }
+    }
+    if(leafBegin.empty()){
+        leafBegin.push_back(0);
+    }
+    const int numLeaves = leafBegin.size();
+    leafBegin.push_back(entries.size());
+    // allocate all the leaf pages as one range of consecutive pages, so
+    // that a range scan reads them in the order of the file
+    const PageId firstLeafPageNo = ((BlobFile *) this -> file) -> allocatePageRange(numLeaves);
+
+    // the leaf pages are formatted in memory by the threads and then
+    // written out in order, one chunk of pages at a time
+    const int chunkPages = 256 * numThreads;
+    std::vector<Page> pages(std::min(chunkPages, numLeaves));
+    for(int chunk = 0; chunk < numLeaves; chunk += chunkPages){
+        const int chunkEnd = std::min(chunk + chunkPages, numLeaves);
+        std::vector<std::thread> workers;
+        for(int t = 0; t < numThreads; ++t){
+            int firstLeaf = chunk + (chunkEnd - chunk) * t / numThreads;
+            int lastLeaf = chunk + (chunkEnd - chunk) * (t + 1) / numThreads;
+            workers.push_back(std::thread(&BTreeIndex::formatLeafPages, &entries, &leafBegin, firstLeafPageNo,
+                                          numLeaves, firstLeaf, lastLeaf, &pages[firstLeaf - chunk], included, this -> includedWidth,
+                                          this -> leafOccupancy, this -> compressLeaves));
+        }
+        for(int t = 0; t < numThreads; ++t){
+            workers[t].join();
+        }
+        // the pages are not in the buffer pool yet, so they are written to
+        // the file directly
+        for(int leaf = chunk; leaf < chunkEnd; ++leaf){
+            this -> file -> writePage(firstLeafPageNo + leaf, pages[leaf - chunk]);
+        }
+    }
+
+    // build the non-leaf levels bottom up. minKeys[i] is the smallest key
+    // below children[i], which is the separator key on its left side, and
+    // counts[i] is the number of entries below children[i].
+    std::vector<PageId> children(numLeaves);
+    std::vector<int> minKeys(numLeaves);
+    std::vector<int> counts(numLeaves);
+    for(int leaf = 0; leaf < numLeaves; ++leaf){
+        children[leaf] = firstLeafPageNo + leaf;
+        minKeys[leaf] = entries.empty() ? 0 : entries[leafBegin[leaf]].key;
+        counts[leaf] = (int)(leafBegin[leaf + 1] - leafBegin[leaf]);
+    }
+    newRootIsLeaf = (numLeaves == 1);
+    int level = 1; // the level right above the leaf pages is 1, the others are 0
+    int height = 1;
+    // the number of children a non-leaf page gets at the fill factor
+    const int perNode = std::max(2, (int)((this -> nodeOccupancy + 1) * fillFactor));
+    while(children.size() > 1){
+        // spread the children evenly over as few non-leaf pages as possible
+        const int numChildren = children.size();
+        const int numNodes = (numChildren + perNode - 1) / perNode;
+        std::vector<PageId> parents(numNodes);
+        std::vector<int> parentMinKeys(numNodes);
+        std::vector<int> parentCounts(numNodes, 0);
+        for(int node = 0; node < numNodes; ++node){
+            int firstChild = (int)((std::int64_t) numChildren * node / numNodes);
+            int lastChild = (int)((std::int64_t) numChildren * (node + 1) / numNodes);
+            Page * newPage;
+            this -> bufMgr -> allocPage(this -> file, parents[node], newPage);
+            NonLeafNodeInt * newNonLeafPage = (NonLeafNodeInt *) newPage;
+            newNonLeafPage -> level = level;
+            newNonLeafPage -> slotTaken = lastChild - firstChild - 1;
+            newNonLeafPage -> pageNoArray[0] = children[firstChild];
+            for(int child = firstChild + 1; child < lastChild; ++child){
+                newNonLeafPage -> keyArray[child - firstChild - 1] = minKeys[child];
+                newNonLeafPage -> pageNoArray[child - firstChild] = children[child];
+            }
+            for(int child = firstChild; child < lastChild; ++child){
+                newNonLeafPage -> countArray[child - firstChild] = counts[child];
+                parentCounts[node] += counts[child];
+            }
+            parentMinKeys[node] = minKeys[firstChild];
+            this -> writeKeyBlocks(newNonLeafPage);
+            this -> bufMgr -> unPinPage(this -> file, parents[node], true);
+        }
+        children.swap(parents);
+        minKeys.swap(parentMinKeys);
+        counts.swap(parentCounts);
+        level = 0;
+        height++;
+    }
+    newRootPageNum = children[0];
+    this -> buildStatistics(entries, numLeaves, height);
+}
+
+/**
+ * Extract and sort the (key, rid) pairs of the records on the pages firstPageNo .. lastPageNo - 1 of the base relation.
+ * @param relation The file of the base relation
+ * @param firstPageNo The first page of the range
+ * @param lastPageNo The page after the last page of the range
+ * @param attrByteOffset The offset of the key inside the records
+ * @param run Returns the sorted (key, rid) pairs
+ * @param includes The included attributes, empty if the index is not a covering index
+ * @param included Returns the included attribute values of the records of the range
+ */
+void BTreeIndex::extractSortedRun(const File * relation, const PageId firstPageNo, const PageId lastPageNo,
+                                  const int attrByteOffset, std::vector< RIDKeyPair<int> > * run,
+                                  const std::vector<IncludeAttr> * includes, IncludedRun * included)
+{
+    int width = 0;
+    for(std::size_t a = 0; a < includes -> size(); ++a){
+        width += attrWidth((*includes)[a].attrType);
+    }
+    included -> firstPageNo = firstPageNo;
+    std::shared_ptr<std::ifstream> in = relation -> openReadStream();
+    for(PageId pageNo = firstPageNo; pageNo < lastPageNo; ++pageNo){
+        // the values of the record in slot s of the page are at the
+        // (pageStart + s - 1)-th place of the values
+        included -> pageStart.push_back(included -> values.size() / std::max(width, 1));
+        Page page = File::readPageFromStream(*in, pageNo, relation -> alignedLayout());
+        // skip the pages which are allocated but not used
+        if(page.page_number() == Page::INVALID_NUMBER){
+            continue;
+        }
+        for(PageIterator iter = page.begin(); iter != page.end(); ++iter){
+            std::string recordStr = *iter;
+            // as in the constructor, the key is an integer
+            RIDKeyPair<int> pair;
+            pair.set(iter.getCurrentRecord(), *((int *)(recordStr.c_str() + attrByteOffset)));
+            run -> push_back(pair);
+            if(width > 0){
+                // the slots of deleted records are left as gaps
+                std::size_t at = (included -> pageStart.back() + pair.rid.slot_number - 1) * width;
+                if(included -> values.size() < at + width){
+                    included -> values.resize(at + width);
+                }
+                for(std::size_t a = 0, pos = at; a < includes -> size(); ++a){
+                    int w = attrWidth((*includes)[a].attrType);
+                    memcpy(&included -> values[pos], recordStr.c_str() + (*includes)[a].attrByteOffset, w);
+                    pos += w;
+                }
+            }
+        }
+    }
+    std::sort(run -> begin(), run -> end());
+}
+
+/**
+ * Find the included attribute values of a record, extracted by extractSortedRun.
+ * @param included The included attribute values of the records, one IncludedRun per page range, in page order
+ * @param rid The record id
+ * @param width The width of the values of one record
+ * @return A pointer to the values
+ */
+const char * BTreeIndex::findIncluded(const std::vector<IncludedRun> & included, const RecordId & rid, const int width)
+{
+    // find the last page range starting at or before the page of the record
+    std::size_t lo = 0;
+    std::size_t hi = included.size();
+    while(hi - lo > 1){
+        std::size_t mid = (lo + hi) / 2;
+        if(included[mid].firstPageNo <= rid.page_number){
+            lo = mid;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    const IncludedRun & run = included[lo];
+    return &run.values[(run.pageStart[rid.page_number - run.firstPageNo] + rid.slot_number - 1) * width];
+}
+
+/**
+ * Format the leaf pages firstLeaf .. lastLeaf - 1 of a bulk loaded tree into pages.
+ * @param entries The (key, rid) pairs of the whole tree sorted by key
+ * @param leafBegin The index of the first pair of every leaf page, followed by the number of pairs
+ * @param firstLeafPageNo The page id of the first leaf page of the tree
+ * @param numLeaves The number of leaf pages of the tree
+ * @param firstLeaf The number of the first leaf page to format
+ * @param lastLeaf The number after the last leaf page to format
+ * @param pages The in memory pages to format into
+ * @param included The included attribute values of the records, NULL if the index is not a covering index
+ * @param includedWidth The width of the included attribute values of one entry
+ * @param leafOccupancy The number of slots of a leaf page
+ * @param compress Whether the leaf pages are formatted as CompressedLeafInt
+ */
+void BTreeIndex::formatLeafPages(const std::vector< RIDKeyPair<int> > * entries, const std::vector<std::size_t> * leafBegin,
+                                 const PageId firstLeafPageNo, const int numLeaves, const int firstLeaf, const int lastLeaf, Page * pages,
+                                 const std::vector<IncludedRun> * included, const int includedWidth, const int leafOccupancy,
+                                 const bool compress)
+{
+    for(int leaf = firstLeaf; leaf < lastLeaf; ++leaf){
+        Page * page = &pages[leaf - firstLeaf];
+        *page = Page();
+        std::size_t first = (*leafBegin)[leaf];
+        std::size_t last = (*leafBegin)[leaf + 1];
+        if(compress){
+            CompressedLeafInt * compressedNode = (CompressedLeafInt *) page;
+            encodeLeaf(entries -> empty() ? NULL : &(*entries)[first], (int)(last - first), compressedNode);
+            compressedNode -> rightSibPageNo = (leaf + 1 < numLeaves) ? firstLeafPageNo + leaf + 1 : Page::INVALID_NUMBER;
+            compressedNode -> leftSibPageNo = (leaf > 0) ? firstLeafPageNo + leaf - 1 : Page::INVALID_NUMBER;
+            continue;
+        }
+        LeafNodeInt * leafNode = (LeafNodeInt *) page;
+        leafNode -> slotTaken = (first < last) ? (int)(last - first) : 0;
+        for(std::size_t i = first; i < last; ++i){
+            leafNode -> keyArray[i - first] = (*entries)[i].key;
+            leafNode -> ridArray[i - first] = (*entries)[i].rid;
+            if(included != NULL){
+                // as in includedValues, the values follow all the record id slots
+                memcpy((char *) &leafNode -> ridArray[leafOccupancy] + (i - first) * includedWidth,
+                       findIncluded(*included, (*entries)[i].rid, includedWidth), includedWidth);
+            }
+        }
+        leafNode -> rightSibPageNo = (leaf + 1 < numLeaves) ? firstLeafPageNo + leaf + 1 : Page::INVALID_NUMBER;
+        leafNode -> leftSibPageNo = (leaf > 0) ? firstLeafPageNo + leaf - 1 : Page::INVALID_NUMBER;
+    }
+}
 
 // -----------------------------------------------------------------------------
 // BTreeIndex::~BTreeIndex -- destructor
@@ -202,6 +621,7 @@ BTreeIndex::~BTreeIndex()
      this -> bufMgr -> printSelf();
      */
     
+    this -> writeStatistics();
     this -> bufMgr -> flushFile(this -> file);
     
     // delete the index file
@@ -215,14 +635,27 @@ BTreeIndex::~BTreeIndex()
  * Insert a new entry using the pair <value,rid>.
  * @param key			A pointer to the value(integer we want to insert)
  * @param rid			The corresponding record id of the tuple in the base relation
+ * @param record		The record itself, from which the included attribute values of a covering index are taken
  **/
-const void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+const void BTreeIndex::insertEntry(const void *key, const RecordId rid, const void *record) 
 {
+    if(this -> file -> mapped()){
+        throw ReadOnlyFileException(this -> file -> filename());
+    }
+    std::vector<char> included(this -> includedWidth);
+    if(this -> includedWidth > 0){
+        if(record == NULL){
+            throw BadIndexInfoException("The record is needed to insert into a covering index.");
+        }
+        this -> extractIncluded((const char *) record, &included[0]);
+    }
+    this -> addKeyToStatistics(*((int *) key));
+    const char * includedPtr = (this -> includedWidth > 0) ? &included[0] : NULL;
     std::vector<PageId> searchPath;
     if(this -> rootIsLeaf == true){
         // this is the case when the root is a leaf index page already,
         // then we can just try to insert into this root page first
-        this -> insertLeafNode(this -> rootPageNum, key, rid, searchPath);
+        this -> insertLeafNode(this -> rootPageNum, key, rid, includedPtr, searchPath);
     }
     else{
         // this is the case when the root page is not a leaf.
@@ -230,21 +663,194 @@ const void BTreeIndex::insertEntry(const void *key, const RecordId rid)
         // this target key value in.
         PageId currPageId = Page::INVALID_NUMBER;
         this -> searchLeafPageWithKey(key, currPageId, this -> rootPageNum, searchPath);
+        // count the new entry in the subtrees along the search path
+        this -> addToPathCounts(*((int *) key), searchPath, 1);
         // insert the (key, rid) pair into this potential leaf node
-        this -> insertLeafNode(currPageId, key, rid, searchPath);
+        this -> insertLeafNode(currPageId, key, rid, includedPtr, searchPath);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::insertBatch
+// -----------------------------------------------------------------------------
+/**
+ * Insert a batch of entries using the pairs <keys[i],rids[i]>.
+ * @param keys			A pointer to the array of n keys(integers we want to insert)
+ * @param rids			The corresponding record ids of the tuples in the base relation
+ * @param n				The number of entries in the batch
+ * @param records	The records rids[i] refer to, from which the included attribute values of a covering index are taken
+ **/
+const void BTreeIndex::insertBatch(const void *keys, const RecordId *rids, const int n, const void * const *records)
+{
+    if(this -> file -> mapped()){
+        throw ReadOnlyFileException(this -> file -> filename());
+    }
+    if(n <= 0){
+        return;
+    }
+    if(this -> includedWidth > 0 && records == NULL){
+        throw BadIndexInfoException("The records are needed to insert into a covering index.");
+    }
+    // sort the batch first, so that all the keys falling into the same
+    // leaf page are next to each other in the batch
+    std::vector< RIDKeyPair<int> > batch(n);
+    for(int i = 0; i < n; ++i){
+        batch[i].set(rids[i], ((const int *) keys)[i]);
+        this -> addKeyToStatistics(batch[i].key);
+    }
+    // the included values follow the pairs of the batch in sorted order
+    std::vector<char> batchIncluded;
+    if(this -> includedWidth > 0){
+        std::vector<int> order(n);
+        for(int i = 0; i < n; ++i){
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&batch](int a, int b) { return batch[a] < batch[b]; });
+        std::vector< RIDKeyPair<int> > sorted(n);
+        batchIncluded.resize((std::size_t) n * this -> includedWidth);
+        for(int i = 0; i < n; ++i){
+            sorted[i] = batch[order[i]];
+            this -> extractIncluded((const char *) records[order[i]], &batchIncluded[(std::size_t) i * this -> includedWidth]);
+        }
+        batch.swap(sorted);
+    }
+    else{
+        std::sort(batch.begin(), batch.end());
+    }
+
+    int next = 0; // the index of the first pair not inserted yet
+    while(next < n){
+        std::vector<PageId> searchPath;
+        PageId leafPageId = Page::INVALID_NUMBER;
+        int upperKey = 0;
+        bool upperKeyValid = false;
+        if(this -> rootIsLeaf == true){
+            // the root is the only leaf, so it covers the whole key range
+            leafPageId = this -> rootPageNum;
+        }
+        else{
+            // descend once for the whole run of keys belonging to this leaf
+            this -> searchLeafPageWithKey(&(batch[next].key), leafPageId, this -> rootPageNum, searchPath, &upperKey, &upperKeyValid);
+        }
+        // find the end of the run of keys which fall into the key range
+        // of this leaf page, i.e. are smaller than the separator key on
+        // the right of this leaf page
+        int end = next + 1;
+        while(end < n && (upperKeyValid == false || batch[end].key < upperKey)){
+            end++;
+        }
+        next = this -> insertLeafRun(leafPageId, batch, next, end, batchIncluded, searchPath);
     }
 }
 
+/**
+ * Insert a run of sorted (key, rid) pairs, which all fall into the key range of one leaf node, into that leaf node.
+ * @param pid: the page id of the leaf node to insert into
+ * @param batch: the sorted (key, rid) pairs of the whole batch
+ * @param begin: the index of the first pair of the run in the batch
+ * @param end: the index after the last pair of the run in the batch
+ * @param batchIncluded: the included attribute values of the pairs of the batch, empty if the index is not a covering index
+ * @param searchPath: a vector of PageId contains all the PageId of the pages we have
+ *  visited along our search path. The purpose of this vector is to benefit our insert later.
+ *  Remark: the searchPath does not contain the pageId of this current node.
+ * @return the index of the first pair in the batch which has not been inserted yet
+ */
+const int BTreeIndex::insertLeafRun(const PageId pid, const std::vector< RIDKeyPair<int> > & batch, const int begin, const int end,
+                                    const std::vector<char> & batchIncluded, std::vector<PageId> & searchPath){
+    if(this -> compressLeaves){
+        // the path counts are added here too, the whole run is taken
+        this -> addToPathCounts(batch[begin].key, searchPath, end - begin);
+        return this -> insertCompressedRun(pid, batch, begin, end, searchPath);
+    }
+    const int width = this -> includedWidth;
+    Page * currPage;
+    this -> bufMgr -> readPage(this -> file, pid, currPage);
+    LeafNodeInt * currLeafPage = (LeafNodeInt*) currPage;
+    // we only split this leaf page once in this call, so we take at most
+    // as many pairs as the two leaf pages after the split can hold.
+    // the rest of the run will be inserted after the next descent.
+    int taken = std::min(end - begin, 2 * this -> leafOccupancy - currLeafPage -> slotTaken);
+    int total = currLeafPage -> slotTaken + taken;
+    // count the pairs taken in the subtrees along the search path. All of
+    // them fall into this leaf page, so they share the same search path.
+    this -> addToPathCounts(batch[begin].key, searchPath, taken);
+
+    if(total <= this -> leafOccupancy){
+        // the case where the whole run fits into this current leaf page.
+        // merge from the back in place, so that only the slots with key
+        // values larger than the smallest new key get shifted.
+        int i = currLeafPage -> slotTaken - 1; // the last existing slot not placed yet
+        int j = begin + taken - 1; // the last new pair not placed yet
+        for(int k = total - 1; j >= begin; --k){
+            if(i >= 0 && currLeafPage -> keyArray[i] > batch[j].key){
+                currLeafPage -> keyArray[k] = currLeafPage -> keyArray[i];
+                currLeafPage -> ridArray[k] = currLeafPage -> ridArray[i];
+                if(width > 0){
+                    memmove(this -> includedValues(currLeafPage, k), this -> includedValues(currLeafPage, i), width);
+                }
+                i--;
+            }
+            else{
+                currLeafPage -> keyArray[k] = batch[j].key;
+                currLeafPage -> ridArray[k] = batch[j].rid;
+                if(width > 0){
+                    memcpy(this -> includedValues(currLeafPage, k), &batchIncluded[(std::size_t) j * width], width);
+                }
+                j--;
+            }
+        }
+        currLeafPage -> slotTaken = total;
+        this -> bufMgr -> unPinPage(this -> file, pid, true);
+        return begin + taken;
+    }
+
+    // this is the case where this current leaf page overflows. We split it
+    // up into two parts only once, no matter how many new pairs it takes.
+    // merge the existing slots of this leaf page and the run of new pairs
+    std::vector<int> mergedKeys(total);
+    std::vector<RecordId> mergedRids(total);
+    std::vector<char> mergedIncluded((std::size_t) total * width);
+    int i = 0; // the next existing slot in this leaf page
+    int j = begin; // the next new pair in the run
+    for(int k = 0; k < total; ++k){
+        if(j < begin + taken && (i >= currLeafPage -> slotTaken || batch[j].key < currLeafPage -> keyArray[i])){
+            mergedKeys[k] = batch[j].key;
+            mergedRids[k] = batch[j].rid;
+            if(width > 0){
+                memcpy(&mergedIncluded[(std::size_t) k * width], &batchIncluded[(std::size_t) j * width], width);
+            }
+            j++;
+        }
+        else{
+            mergedKeys[k] = currLeafPage -> keyArray[i];
+            mergedRids[k] = currLeafPage -> ridArray[i];
+            if(width > 0){
+                memcpy(&mergedIncluded[(std::size_t) k * width], this -> includedValues(currLeafPage, i), width);
+            }
+            i++;
+        }
+    }
+    this -> splitLeafEntries(pid, currLeafPage, mergedKeys, mergedRids, mergedIncluded, searchPath);
+    return begin + taken;
+}
+
 /**
  * Insert a new (key, rid) pair into a leaf node
  * @param pid: the PageId of the potential leaf node to insert into
  * @param key: a pointer to the value(integer we want to insert)
  * @param rid: The corresponding record id of the tuple in the base relation
+ * @param included: the included attribute values of the entry, NULL if the index is not a covering index
  * @param searchPath: a vector of PageId contains all the PageId of the pages we have
  *  visited along our search path. The purpose of this vector is to benefit our insert later.
  *  Remark: the searchPath does not contain the pageId of this current node.
  */
-const void BTreeIndex::insertLeafNode(const PageId pid, const void *key, const RecordId rid, std::vector<PageId> & searchPath){
+const void BTreeIndex::insertLeafNode(const PageId pid, const void *key, const RecordId rid, const char * included, std::vector<PageId> & searchPath){
+    if(this -> compressLeaves){
+        std::vector< RIDKeyPair<int> > run(1);
+        run[0].set(rid, *((int *) key));
+        this -> insertCompressedRun(pid, run, 0, 1, searchPath);
+        return;
+    }
     Page * currPage;
     this -> bufMgr -> readPage(this -> file, pid, currPage);
     LeafNodeInt * currLeafPage = (LeafNodeInt*) currPage;
@@ -276,6 +882,12 @@ const void BTreeIndex::insertLeafNode(const PageId pid, const void *key, const R
         }
         currLeafPage -> keyArray[currLeafPage -> slotTaken - i] = *((int *) key);
         currLeafPage -> ridArray[currLeafPage -> slotTaken - i] = rid;
+        if(included != NULL){
+            // shift the included values of the i shifted slots as well
+            int slot = currLeafPage -> slotTaken - i;
+            memmove(this -> includedValues(currLeafPage, slot + 1), this -> includedValues(currLeafPage, slot), i * this -> includedWidth);
+            memcpy(this -> includedValues(currLeafPage, slot), included, this -> includedWidth);
+        }
         // update the amount of slots being taken up in the leaf node
         currLeafPage -> slotTaken += 1;
         // unpin this leaf index page
@@ -288,7 +900,7 @@ const void BTreeIndex::insertLeafNode(const PageId pid, const void *key, const R
         // unpin the current leaf page pinned in this function
         this -> bufMgr -> unPinPage(this -> file, pid, false);
         // we need to split this leaf page up into two parts
-        this -> splitLeafNode(pid, key, rid, searchPath);
+        this -> splitLeafNode(pid, key, rid, included, searchPath);
     }
 }
 /**
@@ -296,127 +908,85 @@ const void BTreeIndex::insertLeafNode(const PageId pid, const void *key, const R
  * @param pid: the page id of the current leaf node, which is needed to be splitted
  * @param key: a pointer to the value of the key that we are looking for
  * @param rid: The corresponding record id of the tuple in the base relation
+ * @param included: the included attribute values of the entry, NULL if the index is not a covering index
  * @param searchPath: a vector of PageId contains all the PageId of the pages we have
  *  visited along our search path. The purpose of this vector is to benefit our insert later.
  *  Remark: the searchPath does not contain the pageId of this current node.
  */
-const void BTreeIndex::splitLeafNode(PageId pid, const void *key,  const RecordId rid, std::vector<PageId> & searchPath){
+const void BTreeIndex::splitLeafNode(PageId pid, const void *key,  const RecordId rid, const char * included, std::vector<PageId> & searchPath){
     Page * currPage;
     this -> bufMgr -> readPage(this -> file, pid, currPage);
     LeafNodeInt * currLeafPage = (LeafNodeInt*) currPage;
+    const int width = this -> includedWidth;
+    // merge the new (key, rid) pair into the slots of this current leaf
+    // page. The new key goes after all the keys not larger than it.
+    const int total = currLeafPage -> slotTaken + 1;
+    const int position = this -> leafPosition(currLeafPage -> keyArray, currLeafPage -> slotTaken, *((int *) key), true);
+    std::vector<int> mergedKeys(currLeafPage -> keyArray, currLeafPage -> keyArray + currLeafPage -> slotTaken);
+    std::vector<RecordId> mergedRids(currLeafPage -> ridArray, currLeafPage -> ridArray + currLeafPage -> slotTaken);
+    mergedKeys.insert(mergedKeys.begin() + position, *((int *) key));
+    mergedRids.insert(mergedRids.begin() + position, rid);
+    std::vector<char> mergedIncluded;
+    if(width > 0){
+        const char * values = this -> includedValues(currLeafPage, 0);
+        mergedIncluded.assign(values, values + (std::size_t) position * width);
+        mergedIncluded.insert(mergedIncluded.end(), included, included + width);
+        mergedIncluded.insert(mergedIncluded.end(), values + (std::size_t) position * width,
+                              values + (std::size_t)(total - 1) * width);
+    }
+    this -> splitLeafEntries(pid, currLeafPage, mergedKeys, mergedRids, mergedIncluded, searchPath);
+}
+
+/**
+ * Split up a leaf index page, given all of its entries merged with the new ones.
+ * @param pid: the page id of the leaf node to split up
+ * @param currLeafPage: the leaf node to split up, pinned. It is unpinned here.
+ * @param keys: the merged keys
+ * @param rids: the merged record ids
+ * @param included: the merged included attribute values, empty if the index is not a covering index
+ * @param searchPath: a vector of PageId contains all the PageId of the pages we have
+ *  visited along our search path. Remark: the searchPath does not contain the pageId of this current node.
+ */
+const void BTreeIndex::splitLeafEntries(const PageId pid, LeafNodeInt * currLeafPage, const std::vector<int> & keys,
+                                        const std::vector<RecordId> & rids, const std::vector<char> & included, std::vector<PageId> & searchPath){
+    const int width = this -> includedWidth;
+    const int total = keys.size();
     Page * newPage;
     PageId newPageId;
     this -> bufMgr -> allocPage(this -> file, newPageId, newPage);
     LeafNodeInt * newLeafPage = (LeafNodeInt*) newPage;
-    // initialize the variable in this new leaf node
-    newLeafPage -> slotTaken = 0;
     // we will let the new leaf page to be the one with larger key values
     // and let the current leaf node with smaller key values
     // i.e. the new leaf page is the right page of the upper key
     // and the current leaf page changed from the right page of the upper key into its left page.
-    newLeafPage -> rightSibPageNo = currLeafPage -> rightSibPageNo;
-    currLeafPage -> rightSibPageNo = newPageId;
-    // we need to split this current leaf page up into two parts,
-    // by the sizes of leafOccupancy / 2 and leafOccupancy / 2 + 1
-    bool newKeyInserted = false; // var to keep track whether the new
-    // key has been inserted or not.
-    int threshold; // # of keys to split up the non-leaf node
-    
-    if(this -> leafOccupancy % 2 == 0){
-        threshold = this -> leafOccupancy / 2;
+    this -> linkNewLeaf(pid, currLeafPage, newPageId, newLeafPage);
+    // the current leaf page keeps half of the slots, rounded up
+    int leftCount = total - total / 2;
+    for(int k = 0; k < leftCount; ++k){
+        currLeafPage -> keyArray[k] = keys[k];
+        currLeafPage -> ridArray[k] = rids[k];
     }
-    else{
-        threshold = this -> leafOccupancy / 2 + 1;
+    currLeafPage -> slotTaken = leftCount;
+    for(int k = leftCount; k < total; ++k){
+        newLeafPage -> keyArray[k - leftCount] = keys[k];
+        newLeafPage -> ridArray[k - leftCount] = rids[k];
     }
-    
-    for(int i= 0; i < this -> leafOccupancy; ++i){
-        if(currLeafPage -> keyArray[this -> leafOccupancy - 1 - i] > *((int *)key)){
-            if(newLeafPage -> slotTaken <  this -> leafOccupancy + 1 - threshold){
-                // this is the case that we should still insert into
-                // the new leaf node
-                newLeafPage -> keyArray[this -> leafOccupancy  + 1 - threshold - 1 - i] = currLeafPage -> keyArray[this -> leafOccupancy - 1 - i];
-                newLeafPage -> ridArray[this -> leafOccupancy + 1 - threshold - 1 - i] = currLeafPage -> ridArray[this -> leafOccupancy - 1 - i];
-                newLeafPage -> slotTaken += 1;
-                currLeafPage -> slotTaken -= 1;
-            }
-            else{
-                // the new leaf has been filled up to the specified amount
-                // already
-                
-                // shift up the slots in this current leaf page, to make
-                // space for the new key value
-                currLeafPage -> keyArray[this -> leafOccupancy - i] =  currLeafPage -> keyArray[this -> leafOccupancy - 1 - i];
-                currLeafPage -> ridArray[this -> leafOccupancy - i] =  currLeafPage -> ridArray[this -> leafOccupancy - 1 - i];
-               
-                // this is the case where all the keys in the original current leaf are actually larger than the new inserted key. Then, as i is only in range of the amount of total amount of keys in the original current leaf, we never get a chance to insert the new key value.
-                if(i + 1 == this -> leafOccupancy){
-                    currLeafPage -> keyArray[this -> leafOccupancy - 1 - i] = *((int*) key);
-                    currLeafPage -> ridArray[this -> leafOccupancy - 1 - i] = rid;
-                    currLeafPage -> slotTaken += 1;
-                    newKeyInserted = true;
-                }
-            }
-        }
-        else{
-            if(newKeyInserted == false){
-                // this is the first time we meet an exisitng key
-                // larger than the new key value.
-                // We should insert in the new key first.
-                if(newLeafPage -> slotTaken <  this -> leafOccupancy + 1 - threshold){
-                    newLeafPage -> keyArray[this -> leafOccupancy + 1 - threshold - 1 - i] = *((int*)key);
-                    newLeafPage -> ridArray[this -> leafOccupancy + 1 - threshold - 1 - i] = rid;
-                    newLeafPage -> slotTaken += 1;
-                    newKeyInserted = true;
-                }
-                else{
-                   
-                    // DEBUG ONLY
-                    if(newLeafPage -> slotTaken !=  this -> leafOccupancy + 1 - threshold)
-                    std::cout << "the slotTaken value of the new leaf is wrong at (2)! Current slotTaken amount is " << newLeafPage -> slotTaken << " expect to be " << this -> leafOccupancy - threshold << std::endl;
-                    if(currLeafPage -> slotTaken != threshold - 1)
-                    std::cout << "the slotTaken value of the current leaf is wrong at (2)! Current slotTaken amount is " << currLeafPage -> slotTaken << " expect to be " <<  threshold << std::endl;
-                    
-                    
-                    // the new key has to be put in the current leaf page
-                    currLeafPage -> keyArray[this -> leafOccupancy - i] =  *((int*)key);
-                    currLeafPage -> ridArray[this -> leafOccupancy - i] =  rid;
-                    currLeafPage -> slotTaken += 1;
-                    newKeyInserted = true;
-                }
-            }
-            // this is the part under when the new key has been
-            // inserted already
-            // now, we have to re-position the original (leafOccupancy - i - 1) - th slot of the current leaf node
-            if(newLeafPage -> slotTaken <  this -> leafOccupancy + 1 - threshold){
-                newLeafPage -> keyArray[this -> leafOccupancy + 1 - threshold - 2 - i] = currLeafPage -> keyArray[this -> leafOccupancy - i - 1];
-                newLeafPage -> ridArray[this -> leafOccupancy + 1 - threshold - 2 - i] = currLeafPage -> ridArray[this -> leafOccupancy - i - 1];
-                newLeafPage -> slotTaken += 1;
-                currLeafPage -> slotTaken -= 1;
-            }
-            else{
-                
-                // DEBUG ONLY
-                if(newLeafPage -> slotTaken !=  this -> leafOccupancy + 1 - threshold)
-                std::cout << "the slotTaken value of the new leaf is wrong at (3)! Current slotTaken amount is " << newLeafPage -> slotTaken << " expect to be " << this -> leafOccupancy - threshold << std::endl;
-                 if(currLeafPage -> slotTaken != threshold)
-                 std::cout << "the slotTaken value of the current leaf is wrong at (3)! Current slotTaken amount is " << currLeafPage -> slotTaken << " expect to be " <<  threshold + 1<< std::endl;
-                
-                // this is the case where the filling of the new leaf is done
-                // since the new key has been inserted already as well
-                // nothing needed to be done in this case.
-                break;
-            }
-        }
+    newLeafPage -> slotTaken = total - leftCount;
+    this -> stats.leafCount++;
+    if(width > 0){
+        memcpy(this -> includedValues(currLeafPage, 0), &included[0], (std::size_t) leftCount * width);
+        memcpy(this -> includedValues(newLeafPage, 0), &included[(std::size_t) leftCount * width], (std::size_t)(total - leftCount) * width);
     }
-    
+
     int pushup = newLeafPage -> keyArray[0]; // the key value needed to push up into the upper layer non-leaf node
+    int rightCount = total - leftCount;
     this -> bufMgr -> unPinPage(this -> file, pid, true);
     this -> bufMgr -> unPinPage(this -> file, newPageId, true);
     // check whether this current page is actually a root
     if(searchPath.size() == 0){
         // case when this current page is a root. Then, we need to
         // create a new non-leaf root.
-        this -> createAndInsertNewRoot(&pushup, pid, newPageId, 1);
+        this -> createAndInsertNewRoot(&pushup, pid, newPageId, 1, leftCount, rightCount);
     }
     else{
         // case when this current page is not a root.
@@ -424,7 +994,499 @@ const void BTreeIndex::splitLeafNode(PageId pid, const void *key,  const RecordI
         PageId parentId = searchPath[searchPath.size() - 1];
         // delete the parentId from the searchPath, to generate the search path for the parentId
         searchPath.erase(searchPath.begin() + searchPath.size() - 1);
-        this -> insertNonLeafNode(parentId, &pushup, newPageId, searchPath, true);
+        this -> insertNonLeafNode(parentId, &pushup, newPageId, rightCount, leftCount, searchPath, true);
+    }
+}
+
+/**
+ * Find the included attribute values of an entry of a leaf page.
+ * @param leafNode: the leaf page
+ * @param slot: the slot of the entry
+ * @return a pointer to the includedWidth bytes of values of the entry
+ */
+char * BTreeIndex::includedValues(LeafNodeInt * leafNode, const int slot){
+    // the values are stored right after the first leafOccupancy record ids
+    return (char *) &leafNode -> ridArray[this -> leafOccupancy] + (std::size_t) slot * this -> includedWidth;
+}
+
+/**
+ * Copy the included attribute values out of a record.
+ * @param record: the record
+ * @param out: returns the includedWidth bytes of values
+ */
+const void BTreeIndex::extractIncluded(const char * record, char * out){
+    for(std::size_t a = 0; a < this -> includeAttrs.size(); ++a){
+        int w = attrWidth(this -> includeAttrs[a].attrType);
+        memcpy(out, record + this -> includeAttrs[a].attrByteOffset, w);
+        out += w;
+    }
+}
+
+/**
+ * Take the included attributes into use, and lower leafOccupancy by the space their values take up.
+ * @param includes: the included attributes
+ */
+const void BTreeIndex::setIncludes(const std::vector<IncludeAttr> & includes){
+    this -> includeAttrs = includes;
+    this -> includedWidth = 0;
+    for(std::size_t a = 0; a < includes.size(); ++a){
+        this -> includedWidth += attrWidth(includes[a].attrType);
+    }
+    // the values of each entry share the space of ridArray with its record
+    // id, so the leaf pages hold fewer entries
+    this -> leafOccupancy = this -> leafOccupancy * sizeof(RecordId) / (sizeof(RecordId) + this -> includedWidth);
+}
+
+/**
+ * Take the layout of the keys in the non-leaf pages into use.
+ * @param layout: the layout
+ */
+const void BTreeIndex::setNodeLayout(const NodeLayout layout){
+    this -> nodeLayout = layout;
+    if(layout == KEY_BLOCKS){
+        // the summary of the blocks takes the slots of keyArray after the
+        // last key, one for every KEYBLOCKSIZE keys
+        this -> nodeOccupancy = this -> nodeOccupancy * KEYBLOCKSIZE / (KEYBLOCKSIZE + 1);
+    }
+}
+
+/**
+ * Find the child page of a non-leaf page to descend into for a key.
+ * @param node: the non-leaf page
+ * @param key: the key
+ * @return the index of the first key larger than the key, which is the index of the child page
+ */
+const int BTreeIndex::childIndex(const NonLeafNodeInt * node, const int key){
+    const int slots = node -> slotTaken;
+    if(this -> nodeLayout == SORTED_KEYS){
+        return std::upper_bound(node -> keyArray, node -> keyArray + slots, key) - node -> keyArray;
+    }
+    // the blocks whose last key is not larger than the key come before the
+    // child page. Counting them, and then the keys of the next block, takes
+    // no branch on the keys, and the compiler vectorizes both loops.
+    const int * summary = node -> keyArray + this -> nodeOccupancy;
+    const int blocks = (slots + KEYBLOCKSIZE - 1) / KEYBLOCKSIZE;
+    int block = 0;
+    for(int b = 0; b < blocks; ++b){
+        block += (summary[b] <= key);
+    }
+    if(block == blocks){
+        return slots;
+    }
+    const int * first = node -> keyArray + block * KEYBLOCKSIZE;
+    const int size = std::min(KEYBLOCKSIZE, slots - block * KEYBLOCKSIZE);
+    int index = block * KEYBLOCKSIZE;
+    for(int i = 0; i < size; ++i){
+        index += (first[i] <= key);
+    }
+    return index;
+}
+
+/**
+ * Write the summary of the blocks of a non-leaf page again.
+ * @param node: the non-leaf page
+ */
+const void BTreeIndex::writeKeyBlocks(NonLeafNodeInt * node){
+    if(this -> nodeLayout == SORTED_KEYS){
+        return;
+    }
+    int * summary = node -> keyArray + this -> nodeOccupancy;
+    const int blocks = (node -> slotTaken + KEYBLOCKSIZE - 1) / KEYBLOCKSIZE;
+    for(int b = 0; b < blocks; ++b){
+        summary[b] = node -> keyArray[std::min((b + 1) * KEYBLOCKSIZE, node -> slotTaken) - 1];
+    }
+}
+
+/**
+ * Find the first slot of a leaf page after a key.
+ * @param keys: the sorted keys of the leaf page
+ * @param count: the number of keys
+ * @param key: the key
+ * @param inclusive: whether the keys equal to the key are counted too
+ * @return the index of the first key larger than (inclusive) or not smaller than (not inclusive) the key
+ */
+const int BTreeIndex::leafPosition(const int * keys, const int count, const int key, const bool inclusive){
+    if(this -> leafSearch == BINARY_SEARCH || count < 2){
+        if(inclusive){
+            return std::upper_bound(keys, keys + count, key) - keys;
+        }
+        return std::lower_bound(keys, keys + count, key) - keys;
+    }
+    // whether a slot is at or after the one searched for
+    auto after = [keys, key, inclusive](const int slot){
+        return inclusive ? keys[slot] > key : keys[slot] >= key;
+    };
+    // binary search over the slots from first up to last, last excluded
+    auto search = [keys, key, inclusive](const int first, const int last){
+        if(inclusive){
+            return (int)(std::upper_bound(keys + first, keys + last, key) - keys);
+        }
+        return (int)(std::lower_bound(keys + first, keys + last, key) - keys);
+    };
+    if(after(0)){
+        return 0;
+    }
+    if(!after(count - 1)){
+        return count;
+    }
+    // the first key is before the key and the last key is not, so they are
+    // different, and the slot predicted is within the leaf page
+    const std::int64_t low = keys[0];
+    const std::int64_t high = keys[count - 1];
+    const int predicted = (int)((key - low) * (count - 1) / (high - low));
+    if(after(predicted)){
+        // the slot searched for is the predicted one or to its left
+        int right = predicted;
+        for(int step = 1; step <= INTERPOLATIONWINDOW; step *= 2){
+            const int probe = right - step;
+            if(probe < 0 || !after(probe)){
+                return search(std::max(probe + 1, 0), right);
+            }
+            right = probe;
+        }
+        return search(0, right);
+    }
+    // the slot searched for is to the right of the predicted one
+    int left = predicted;
+    for(int step = 1; step <= INTERPOLATIONWINDOW; step *= 2){
+        const int probe = left + step;
+        if(probe >= count || after(probe)){
+            return search(left + 1, std::min(probe, count));
+        }
+        left = probe;
+    }
+    return search(left + 1, count);
+}
+
+/**
+ * Get at the entries of a leaf page, whichever its format.
+ * @param page: the leaf page
+ * @param view: the view to fill in
+ * @return the view
+ */
+LeafView * BTreeIndex::viewLeaf(Page * page, LeafView & view){
+    if(this -> compressLeaves){
+        const CompressedLeafInt * leafNode = (const CompressedLeafInt *) page;
+        decodeLeaf(leafNode, view.keys, view.rids);
+        view.slotTaken = leafNode -> slotTaken;
+        view.keyArray = view.keys.data();
+        view.ridArray = view.rids.data();
+        view.includedArray = NULL;
+        view.rightSibPageNo = leafNode -> rightSibPageNo;
+        view.leftSibPageNo = leafNode -> leftSibPageNo;
+        return &view;
+    }
+    LeafNodeInt * leafNode = (LeafNodeInt *) page;
+    view.slotTaken = leafNode -> slotTaken;
+    view.keyArray = leafNode -> keyArray;
+    view.ridArray = leafNode -> ridArray;
+    view.includedArray = this -> includedValues(leafNode, 0);
+    view.rightSibPageNo = leafNode -> rightSibPageNo;
+    view.leftSibPageNo = leafNode -> leftSibPageNo;
+    return &view;
+}
+
+/**
+ * Get at the entries of the current page being scanned.
+ * @return the view of the entries
+ */
+LeafView * BTreeIndex::currentLeaf(){
+    if(this -> compressLeaves && this -> scanViewPageNum == this -> currentPageNum){
+        // decoded already, when the scan moved onto this page
+        return &this -> scanView;
+    }
+    this -> scanViewPageNum = this -> currentPageNum;
+    return this -> viewLeaf(this -> currentPageData, this -> scanView);
+}
+
+/**
+ * The number of bits needed for the differences from a base up to a given one.
+ * @param range: the largest difference
+ * @return the number of bits
+ */
+static int bitWidth(const std::uint32_t range){
+    return (range == 0) ? 0 : 32 - __builtin_clz(range);
+}
+
+/**
+ * The number of words a column of bit-packed values takes.
+ * @param count: the number of values
+ * @param bits: the number of bits of every value
+ * @return the number of words
+ */
+static std::size_t columnWords(const std::size_t count, const int bits){
+    return (count * bits + 63) / 64;
+}
+
+/**
+ * Find how many entries from the start of a sorted run fit into a compressed leaf page.
+ * @param entries: the entries, sorted by key
+ * @param count: the number of entries
+ * @param words: the number of words to fill
+ * @return the number of entries which fit
+ */
+std::size_t BTreeIndex::packLeaf(const RIDKeyPair<int> * entries, const std::size_t count, const int words){
+    // the keys are sorted, so only the smallest and largest page and slot
+    // numbers have to be followed as the entries are taken one by one
+    PageId minPage = 0, maxPage = 0;
+    SlotId minSlot = 0, maxSlot = 0;
+    for(std::size_t n = 0; n < count; ++n){
+        const RecordId & rid = entries[n].rid;
+        minPage = (n == 0) ? rid.page_number : std::min(minPage, rid.page_number);
+        maxPage = (n == 0) ? rid.page_number : std::max(maxPage, rid.page_number);
+        minSlot = (n == 0) ? rid.slot_number : std::min(minSlot, rid.slot_number);
+        maxSlot = (n == 0) ? rid.slot_number : std::max(maxSlot, rid.slot_number);
+        const int keyBits = bitWidth((std::uint32_t) entries[n].key - (std::uint32_t) entries[0].key);
+        // one word is left after the columns
+        std::size_t needed = columnWords(n + 1, keyBits) + columnWords(n + 1, bitWidth(maxPage - minPage))
+                             + columnWords(n + 1, bitWidth(maxSlot - minSlot)) + 1;
+        if(needed > (std::size_t) words){
+            return std::max((std::size_t) 1, n);
+        }
+    }
+    return count;
+}
+
+/**
+ * Append values to a column of bit-packed values.
+ * @param words: the first word of the column, zeroed
+ * @param index: the index of the value in the column
+ * @param bits: the number of bits of every value
+ * @param value: the value
+ */
+static void packValue(std::uint64_t * words, const std::size_t index, const int bits, const std::uint64_t value){
+    const std::size_t bit = index * bits;
+    const int offset = bit & 63;
+    words[bit >> 6] |= value << offset;
+    if(offset + bits > 64){
+        words[(bit >> 6) + 1] |= value >> (64 - offset);
+    }
+}
+
+/**
+ * Read a value of a column of bit-packed values. The word after the one the
+ * value starts in is always read, so that there is no branch.
+ * @param words: the first word of the column
+ * @param index: the index of the value in the column
+ * @param bits: the number of bits of every value
+ * @return the value
+ */
+static std::uint32_t unpackValue(const std::uint64_t * words, const std::size_t index, const int bits){
+    const std::size_t bit = index * bits;
+    const int offset = bit & 63;
+    const std::uint64_t low = words[bit >> 6] >> offset;
+    // shifting by 64 is not defined, so the high word is shifted in two steps
+    const std::uint64_t high = (words[(bit >> 6) + 1] << 1) << (63 - offset);
+    return (std::uint32_t)((low | high) & ((std::uint64_t(1) << bits) - 1));
+}
+
+/**
+ * Encode sorted entries into a compressed leaf page.
+ * @param entries: the entries, sorted by key
+ * @param count: the number of entries
+ * @param leaf: the leaf page
+ */
+void BTreeIndex::encodeLeaf(const RIDKeyPair<int> * entries, const int count, CompressedLeafInt * leaf){
+    leaf -> slotTaken = count;
+    leaf -> keyBase = (count > 0) ? entries[0].key : 0;
+    leaf -> pageBase = 0;
+    leaf -> slotBase = 0;
+    PageId maxPage = 0;
+    SlotId maxSlot = 0;
+    for(int i = 0; i < count; ++i){
+        leaf -> pageBase = (i == 0) ? entries[i].rid.page_number : std::min(leaf -> pageBase, entries[i].rid.page_number);
+        leaf -> slotBase = (i == 0) ? entries[i].rid.slot_number : std::min(leaf -> slotBase, entries[i].rid.slot_number);
+        maxPage = std::max(maxPage, entries[i].rid.page_number);
+        maxSlot = std::max(maxSlot, entries[i].rid.slot_number);
+    }
+    leaf -> keyBits = (count > 0) ? bitWidth((std::uint32_t) entries[count - 1].key - (std::uint32_t) leaf -> keyBase) : 0;
+    leaf -> pageBits = bitWidth(maxPage - leaf -> pageBase);
+    leaf -> slotBits = bitWidth(maxSlot - leaf -> slotBase);
+    memset(leaf -> words, 0, sizeof(leaf -> words));
+    std::uint64_t * keyColumn = leaf -> words;
+    std::uint64_t * pageColumn = keyColumn + columnWords(count, leaf -> keyBits);
+    std::uint64_t * slotColumn = pageColumn + columnWords(count, leaf -> pageBits);
+    for(int i = 0; i < count; ++i){
+        packValue(keyColumn, i, leaf -> keyBits, (std::uint32_t) entries[i].key - (std::uint32_t) leaf -> keyBase);
+        packValue(pageColumn, i, leaf -> pageBits, entries[i].rid.page_number - leaf -> pageBase);
+        packValue(slotColumn, i, leaf -> slotBits, entries[i].rid.slot_number - leaf -> slotBase);
+    }
+}
+
+/**
+ * Decode the entries of a compressed leaf page. Each column is decoded by a
+ * loop of its own with a fixed number of bits, which the compiler vectorizes.
+ * @param leaf: the leaf page
+ * @param keys: returns the keys
+ * @param rids: returns the record ids
+ */
+void BTreeIndex::decodeLeaf(const CompressedLeafInt * leaf, std::vector<int> & keys, std::vector<RecordId> & rids){
+    const int count = leaf -> slotTaken;
+    keys.resize(count);
+    rids.resize(count);
+    const std::uint64_t * keyColumn = leaf -> words;
+    const std::uint64_t * pageColumn = keyColumn + columnWords(count, leaf -> keyBits);
+    const std::uint64_t * slotColumn = pageColumn + columnWords(count, leaf -> pageBits);
+    const int keyBits = leaf -> keyBits;
+    const int pageBits = leaf -> pageBits;
+    const int slotBits = leaf -> slotBits;
+    for(int i = 0; i < count; ++i){
+        keys[i] = (int)((std::uint32_t) leaf -> keyBase + unpackValue(keyColumn, i, keyBits));
+    }
+    for(int i = 0; i < count; ++i){
+        rids[i].page_number = leaf -> pageBase + unpackValue(pageColumn, i, pageBits);
+    }
+    for(int i = 0; i < count; ++i){
+        rids[i].slot_number = leaf -> slotBase + unpackValue(slotColumn, i, slotBits);
+    }
+}
+
+/**
+ * Insert a run of sorted (key, rid) pairs into a compressed leaf page.
+ * @param pid: the page id of the leaf page
+ * @param batch: the sorted (key, rid) pairs
+ * @param begin: the index of the first pair of the run in the batch
+ * @param end: the index after the last pair of the run in the batch
+ * @param searchPath: the non-leaf pages visited while searching for the leaf page
+ * @return the index after the last pair inserted
+ */
+const int BTreeIndex::insertCompressedRun(const PageId pid, const std::vector< RIDKeyPair<int> > & batch, const int begin, const int end,
+                                          std::vector<PageId> & searchPath){
+    Page * currPage;
+    this -> bufMgr -> readPage(this -> file, pid, currPage);
+    LeafView view;
+    this -> viewLeaf(currPage, view);
+    // merge the entries of the leaf page with the run
+    std::vector< RIDKeyPair<int> > merged;
+    merged.reserve(view.slotTaken + end - begin);
+    int i = 0; // the next entry of the leaf page
+    int j = begin; // the next pair of the run
+    while(i < view.slotTaken || j < end){
+        if(j < end && (i >= view.slotTaken || batch[j].key < view.keyArray[i])){
+            merged.push_back(batch[j]);
+            j++;
+        }
+        else{
+            RIDKeyPair<int> pair;
+            pair.set(view.ridArray[i], view.keyArray[i]);
+            merged.push_back(pair);
+            i++;
+        }
+    }
+    const std::size_t total = merged.size();
+
+    // the fewest leaf pages the entries fit into, filled greedily, give the
+    // number of pages. The entries are then spread evenly over them, with
+    // one more page whenever an even share does not fit.
+    int pieces = 0;
+    for(std::size_t first = 0; first < total; first += packLeaf(&merged[first], total - first, COMPRESSEDLEAFWORDS)){
+        pieces++;
+    }
+    std::vector<std::size_t> pieceBegin;
+    while(1){
+        pieceBegin.clear();
+        bool fits = true;
+        for(int p = 0; p <= pieces; ++p){
+            pieceBegin.push_back(total * p / pieces);
+        }
+        for(int p = 0; fits && p < pieces; ++p){
+            std::size_t size = pieceBegin[p + 1] - pieceBegin[p];
+            fits = (packLeaf(&merged[pieceBegin[p]], size, COMPRESSEDLEAFWORDS) == size);
+        }
+        if(fits){
+            break;
+        }
+        pieces++;
+    }
+
+    // the leaf page keeps the first piece, and new leaf pages linked in on
+    // its right take the others
+    std::vector<PageId> pageIds(pieces, pid);
+    std::vector<Page *> pages(pieces, currPage);
+    for(int p = 1; p < pieces; ++p){
+        this -> bufMgr -> allocPage(this -> file, pageIds[p], pages[p]);
+    }
+    const PageId rightSibPageNo = view.rightSibPageNo;
+    const PageId leftSibPageNo = view.leftSibPageNo;
+    for(int p = 0; p < pieces; ++p){
+        CompressedLeafInt * leafNode = (CompressedLeafInt *) pages[p];
+        encodeLeaf(&merged[pieceBegin[p]], (int)(pieceBegin[p + 1] - pieceBegin[p]), leafNode);
+        leafNode -> leftSibPageNo = (p == 0) ? leftSibPageNo : pageIds[p - 1];
+        leafNode -> rightSibPageNo = (p + 1 < pieces) ? pageIds[p + 1] : rightSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, pageIds[p], true);
+    }
+    if(pieces > 1 && rightSibPageNo != Page::INVALID_NUMBER){
+        Page * rightPage;
+        this -> bufMgr -> readPage(this -> file, rightSibPageNo, rightPage);
+        ((CompressedLeafInt *) rightPage) -> leftSibPageNo = pageIds[pieces - 1];
+        this -> bufMgr -> unPinPage(this -> file, rightSibPageNo, true);
+    }
+    this -> stats.leafCount += pieces - 1;
+    // the entries decoded for the scan may be the ones of this leaf page
+    this -> scanViewPageNum = Page::INVALID_NUMBER;
+
+    // push the first key of every new leaf page up, one at a time. Until its
+    // key is pushed up, a new leaf page is below the parent entry of the one
+    // on its left, so the search for its key finds the parent to insert into.
+    for(int p = 1; p < pieces; ++p){
+        int pushup = merged[pieceBegin[p]].key;
+        int leftCount = pieceBegin[p] - pieceBegin[p - 1];
+        int rightCount = total - pieceBegin[p];
+        std::vector<PageId> path;
+        if(p == 1){
+            path = searchPath;
+        }
+        else{
+            PageId leafPageId;
+            this -> searchLeafPageWithKey(&pushup, leafPageId, this -> rootPageNum, path);
+        }
+        if(path.empty()){
+            // the leaf page has been the root
+            this -> createAndInsertNewRoot(&pushup, pageIds[p - 1], pageIds[p], 1, leftCount, rightCount);
+        }
+        else{
+            PageId parentId = path.back();
+            path.pop_back();
+            this -> insertNonLeafNode(parentId, &pushup, pageIds[p], rightCount, leftCount, path, true);
+        }
+    }
+    return end;
+}
+
+/**
+ * The width of an attribute of a given type inside the records.
+ * @param type: the type of the attribute
+ * @return the width in bytes
+ */
+int BTreeIndex::attrWidth(const Datatype type){
+    switch(type){
+        case INTEGER:
+            return sizeof(int);
+        case DOUBLE:
+            return sizeof(double);
+        default:
+            // the size of string record is provided in the instruction file
+            return sizeof(char[64]);
+    }
+}
+
+/**
+ * Link a new leaf page into the sibling chain, right after the leaf page it has been split off from.
+ * @param pid: the page id of the leaf page which has been split up
+ * @param currLeafPage: the leaf page which has been split up
+ * @param newPageId: the page id of the new leaf page
+ * @param newLeafPage: the new leaf page, which holds the larger keys
+ */
+const void BTreeIndex::linkNewLeaf(const PageId pid, LeafNodeInt * currLeafPage, const PageId newPageId, LeafNodeInt * newLeafPage){
+    newLeafPage -> rightSibPageNo = currLeafPage -> rightSibPageNo;
+    newLeafPage -> leftSibPageNo = pid;
+    currLeafPage -> rightSibPageNo = newPageId;
+    // the old right sibling page now has the new leaf page on its left side
+    if(newLeafPage -> rightSibPageNo != Page::INVALID_NUMBER){
+        Page * rightPage;
+        this -> bufMgr -> readPage(this -> file, newLeafPage -> rightSibPageNo, rightPage);
+        ((LeafNodeInt *) rightPage) -> leftSibPageNo = newPageId;
+        this -> bufMgr -> unPinPage(this -> file, newLeafPage -> rightSibPageNo, true);
     }
 }
 
@@ -434,8 +1496,11 @@ const void BTreeIndex::splitLeafNode(PageId pid, const void *key,  const RecordI
  * @param leftPageId: the pageId on the left side of this new key
  * @param rightPageId: the pageId on the right side of this new key
  * @param level: the level of this non-leaf root page
+ * @param leftCount: the number of entries below the left page
+ * @param rightCount: the number of entries below the right page
  */
-const void BTreeIndex::createAndInsertNewRoot(const void *key, const PageId leftPageId, const PageId rightPageId, int level){
+const void BTreeIndex::createAndInsertNewRoot(const void *key, const PageId leftPageId, const PageId rightPageId, int level,
+                                              const int leftCount, const int rightCount){
     PageId rootId;
     Page * rootPage;
     // allocate a page for the new non-leaf root
@@ -446,10 +1511,14 @@ const void BTreeIndex::createAndInsertNewRoot(const void *key, const PageId left
     nonLeafRootPage -> keyArray[0]= *((int*) key);
     nonLeafRootPage -> pageNoArray[0] = leftPageId;
     nonLeafRootPage -> pageNoArray[1] = rightPageId;
+    nonLeafRootPage -> countArray[0] = leftCount;
+    nonLeafRootPage -> countArray[1] = rightCount;
     nonLeafRootPage -> slotTaken += 1;
+    this -> writeKeyBlocks(nonLeafRootPage);
     this -> bufMgr -> unPinPage(this -> file, rootId, true);
     // update the private var and the vars in the meta page
     this -> rootIsLeaf = false;
+    this -> stats.height++;
     this -> rootPageNum = rootId;
     Page * metaPage;
     this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
@@ -465,12 +1534,15 @@ const void BTreeIndex::createAndInsertNewRoot(const void *key, const PageId left
  * @param key: the new key or the pushup-ed key from lower level
  * @param leftPageId: the pageId of the newly created page in the lower level and need to insert this pageId on the left side of the new key.
  * Remark: if this key is actually inserted from a lower leaf page, then the newly created pageId is actually for the right pageId.
+ * @param newCount: the number of entries below the newly created page
+ * @param oldCount: the number of entries left below the page which has been split up
  * @param searchPath: the search path leading toward this current non-leaf node.
  * Remark: the searchPath does not contain the pageId of this current node.
  * @param: fromLeaf: is the bool var, true means inserting up from a leaf node. false means from a
  * nonleaf node.
  */
-const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const PageId leftPageId, std::vector<PageId> searchPath, bool fromLeaf){
+const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const PageId leftPageId, const int newCount, const int oldCount,
+                                         std::vector<PageId> searchPath, bool fromLeaf){
     Page * currPage;
     this -> bufMgr -> readPage(this -> file, pid, currPage);
     NonLeafNodeInt * currNonLeafPage = (NonLeafNodeInt*) currPage;
@@ -488,12 +1560,14 @@ const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const Page
         // shift the slot for the pageId corresponding to the greatest key upper by 1. We know that the newly inserted key will at most belong to the page pointed by the pageId corresponding to the greatest key.
         // Thus, the newly inserted pageId will be on the left of this pageId corresponding to the greatest key for sure.
         currNonLeafPage -> pageNoArray[currNonLeafPage -> slotTaken + 1] =  currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken];
+        currNonLeafPage -> countArray[currNonLeafPage -> slotTaken + 1] =  currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken];
         for(i = 0; i <  currNonLeafPage -> slotTaken; ++i){
             // shift all the slots with key value larger than this
             // target key into the slots upper by 1.
             if( currNonLeafPage -> keyArray[ currNonLeafPage -> slotTaken - 1 - i] >  *((int *) key)){
                  currNonLeafPage -> keyArray[ currNonLeafPage -> slotTaken - i] =  currNonLeafPage -> keyArray[ currNonLeafPage -> slotTaken - 1 - i];
                  currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken - i] =  currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken - 1 - i];
+                 currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken - i] =  currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken - 1 - i];
             }
             // the only case in the else is where the key value in
             // the slot "currLeafPage -> slotTaken - 1 - i" is less than
@@ -508,6 +1582,8 @@ const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const Page
         if(fromLeaf == false){
          currNonLeafPage -> keyArray[ currNonLeafPage -> slotTaken - i] = *((int *) key);
          currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken - i] = leftPageId;
+         currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken - i] = newCount;
+         currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken - i + 1] = oldCount;
         }
         else{
             // if the new key is inserted from a leaf node, then the new
@@ -516,10 +1592,13 @@ const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const Page
             currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken - i + 1] = leftPageId;
             currNonLeafPage -> keyArray[ currNonLeafPage -> slotTaken - i] = *((int *) key);
             currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken - i] = CorrectLeftPageId;
+            currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken - i] = oldCount;
+            currNonLeafPage -> countArray[ currNonLeafPage -> slotTaken - i + 1] = newCount;
         }
         // update the amount of slots being taken up in the
         // leaf index page
          currNonLeafPage -> slotTaken += 1;
+        this -> writeKeyBlocks(currNonLeafPage);
         // unpin this non-leaf index page
         this -> bufMgr -> unPinPage(this -> file, pid, true);
         return;
@@ -530,7 +1609,7 @@ const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const Page
         // unpin the current leaf page pinned in this function
         this -> bufMgr -> unPinPage(this -> file, pid, false);
         // we need to split this non-leaf page up into two parts
-        this -> splitNonLeafNode(pid, key, leftPageId, searchPath, fromLeaf);
+        this -> splitNonLeafNode(pid, key, leftPageId, newCount, oldCount, searchPath, fromLeaf);
     }
 }
 
@@ -540,14 +1619,16 @@ const void BTreeIndex::insertNonLeafNode(PageId pid, const void *key, const Page
  * @param key: the new key needed to be inserted
  * @param leftPageId: the pageId of the newly created page in the lower level and need to insert this pageId on the left side of the new key
  * Remark: if this key is actually inserted from a lower leaf page, then the newly created pageId is actually for the right pageId.
+ * @param newCount: the number of entries below the newly created page
+ * @param oldCount: the number of entries left below the page which has been split up
  * @param searchPath: a vector of PageId contains all the PageId of the pages we have
  *  visited along our search path. The purpose of this vector is to benefit our insert later.
  *  Remark: the searchPath does not contain the pageId of this current node.
  *   @param: fromLeaf: is the bool var, true means inserting up from a leaf node. false means from a nonleaf node.
  */
-const void BTreeIndex::splitNonLeafNode(PageId pid, const void *key,  const PageId leftPageId, std::vector<PageId> & searchPath, bool fromLeaf){
+const void BTreeIndex::splitNonLeafNode(PageId pid, const void *key,  const PageId leftPageId, const int newCount, const int oldCount,
+                                        std::vector<PageId> & searchPath, bool fromLeaf){
     // most part of this function should be similar to the splitLeafNode function. However, in this splitNonLeaf case, we don't copy,i.e. keep, the pushup value any more.
-    // TODO.
     Page * currPage;
     this -> bufMgr -> readPage(this -> file, pid, currPage);
     NonLeafNodeInt * currNonLeafPage = (NonLeafNodeInt*) currPage;
@@ -555,184 +1636,78 @@ const void BTreeIndex::splitNonLeafNode(PageId pid, const void *key,  const Page
     PageId newPageId;
     this -> bufMgr -> allocPage(this -> file, newPageId, newPage);
     NonLeafNodeInt * newNonLeafPage = (NonLeafNodeInt*) newPage;
-    // initialize the variable in this new leaf node
-    newNonLeafPage -> slotTaken = 0;
     newNonLeafPage -> level = currNonLeafPage -> level;
-    // we need to split this current non-leaf page up into two parts,
-    // by the sizes of nodeOccupancy / 2 and nodeOccupancy / 2 + 1
-    bool newKeyInserted = false; // var to keep track whether the new
-    // key has been inserted or not.
-    int pushup; // the key value needed to push up into the upper layer non-leaf node
-    int threshold; // # of keys to split up the non-leaf node
-    if(this -> nodeOccupancy % 2 == 0){
-        threshold = this -> nodeOccupancy / 2;
+
+    // merge the new key into the keys, pages and entry counts of this
+    // current non-leaf page first, which gives nodeOccupancy + 1 keys and
+    // nodeOccupancy + 2 pages.
+    const int total = this -> nodeOccupancy + 1;
+    std::vector<int> mergedKeys(total);
+    std::vector<PageId> mergedPages(total + 1);
+    std::vector<int> mergedCounts(total + 1);
+    // the slot of the new key, which is also the slot of the page which
+    // has been split up in the lower level
+    int position = 0;
+    while(position < this -> nodeOccupancy && currNonLeafPage -> keyArray[position] < *((int *) key)){
+        position++;
+    }
+    for(int i = 0; i < this -> nodeOccupancy; ++i){
+        mergedKeys[(i < position) ? i : i + 1] = currNonLeafPage -> keyArray[i];
+    }
+    for(int i = 0; i <= this -> nodeOccupancy; ++i){
+        mergedPages[(i <= position) ? i : i + 1] = currNonLeafPage -> pageNoArray[i];
+        mergedCounts[(i <= position) ? i : i + 1] = currNonLeafPage -> countArray[i];
+    }
+    mergedKeys[position] = *((int *) key);
+    if(fromLeaf == false){
+        // the newly created page is on the left side of the new key
+        mergedPages[position + 1] = mergedPages[position];
+        mergedCounts[position + 1] = oldCount;
+        mergedPages[position] = leftPageId;
+        mergedCounts[position] = newCount;
     }
     else{
-        threshold = this -> nodeOccupancy / 2 + 1;
+        // if the new key is inserted from a leaf node, then the newly
+        // created page is on the right side of the new key
+        mergedPages[position + 1] = leftPageId;
+        mergedCounts[position + 1] = newCount;
+        mergedCounts[position] = oldCount;
     }
-    for(int i= 0; i < this -> nodeOccupancy; ++i){
-        if( currNonLeafPage -> keyArray[i] < *((int *)key)){
-            if(newNonLeafPage -> slotTaken < threshold){
-                newNonLeafPage -> keyArray[i] =  currNonLeafPage -> keyArray[i];
-                newNonLeafPage -> pageNoArray[i] =  currNonLeafPage -> pageNoArray[i];
-                newNonLeafPage -> slotTaken += 1;
-                 currNonLeafPage -> slotTaken -= 1;
-            }
-            // this is the breaking up of the currNonLeafPage's keys,
-            // which is the first key left in the current non-leaf page,
-            // i.e. the first key that cannot be inserted in the new non-leaf node.
-            // However, in the non-leaf node pushup, we don't need to
-            // copy the element needed to push up in our current non-leaf page.
-            // Therefore, we will not store it in the current non-leaf page.
-            // Instead, we will directly push up and insert this key into the upper level parent non-leaf page.
-            else if(newNonLeafPage -> slotTaken == threshold){
-                // push up this key to break up the new non-leaf Node and the current non-leaf node.
-                pushup =  currNonLeafPage -> keyArray[i];
-                // Even though we don't copy or store the value of this key in any non-leaf node in this level, we cannot
-                // lose the pageId that this key is corresponding to.
-                // We will store the pageId corresponding to this pushup key at the end of the new non-leaf node.
-                newNonLeafPage -> pageNoArray[newNonLeafPage -> slotTaken] =  currNonLeafPage -> pageNoArray[i];
-                 currNonLeafPage -> slotTaken -= 1;
-            }
-            else{
-                // shift down the rest slots in this current non-leaf page (there have newNonLeafPage -> slotTaken + 1 slots being removed from this current non-leaf page in the front already.)
-                 currNonLeafPage -> keyArray[i - newNonLeafPage -> slotTaken - 1] =   currNonLeafPage -> keyArray[i];
-                 currNonLeafPage -> pageNoArray[i - newNonLeafPage -> slotTaken - 1] =   currNonLeafPage -> pageNoArray[i];
-            }
-        }
-        else{
-            if(newKeyInserted == false){
-                // this is the first time we meet an exisitng key
-                // larger than the new key value.
-                // We should insert in the new key first.
-                if(newNonLeafPage -> slotTaken < threshold){
-                    newNonLeafPage -> keyArray[i] = *((int *)key);
-                    // it is remarked the right pageId of this new key
-                    // has not been changed and it should still be pointing to the slots that this new key used to belong to.
-                    if(fromLeaf == false){
-                        newNonLeafPage -> pageNoArray[i] = leftPageId;
-                    }
-                    else{
-                        PageId trueLeftPageId = currNonLeafPage -> pageNoArray[i];
-                        currNonLeafPage -> pageNoArray[i] = leftPageId;
-                        newNonLeafPage -> pageNoArray[i] = trueLeftPageId;
-                    }
-                    newNonLeafPage -> slotTaken += 1;
-                    newKeyInserted = true;
-                }
-                // this is the breaking up of the currNonLeafPage's keys,
-                // which is the first key left in the current non-leaf page,
-                // i.e. the first key that cannot be inserted in the new non-leaf node.
-                // However, in the non-leaf node pushup, we don't need to
-                // copy the element needed to push up in our current non-leaf page.
-                // Therefore, we will not store it in the current non-leaf page.
-                // Instead, we will directly push up and insert this key into the upper level parent non-leaf page.
-                else if(newNonLeafPage -> slotTaken == threshold){
-                    // push up this key to break up the new non-leaf Node and the current non-leaf node.
-                    pushup = *((int *)key);
-                    // Even though we don't copy or store the value of this key in any non-leaf node in this level, we cannot
-                    // lose the pageId that this key is corresponding to.
-                    // We will store the pageId corresponding to this pushup key at the end of the new non-leaf node.
-                    if(fromLeaf == false){
-                        newNonLeafPage -> pageNoArray[newNonLeafPage -> slotTaken] = leftPageId;
-                    }
-                    else{
-                        PageId trueLeftPageId = currNonLeafPage -> pageNoArray[i];
-                        currNonLeafPage -> pageNoArray[i] = leftPageId;
-                        newNonLeafPage -> pageNoArray[newNonLeafPage -> slotTaken] = trueLeftPageId;
-                    }
-                    newKeyInserted = true;
-                }
-                // this is the case where we have to insert this new key
-                // into the current non-leaf page
-                else{
-                    // shift down the slots in this current non-leaf page
-                    // in this case, there are  currNonLeafPage -> slotTaken + 1 amount of slots having been moved away from this current non-leaf page already.
-                     currNonLeafPage -> keyArray[i - newNonLeafPage -> slotTaken - 1] =  *((int*)key);
-                    if(fromLeaf == false){
-                     currNonLeafPage -> pageNoArray[i - newNonLeafPage -> slotTaken - 1] =  leftPageId;
-                    }
-                    else{
-                        PageId trueLeftPageId = currNonLeafPage -> pageNoArray[i];
-                        currNonLeafPage -> pageNoArray[i] = leftPageId;
-                        currNonLeafPage -> pageNoArray[i - newNonLeafPage -> slotTaken - 1] =  trueLeftPageId;
-                    }
-                     currNonLeafPage -> slotTaken += 1;
-                    newKeyInserted = true;
-                }
-            }
-            // this is the part under when the new key has been
-            // inserted already
-            // now, we have to re-position the original i-th slot of the current non-leaf node
-            if(newNonLeafPage -> slotTaken < threshold){
-                newNonLeafPage -> keyArray[i+1] =  currNonLeafPage -> keyArray[i];
-                newNonLeafPage -> pageNoArray[i+1] =  currNonLeafPage -> pageNoArray[i];
-                newNonLeafPage -> slotTaken += 1;
-                 currNonLeafPage -> slotTaken -= 1;
-            }
-            // this is the breaking up of the currNonLeafPage's keys,
-            // which is the first key left in the current non-leaf page,
-            // i.e. the first key that cannot be inserted in the new non-leaf node.
-            // However, in the non-leaf node pushup, we don't need to
-            // copy the element needed to push up in our current non-leaf page.
-            // Therefore, we will not store it in the current non-leaf page.
-            // Instead, we will directly push up and insert this key into the upper level parent non-leaf page.
-            else if(newNonLeafPage -> slotTaken == threshold){
-                // push up this key to break up the new non-leaf Node and the current non-leaf node.
-                pushup =  currNonLeafPage -> keyArray[i];
-                // Even though we don't copy or store the value of this key in any non-leaf node in this level, we cannot
-                // lose the pageId that this key is corresponding to.
-                // We will store the pageId corresponding to this pushup key at the end of the new non-leaf node.
-                newNonLeafPage -> pageNoArray[newNonLeafPage -> slotTaken] =  currNonLeafPage -> pageNoArray[i];
-                 currNonLeafPage -> slotTaken -= 1;
-            }
-            else{
-                // shift down the slots in this current non-leaf page
-                // It is clear that there are exact newNonLeafPage -> slotTaken amount of slots being removed
-                // away from this current non-leaf page.
-                 currNonLeafPage -> keyArray[i - newNonLeafPage -> slotTaken] =   currNonLeafPage -> keyArray[i];
-                 currNonLeafPage -> pageNoArray[i - newNonLeafPage -> slotTaken] =   currNonLeafPage -> pageNoArray[i];
-            }
-        }
+
+    // we will let the new non-leaf page take the smaller keys, and the
+    // current non-leaf page keep the larger keys. The key in between is
+    // pushed up, and not kept in this level.
+    int threshold; // # of keys to split up the non-leaf node
+    if(this -> nodeOccupancy % 2 == 0){
+        threshold = this -> nodeOccupancy / 2;
     }
-    
-    // it is remarked that during the for loop, we are only
-    // shifting the pair of (leftPageId, key) around the current non-leaf node.
-    // However, the original pageId at the end of the current non-leaf node has not been checked yet.
-    // Now, we should move the original pageId at the end of the current non-leaf node, index at nodeOccupancy, to the correct position,
-    // which should be the end of the updated pageNoArray of this current non-leaf node, at index  currNonLeafPage -> slotTaken.
-     currNonLeafPage -> pageNoArray[currNonLeafPage -> slotTaken] =  currNonLeafPage -> pageNoArray[this -> nodeOccupancy];
-    
-    // another speical case is when all the keys in current non-leaf node are smaller than the new key.
-    // Then, based on the current code, we have not inserted the new key yet.
-    if(newKeyInserted == false){
-        
-        // DEBUG ONLY
-        if(currNonLeafPage -> slotTaken + newNonLeafPage -> slotTaken != this -> nodeOccupancy)
-            std::cout << "the specail case of all keys smaller than new is wrong! the new key is inserted already!" << std::endl;
-        
-        currNonLeafPage -> pageNoArray[currNonLeafPage -> slotTaken] = *((int *) key);
-        if(fromLeaf == false){
-            // the pageId currently at the end of the list should be on the right of this key
-            PageId trueRightPage = currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken];
-            currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken] = leftPageId;
-            currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken + 1] = trueRightPage;
-        }
-        else{
-            currNonLeafPage -> pageNoArray[ currNonLeafPage -> slotTaken + 1] = leftPageId;
-        }
-        newKeyInserted = true;
-        currNonLeafPage -> slotTaken += 1;
+    else{
+        threshold = this -> nodeOccupancy / 2 + 1;
     }
-    
-    // DEBUG ONLY:
-    // to check wether some key and pageId pairs are missing
-    if(currNonLeafPage -> slotTaken + newNonLeafPage -> slotTaken != this -> nodeOccupancy + 1)
-        std::cout << "the final amount of inserting key into non-leaf and split is wrong!!!! And current total amount is: " << currNonLeafPage -> slotTaken + newNonLeafPage -> slotTaken << " , but expected to be: "<< this -> nodeOccupancy + 1 << std::endl;
-    // check whether the new key has been inserted
-    if(newKeyInserted == false)
-        std::cout << "the new key has not been inserted yet!!!!" << std::endl;
-    
+    int pushup = mergedKeys[threshold]; // the key value needed to push up into the upper layer non-leaf node
+    int newSum = 0; // the number of entries below the new non-leaf page
+    int currSum = 0; // the number of entries below the current non-leaf page
+    newNonLeafPage -> slotTaken = threshold;
+    for(int i = 0; i < threshold; ++i){
+        newNonLeafPage -> keyArray[i] = mergedKeys[i];
+    }
+    for(int i = 0; i <= threshold; ++i){
+        newNonLeafPage -> pageNoArray[i] = mergedPages[i];
+        newNonLeafPage -> countArray[i] = mergedCounts[i];
+        newSum += mergedCounts[i];
+    }
+    currNonLeafPage -> slotTaken = total - threshold - 1;
+    for(int i = threshold + 1; i < total; ++i){
+        currNonLeafPage -> keyArray[i - threshold - 1] = mergedKeys[i];
+    }
+    for(int i = threshold + 1; i <= total; ++i){
+        currNonLeafPage -> pageNoArray[i - threshold - 1] = mergedPages[i];
+        currNonLeafPage -> countArray[i - threshold - 1] = mergedCounts[i];
+        currSum += mergedCounts[i];
+    }
+    this -> writeKeyBlocks(newNonLeafPage);
+    this -> writeKeyBlocks(currNonLeafPage);
+
     this -> bufMgr -> unPinPage(this -> file, pid, true);
     this -> bufMgr -> unPinPage(this -> file, newPageId, true);
     
@@ -740,7 +1715,7 @@ const void BTreeIndex::splitNonLeafNode(PageId pid, const void *key,  const Page
     if(searchPath.size() == 0){
         // case when this current page is a root. Then, we need to
         // create a new non-leaf root.
-        this -> createAndInsertNewRoot(&pushup, newPageId, pid, 0);
+        this -> createAndInsertNewRoot(&pushup, newPageId, pid, 0, newSum, currSum);
         // since this is a non-leaf node, then the nodes above this one
         // must be at level = 0 for sure.
     }
@@ -750,7 +1725,7 @@ const void BTreeIndex::splitNonLeafNode(PageId pid, const void *key,  const Page
         PageId parentId = searchPath[searchPath.size() - 1];
         // delete the parentId from the searchPath, to generate the search path for the parentId
         searchPath.erase(searchPath.begin() + searchPath.size() - 1);
-        this -> insertNonLeafNode(parentId, &pushup, newPageId, searchPath, false);
+        this -> insertNonLeafNode(parentId, &pushup, newPageId, newSum, currSum, searchPath, false);
     }
 }
 
@@ -763,24 +1738,26 @@ const void BTreeIndex::splitNonLeafNode(PageId pid, const void *key,  const Page
  * @param searchPath: a vector of PageId contains all the PageId of the pages we have
  *  visited along our search path. The purpose of this vector is to benefit our insert later.
  *  It is remarked that the last leaf page id is not in this searchPath.
+ * @param upperKey: if not NULL, returns the smallest separator key on the search path which is larger than the key
+ * @param upperKeyValid: if not NULL, returns whether such a separator key exists
  */
-const void BTreeIndex::searchLeafPageWithKey(const void *key, PageId & pid, PageId currentPageId, std::vector<PageId> & searchPath){
+const void BTreeIndex::searchLeafPageWithKey(const void *key, PageId & pid, PageId currentPageId, std::vector<PageId> & searchPath,
+                                             int * upperKey, bool * upperKeyValid){
     Page * currPage;
     this -> bufMgr -> readPage(this -> file, currentPageId, currPage);
     NonLeafNodeInt * currNode = (NonLeafNodeInt *) currPage;
 
-    int targetIndex = 0;
     int slotAvailable = currNode -> slotTaken;
-    
-    while(targetIndex < slotAvailable){
-        if(*((int *) key) < currNode -> keyArray[targetIndex]){
-            break;
-        }
-        else{
-            targetIndex++;
+    int targetIndex = this -> childIndex(currNode, *((int *) key));
+    PageId updateCurrPageNum = currNode -> pageNoArray[targetIndex];
+    // the separator key on the right of the child page bounds the key
+    // range of the child page. The deeper the level, the tighter the bound.
+    if(upperKey != NULL && targetIndex < slotAvailable){
+        *upperKey = currNode -> keyArray[targetIndex];
+        if(upperKeyValid != NULL){
+            *upperKeyValid = true;
         }
     }
-    PageId updateCurrPageNum = currNode -> pageNoArray[targetIndex];
     // check if the next lower level node is leaf node or not
     if(currNode -> level == 1){
         this -> bufMgr -> unPinPage(this -> file, currentPageId, false);
@@ -795,10 +1772,65 @@ const void BTreeIndex::searchLeafPageWithKey(const void *key, PageId & pid, Page
         this -> bufMgr -> unPinPage(this -> file, currentPageId, false);
         searchPath.push_back(currentPageId);
         // we keep on doing the recursion
-        this -> searchLeafPageWithKey(key, pid, updateCurrPageNum, searchPath);
+        this -> searchLeafPageWithKey(key, pid, updateCurrPageNum, searchPath, upperKey, upperKeyValid);
     }
 }
 
+/**
+ * Add to the entry counts of the child pages on the search path of a key.
+ * @param key: the key whose search path is updated
+ * @param searchPath: the non-leaf pages visited while searching for the leaf page of the key, from the root down
+ * @param delta: the number of entries inserted below the search path
+ */
+const void BTreeIndex::addToPathCounts(const int key, const std::vector<PageId> & searchPath, const int delta){
+    for(std::size_t i = 0; i < searchPath.size(); ++i){
+        Page * currPage;
+        this -> bufMgr -> readPage(this -> file, searchPath[i], currPage);
+        NonLeafNodeInt * currNode = (NonLeafNodeInt *) currPage;
+        // find the child page on the search path the same way as
+        // searchLeafPageWithKey does
+        int targetIndex = this -> childIndex(currNode, key);
+        currNode -> countArray[targetIndex] += delta;
+        this -> bufMgr -> unPinPage(this -> file, searchPath[i], true);
+    }
+}
+
+/**
+ * Count the entries whose key is smaller than a key, or smaller than or equal to it.
+ * @param key: the key
+ * @param inclusive: whether the entries with the key itself are counted too
+ * @return the number of entries found
+ */
+const int BTreeIndex::countBelow(const int key, const bool inclusive){
+    int count = 0;
+    PageId currPageId = this -> rootPageNum;
+    bool isLeaf = this -> rootIsLeaf;
+    while(isLeaf == false){
+        Page * currPage;
+        this -> bufMgr -> readPage(this -> file, currPageId, currPage);
+        NonLeafNodeInt * currNode = (NonLeafNodeInt *) currPage;
+        // every entry below the child pages on the left of the search
+        // path has a smaller key
+        int targetIndex = this -> childIndex(currNode, key);
+        for(int i = 0; i < targetIndex; ++i){
+            count += currNode -> countArray[i];
+        }
+        PageId nextPageId = currNode -> pageNoArray[targetIndex];
+        isLeaf = (currNode -> level == 1);
+        this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+        currPageId = nextPageId;
+    }
+    Page * leafPage;
+    this -> bufMgr -> readPage(this -> file, currPageId, leafPage);
+    LeafView view;
+    LeafView * leafNode = this -> viewLeaf(leafPage, view);
+    // the keys in the leaf page are sorted, so search for the first slot
+    // not counted
+    count += this -> leafPosition(leafNode -> keyArray, leafNode -> slotTaken, key, inclusive);
+    this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+    return count;
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::startScan
 // -----------------------------------------------------------------------------
@@ -814,11 +1846,13 @@ const void BTreeIndex::searchLeafPageWithKey(const void *key, PageId & pid, Page
  * @param lowOpParm The operation to be used in testing the low range.
  * @param highValParm The high value to be tested.
  * @param highOpParm The operation to be used in testing the high range.
+ * @param orderParm The order in which scanNext returns the entries.
  */
 const void BTreeIndex::startScan(const void* lowValParm,
 				   const Operator lowOpParm,
 				   const void* highValParm,
-				   const Operator highOpParm)
+				   const Operator highOpParm,
+				   const ScanOrder orderParm)
 {
     /*
     // DEBUG ONLY
@@ -900,6 +1934,12 @@ const void BTreeIndex::startScan(const void* lowValParm,
     this -> scanExecuting = true;
     this -> lowOp = lowOpParm;
     this -> highOp = highOpParm;
+    this -> scanOrder = orderParm;
+    if(this -> scanOrder == DESCENDING){
+        // a descending scan starts from the high end of the range instead
+        this -> startDescendingScan();
+        return;
+    }
     
     PageId pid; // the page potentially containing the lowVal we want to find
     std::vector<PageId> searchPath; // the vector containing the path along searching
@@ -918,7 +1958,7 @@ const void BTreeIndex::startScan(const void* lowValParm,
     // update the currentPageNum & currentPageData & nextEntry
     this -> currentPageNum = pid;
     this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
-    LeafNodeInt * leafNode = (LeafNodeInt*) currentPageData;
+    LeafView * leafNode = this -> currentLeaf();
     /*
     // DEBUG ONLY
     std::cout << "page search pid : "<< pid << " , slots taken: " << leafNode -> slotTaken << " , first few keys: " << leafNode -> keyArray[0] << " , second elem: " << leafNode -> keyArray[1] << std::endl;
@@ -966,6 +2006,222 @@ const void BTreeIndex::startScan(const void* lowValParm,
     this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
 }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::startMultiScan
+// -----------------------------------------------------------------------------
+/**
+ * Begin a scan of several sorted ranges of the index.
+ * @param ranges The ranges to scan
+ */
+const void BTreeIndex::startMultiScan(const std::vector<ScanRange> & ranges)
+{
+    // check the operators and the order of the ranges first
+    for(std::size_t i = 0; i < ranges.size(); ++i){
+        if(ranges[i].lowOp != GT && ranges[i].lowOp != GTE){
+            throw BadOpcodesException();
+        }
+        if(ranges[i].highOp != LT && ranges[i].highOp != LTE){
+            throw BadOpcodesException();
+        }
+        if(ranges[i].lowVal > ranges[i].highVal){
+            throw BadScanrangeException();
+        }
+        // every range has to start after the previous one ends, a shared
+        // bound may only be taken by one of them
+        if(i > 0 && (ranges[i].lowVal < ranges[i - 1].highVal
+                     || (ranges[i].lowVal == ranges[i - 1].highVal && ranges[i].lowOp == GTE && ranges[i - 1].highOp == LTE))){
+            throw BadScanrangeException();
+        }
+    }
+    // If another scan is already executing, that needs to be ended here.
+    if(this -> scanExecuting == true){
+        this -> endScan();
+    }
+    this -> scanExecuting = true;
+    this -> scanOrder = ASCENDING;
+    this -> multiRangeScan = true;
+    this -> scanRanges = ranges;
+    this -> currentRange = -1;
+    // no leaf page has been read yet, so the first range descends from the root
+    this -> currentPageNum = Page::INVALID_NUMBER;
+    if(this -> seekNextRange() == false){
+        endScan();
+        throw NoSuchKeyFoundException();
+    }
+}
+
+/**
+ * Check whether a key satisfies the low bound of the current scan.
+ * @param key: the key
+ * @return true if the key is within the low bound
+ */
+const bool BTreeIndex::satisfiesLow(const int key){
+    return key > this -> lowValInt || (key == this -> lowValInt && this -> lowOp == GTE);
+}
+
+/**
+ * Set up a descending scan, starting from the leaf page holding the high value.
+ */
+const void BTreeIndex::startDescendingScan(){
+    PageId pid; // the page potentially containing the highVal we want to find
+    std::vector<PageId> searchPath; // the vector containing the path along searching
+    if (this -> rootIsLeaf){
+        pid = this -> rootPageNum;
+    }
+    else{
+        this -> searchLeafPageWithKey(&(this -> highValInt), pid, this -> rootPageNum, searchPath);
+    }
+    this -> currentPageNum = pid;
+    this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+    LeafView * leafNode = this -> currentLeaf();
+    // find the last entry within the high bound, i.e. the one before the
+    // first key larger than (LTE) or equal to (LT) the high value
+    int entry = this -> leafPosition(leafNode -> keyArray, leafNode -> slotTaken, this -> highValInt, this -> highOp == LTE) - 1;
+    // all the keys of this leaf page may be beyond the high value. Every
+    // key of the leaf pages on the left side is smaller than the separator
+    // key leading to this leaf page, so they are all within the high bound.
+    while(entry < 0 && leafNode -> leftSibPageNo != Page::INVALID_NUMBER){
+        PageId prevPage = leafNode -> leftSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        this -> currentPageNum = prevPage;
+        this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+        leafNode = this -> currentLeaf();
+        entry = leafNode -> slotTaken - 1;
+    }
+    if(entry < 0 || this -> satisfiesLow(leafNode -> keyArray[entry]) == false){
+        // throw error if none satisfied page exist, and call endScan before throwing
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        endScan();
+        throw NoSuchKeyFoundException();
+    }
+    this -> nextEntry = entry;
+    this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+}
+
+/**
+ * Fetch the record id of the next index entry of a descending scan.
+ * @param outRid: the record id of the next entry that matches the scan filter set in startScan.
+ * @param outIncluded: if not NULL, returns the included attribute values of the entry
+ */
+const void BTreeIndex::scanNextDescending(RecordId & outRid, void * outIncluded){
+    // we use the nextEntry == -2 to represent that there is no more
+    // satisfied records later, as in scanNext
+    if(this -> nextEntry == -2){
+        throw IndexScanCompletedException();
+    }
+    this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+    LeafView * currPage = this -> currentLeaf();
+    outRid = currPage -> ridArray[this -> nextEntry];
+    if(outIncluded != NULL){
+        memcpy(outIncluded, currPage -> includedArray + (std::size_t) this -> nextEntry * this -> includedWidth, this -> includedWidth);
+    }
+    // move the scanner to the previous entry, which is on the left sibling
+    // page if this was the first entry of the current page
+    this -> nextEntry -= 1;
+    while(this -> nextEntry < 0 && currPage -> leftSibPageNo != Page::INVALID_NUMBER){
+        PageId prevPage = currPage -> leftSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        this -> currentPageNum = prevPage;
+        this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+        currPage = this -> currentLeaf();
+        this -> nextEntry = currPage -> slotTaken - 1;
+    }
+    if(this -> nextEntry < 0 || this -> satisfiesLow(currPage -> keyArray[this -> nextEntry]) == false){
+        // the scan is complete
+        this -> nextEntry = -2;
+    }
+    this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+}
+
+/**
+ * Place the cursor of the current scan on the first entry within the low bound.
+ * @return false if there is no entry within the low bound at all
+ */
+const bool BTreeIndex::seekLow(){
+    // the first slot of a leaf page within the low bound, slotTaken if there is none
+    const int lowVal = this -> lowValInt;
+    const Operator lowOp = this -> lowOp;
+    auto firstWithinLow = [this, lowVal, lowOp](const LeafView * leafNode){
+        return this -> leafPosition(leafNode -> keyArray, leafNode -> slotTaken, lowVal, lowOp == GT);
+    };
+    LeafView * leafNode = NULL;
+    int entry = 0;
+    if(this -> currentPageNum != Page::INVALID_NUMBER){
+        // every key before the cursor is smaller than the low value, so if
+        // the current leaf page or its right sibling holds a key within the
+        // low bound, the first one is there
+        this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+        leafNode = this -> currentLeaf();
+        entry = firstWithinLow(leafNode);
+        if(entry == leafNode -> slotTaken && leafNode -> rightSibPageNo != Page::INVALID_NUMBER){
+            PageId nextPage = leafNode -> rightSibPageNo;
+            this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+            this -> currentPageNum = nextPage;
+            this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+            leafNode = this -> currentLeaf();
+            entry = firstWithinLow(leafNode);
+        }
+        if(entry == leafNode -> slotTaken){
+            // the range starts further away, so descend from the root
+            this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+            leafNode = NULL;
+        }
+    }
+    if(leafNode == NULL){
+        std::vector<PageId> searchPath;
+        if(this -> rootIsLeaf){
+            this -> currentPageNum = this -> rootPageNum;
+        }
+        else{
+            this -> searchLeafPageWithKey(&(this -> lowValInt), this -> currentPageNum, this -> rootPageNum, searchPath);
+        }
+        this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+        leafNode = this -> currentLeaf();
+        entry = firstWithinLow(leafNode);
+        // the keys of the leaf page may all be smaller than the low value,
+        // then the first key within the low bound is on the right sibling
+        if(entry == leafNode -> slotTaken && leafNode -> rightSibPageNo != Page::INVALID_NUMBER){
+            PageId nextPage = leafNode -> rightSibPageNo;
+            this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+            this -> currentPageNum = nextPage;
+            this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+            leafNode = this -> currentLeaf();
+            entry = 0;
+        }
+    }
+    bool found = (entry < leafNode -> slotTaken);
+    this -> nextEntry = found ? entry : -2;
+    this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+    return found;
+}
+
+/**
+ * Move a multi-range scan on to the next range which has an entry.
+ * @return false if none of the ranges left has an entry
+ */
+const bool BTreeIndex::seekNextRange(){
+    while(++(this -> currentRange) < (int) this -> scanRanges.size()){
+        const ScanRange & range = this -> scanRanges[this -> currentRange];
+        this -> lowValInt = range.lowVal;
+        this -> lowOp = range.lowOp;
+        this -> highValInt = range.highVal;
+        this -> highOp = range.highOp;
+        if(this -> seekLow() == false){
+            // there is no key left within the low bound of any of the ranges
+            break;
+        }
+        // check whether the entry found is within the high bound as well
+        this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
+        int key = this -> currentLeaf() -> keyArray[this -> nextEntry];
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        if(key < this -> highValInt || (key == this -> highValInt && this -> highOp == LTE)){
+            return true;
+        }
+    }
+    this -> nextEntry = -2;
+    return false;
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::scanNext
 // -----------------------------------------------------------------------------
@@ -984,14 +2240,27 @@ const void BTreeIndex::startScan(const void* lowValParm,
  *
  * @param outRid An output value;This is the record id of the next entry
  *                that matches the scan filter set in startScan.
+ * @param outIncluded If not NULL, an output value; the included attribute
+ *                values of that entry, if the index is a covering index.
  */
-const void BTreeIndex::scanNext(RecordId& outRid) 
+const void BTreeIndex::scanNext(RecordId& outRid, void* outIncluded) 
 {
     // throws ScanNotInitializedException
     // If no scan has been initialized.
     if(this -> scanExecuting == false){
         throw ScanNotInitializedException();
     }
+    if(this -> scanOrder == DESCENDING){
+        this -> scanNextDescending(outRid, outIncluded);
+        return;
+    }
+    // a multi-range scan moves on to the next range, once the current one
+    // is complete
+    if(this -> multiRangeScan == true && this -> nextEntry == -2){
+        if(this -> seekNextRange() == false){
+            throw IndexScanCompletedException();
+        }
+    }
     this -> bufMgr -> readPage(this -> file, this -> currentPageNum, this -> currentPageData);
     // If no more records, satisfying the scan criteria, are left to be scanned.
     // we use the nextEntry == -2 to represent that there is no more
@@ -1016,7 +2285,7 @@ const void BTreeIndex::scanNext(RecordId& outRid)
         throw IndexScanCompletedException();
     }
     // Fetch the record id of the next index entry that matches the scan.
-    LeafNodeInt * currPage = (LeafNodeInt *) (this -> currentPageData);
+    LeafView * currPage = this -> currentLeaf();
     // Return the next record from current page being scanned.
     
      // DEBUG ONLY
@@ -1027,6 +2296,10 @@ const void BTreeIndex::scanNext(RecordId& outRid)
     */
      
     outRid = currPage -> ridArray[this -> nextEntry];
+    // a covering index returns the included values along with the record id
+    if(outIncluded != NULL){
+        memcpy(outIncluded, currPage -> includedArray + (std::size_t) this -> nextEntry * this -> includedWidth, this -> includedWidth);
+    }
     // move the scanner to the next satisfied record
     // check whether theer is more records in this current leaf node or not
     if(this -> nextEntry < currPage  -> slotTaken - 1){
@@ -1118,7 +2391,7 @@ const void BTreeIndex::scanNext(RecordId& outRid)
             // endScan method, if the scan is complete. Therefore,
             // we will leave for the endScan method to unpin this new
             // scanned page.
-            currPage = (LeafNodeInt *) this -> currentPageData;
+            currPage = this -> currentLeaf();
             // check whether the first slot in the new index page has
             // valid record or not. I.e. check whether this first slot
             // has been taken up or not
@@ -1224,7 +2497,427 @@ const void BTreeIndex::endScan()
     this -> currentPageData = NULL;
     this -> lowOp = (Operator)-1;
     this -> highOp = (Operator)-1;
+    this -> scanOrder = ASCENDING;
+    this -> multiRangeScan = false;
+    this -> scanRanges.clear();
+    this -> currentRange = -1;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::countRange
+// -----------------------------------------------------------------------------
+/**
+ * Count the entries within a range, using the entry counts of the subtrees.
+ * @param lowValParm The low value to be tested
+ * @param lowOpParm The operation to be used in testing the low range.
+ * @param highValParm The high value to be tested.
+ * @param highOpParm The operation to be used in testing the high range.
+ * @return the number of entries within the range
+ */
+const int BTreeIndex::countRange(const void* lowValParm,
+                                 const Operator lowOpParm,
+                                 const void* highValParm,
+                                 const Operator highOpParm)
+{
+    if(lowOpParm != GT && lowOpParm != GTE){
+        throw BadOpcodesException();
+    }
+    if(highOpParm != LT && highOpParm != LTE){
+        throw BadOpcodesException();
+    }
+    int lowVal = *((int*) lowValParm);
+    int highVal = *((int*) highValParm);
+    if(lowVal > highVal){
+        throw BadScanrangeException();
+    }
+    // the entries within the range are the ones below the high value,
+    // without the ones below the low value. GT excludes the low value
+    // itself, and LTE includes the high value itself.
+    int count = this -> countBelow(highVal, highOpParm == LTE) - this -> countBelow(lowVal, lowOpParm == GT);
+    // a range like (5, 5) has no entries at all
+    return std::max(count, 0);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::selectByRank
+// -----------------------------------------------------------------------------
+/**
+ * Find the entry with a given rank, using the entry counts of the subtrees.
+ * @param rank The position of the entry in key order, counted from 0
+ * @param outRid The record id of the entry found
+ */
+const void BTreeIndex::selectByRank(const int rank, RecordId& outRid)
+{
+    if(rank < 0){
+        throw NoSuchKeyFoundException();
+    }
+    int remaining = rank; // the rank of the entry within the current subtree
+    PageId currPageId = this -> rootPageNum;
+    bool isLeaf = this -> rootIsLeaf;
+    while(isLeaf == false){
+        Page * currPage;
+        this -> bufMgr -> readPage(this -> file, currPageId, currPage);
+        NonLeafNodeInt * currNode = (NonLeafNodeInt *) currPage;
+        // skip the child pages whose entries all come before the entry
+        int targetIndex = 0;
+        while(targetIndex < currNode -> slotTaken && remaining >= currNode -> countArray[targetIndex]){
+            remaining -= currNode -> countArray[targetIndex];
+            targetIndex++;
+        }
+        PageId nextPageId = currNode -> pageNoArray[targetIndex];
+        isLeaf = (currNode -> level == 1);
+        this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+        currPageId = nextPageId;
+    }
+    Page * leafPage;
+    this -> bufMgr -> readPage(this -> file, currPageId, leafPage);
+    LeafView view;
+    LeafView * leafNode = this -> viewLeaf(leafPage, view);
+    // the rank is out of range if even the right most leaf page does not
+    // hold enough entries
+    if(remaining >= leafNode -> slotTaken){
+        this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+        throw NoSuchKeyFoundException();
+    }
+    outRid = leafNode -> ridArray[remaining];
+    this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::getStatistics
+// -----------------------------------------------------------------------------
+/**
+ * Get the statistics of the index. The fill factor and the number of
+ * distinct keys are derived from the stored statistics on every call.
+ * @param outStats Returns the statistics
+ */
+const void BTreeIndex::getStatistics(IndexStatistics& outStats)
+{
+    outStats = this -> stats;
+    outStats.fillFactor = (double) this -> stats.entryCount / ((double) this -> stats.leafCount * this -> leafOccupancy);
+    // the HyperLogLog estimate, with the linear counting correction for
+    // small numbers of keys, where many registers are still empty
+    const double m = HLLREGISTERS;
+    double sum = 0;
+    int zeros = 0;
+    for(int j = 0; j < HLLREGISTERS; ++j){
+        sum += std::ldexp(1.0, -this -> stats.hllRegisters[j]);
+        if(this -> stats.hllRegisters[j] == 0){
+            zeros++;
+        }
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if(estimate <= 2.5 * m && zeros > 0){
+        estimate = m * std::log(m / zeros);
+    }
+    outStats.distinctKeys = estimate;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::estimateRange
+// -----------------------------------------------------------------------------
+/**
+ * Estimate the number of entries within a range from the histogram.
+ * @param lowValParm The low value of the range
+ * @param lowOpParm The operation to be used in testing the low range
+ * @param highValParm The high value of the range
+ * @param highOpParm The operation to be used in testing the high range
+ * @return the estimated number of entries
+ */
+const double BTreeIndex::estimateRange(const void* lowValParm, const Operator lowOpParm, const void* highValParm, const Operator highOpParm)
+{
+    if((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)){
+        throw BadOpcodesException();
+    }
+    if(*((int *) lowValParm) > *((int *) highValParm)){
+        throw BadScanrangeException();
+    }
+    // turn the range into the inclusive one [low, high]
+    std::int64_t low = *((int *) lowValParm) + (lowOpParm == GT ? 1 : 0);
+    std::int64_t high = *((int *) highValParm) - (highOpParm == LT ? 1 : 0);
+    double estimate = 0;
+    for(int b = 0; b < this -> stats.histBuckets; ++b){
+        std::int64_t bucketLow = this -> stats.histLow[b];
+        std::int64_t bucketHigh = (b + 1 < this -> stats.histBuckets) ? (std::int64_t) this -> stats.histLow[b + 1] - 1 : this -> stats.maxKey;
+        bucketHigh = std::max(bucketHigh, bucketLow);
+        std::int64_t overlapLow = std::max(low, bucketLow);
+        std::int64_t overlapHigh = std::min(high, bucketHigh);
+        if(overlapLow <= overlapHigh){
+            estimate += (double) this -> stats.histCount[b] * (overlapHigh - overlapLow + 1) / (bucketHigh - bucketLow + 1);
+        }
+    }
+    return estimate;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::rebuildStatistics
+// -----------------------------------------------------------------------------
+/**
+ * Compute the statistics exactly again. The leftmost path gives the height
+ * of the tree, and the leaf pages are read from left to right for the keys.
+ */
+const void BTreeIndex::rebuildStatistics()
+{
+    int height;
+    PageId pid = this -> leftmostLeaf(height);
+    std::vector< RIDKeyPair<int> > entries;
+    int leafCount = 0;
+    LeafView view;
+    while(pid != Page::INVALID_NUMBER){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, pid, page);
+        LeafView * leafNode = this -> viewLeaf(page, view);
+        for(int i = 0; i < leafNode -> slotTaken; ++i){
+            RIDKeyPair<int> pair;
+            pair.set(leafNode -> ridArray[i], leafNode -> keyArray[i]);
+            entries.push_back(pair);
+        }
+        PageId next = leafNode -> rightSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, pid, false);
+        pid = next;
+        leafCount++;
+    }
+    this -> buildStatistics(entries, leafCount, height);
+}
+
+/**
+ * Find the leftmost leaf page of the tree.
+ * @param height: returns the number of levels of the tree
+ * @return the page id of the leftmost leaf page
+ */
+const PageId BTreeIndex::leftmostLeaf(int & height)
+{
+    PageId pid = this -> rootPageNum;
+    height = 1;
+    if(this -> rootIsLeaf == false){
+        while(1){
+            Page * page;
+            this -> bufMgr -> readPage(this -> file, pid, page);
+            NonLeafNodeInt * node = (NonLeafNodeInt *) page;
+            PageId child = node -> pageNoArray[0];
+            int level = node -> level;
+            this -> bufMgr -> unPinPage(this -> file, pid, false);
+            pid = child;
+            height++;
+            if(level == 1){
+                break;
+            }
+        }
+    }
+    return pid;
+}
+
+/**
+ * Compute the statistics exactly from all the entries of the index. The
+ * histogram buckets get the same number of entries each, give or take one.
+ * @param entries: all the (key, rid) pairs of the index, sorted by key
+ * @param leafCount: the number of leaf pages
+ * @param height: the number of levels of the tree
+ */
+const void BTreeIndex::buildStatistics(const std::vector< RIDKeyPair<int> > & entries, const int leafCount, const int height)
+{
+    memset(&this -> stats, 0, sizeof(IndexStatistics));
+    this -> stats.height = height;
+    this -> stats.leafCount = leafCount;
+    const std::size_t n = entries.size();
+    const int buckets = (int) std::min((std::size_t) HISTOGRAMBUCKETS, n);
+    for(int b = 0; b < buckets; ++b){
+        std::size_t first = n * b / buckets;
+        std::size_t last = n * (b + 1) / buckets;
+        this -> stats.histLow[b] = entries[first].key;
+        this -> stats.histCount[b] = last - first;
+    }
+    this -> stats.histBuckets = buckets;
+    this -> stats.maxKey = (n > 0) ? entries[n - 1].key : 0;
+    for(std::size_t i = 0; i < n; ++i){
+        addToRegisters(this -> stats.hllRegisters, entries[i].key);
+    }
+    this -> stats.entryCount = n;
+    this -> writeStatistics();
+}
+
+/**
+ * Take a new key into the statistics. The key is counted in the bucket whose
+ * range holds it, and the first and last buckets are widened for keys beyond
+ * the ones seen so far.
+ * @param key: the key
+ */
+const void BTreeIndex::addKeyToStatistics(const int key)
+{
+    this -> stats.entryCount++;
+    addToRegisters(this -> stats.hllRegisters, key);
+
+    if(this -> stats.histBuckets == 0){
+        // the first key of an empty index opens a single bucket
+        this -> stats.histBuckets = 1;
+        this -> stats.histLow[0] = key;
+        this -> stats.maxKey = key;
+    }
+    if(key < this -> stats.histLow[0]){
+        this -> stats.histLow[0] = key;
+    }
+    this -> stats.maxKey = std::max(this -> stats.maxKey, key);
+    int b = std::upper_bound(this -> stats.histLow, this -> stats.histLow + this -> stats.histBuckets, key) - this -> stats.histLow - 1;
+    this -> stats.histCount[b]++;
+}
+
+/**
+ * Write the statistics to the statistics page.
+ */
+const void BTreeIndex::writeStatistics()
+{
+    // the statistics page of a mapped index file can not be written, so
+    // the statistics rebuilt are only kept in memory
+    if(this -> file -> mapped()){
+        return;
+    }
+    Page * statsPage;
+    this -> bufMgr -> readPage(this -> file, this -> statsPageNum, statsPage);
+    *(IndexStatistics *) statsPage = this -> stats;
+    this -> bufMgr -> unPinPage(this -> file, this -> statsPageNum, true);
+}
+
+/**
+ * Write out the index file built, and open it again as a MmapFile. The
+ * pages written are dropped from the buffer pool by the flush, and from
+ * then on read through the mapping.
+ */
+const void BTreeIndex::mapIndexFile()
+{
+    this -> writeStatistics();
+    this -> bufMgr -> flushFile(this -> file);
+    std::string name = this -> file -> filename();
+    delete this -> file;
+    this -> file = (File *) new MmapFile(name);
 }
 
+/**
+ * Take a key into HyperLogLog registers. The high bits of the key hash pick
+ * the register, which keeps the largest position of the first set bit among
+ * the remaining bits.
+ * @param registers: the registers
+ * @param key: the key
+ */
+void BTreeIndex::addToRegisters(unsigned char * registers, const int key)
+{
+    // the finalizer of splitmix64
+    std::uint64_t h = (std::uint32_t) key;
+    h += 0x9e3779b97f4a7c15ull;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    int reg = (int)(h >> (64 - HLLREGISTERBITS));
+    std::uint64_t rest = h << HLLREGISTERBITS;
+    unsigned char rank = (rest == 0) ? (64 - HLLREGISTERBITS + 1) : (__builtin_clzll(rest) + 1);
+    registers[reg] = std::max(registers[reg], rank);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::compact
+// -----------------------------------------------------------------------------
+/**
+ * Rebuild the tree into new pages at a fill factor and swap in its root.
+ * The old tree is only read, so that it stays valid until the swap.
+ * @param fillFactor The fraction of the slots of every page to fill
+ * @return the number of pages of the old tree left unused
+ */
+const int BTreeIndex::compact(const double fillFactor)
+{
+    if(!(fillFactor > 0 && fillFactor <= 1)){
+        throw BadIndexInfoException("The fill factor has to be in (0, 1].");
+    }
+    if(this -> file -> mapped()){
+        throw ReadOnlyFileException(this -> file -> filename());
+    }
+    const int width = this -> includedWidth;
+    // count the non-leaf pages of the old tree level by level
+    int oldPages = 0;
+    if(this -> rootIsLeaf == false){
+        std::vector<PageId> nodes(1, this -> rootPageNum);
+        while(!nodes.empty()){
+            std::vector<PageId> children;
+            for(std::size_t n = 0; n < nodes.size(); ++n){
+                Page * page;
+                this -> bufMgr -> readPage(this -> file, nodes[n], page);
+                NonLeafNodeInt * node = (NonLeafNodeInt *) page;
+                if(node -> level != 1){
+                    children.insert(children.end(), node -> pageNoArray, node -> pageNoArray + node -> slotTaken + 1);
+                }
+                this -> bufMgr -> unPinPage(this -> file, nodes[n], false);
+            }
+            oldPages += nodes.size();
+            nodes.swap(children);
+        }
+    }
+
+    // read all the entries in key order from the leaf pages of the old tree,
+    // with the included values of a covering index next to them
+    int height;
+    PageId pid = this -> leftmostLeaf(height);
+    std::vector< RIDKeyPair<int> > entries;
+    std::vector<char> values;
+    LeafView view;
+    while(pid != Page::INVALID_NUMBER){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, pid, page);
+        LeafView * leafNode = this -> viewLeaf(page, view);
+        for(int i = 0; i < leafNode -> slotTaken; ++i){
+            RIDKeyPair<int> pair;
+            pair.set(leafNode -> ridArray[i], leafNode -> keyArray[i]);
+            entries.push_back(pair);
+            if(width > 0){
+                const char * value = leafNode -> includedArray + (std::size_t) i * width;
+                values.insert(values.end(), value, value + width);
+            }
+        }
+        PageId next = leafNode -> rightSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, pid, false);
+        pid = next;
+        oldPages++;
+    }
+
+    // bulkLoad looks the included values up by record id, so they are laid
+    // out as one IncludedRun over the pages of the base relation referred to
+    std::vector<IncludedRun> included;
+    if(width > 0 && !entries.empty()){
+        PageId firstPageNo = entries[0].rid.page_number;
+        PageId lastPageNo = firstPageNo;
+        for(std::size_t i = 0; i < entries.size(); ++i){
+            firstPageNo = std::min(firstPageNo, entries[i].rid.page_number);
+            lastPageNo = std::max(lastPageNo, entries[i].rid.page_number);
+        }
+        std::vector<std::size_t> slots(lastPageNo - firstPageNo + 1, 0);
+        for(std::size_t i = 0; i < entries.size(); ++i){
+            std::size_t & s = slots[entries[i].rid.page_number - firstPageNo];
+            s = std::max(s, (std::size_t) entries[i].rid.slot_number);
+        }
+        included.resize(1);
+        included[0].firstPageNo = firstPageNo;
+        std::size_t start = 0;
+        for(std::size_t p = 0; p < slots.size(); ++p){
+            included[0].pageStart.push_back(start);
+            start += slots[p];
+        }
+        included[0].values.resize(start * width);
+        for(std::size_t i = 0; i < entries.size(); ++i){
+            const RecordId & rid = entries[i].rid;
+            memcpy(&included[0].values[(included[0].pageStart[rid.page_number - firstPageNo] + rid.slot_number - 1) * width],
+                   &values[i * width], width);
+        }
+        std::vector<char>().swap(values);
+    }
+
+    // build the new tree in new pages, then swap its root into the meta page
+    PageId newRootPageNum;
+    bool newRootIsLeaf;
+    this -> bulkLoad(entries, (width > 0) ? &included : NULL, 1, newRootPageNum, newRootIsLeaf, fillFactor);
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    ((IndexMetaInfo *) metaPage) -> rootPageNo = newRootPageNum;
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+    this -> rootPageNum = newRootPageNum;
+    this -> rootIsLeaf = newRootIsLeaf;
+    return oldPages;
+}
 
 }
@@ -12,6 +12,7 @@
 #include "string.h"
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 #include "types.h"
 #include "page.h"
@@ -42,18 +43,93 @@ enum Operator
 	GT		/* Greater Than */
 };
 
+/**
+ * @brief Scan order enumeration. Passed to BTreeIndex::startScan() method.
+ */
+enum ScanOrder
+{
+	ASCENDING,	/* From the low value up to the high value */
+	DESCENDING	/* From the high value down to the low value */
+};
+
+/**
+ * @brief Layout of the keys in the non-leaf pages of a BTreeIndex. Passed through IndexOptions.
+ */
+enum NodeLayout
+{
+	SORTED_KEYS,	/* The keys sorted in keyArray, binary searched */
+	KEY_BLOCKS	/* The keys sorted in keyArray in blocks of KEYBLOCKSIZE, with the last key of every block in a summary after them */
+};
+
+/**
+ * @brief Number of keys of a block of the KEY_BLOCKS layout, which is the number of INTEGER keys in a 64 byte cache line.
+ */
+const int KEYBLOCKSIZE = 16;
+
+/**
+ * @brief Search for a key within the leaf pages of a BTreeIndex. Passed through IndexOptions.
+ */
+enum LeafSearch
+{
+	BINARY_SEARCH,	/* Binary search over the keys of the leaf page */
+	INTERPOLATION_SEARCH	/* Predict the slot of the key from the first and the last key of the leaf page, then search around it */
+};
+
+/**
+ * @brief Farthest distance from the slot predicted by INTERPOLATION_SEARCH that is searched step by step, doubling the
+ * step, before falling back to binary search over the rest of the leaf page.
+ */
+const int INTERPOLATIONWINDOW = 32;
+
+/**
+ * @brief A range of INTEGER keys of a multi-range scan. Passed to BTreeIndex::startMultiScan() method.
+ */
+struct ScanRange{
+  /**
+   * Low value of the range.
+   */
+	int lowVal;
+
+  /**
+   * Low operator (GT/GTE).
+   */
+	Operator lowOp;
+
+  /**
+   * High value of the range.
+   */
+	int highVal;
+
+  /**
+   * High operator (LT/LTE).
+   */
+	Operator highOp;
+
+  /**
+   * The range [lowVal, highVal] or (lowVal, highVal) etc., depending on the operators.
+   */
+	ScanRange(int lowVal, Operator lowOp, int highVal, Operator highOp)
+		: lowVal(lowVal), lowOp(lowOp), highVal(highVal), highOp(highOp) {}
+
+  /**
+   * The range holding a single key, i.e. [key, key]. A list of these makes up an IN-list.
+   */
+	ScanRange(int key)
+		: lowVal(key), lowOp(GTE), highVal(key), highOp(LTE) {}
+};
+
 
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+//                                                  slotTaken       sibling ptrs                key               rid
+const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( int ) - 2 * sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
  */
-//                                                     level     extra pageNo                  key       pageNo
-const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+//                                                     level, slotTaken  extra pageNo      extra count                key       pageNo           count
+const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - 2 * sizeof( int ) - sizeof( PageId ) - sizeof( int ) ) / ( sizeof( int ) + sizeof( PageId ) + sizeof( int ) );
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
@@ -101,6 +177,135 @@ bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 		return r1.rid.page_number < r2.rid.page_number;
 }
 
+/**
+ * @brief Maximum number of included attributes of a covering BTreeIndex.
+ */
+const int MAXINCLUDEATTRS = 8;
+
+/**
+ * @brief Maximum number of key attributes of a CompositeBTreeIndex.
+ */
+const int MAXKEYATTRS = 4;
+
+/**
+ * @brief Format of the meta page and the nodes of the index files of BTreeIndex and CompositeBTreeIndex, kept in
+ * IndexMetaInfo::formatVersion. "BT" in the upper half, and a version number bumped whenever the layout changes in
+ * the lower half.
+ */
+const int INDEXFORMATVERSION = 0x42540002;
+
+/**
+ * @brief An attribute of the base relation stored in the leaf pages of a covering index, next to the key,
+ * so that scans can return its value without fetching the record. Passed to the BTreeIndex constructor in IndexOptions.
+*/
+struct IncludeAttr{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute, which gives its width: an int, a double or a char[64] string.
+   */
+	Datatype attrType;
+
+	IncludeAttr(int attrByteOffset, Datatype attrType) : attrByteOffset(attrByteOffset), attrType(attrType) {}
+};
+
+/**
+ * @brief The included attribute values of the records on a range of pages of the base relation, addressed by record id.
+ * Filled by one thread of a bulk build of a covering index, next to its sorted run of (key, rid) pairs, so that the
+ * values can be found again once the runs have been merged.
+*/
+struct IncludedRun{
+  /**
+   * First page of the range.
+   */
+	PageId firstPageNo;
+
+  /**
+   * For every page of the range, the position of the values of the record in slot 1 in values, counted in records.
+   */
+	std::vector<std::size_t> pageStart;
+
+  /**
+   * The values of the included attributes of every record, one after the other.
+   */
+	std::vector<char> values;
+};
+
+/**
+ * @brief Number of bits of the key hash selecting a HyperLogLog register of the index statistics.
+ */
+const int HLLREGISTERBITS = 11;
+
+/**
+ * @brief Number of HyperLogLog registers of the index statistics.
+ */
+const int HLLREGISTERS = 1 << HLLREGISTERBITS;
+
+/**
+ * @brief Maximum number of buckets of the equi-depth key histogram of the index statistics.
+ */
+const int HISTOGRAMBUCKETS = 128;
+
+/**
+ * @brief Statistics of a BTreeIndex, kept on the statistics page of the index file, for estimating how many entries
+ * a scan returns before running it. They are exact after a build or rebuildStatistics, and maintained approximately
+ * by inserts: the histogram bucket bounds stay fixed, and only the counts of the buckets change.
+*/
+struct IndexStatistics{
+  /**
+   * Number of entries in the index.
+   */
+	std::int64_t entryCount;
+
+  /**
+   * Number of levels of the tree, 1 if the root is a leaf.
+   */
+	int height;
+
+  /**
+   * Number of leaf pages.
+   */
+	int leafCount;
+
+  /**
+   * Average share of the leaf slots taken up, filled in by BTreeIndex::getStatistics.
+   */
+	double fillFactor;
+
+  /**
+   * Estimated number of distinct keys, filled in by BTreeIndex::getStatistics from the HyperLogLog registers.
+   */
+	double distinctKeys;
+
+  /**
+   * Number of buckets of the histogram taken up, 0 if the index has no entries.
+   */
+	int histBuckets;
+
+  /**
+   * Largest key in the index, the upper bound of the last bucket.
+   */
+	int maxKey;
+
+  /**
+   * Smallest key of every bucket. Bucket b holds the keys from histLow[b] up to histLow[b + 1].
+   */
+	int histLow[ HISTOGRAMBUCKETS ];
+
+  /**
+   * Number of entries in every bucket.
+   */
+	std::int64_t histCount[ HISTOGRAMBUCKETS ];
+
+  /**
+   * HyperLogLog registers, the largest position of the first set bit seen among the key hashes of every register.
+   */
+	unsigned char hllRegisters[ HLLREGISTERS ];
+};
+
 /**
  * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
  * to the following structure to store or retrieve information from it.
@@ -129,6 +334,58 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Number of attributes included in the leaf pages, 0 if the index is not a covering index.
+   */
+	int includeCount;
+
+  /**
+   * Offsets of the included attributes inside the records.
+   */
+	int includeOffsets[ MAXINCLUDEATTRS ];
+
+  /**
+   * Types of the included attributes.
+   */
+	Datatype includeTypes[ MAXINCLUDEATTRS ];
+
+  /**
+   * Number of attributes of the key of a CompositeBTreeIndex, compared in this order. 0 for BTreeIndex, whose key is
+   * the single attribute given by attrByteOffset and attrType.
+   */
+	int keyCount;
+
+  /**
+   * Offsets of the key attributes inside the records.
+   */
+	int keyOffsets[ MAXKEYATTRS ];
+
+  /**
+   * Types of the key attributes.
+   */
+	Datatype keyTypes[ MAXKEYATTRS ];
+
+  /**
+   * Page number of the statistics page of a BTreeIndex, which holds its IndexStatistics.
+   */
+	PageId statsPageNo;
+
+  /**
+   * Layout of the keys in the non-leaf pages.
+   */
+	NodeLayout nodeLayout;
+
+  /**
+   * Whether the leaf pages are CompressedLeafInt.
+   */
+	bool compressedLeaves;
+
+  /**
+   * INDEXFORMATVERSION when the file was created. An index file of another layout, including the ones written before
+   * this field was added, is not opened.
+   */
+	int formatVersion;
 };
 
 /*
@@ -161,6 +418,11 @@ struct NonLeafNodeInt{
    * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
 	PageId pageNoArray[ INTARRAYNONLEAFSIZE + 1 ];
+
+  /**
+   * Stores the number of entries in the subtrees of the child pages, countArray[i] for the child pageNoArray[i].
+   */
+	int countArray[ INTARRAYNONLEAFSIZE + 1 ];
 };
 
 
@@ -188,8 +450,179 @@ struct LeafNodeInt{
 	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
 	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+	 * This linking of leaves allows to move from one leaf to the previous leaf during a descending index scan.
+	 * Only maintained by BTreeIndex.
+   */
+	PageId leftSibPageNo;
 };
 
+/**
+ * @brief Number of 64 bit words of bit-packed entries in a compressed leaf page. The fields before them take 32 bytes.
+ */
+const int COMPRESSEDLEAFWORDS = ( Page::SIZE - 32 ) / sizeof( std::uint64_t );
+
+/**
+ * @brief Structure for the leaf nodes of a BTreeIndex with compressed leaves, when the key is of INTEGER type.
+ * Every key and every page number and slot number of a record id is stored as its difference from the smallest one of
+ * the page (frame of reference), in as many bits as the largest difference needs. The keys, the page numbers and the
+ * slot numbers are packed one after the other into three columns of words, each one starting on a new word.
+*/
+struct CompressedLeafInt{
+  /**
+   * Number of entries in the node.
+   */
+	int slotTaken;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * Smallest key of the node.
+   */
+	int keyBase;
+
+  /**
+   * Smallest page number of the record ids of the node.
+   */
+	PageId pageBase;
+
+  /**
+   * Smallest slot number of the record ids of the node.
+   */
+	SlotId slotBase;
+
+  /**
+   * Number of bits of every key, page number and slot number.
+   */
+	unsigned char keyBits, pageBits, slotBits;
+
+  /**
+   * The three columns of bit-packed values. One word is always left after them, so that a value can be read as two
+   * whole words.
+   */
+	std::uint64_t words[ COMPRESSEDLEAFWORDS ];
+};
+
+/**
+ * @brief The entries of a leaf node, as read by BTreeIndex. For a LeafNodeInt it points into the page, for a
+ * CompressedLeafInt into the entries decoded from it.
+*/
+struct LeafView{
+  /**
+   * Number of entries.
+   */
+	int slotTaken;
+
+  /**
+   * The keys.
+   */
+	const int * keyArray;
+
+  /**
+   * The record ids.
+   */
+	const RecordId * ridArray;
+
+  /**
+   * The included attribute values of a covering index, one entry after the other. NULL for compressed leaves.
+   */
+	const char * includedArray;
+
+  /**
+   * Page number of the leaf on the right side.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side.
+   */
+	PageId leftSibPageNo;
+
+  /**
+   * The keys decoded from a compressed leaf node.
+   */
+	std::vector<int> keys;
+
+  /**
+   * The record ids decoded from a compressed leaf node.
+   */
+	std::vector<RecordId> rids;
+};
+
+
+/**
+ * @brief Options for creating an index. Passed to the BTreeIndex and LSMTreeIndex constructors. The default options
+ * give the original index, built by inserting every tuple of the base relation one at a time.
+*/
+struct IndexOptions{
+  /**
+   * Number of threads building a new index file bottom up from the base relation: the heap file is
+   * partitioned by page ranges, keys are extracted and sorted in parallel, and the leaf pages are formatted
+   * in parallel before the non-leaf levels are built on top of them. 0 inserts the tuples one at a time instead.
+   */
+	int buildThreads;
+
+  /**
+   * Number of entries LSMTreeIndex keeps in its memtable before writing them out as a run.
+   */
+	int memtableSize;
+
+  /**
+   * Attributes BTreeIndex stores in its leaf pages next to every key, making a covering index. The values are stored
+   * one after the other, in this order, at the end of the leaf page, which lowers the number of entries per leaf page.
+   * An existing index file keeps the attributes it has been created with.
+   */
+	std::vector<IncludeAttr> includes;
+
+  /**
+   * Layout of the keys in the non-leaf pages of BTreeIndex. KEY_BLOCKS finds the child page to descend into by
+   * comparing against the summary of the blocks and then against a single block, so that a descent touches a few
+   * cache lines per non-leaf page instead of about ten, without branches depending on the keys. The summary takes
+   * the space of one key in KEYBLOCKSIZE + 1. An existing index file keeps the layout it has been created with.
+   */
+	NodeLayout nodeLayout;
+
+  /**
+   * Whether BTreeIndex stores its leaf pages compressed, as CompressedLeafInt. Dense keys and record ids clustered on
+   * few pages of the base relation take a few bits each, so that a leaf page holds several times the entries, and
+   * a range scan reads as many times fewer pages. An insert decodes the leaf page and encodes it again, so that
+   * compressed leaves suit indexes which are read far more than written. The fill factor of the IndexStatistics is
+   * counted against the capacity of an uncompressed leaf page, and may be larger than 1. Not available together with
+   * included attributes. An existing index file keeps the leaf format it has been created with.
+   */
+	bool compressLeaves;
+
+  /**
+   * Search for a key within the leaf pages of BTreeIndex. The keys of a leaf page are sorted, so the line through its
+   * first and its last key predicts the slot of a key. INTERPOLATION_SEARCH reads the slot predicted, and then the
+   * slots 1, 2, 4, ... away from it up to INTERPOLATIONWINDOW, so that keys spread evenly, like sequential ids, are
+   * found within a few probes of one or two cache lines. When the keys are skewed and the key is farther away than
+   * that, binary search finishes over the slots left. The search is not kept in the index file.
+   */
+	LeafSearch leafSearch;
+
+  /**
+   * Whether BTreeIndex opens its index file as a MmapFile, read-only. The pages are then used where they lie in the
+   * page cache of the kernel, which BufMgr hands out without copying them into its frames, so that a read-mostly
+   * index shares the page cache with other processes instead of being cached twice, and takes no frames. A new
+   * index is built through a BlobFile first, and opened again mapped once it is built. Inserts and compaction of a
+   * mapped index throw ReadOnlyFileException, and its statistics are only kept in memory.
+   */
+	bool mmapIndex;
+
+	IndexOptions() : buildThreads(0), memtableSize(32768), nodeLayout(SORTED_KEYS), compressLeaves(false),
+	                 leafSearch(BINARY_SEARCH), mmapIndex(false) {}
+};
 
 /**
  * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
@@ -239,6 +672,51 @@ class BTreeIndex {
    */
 	int			leafOccupancy;
 
+  /**
+   * Attributes stored in the leaf pages next to every key, empty if the index is not a covering index.
+   */
+	std::vector<IncludeAttr>	includeAttrs;
+
+  /**
+   * Width of the included attribute values of one entry, 0 if the index is not a covering index.
+   */
+	int			includedWidth;
+
+  /**
+   * Layout of the keys in the non-leaf pages.
+   */
+	NodeLayout	nodeLayout;
+
+  /**
+   * Whether the leaf pages are compressed.
+   */
+	bool		compressLeaves;
+
+  /**
+   * Search for a key within the leaf pages.
+   */
+	LeafSearch	leafSearch;
+
+  /**
+   * The entries of the current page being scanned. For compressed leaves they are decoded once per page.
+   */
+	LeafView	scanView;
+
+  /**
+   * Page number scanView has been decoded from, INVALID_NUMBER if none.
+   */
+	PageId		scanViewPageNum;
+
+  /**
+   * Statistics of the index, written to the statistics page after builds and when the index is closed.
+   */
+	IndexStatistics	stats;
+
+  /**
+   * Page number of the statistics page.
+   */
+	PageId	statsPageNum;
+
   /**
    * Number of keys in non-leaf node, depending upon the type of key.
    */
@@ -306,35 +784,245 @@ class BTreeIndex {
    * High Operator. Can only be LT(<) or LTE(<=).
    */
 	Operator	highOp;
+
+  /**
+   * Order in which the current scan returns the entries.
+   */
+	ScanOrder	scanOrder;
+
+  /**
+   * True if the current scan is a multi-range scan.
+   */
+	bool		multiRangeScan;
+
+  /**
+   * Ranges of the current multi-range scan. The bounds of the range being scanned are copied into lowValInt etc.
+   */
+	std::vector<ScanRange>	scanRanges;
+
+  /**
+   * Index of the range being scanned in scanRanges.
+   */
+	int			currentRange;
     
     /**
      * Insert a new (key, rid) pair into a leaf node
      * @param pid: the PageId of the potential leaf node to insert into
      * @param key: a pointer to the value(integer we want to insert)
      * @param rid: The corresponding record id of the tuple in the base relation
+     * @param included: the included attribute values of the entry, NULL if the index is not a covering index
      * @param searchPath: a vector of PageId contains all the PageId of the pages we have
      *  visited along our search path. The purpose of this vector is to benefit our insert later.
      */
-    const void insertLeafNode(const PageId pid, const void *key, const RecordId rid, std::vector<PageId> & searchPath);
+    const void insertLeafNode(const PageId pid, const void *key, const RecordId rid, const char * included, std::vector<PageId> & searchPath);
     
     /**
      * Split up a leaf index page.
      * @param pid: the page id of the current leaf node, which is needed to be splitted
      * @param key: a pointer to the value of the key that we are looking for
      * @param rid: The corresponding record id of the tuple in the base relation
+     * @param included: the included attribute values of the entry, NULL if the index is not a covering index
+     * @param searchPath: a vector of PageId contains all the PageId of the pages we have
+     *  visited along our search path. The purpose of this vector is to benefit our insert later.
+     */
+    const void splitLeafNode(PageId pid, const void *key,  const RecordId rid, const char * included, std::vector<PageId> & searchPath);
+
+    /**
+     * Split up a leaf index page, given all of its entries merged with the new ones. The page keeps the smaller half of them
+     * and a new leaf page, linked in on its right side, takes the larger half. The first key of the new page is pushed up.
+     * @param pid: the page id of the leaf node to split up
+     * @param currLeafPage: the leaf node to split up, pinned. It is unpinned here.
+     * @param keys: the merged keys
+     * @param rids: the merged record ids
+     * @param included: the merged included attribute values, empty if the index is not a covering index
+     * @param searchPath: a vector of PageId contains all the PageId of the pages we have
+     *  visited along our search path. Remark: the searchPath does not contain the pageId of this current node.
+     */
+    const void splitLeafEntries(const PageId pid, LeafNodeInt * currLeafPage, const std::vector<int> & keys,
+                                const std::vector<RecordId> & rids, const std::vector<char> & included, std::vector<PageId> & searchPath);
+
+    /**
+     * Find the included attribute values of an entry of a leaf page. They are stored one entry after the other in the
+     * part of ridArray past leafOccupancy, which the smaller leafOccupancy of a covering index leaves unused.
+     * @param leafNode: the leaf page
+     * @param slot: the slot of the entry
+     * @return a pointer to the includedWidth bytes of values of the entry
+     */
+    char * includedValues(LeafNodeInt * leafNode, const int slot);
+
+    /**
+     * Copy the included attribute values out of a record.
+     * @param record: the record
+     * @param out: returns the includedWidth bytes of values
+     */
+    const void extractIncluded(const char * record, char * out);
+
+    /**
+     * Take the included attributes into use, and lower leafOccupancy by the space their values take up.
+     * @param includes: the included attributes
+     */
+    const void setIncludes(const std::vector<IncludeAttr> & includes);
+
+    /**
+     * Take the layout of the keys in the non-leaf pages into use, and lower nodeOccupancy by the space the summary
+     * of the blocks of the KEY_BLOCKS layout takes up.
+     * @param layout: the layout
+     */
+    const void setNodeLayout(const NodeLayout layout);
+
+    /**
+     * Find the child page of a non-leaf page to descend into for a key, i.e. the index of the first key larger than it.
+     * @param node: the non-leaf page
+     * @param key: the key
+     * @return the index of the child page in pageNoArray
+     */
+    const int childIndex(const NonLeafNodeInt * node, const int key);
+
+    /**
+     * Write the summary of the blocks of a non-leaf page again after its keys have changed. Does nothing for the
+     * SORTED_KEYS layout.
+     * @param node: the non-leaf page
+     */
+    const void writeKeyBlocks(NonLeafNodeInt * node);
+
+    /**
+     * Find the first slot of a leaf page after a key, i.e. the number of keys smaller than it, or not larger than it.
+     * @param keys: the sorted keys of the leaf page
+     * @param count: the number of keys
+     * @param key: the key
+     * @param inclusive: whether the keys equal to the key are counted too
+     * @return the index of the first key larger than (inclusive) or not smaller than (not inclusive) the key
+     */
+    const int leafPosition(const int * keys, const int count, const int key, const bool inclusive);
+
+    /**
+     * Get at the entries of a leaf page, whichever its format.
+     * @param page: the leaf page, pinned
+     * @param view: the view to fill in, which holds the decoded entries of a compressed leaf page
+     * @return the view
+     */
+    LeafView * viewLeaf(Page * page, LeafView & view);
+
+    /**
+     * Get at the entries of the current page being scanned, which has been read into currentPageData. A compressed
+     * leaf page is only decoded once while the scan stays on it.
+     * @return the view of the entries
+     */
+    LeafView * currentLeaf();
+
+    /**
+     * Find how many entries from the start of a sorted run fit into a compressed leaf page.
+     * @param entries: the entries, sorted by key
+     * @param count: the number of entries
+     * @param words: the number of words of the page to fill, at most COMPRESSEDLEAFWORDS
+     * @return the number of entries which fit, at least 1 if count is not 0
+     */
+    static std::size_t packLeaf(const RIDKeyPair<int> * entries, const std::size_t count, const int words);
+
+    /**
+     * Encode sorted entries into a compressed leaf page. The sibling page numbers are not changed.
+     * @param entries: the entries, sorted by key
+     * @param count: the number of entries, which have to fit as found by packLeaf
+     * @param leaf: the leaf page
+     */
+    static void encodeLeaf(const RIDKeyPair<int> * entries, const int count, CompressedLeafInt * leaf);
+
+    /**
+     * Decode the entries of a compressed leaf page.
+     * @param leaf: the leaf page
+     * @param keys: returns the keys
+     * @param rids: returns the record ids
+     */
+    static void decodeLeaf(const CompressedLeafInt * leaf, std::vector<int> & keys, std::vector<RecordId> & rids);
+
+    /**
+     * Insert a run of sorted (key, rid) pairs, which all fall into the key range of one compressed leaf page, into
+     * that leaf page. The entries are merged and encoded again, into as many leaf pages as they need.
+     * @param pid: the page id of the leaf page
+     * @param batch: the sorted (key, rid) pairs
+     * @param begin: the index of the first pair of the run in the batch
+     * @param end: the index after the last pair of the run in the batch
+     * @param searchPath: the non-leaf pages visited while searching for the leaf page. Remark: the searchPath does not
+     *  contain the pageId of this current node.
+     * @return the index after the last pair inserted, which is end
+     */
+    const int insertCompressedRun(const PageId pid, const std::vector< RIDKeyPair<int> > & batch, const int begin, const int end,
+                                  std::vector<PageId> & searchPath);
+
+    /**
+     * The width of an attribute of a given type inside the records.
+     * @param type: the type of the attribute
+     * @return the width in bytes
+     */
+    static int attrWidth(const Datatype type);
+
+    /**
+     * Take a new key into the statistics: the entry count, the HyperLogLog registers and the count of its histogram bucket.
+     * @param key: the key
+     */
+    const void addKeyToStatistics(const int key);
+
+    /**
+     * Compute the statistics exactly from all the entries of the index, and write them to the statistics page.
+     * @param entries: all the (key, rid) pairs of the index, sorted by key
+     * @param leafCount: the number of leaf pages
+     * @param height: the number of levels of the tree
+     */
+    const void buildStatistics(const std::vector< RIDKeyPair<int> > & entries, const int leafCount, const int height);
+
+    /**
+     * Write the statistics to the statistics page.
+     */
+    const void writeStatistics();
+
+    /**
+     * Write out the index file built, and open it again as a MmapFile.
+     */
+    const void mapIndexFile();
+
+    /**
+     * Take a key into HyperLogLog registers.
+     * @param registers: the HLLREGISTERS registers
+     * @param key: the key
+     */
+    static void addToRegisters(unsigned char * registers, const int key);
+
+    /**
+     * Insert a run of sorted (key, rid) pairs, which all fall into the key range of one leaf node, into that leaf node.
+     * The leaf node is split at most once per call. Thus, only as many pairs as two leaf nodes can hold are taken from the run.
+     * @param pid: the page id of the leaf node to insert into
+     * @param batch: the sorted (key, rid) pairs of the whole batch
+     * @param begin: the index of the first pair of the run in the batch
+     * @param end: the index after the last pair of the run in the batch
+     * @param batchIncluded: the included attribute values of the pairs of the batch, in the same order, empty if the index is not a covering index
      * @param searchPath: a vector of PageId contains all the PageId of the pages we have
      *  visited along our search path. The purpose of this vector is to benefit our insert later.
+     * @return the index of the first pair in the batch which has not been inserted yet
      */
-    const void splitLeafNode(PageId pid, const void *key,  const RecordId rid, std::vector<PageId> & searchPath);
+    const int insertLeafRun(const PageId pid, const std::vector< RIDKeyPair<int> > & batch, const int begin, const int end,
+                            const std::vector<char> & batchIncluded, std::vector<PageId> & searchPath);
     
+    /**
+     * Link a new leaf page into the sibling chain, right after the leaf page it has been split off from.
+     * The left sibling link of the old right sibling page is updated too.
+     * @param pid: the page id of the leaf page which has been split up
+     * @param currLeafPage: the leaf page which has been split up
+     * @param newPageId: the page id of the new leaf page
+     * @param newLeafPage: the new leaf page, which holds the larger keys
+     */
+    const void linkNewLeaf(const PageId pid, LeafNodeInt * currLeafPage, const PageId newPageId, LeafNodeInt * newLeafPage);
+
     /**
      * This function helps create a new non-leaf root, with inserting the pushup values into this root.
      * @param key: the new key needed to insert in to this non-leaf root
      * @param leftPageId: the pageId on the left side of this new key
      * @param rightPageId: the pageId on the right side of this new key
      * @param level: the level of this non-leaf root page
+     * @param leftCount: the number of entries below the left page
+     * @param rightCount: the number of entries below the right page
      */
-    const void createAndInsertNewRoot(const void *key, const PageId leftPageId, const PageId rightPageId, int level);
+    const void createAndInsertNewRoot(const void *key, const PageId leftPageId, const PageId rightPageId, int level,
+                                      const int leftCount, const int rightCount);
     
     /**
      * This function helps insert the pushup key from lower level into the upper level non-leaf node.
@@ -342,11 +1030,14 @@ class BTreeIndex {
      * @param key: the new key or the pushup-ed key from lower level
      * @param leftPageId: the pageId of the newly created page in the lower level and need to insert this pageId on the left side of the new key
      * Remark: if this key is actually inserted from a lower leaf page, then the newly created pageId is actually for the right pageId.
+     * @param newCount: the number of entries below the newly created page
+     * @param oldCount: the number of entries left below the page which has been split up
      * @param searchPath: the search path leading toward this current non-leaf node.
      * Remark: the searchPath does not contain the pageId of this current node.
      * @param: fromLeaf: is the bool var, true means inserting up from a leaf node. false means from a nonleaf node.
      */
-    const void insertNonLeafNode(PageId pid, const void *key, const PageId leftPageId, std::vector<PageId> searchPath, bool fromLeaf);
+    const void insertNonLeafNode(PageId pid, const void *key, const PageId leftPageId, const int newCount, const int oldCount,
+                                 std::vector<PageId> searchPath, bool fromLeaf);
         
     /**
      * Split up a non-leaf index page.
@@ -354,12 +1045,15 @@ class BTreeIndex {
      * @param key: the new key needed to be inserted
      * @param leftPageId: the pageId of the newly created page in the lower level and need to insert this pageId on the left side of the new key
      * Remark: if this key is actually inserted from a lower leaf page, then the newly created pageId is actually for the right pageId.
+     * @param newCount: the number of entries below the newly created page
+     * @param oldCount: the number of entries left below the page which has been split up
      * @param searchPath: a vector of PageId contains all the PageId of the pages we have
      *  visited along our search path. The purpose of this vector is to benefit our insert later.
      *  Remark: the searchPath does not contain the pageId of this current node.
      *   @param: fromLeaf: is the bool var, true means inserting up from a leaf node. false means from a nonleaf node.
      */
-    const void splitNonLeafNode(PageId pid, const void *key,  const PageId leftPageId, std::vector<PageId> & searchPath, bool fromLeaf);
+    const void splitNonLeafNode(PageId pid, const void *key,  const PageId leftPageId, const int newCount, const int oldCount,
+                                std::vector<PageId> & searchPath, bool fromLeaf);
     
     /**
      *Recursively find the page potentially containing the target key, which is the page id of the first element larger than or equal to the lower bound given.
@@ -370,8 +1064,139 @@ class BTreeIndex {
      * @param searchPath: a vector of PageId contains all the PageId of the pages we have
      *  visited along our search path. The purpose of this vector is to benefit our insert later.
      *  It is remarked that the last leaf page id is not in this searchPath.
+     * @param upperKey: if not NULL, returns the smallest separator key on the search path which is larger than the key,
+     *  i.e. the exclusive upper bound of the key range covered by the leaf page found.
+     * @param upperKeyValid: if not NULL, returns whether such a separator key exists. If not, the leaf page found is the right most one.
     */
-    const void searchLeafPageWithKey(const void *key, PageId & pid,  PageId currentPageId, std::vector<PageId> & searchPath);
+    const void searchLeafPageWithKey(const void *key, PageId & pid,  PageId currentPageId, std::vector<PageId> & searchPath,
+                                     int * upperKey = NULL, bool * upperKeyValid = NULL);
+
+    /**
+     * Build a new index file bottom up from the base relation. The pages of the relation are partitioned into
+     * one page range per thread, and each thread extracts and sorts the (key, rid) pairs of its range.
+     * The sorted runs are merged in parallel, then bulkLoad builds the tree and the meta page is updated.
+     * @param relationName: the name of the base relation
+     * @param numThreads: the number of threads to use
+     */
+    const void bulkBuild(const std::string & relationName, const int numThreads);
+
+    /**
+     * Add to the entry counts of the child pages on the search path of a key, before the entries are inserted into the leaf.
+     * @param key: the key whose search path is updated
+     * @param searchPath: the non-leaf pages visited while searching for the leaf page of the key, from the root down
+     * @param delta: the number of entries inserted below the search path
+     */
+    const void addToPathCounts(const int key, const std::vector<PageId> & searchPath, const int delta);
+
+    /**
+     * Count the entries whose key is smaller than a key, or smaller than or equal to it. Only the path from the root to
+     * the leaf page of the key is read. The entry counts of the child pages left of the path are summed up on the way down.
+     * @param key: the key
+     * @param inclusive: whether the entries with the key itself are counted too
+     * @return the number of entries found
+     */
+    const int countBelow(const int key, const bool inclusive);
+
+    /**
+     * Check whether a key satisfies the low bound of the current scan.
+     * @param key: the key
+     * @return true if the key is within the low bound
+     */
+    const bool satisfiesLow(const int key);
+
+    /**
+     * Set up a descending scan after startScan has checked and stored the scan parameters. The leaf page holding the
+     * high value is found, and the cursor is placed on the last entry within the high bound, on the left sibling if needed.
+     * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+     */
+    const void startDescendingScan();
+
+    /**
+     * Fetch the record id of the next index entry of a descending scan, and move the cursor to the previous entry,
+     * following leftSibPageNo at the start of a leaf page.
+     * @param outRid: RecordId of next record found that satisfies the scan criteria returned in this
+     * @param outIncluded: if not NULL, returns the included attribute values of the entry
+     * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+     */
+    const void scanNextDescending(RecordId & outRid, void * outIncluded);
+
+    /**
+     * Place the cursor of the current scan on the first entry within the low bound. If the cursor is already on a leaf page,
+     * the entry is looked for on that leaf page and its right sibling first, and the tree is only descended from the root
+     * if it is not found there.
+     * @return false if there is no entry within the low bound at all
+     */
+    const bool seekLow();
+
+    /**
+     * Move a multi-range scan on to the next range which has an entry, and place the cursor on its first entry.
+     * @return false if none of the ranges left has an entry
+     */
+    const bool seekNextRange();
+
+    /**
+     * Build the leaf level of a tree from (key, rid) pairs sorted by key, then build the non-leaf levels on top of it.
+     * The leaf pages are allocated as one range of consecutive pages, and numThreads threads format them in parallel.
+     * The meta page is not changed.
+     * @param entries: the (key, rid) pairs sorted by key
+     * @param included: the included attribute values of the records, addressed by record id. NULL if the index is not a covering index.
+     * @param numThreads: the number of threads formatting the leaf pages
+     * @param newRootPageNum: returns the page id of the root of the new tree
+     * @param newRootIsLeaf: returns whether the root of the new tree is a leaf node
+     * @param fillFactor: the fraction of the slots of every page but the last one of each level to fill
+     */
+    const void bulkLoad(const std::vector< RIDKeyPair<int> > & entries, const std::vector<IncludedRun> * included, const int numThreads,
+                        PageId & newRootPageNum, bool & newRootIsLeaf, const double fillFactor = 1.0);
+
+    /**
+     * Find the leftmost leaf page of the tree by following the first child of every non-leaf node from the root.
+     * @param height: returns the number of levels of the tree
+     * @return the page id of the leftmost leaf page
+     */
+    const PageId leftmostLeaf(int & height);
+
+    /**
+     * Extract the (key, rid) pairs of all the records on a range of pages of the base relation and sort them by key.
+     * Runs in a thread of its own and reads the relation through a private stream.
+     * @param relation: the file of the base relation
+     * @param firstPageNo: the first page of the range
+     * @param lastPageNo: the page after the last page of the range
+     * @param attrByteOffset: the offset of the key inside the records
+     * @param run: returns the sorted (key, rid) pairs
+     * @param includes: the included attributes, empty if the index is not a covering index
+     * @param included: returns the included attribute values of the records of the range
+     */
+    static void extractSortedRun(const File * relation, const PageId firstPageNo, const PageId lastPageNo,
+                                 const int attrByteOffset, std::vector< RIDKeyPair<int> > * run,
+                                 const std::vector<IncludeAttr> * includes, IncludedRun * included);
+
+    /**
+     * Find the included attribute values of a record, extracted by extractSortedRun.
+     * @param included: the included attribute values of the records, one IncludedRun per page range, in page order
+     * @param rid: the record id
+     * @param width: the width of the values of one record
+     * @return a pointer to the values
+     */
+    static const char * findIncluded(const std::vector<IncludedRun> & included, const RecordId & rid, const int width);
+
+    /**
+     * Format a range of leaf pages of a bulk loaded tree in memory. Runs in a thread of its own.
+     * @param entries: the (key, rid) pairs of the whole tree sorted by key
+     * @param leafBegin: the index of the first pair of every leaf page in entries, followed by the number of pairs
+     * @param firstLeafPageNo: the page id of the first leaf page of the tree
+     * @param numLeaves: the number of leaf pages of the tree
+     * @param firstLeaf: the number of the first leaf page to format, counted from the first leaf page of the tree
+     * @param lastLeaf: the number after the last leaf page to format
+     * @param pages: the in memory pages to format the leaf pages firstLeaf .. lastLeaf - 1 into
+     * @param included: the included attribute values of the records, NULL if the index is not a covering index
+     * @param includedWidth: the width of the included attribute values of one entry
+     * @param leafOccupancy: the number of slots of a leaf page, after which the included attribute values start
+     * @param compress: whether the leaf pages are formatted as CompressedLeafInt
+     */
+    static void formatLeafPages(const std::vector< RIDKeyPair<int> > * entries, const std::vector<std::size_t> * leafBegin,
+                                const PageId firstLeafPageNo, const int numLeaves, const int firstLeaf, const int lastLeaf, Page * pages,
+                                const std::vector<IncludedRun> * included, const int includedWidth, const int leafOccupancy,
+                                const bool compress);
 
 
  public:
@@ -386,10 +1211,12 @@ class BTreeIndex {
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param options							Options for building a new index file
    * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexOptions & options = IndexOptions());
 	
 
   /**
@@ -409,8 +1236,24 @@ class BTreeIndex {
 	 * Make sure to unpin pages as soon as you can.
    * @param key			Key to insert, pointer to integer/double/char string
    * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param record		The record itself, from which the included attribute values of a covering index are taken
+   * @throws  BadIndexInfoException If the index is a covering index but no record is given.
+   * @throws  ReadOnlyFileException If the index file is mapped, see IndexOptions::mmapIndex.
+	**/
+	const void insertEntry(const void* key, const RecordId rid, const void* record = NULL);
+
+  /**
+	 * Insert a batch of entries using the pairs <keys[i],rids[i]>.
+	 * The batch is sorted first. Then the tree is descended once per target leaf and every key falling into the key range
+	 * of that leaf is applied before moving on. A leaf overflowing during this is split once, not once per key.
+   * @param keys			Array of n keys to insert, pointer to integers/doubles/char strings
+   * @param rids			Array of n record IDs, rids[i] is the record whose entry keys[i] is getting inserted into the index.
+   * @param n				Number of entries in the batch
+   * @param records	Array of n records, records[i] is the record rids[i], from which the included attribute values of a covering index are taken
+   * @throws  BadIndexInfoException If the index is a covering index but no records are given.
+   * @throws  ReadOnlyFileException If the index file is mapped, see IndexOptions::mmapIndex.
 	**/
-	const void insertEntry(const void* key, const RecordId rid);
+	const void insertBatch(const void* keys, const RecordId* rids, const int n, const void* const* records = NULL);
     
     
 
@@ -422,25 +1265,45 @@ class BTreeIndex {
 	 * If another scan is already executing, that needs to be ended here.
 	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
 	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+	 * A DESCENDING scan starts from the leaf page of the high value and returns the entries from the largest key down,
+	 * so that reading the first N entries only reads the leaf pages holding them.
    * @param lowVal	Low value of range, pointer to integer / double / char string
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
    * @param highOp	High operator (LT/LTE)
+   * @param order		Order of the entries returned by scanNext (ASCENDING/DESCENDING)
    * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
    * @throws  BadScanrangeException If lowVal > highval
    * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
 	**/
-	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                     const ScanOrder order = ASCENDING);
 
 
+  /**
+	 * Begin a scan of several ranges of the index, in a single pass over the leaf pages. The ranges have to be sorted
+	 * and must not overlap, e.g. (10,20), [20,30], [35,35]. The entries of all the ranges are returned by scanNext
+	 * in key order. Moving on to the next range reuses the current leaf page or its right sibling whenever the next
+	 * range starts there, and only descends from the root otherwise. A list of single key ranges makes up an IN-list.
+	 * If another scan is already executing, that needs to be ended here.
+   * @param ranges	The ranges to scan
+   * @throws  BadOpcodesException If a range does not contain one of the expected operators
+   * @throws  BadScanrangeException If a range has lowVal > highVal, or the ranges are not sorted or overlap
+   * @throws  NoSuchKeyFoundException If there is no key in the B+ tree within any of the ranges.
+	**/
+	const void startMultiScan(const std::vector<ScanRange> & ranges);
+
   /**
 	 * Fetch the record id of the next index entry that matches the scan.
 	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+	 * A DESCENDING scan moves on to the left sibling instead.
    * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outIncluded	If not NULL, returns the values of the included attributes of a covering index, one after the other
+   *                      in the order they have been given at creation, without fetching the record
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
 	**/
-	const void scanNext(RecordId& outRid);  // returned record id
+	const void scanNext(RecordId& outRid, void* outIncluded = NULL);  // returned record id
 
 
   /**
@@ -448,6 +1311,69 @@ class BTreeIndex {
 	 * @throws ScanNotInitializedException If no scan has been initialized.
 	**/
 	const void endScan();
+
+  /**
+	 * Count the entries within a range, without scanning the leaf pages of the range. The operators are the ones of startScan.
+	 * Only the two paths from the root to the leaf pages of the low and high value are read.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @return the number of entries within the range
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	const int countRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Find the entry with a given rank, i.e. the position of the entry in key order, counted from 0.
+	 * Only the path from the root to the leaf page of the entry is read.
+   * @param rank		Rank of the entry
+   * @param outRid	RecordId of the entry found
+   * @throws  NoSuchKeyFoundException If rank is negative or not smaller than the number of entries in the index.
+	**/
+	const void selectByRank(const int rank, RecordId& outRid);
+
+  /**
+	 * Get the statistics of the index.
+   * @param outStats	Returns the statistics, including the fill factor and the estimated number of distinct keys
+	**/
+	const void getStatistics(IndexStatistics& outStats);
+
+  /**
+	 * Estimate the number of entries within a range from the histogram, without reading any page. The entries of a
+	 * bucket are taken to be spread evenly over its keys. The operators are the ones of startScan. Together with
+	 * the statistics, this lets a caller choose between an index scan and a FileScan before running either.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @return the estimated number of entries within the range
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	const double estimateRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Compute the statistics exactly again, reading all the leaf pages, e.g. after many inserts have made the
+	 * histogram bucket bounds of the statistics skewed.
+	**/
+	const void rebuildStatistics();
+
+  /**
+	 * Rebuild the tree online, e.g. after random inserts have left the leaf pages half full and spread over the file.
+	 * The entries are read from the leaf pages in key order and written into new leaf pages, which are one range of
+	 * consecutive pages filled up to the fill factor, and new non-leaf levels are built on top of them. None of the
+	 * pages of the old tree is changed, so the old tree keeps serving lookups and a scan executing during the rebuild,
+	 * until the new root is swapped into the meta page in a single write. The pages of the old tree stay unused in the
+	 * file afterwards, since a BlobFile can not delete pages.
+   * @param fillFactor	The fraction of the slots of every leaf and non-leaf page to fill, in (0, 1]. A lower fill factor
+   *										leaves room for later inserts without splits.
+   * @return the number of pages of the old tree left unused
+   * @throws  BadIndexInfoException If the fill factor is not in (0, 1].
+   * @throws  ReadOnlyFileException If the index file is mapped, see IndexOptions::mmapIndex.
+	**/
+	const int compact(const double fillFactor = 1.0);
 	
 };
 
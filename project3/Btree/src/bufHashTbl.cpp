@@ -5,6 +5,7 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cstdint>
 #include <memory>
 #include <iostream>
 #include "buffer.h"
@@ -15,16 +16,21 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+/**
+ * Number of buckets of the table before a resize whose entries every operation moves to the new table.
+ */
+static const int REHASHSTEP = 8;
+
+int BufHashTbl::hash(const File* file, const PageId pageNo, const int size)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  // the pointer to the file object, cast to an unsigned integer, so the value is never negative
+  std::uintptr_t tmp = (std::uintptr_t)file;
+  int value = (tmp + pageNo) % size;
   return value;
 }
 
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(htSize), oldSize(0), oldHt(NULL), migrated(0)
 {
   // allocate an array of pointers to hashBuckets
   ht = new hashBucket* [htSize];
@@ -43,23 +49,71 @@ BufHashTbl::~BufHashTbl()
     }
   }
   delete [] ht;
+
+  if (oldHt != NULL) {
+    for(int i = migrated; i < oldSize; i++) {
+      while (oldHt[i]) {
+        hashBucket* tmpBuf = oldHt[i];
+        oldHt[i] = oldHt[i]->next;
+        delete tmpBuf;
+      }
+    }
+    delete [] oldHt;
+  }
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+void BufHashTbl::migrate()
 {
-  int index = hash(file, pageNo);
+  for (int step = 0; step < REHASHSTEP && migrated < oldSize; step++, migrated++) {
+    while (oldHt[migrated]) {
+      hashBucket* tmpBuc = oldHt[migrated];
+      oldHt[migrated] = tmpBuc->next;
+      int index = hash(tmpBuc->file, tmpBuc->pageNo, HTSIZE);
+      tmpBuc->next = ht[index];
+      ht[index] = tmpBuc;
+    }
+  }
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+  if (migrated == oldSize) {
+    delete [] oldHt;
+    oldHt = NULL;
   }
+}
+
+hashBucket** BufHashTbl::locate(const File* file, const PageId pageNo)
+{
+  // an entry is in the old table until its bucket there is moved, and
+  // the entries inserted since the resize are all in the new one
+  if (oldHt != NULL) {
+    int oldIndex = hash(file, pageNo, oldSize);
+    if (oldIndex >= migrated) {
+      for (hashBucket** link = &oldHt[oldIndex]; *link; link = &(*link)->next) {
+        if ((*link)->file == file && (*link)->pageNo == pageNo)
+          return link;
+      }
+    }
+  }
+
+  hashBucket** link = &ht[hash(file, pageNo, HTSIZE)];
+  while (*link && !((*link)->file == file && (*link)->pageNo == pageNo))
+    link = &(*link)->next;
+  return link;
+}
+
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  if (oldHt != NULL)
+    migrate();
+
+  hashBucket* tmpBuc = *locate(file, pageNo);
+  if (tmpBuc)
+  	throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
 
   tmpBuc = new hashBucket;
   if (!tmpBuc)
   	throw HashTableException();
 
+  int index = hash(file, pageNo, HTSIZE);
   tmpBuc->file = (File*) file;
   tmpBuc->pageNo = pageNo;
   tmpBuc->frameNo = frameNo;
@@ -69,46 +123,58 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  if (!find(file, pageNo, frameNo))
+  {
+    throw HashNotFoundException(file->filename(), pageNo);
   }
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo) 
+{
+  if (oldHt != NULL)
+    migrate();
+
+  hashBucket* tmpBuc = *locate(file, pageNo);
+  if (tmpBuc)
+  {
+    frameNo = tmpBuc->frameNo; // return frameNo by reference
+    return true;
+  }
+
+  return false;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
+  if (oldHt != NULL)
+    migrate();
 
-  while (tmpBuc)
+  hashBucket** link = locate(file, pageNo);
+  if (*link)
 	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
-    }
+    hashBucket* tmpBuc = *link;
+    *link = tmpBuc->next;
+    delete tmpBuc;
+    return;
   }
 
   throw HashNotFoundException(file->filename(), pageNo);
 }
 
+void BufHashTbl::resize(const int htSize)
+{
+  while (oldHt != NULL)
+    migrate();
+  if (htSize == HTSIZE)
+    return;
+
+  oldHt = ht;
+  oldSize = HTSIZE;
+  migrated = 0;
+  ht = new hashBucket* [htSize];
+  HTSIZE = htSize;
+  for(int i=0; i < HTSIZE; i++)
+    ht[i] = NULL;
+}
+
 }
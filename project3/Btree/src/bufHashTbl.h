@@ -55,13 +55,41 @@ class BufHashTbl
   hashBucket**  ht;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * The table before the last resize(), and its size, while its entries are moved to ht a few buckets at a time.
+	 * NULL once they all have been
+	 */
+  int oldSize;
+  hashBucket**  oldHt;
+
+	/**
+	 * Number of buckets of oldHt whose entries have been moved to ht
+	 */
+  int migrated;
+
+	/**
+	 * returns hash value between 0 and size-1 computed using file and pageNo
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
+	 * @param size  	Size of the table
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  int	 hash(const File* file, const PageId pageNo, const int size);
+
+	/**
+	 * Move the entries of the next REHASHSTEP buckets of oldHt to ht, and free oldHt once it is empty. Called by
+	 * every insert, lookup and removal while a resize is under way, so that none of them moves the whole table.
+	 */
+  void migrate();
+
+	/**
+	 * Find the bucket holding the entry of (file, pageNo), in oldHt if its bucket there has not been moved yet, or in ht.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Pointer to the link to the entry, or to the NULL ending its chain in ht if there is none
+	 */
+  hashBucket** locate(const File* file, const PageId pageNo);
 
  public:
 	/**
@@ -96,6 +124,18 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool, like lookup(),
+   * without throwing when it is not.  A miss of the buffer pool then costs
+   * no exception.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, set if the page is found
+   * @return  True if the page entry is found in the hash table
+	 */
+  bool find(const File* file, const PageId pageNo, FrameId &frameNo);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -104,6 +144,23 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+   * Change the size of the hash table, for a buffer pool which has been resized. The entries are moved to the new
+   * table incrementally, by the operations which follow, and looked up in both tables meanwhile. A resize still
+   * under way is finished first.
+	 *
+	 * @param htSize	New size of the hash table
+	 */
+  void resize(const int htSize);
+
+	/**
+   * Returns true while the entries of the table before the last resize() have not all been moved
+	 */
+  bool rehashing() const
+  {
+    return oldHt != NULL;
+  }
 };
 
 }
@@ -7,142 +7,429 @@
 
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/bad_resize_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/read_only_file_exception.h"
 
 namespace badgerdb { 
 
+/**
+ * Set in the tags of the writes submitted to the IOEngine, whose other bits are the frame number, like the tags of the reads.
+ */
+static const std::uint64_t IOWRITETAG = (std::uint64_t) 1 << 32;
+
+/**
+ * Size of the huge pages bufPool is aligned to, the size of the transparent huge pages of x86-64 and arm64.
+ */
+static const std::size_t HUGEPAGESIZE = (std::size_t) 2 << 20;
+
+/**
+ * Largest number of consecutive pages of a file written back by a single vectored write.
+ */
+static const std::size_t WRITERUNPAGES = 64;
+
+/**
+ * Largest number of frames a sweep of the clock evicts at once, which is also the largest number of dirty frames
+ * written back together with the ones evicted, and the number of frames ahead of the clock hand looked at for them.
+ */
+static const std::uint32_t EVICTBATCH = 16;
+static const std::uint32_t EVICTWINDOW = 64;
+
+const FrameId BufDesc::NOFRAME;
+
+/**
+ * Number of buckets of the hash table of a buffer pool of a given number of frames.
+ */
+static int hashTableSize(const std::uint32_t bufs)
+{
+  return ((((int) (bufs * 1.2))*2)/2)+1;
+}
+
+/**
+ * Number of frames a sweep of the clock evicts at once for a buffer pool of a given number of frames.
+ */
+static std::uint32_t victimBatchSize(const std::uint32_t bufs)
+{
+  return std::max((std::uint32_t) 1, std::min(EVICTBATCH, bufs / 64));
+}
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
+BufMgr::BufMgr(std::uint32_t bufs, const IOOptions & ioOptions, const PoolOptions & poolOptions)
+	: numBufs(bufs), maxBufs(std::max(bufs, poolOptions.maxFrames)) {
+	bufDescTable = new BufDesc[maxBufs];
 
-  for (FrameId i = 0; i < bufs; i++) 
+  for (FrameId i = 0; i < maxBufs; i++) 
   {
   	bufDescTable[i].frameNo = i;
   	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  // every frame is free, and the first ones are taken first
+  freeFrames.reserve(bufs);
+  for (FrameId i = bufs; i > 0; i--)
+  {
+    freeFrames.push_back(i - 1);
+  }
+  victimBatch = victimBatchSize(bufs);
+
+  // the mapping is aligned to pages, so the frames are aligned for the
+  // O_DIRECT transfers of files opened with direct I/O. It has room for
+  // the frames the pool can be grown to
+  mapPool(maxBufs, poolOptions.hugePages);
+  if (poolOptions.prefaultThreads > 0)
+  {
+    prefaultPool(poolOptions.prefaultThreads);
+  }
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
+  int htsize = hashTableSize(bufs);
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
 
   clockHand = bufs - 1;
+
+  ioEngine = new IOEngine(ioOptions);
+  writesInFlight = 0;
 }
 
 
 BufMgr::~BufMgr() {
+  // let the prefetches in flight complete, their frames are freed below
+  while (ioEngine->outstanding() > 0)
+  {
+    reapIO();
+  }
+
   //Flush out all unwritten pages
+  std::vector<FrameId> dirtyFrames;
   for (std::uint32_t i = 0; i < numBufs; i++) 
   {
   	BufDesc* tmpbuf = &bufDescTable[i];
   	if (tmpbuf->valid == true && tmpbuf->dirty == true)
 		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+			dirtyFrames.push_back(i);
   	}
   }
+  writeBack(dirtyFrames);
 
+  delete ioEngine;
   delete [] bufDescTable;
-  delete [] bufPool;
+  // Page has nothing to destroy
+  munmap(poolMapping, poolMappingBytes);
+}
+
+void BufMgr::mapPool(std::uint32_t bufs, HugePages hugePages)
+{
+  const std::size_t bytes = sizeof(Page) * bufs;
+  // whole huge pages, the rest of the last one is never touched
+  const std::size_t hugeBytes = (bytes + HUGEPAGESIZE - 1) / HUGEPAGESIZE * HUGEPAGESIZE;
+  poolPages = hugePages;
+  poolMapping = MAP_FAILED;
+
+  if (poolPages == HUGEPAGES_HUGETLB)
+  {
+#ifdef MAP_HUGETLB
+    poolMappingBytes = hugeBytes;
+    poolMapping = mmap(NULL, poolMappingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    // without huge pages reserved in the kernel, transparent huge pages are asked for instead
+    if (poolMapping == MAP_FAILED)
+    {
+      poolPages = HUGEPAGES_TRANSPARENT;
+    }
+  }
+
+  if (poolPages == HUGEPAGES_TRANSPARENT)
+  {
+    // map a huge page more than needed, and unmap the memory before the first huge page boundary and after the
+    // pool, so that the kernel can back every huge page of the pool with one
+    poolMappingBytes = hugeBytes;
+    char* mapping = static_cast<char*>(mmap(NULL, poolMappingBytes + HUGEPAGESIZE, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (mapping == MAP_FAILED)
+    {
+      throw std::bad_alloc();
+    }
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(mapping) + HUGEPAGESIZE - 1) & ~(HUGEPAGESIZE - 1));
+    if (aligned > mapping)
+    {
+      munmap(mapping, aligned - mapping);
+    }
+    if (mapping + HUGEPAGESIZE > aligned)
+    {
+      munmap(aligned + poolMappingBytes, mapping + HUGEPAGESIZE - aligned);
+    }
+    poolMapping = aligned;
+#ifdef MADV_HUGEPAGE
+    // ignored when transparent huge pages are disabled, and the pool is then backed by default pages
+    madvise(poolMapping, poolMappingBytes, MADV_HUGEPAGE);
+#endif
+  }
+  else if (poolPages == HUGEPAGES_NONE)
+  {
+    poolMappingBytes = bytes;
+    poolMapping = mmap(NULL, poolMappingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (poolMapping == MAP_FAILED)
+    {
+      throw std::bad_alloc();
+    }
+  }
+
+  bufPool = static_cast<Page*>(poolMapping);
+}
+
+void BufMgr::prefaultPool(std::uint32_t threads)
+{
+  const std::uint32_t perThread = (numBufs + threads - 1) / threads;
+  std::vector<std::thread> workers;
+  for (std::uint32_t t = 0; t < threads && t * perThread < numBufs; t++)
+  {
+    const FrameId first = t * perThread;
+    const FrameId last = std::min(numBufs, first + perThread);
+    // constructing a page writes all of it, which faults in its memory
+    workers.push_back(std::thread([this, first, last]()
+    {
+      for (FrameId i = first; i < last; i++)
+      {
+        new (&bufPool[i]) Page();
+      }
+    }));
+  }
+  for (std::size_t t = 0; t < workers.size(); t++)
+  {
+    workers[t].join();
+  }
+}
+
+std::size_t BufMgr::getHugePageBytes() const
+{
+  if (poolPages == HUGEPAGES_HUGETLB)
+  {
+    return poolMappingBytes;
+  }
+
+  // the mapping may have been split in several areas, whose AnonHugePages are added up
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(poolMapping);
+  const std::uintptr_t end = begin + poolMappingBytes;
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool inPool = false;
+  std::size_t kilobytes = 0;
+  while (std::getline(smaps, line))
+  {
+    unsigned long areaBegin;
+    unsigned long areaEnd;
+    if (sscanf(line.c_str(), "%lx-%lx ", &areaBegin, &areaEnd) == 2)
+    {
+      inPool = areaBegin < end && areaEnd > begin;
+    }
+    else if (inPool && line.compare(0, 14, "AnonHugePages:") == 0)
+    {
+      kilobytes += strtoul(line.c_str() + 14, NULL, 10);
+    }
+  }
+  return kilobytes * 1024;
 }
 
 void BufMgr::allocBuf(FrameId & frame) 
 {
-  // perform first part of clock algorithm to search for 
-  // open buffer frame
+  // the clock is only swept once no frame is free
   // Assumes non-concurrent access to buffer manager
-  std::uint32_t numScanned = 0;
-  bool found = 0;
+  if (freeFrames.empty())
+  {
+    evictVictims();
+  }
+  frame = freeFrames.back();
+  freeFrames.pop_back();
+} // end allocBuf
 
-  while (numScanned < 2*numBufs)	//Need to scn twice
+void BufMgr::allocRingBuf(BufferAccessStrategy * strategy, FrameId & frame)
+{
+  FrameId & slot = strategy->ring[strategy->next];
+  strategy->next = (strategy->next + 1) % strategy->ring.size();
+  if (slot != BufDesc::NOFRAME)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[slot]);
+    if (tmpbuf->valid && tmpbuf->pinCnt == 0 && !tmpbuf->refbit && !tmpbuf->ioPending)
+    {
+      hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+      if (tmpbuf->dirty)
+        writeBack(std::vector<FrameId>(1, slot));
+      // the frame is put on the free-frame list, and taken right back
+      clearFrame(slot);
+      freeFrames.pop_back();
+      strategy->reused++;
+      frame = slot;
+      return;
+    }
+  }
+  allocBuf(frame);
+  slot = frame;
+}
+
+void BufMgr::evictVictims()
+{
+  // perform the clock algorithm to search for a batch of victims
+  std::uint32_t numScanned = 0;
+  std::vector<FrameId> victims;
+  std::vector<FrameId> dirtyVictims;
+  while (numScanned < 2*numBufs && victims.size() < victimBatch)	//Need to scn twice
   {
     // advance the clock
     advanceClock();
     numScanned++;
+    BufDesc* tmpbuf = &(bufDescTable[clockHand]);
 
-    // if invalid, use frame
-    if (! bufDescTable[clockHand].valid)
+    // an invalid frame is on the free-frame list already
+    if (! tmpbuf->valid)
     {
-      break;
+      continue;
+    }
+
+    // a victim stays valid until the sweep ends, so on its second
+    // revolution the sweep skips the frames it has taken already
+    if (numScanned > numBufs && std::find(victims.begin(), victims.end(), clockHand) != victims.end())
+    {
+      continue;
     }
 
     // is valid, check referenced bit
-    if (! bufDescTable[clockHand].refbit)
+    if (! tmpbuf->refbit)
     {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
+      // check to see if someone has it pinned, or a read into it is in flight
+      if (tmpbuf->pinCnt == 0 && !tmpbuf->ioPending)
       {
         // hasn't been referenced and is not pinned, use it
         // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-        found = true;
-        break;
+        hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+        victims.push_back(clockHand);
+        if (tmpbuf->dirty)
+          dirtyVictims.push_back(clockHand);
       }
     }
     else
     {
       // has been referenced, clear the bit
       bufStats.accesses++;
-      bufDescTable[clockHand].refbit = false;
+      tmpbuf->refbit = false;
     }
   }
+  bufStats.sweeps++;
+  bufStats.sweptFrames += numScanned;
+  bufStats.longestSweep = std::max(bufStats.longestSweep, (int) numScanned);
   
   // check for full buffer pool
-  if (!found && numScanned >= 2*numBufs)
+  if (victims.empty())
   {
+    if (ioEngine->outstanding() > 0)
+    {
+      // the frames of the prefetches in flight become free once they complete
+      while (ioEngine->outstanding() > 0)
+      {
+        reapIO();
+      }
+      if (freeFrames.empty())
+        evictVictims();
+      return;
+    }
     throw BufferExceededException();
   }
   
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+  // flush any existing changes to disk if necessary, together with the
+  // dirty frames the clock would evict next, so that they are clean by the
+  // time it gets to them and their pages are written in order
+  if (!dirtyVictims.empty())
   {
-    bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    // only the frames this sweep has not passed over yet, which holds none of the victims
+    for (std::uint32_t i = 1; i <= EVICTWINDOW && i + numScanned <= numBufs && dirtyVictims.size() < EVICTBATCH; i++)
+    {
+      const FrameId ahead = (clockHand + i) % numBufs;
+      const BufDesc* tmpbuf = &(bufDescTable[ahead]);
+      if (tmpbuf->valid && tmpbuf->dirty && !tmpbuf->refbit && tmpbuf->pinCnt == 0 && !tmpbuf->ioPending)
+        dirtyVictims.push_back(ahead);
+    }
+    writeBack(dirtyVictims);
   }
 
-	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
-
-  // return new frame number
-  frame = clockHand;
+	//Reset all the BufDesc entries of the victims, which become free
+  bufStats.evictions += victims.size();
+  for (std::size_t i = 0; i < victims.size(); i++)
+  {
+    clearFrame(victims[i]);
+  }
 } // end allocBuf
 
 	
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, BufferAccessStrategy * strategy)
 {
+  // the pages of a mapped file are used where they lie, and only counted
+  if (file->mapped())
+  {
+    page = file->mappedPage(pageNo);
+    mappedPins[std::make_pair(static_cast<const File*>(file), pageNo)]++;
+    return;
+  }
+
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  bool found = hashTable->find(file, pageNo, frameNo);
+  if (found && bufDescTable[frameNo].ioPending)
+  {
+    waitForRead(frameNo);
+    // a prefetch which failed leaves the frame empty, and the page is read
+    // again below, throwing the exception of the file
+    found = bufDescTable[frameNo].valid;
+  }
 
+  if (found)
+  {
     // set the referenced bit
     bufDescTable[frameNo].refbit = true;
     bufDescTable[frameNo].pinCnt++;
     page = &bufPool[frameNo];
   }
-  catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
+  else //not in the buffer pool, must allocate a new page
   {
-    // alloc a new frame
-    allocBuf(frameNo);
+    // alloc a new frame, from the ring of the strategy if there is one
+    if (strategy != NULL)
+      allocRingBuf(strategy, frameNo);
+    else
+      allocBuf(frameNo);
 
-    // read the page into the new frame
+    // read the page into the new frame, which is free again if the page
+    // can not be read
     bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+    try
+    {
+      file->readPageInto(pageNo, bufPool[frameNo]);
+    }
+    catch (...)
+    {
+      freeFrames.push_back(frameNo);
+      throw;
+    }
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
+    // set up the entry properly. A page read through a ring is not
+    // referenced, so that the clock evicts it first if the ring leaves it
+    setFrame(frameNo, file, pageNo);
+    if (strategy != NULL)
+      bufDescTable[frameNo].refbit = false;
     page = &bufPool[frameNo];
 
     // insert in the hash table
@@ -154,6 +441,20 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 void BufMgr::unPinPage(File* file, const PageId pageNo, 
 			     const bool dirty) 
 {
+  if (file->mapped())
+  {
+    std::map<std::pair<const File*, PageId>, std::uint32_t>::iterator pin =
+      mappedPins.find(std::make_pair(static_cast<const File*>(file), pageNo));
+    if (pin == mappedPins.end())
+      throw PageNotPinnedException(file->filename(), pageNo, numBufs);
+    if (--pin->second == 0)
+      mappedPins.erase(pin);
+    // the mapping is read-only, so a page of it cannot have been written
+    if (dirty == true)
+      throw ReadOnlyFileException(file->filename());
+    return;
+  }
+
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
@@ -170,40 +471,315 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
 
 void BufMgr::flushFile(const File* file) 
 {
-  for (std::uint32_t i = 0; i < numBufs; i++)
+  // check every frame of the file before writing any, and write the dirty
+  // ones back together, in the order of their pages in the file
+  std::vector<FrameId> fileFrameNos;
+  unpinnedFileFrames(file, fileFrameNos);
+  std::vector<FrameId> dirtyFrames;
+  for (std::size_t i = 0; i < fileFrameNos.size(); i++)
+	{
+    if (bufDescTable[fileFrameNos[i]].dirty == true)
+      dirtyFrames.push_back(fileFrameNos[i]);
+  }
+  writeBack(dirtyFrames);
+  // a single sync once they are all written makes them durable
+  if (!dirtyFrames.empty() && file->descriptor() >= 0)
+    fdatasync(file->descriptor());
+
+  for (std::size_t i = 0; i < fileFrameNos.size(); i++)
+	{
+  	hashTable->remove(file, bufDescTable[fileFrameNos[i]].pageNo);
+  	clearFrame(fileFrameNos[i]);
+  }
+}
+
+void BufMgr::dropFile(const File* file)
+{
+  std::vector<FrameId> fileFrameNos;
+  unpinnedFileFrames(file, fileFrameNos);
+  for (std::size_t i = 0; i < fileFrameNos.size(); i++)
+	{
+  	hashTable->remove(file, bufDescTable[fileFrameNos[i]].pageNo);
+  	clearFrame(fileFrameNos[i]);
+  }
+}
+
+void BufMgr::unpinnedFileFrames(const File* file, std::vector<FrameId> & frames)
+{
+  // a mapped file has no frames, but its pages are not to be pinned either
+  std::map<std::pair<const File*, PageId>, std::uint32_t>::const_iterator pin =
+    mappedPins.lower_bound(std::make_pair(file, (PageId) 0));
+  if (pin != mappedPins.end() && pin->first.first == file)
+    throw PagePinnedException(file->filename(), pin->first.second, numBufs);
+
+  std::map<const File*, FrameId>::const_iterator head = fileFrames.find(file);
+  if (head == fileFrames.end())
+  {
+    frames.clear();
+    return;
+  }
+
+  // the prefetches of the file in flight complete first. A prefetch which
+  // failed takes its frame off the list, so the list is walked again after
+  frames.clear();
+  for (FrameId i = head->second; i != BufDesc::NOFRAME; i = bufDescTable[i].nextInFile)
+    frames.push_back(i);
+  for (std::size_t i = 0; i < frames.size(); i++)
+	{
+  	if (bufDescTable[frames[i]].ioPending && bufDescTable[frames[i]].file == file)
+  		waitForRead(frames[i]);
+  }
+
+  frames.clear();
+  head = fileFrames.find(file);
+  if (head == fileFrames.end())
+    return;
+  for (FrameId i = head->second; i != BufDesc::NOFRAME; i = bufDescTable[i].nextInFile)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
-  	if(tmpbuf->valid == true && tmpbuf->file == file)
-		{
-	    if (tmpbuf->pinCnt > 0)
-  			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
-
-	    if (tmpbuf->dirty == true)
-			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
-    	}
-
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
-  	}
-		else if (tmpbuf->valid == false && tmpbuf->file == file)
+    if (tmpbuf->valid == false)
   		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
+    if (tmpbuf->pinCnt > 0)
+ 			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+    frames.push_back(i);
+  }
+  const BufDesc* table = bufDescTable;
+  std::sort(frames.begin(), frames.end(), [table](const FrameId a, const FrameId b) {
+    return table[a].pageNo < table[b].pageNo;
+  });
+}
+
+void BufMgr::setFrame(const FrameId frameNo, File* file, const PageId pageNo)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+  tmpbuf->Set(file, pageNo);
+
+  // the frame becomes the head of the list of the file
+  std::pair<std::map<const File*, FrameId>::iterator, bool> head =
+    fileFrames.insert(std::make_pair(static_cast<const File*>(file), frameNo));
+  tmpbuf->prevInFile = BufDesc::NOFRAME;
+  tmpbuf->nextInFile = BufDesc::NOFRAME;
+  if (!head.second)
+  {
+    tmpbuf->nextInFile = head.first->second;
+    bufDescTable[head.first->second].prevInFile = frameNo;
+    head.first->second = frameNo;
+  }
+}
+
+void BufMgr::clearFrame(const FrameId frameNo)
+{
+  BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+  if (tmpbuf->file != NULL)
+  {
+    if (tmpbuf->nextInFile != BufDesc::NOFRAME)
+      bufDescTable[tmpbuf->nextInFile].prevInFile = tmpbuf->prevInFile;
+    if (tmpbuf->prevInFile != BufDesc::NOFRAME)
+      bufDescTable[tmpbuf->prevInFile].nextInFile = tmpbuf->nextInFile;
+    else if (tmpbuf->nextInFile != BufDesc::NOFRAME)
+      fileFrames[tmpbuf->file] = tmpbuf->nextInFile;
+    else
+      fileFrames.erase(tmpbuf->file);
+    tmpbuf->prevInFile = BufDesc::NOFRAME;
+    tmpbuf->nextInFile = BufDesc::NOFRAME;
+  }
+  tmpbuf->Clear();
+  freeFrames.push_back(frameNo);
+}
+
+std::uint32_t BufMgr::getFileFrames(const File* file) const
+{
+  std::map<const File*, FrameId>::const_iterator head = fileFrames.find(file);
+  std::uint32_t frames = 0;
+  if (head != fileFrames.end())
+  {
+    for (FrameId i = head->second; i != BufDesc::NOFRAME; i = bufDescTable[i].nextInFile)
+      frames++;
+  }
+  return frames;
+}
+
+void BufMgr::prefetch(File* file, const std::vector<PageId> & pageNos)
+{
+  // the pages of a mapped file are faulted in when they are used
+  if (file->mapped())
+    return;
+
+  const int fd = file->descriptor();
+  for (std::size_t i = 0; i < pageNos.size(); i++)
+	{
+    FrameId frameNo = 0;
+    if (hashTable->find(file, pageNos[i], frameNo))
+      continue;
+
+    if (fd < 0)
+    {
+      // without a file descriptor, the page is read right away
+      Page* page;
+      readPage(file, pageNos[i], page);
+      unPinPage(file, pageNos[i], false);
+      continue;
+    }
+
+    // the frame is assigned to the page now, but neither pinned nor
+    // replaced until the read completes
+    allocBuf(frameNo);
+    bufStats.diskreads++;
+    setFrame(frameNo, file, pageNos[i]);
+    bufDescTable[frameNo].pinCnt = 0;
+    bufDescTable[frameNo].ioPending = true;
+    hashTable->insert(file, pageNos[i], frameNo);
+    ioEngine->read(fd, file->pageOffset(pageNos[i]), &bufPool[frameNo], Page::SIZE, frameNo);
+  }
+  ioEngine->submit();
+}
+
+void BufMgr::readPages(File* file, const std::vector<PageId> & pageNos, std::vector<Page*> & pages)
+{
+  prefetch(file, pageNos);
+  pages.resize(pageNos.size());
+  for (std::size_t i = 0; i < pageNos.size(); i++)
+	{
+    readPage(file, pageNos[i], pages[i]);
+  }
+}
+
+void BufMgr::completeIO(const IOCompletion & completion)
+{
+  const FrameId frameNo = completion.tag & (IOWRITETAG - 1);
+  BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+  if (completion.tag & IOWRITETAG)
+  {
+    // the tag of a write holds the index of its run of frames instead
+    const std::vector<FrameId> & run = writeRuns[completion.tag & (IOWRITETAG - 1)];
+    writesInFlight--;
+    if (completion.result == (std::int64_t) (run.size() * Page::SIZE))
+    {
+      for (std::size_t i = 0; i < run.size(); i++)
+        bufDescTable[run[i]].dirty = false;
+    }
+    return;
+  }
+  tmpbuf->ioPending = false;
+  if (completion.result != (std::int64_t) Page::SIZE || !tmpbuf->file->checkPage(tmpbuf->pageNo, bufPool[frameNo]))
+  {
+    hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+    clearFrame(frameNo);
+  }
+}
+
+void BufMgr::reapIO()
+{
+  std::vector<IOCompletion> completions;
+  ioEngine->reap(completions, 1);
+  for (std::size_t i = 0; i < completions.size(); i++)
+  {
+    completeIO(completions[i]);
+  }
+}
+
+void BufMgr::waitForRead(const FrameId frame)
+{
+  while (bufDescTable[frame].ioPending)
+  {
+    reapIO();
+  }
+}
+
+void BufMgr::writeBack(const std::vector<FrameId> & frames)
+{
+  // the pages in the order of their files and page numbers
+  std::vector<FrameId> sorted(frames);
+  const BufDesc* table = bufDescTable;
+  std::sort(sorted.begin(), sorted.end(), [table](const FrameId a, const FrameId b) {
+    return table[a].file != table[b].file ? table[a].file < table[b].file : table[a].pageNo < table[b].pageNo;
+  });
+  bufStats.diskwrites += sorted.size();
+
+  // the pages consecutive in a file make up a run, written at once
+  writeRuns.clear();
+  for (std::size_t i = 0; i < sorted.size(); i++)
+	{
+    BufDesc* tmpbuf = &(bufDescTable[sorted[i]]);
+    if (!tmpbuf->file->rawPageWrites() || tmpbuf->file->descriptor() < 0)
+    {
+      tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[sorted[i]]);
+      tmpbuf->dirty = false;
+      continue;
+    }
+    if (!writeRuns.empty())
+    {
+      const BufDesc* last = &(bufDescTable[writeRuns.back().back()]);
+      if (last->file == tmpbuf->file && writeRuns.back().size() < WRITERUNPAGES &&
+          last->file->pageOffset(last->pageNo) + Page::SIZE == tmpbuf->file->pageOffset(tmpbuf->pageNo))
+      {
+        writeRuns.back().push_back(sorted[i]);
+        continue;
+      }
+    }
+    writeRuns.push_back(std::vector<FrameId>(1, sorted[i]));
+  }
+
+  std::vector< std::vector<struct iovec> > iovs(writeRuns.size());
+  for (std::size_t r = 0; r < writeRuns.size(); r++)
+	{
+    const std::vector<FrameId> & run = writeRuns[r];
+    const BufDesc* first = &(bufDescTable[run[0]]);
+    if (run.size() == 1)
+    {
+      ioEngine->write(first->file->descriptor(), first->file->pageOffset(first->pageNo), &bufPool[run[0]], Page::SIZE,
+                      IOWRITETAG | r);
+    }
+    else
+    {
+      iovs[r].resize(run.size());
+      for (std::size_t i = 0; i < run.size(); i++)
+      {
+        iovs[r][i].iov_base = &bufPool[run[i]];
+        iovs[r][i].iov_len = Page::SIZE;
+      }
+      ioEngine->write(first->file->descriptor(), first->file->pageOffset(first->pageNo), &iovs[r][0], (int) run.size(),
+                      IOWRITETAG | r);
+    }
+    writesInFlight++;
+  }
+  while (writesInFlight > 0)
+  {
+    reapIO();
+  }
+  writeRuns.clear();
+
+  for (std::size_t i = 0; i < sorted.size(); i++)
+  {
+    BufDesc* tmpbuf = &(bufDescTable[sorted[i]]);
+    if (tmpbuf->dirty)
+    {
+      tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[sorted[i]]);
+      tmpbuf->dirty = false;
+    }
   }
 }
 
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
 	//Deallocate from file altogether
+  //A mapped file rejects it, and has no page in the buffer pool
+  if (file->mapped())
+    throw ReadOnlyFileException(file->filename());
+
   //See if it is in the buffer pool
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
+  waitForRead(frameNo);
 
-	// clear the page
-	bufDescTable[frameNo].Clear();
+  // a prefetch of the page which failed has cleared the frame already
+  if (bufDescTable[frameNo].valid)
+  {
+	  // clear the page
+	  clearFrame(frameNo);
 
-	hashTable->remove(file, pageNo);
+	  hashTable->remove(file, pageNo);
+  }
 
   // deallocate it in the file	
   file->deletePage(pageNo);
@@ -214,21 +790,96 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 {
   FrameId frameNo;
 
+  // a mapped file rejects it before any frame is taken
+  if (file->mapped())
+    throw ReadOnlyFileException(file->filename());
+
   // alloc a new frame
   allocBuf(frameNo);
 
   // allocate a new page in the file
-	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  try
+  {
+    file->allocatePageInto(pageNo, bufPool[frameNo]);
+  }
+  catch (...)
+  {
+    freeFrames.push_back(frameNo);
+    throw;
+  }
   page = &bufPool[frameNo];
 
   // set up the entry properly
-  bufDescTable[frameNo].Set(file, pageNo);
+  setFrame(frameNo, file, pageNo);
 
   // insert in the hash table
   hashTable->insert(file, pageNo, frameNo);
 }
 
+void BufMgr::resize(const std::uint32_t bufs)
+{
+  if (bufs == 0 || bufs > maxBufs)
+    throw BadResizeException(bufs, maxBufs);
+
+  if (bufs > numBufs)
+  {
+    // the frames added are free, and the first ones are taken first
+    for (FrameId i = bufs; i > numBufs; i--)
+    {
+      freeFrames.push_back(i - 1);
+    }
+  }
+  else if (bufs < numBufs)
+  {
+    // the reads in flight into the frames removed complete first
+    for (FrameId i = bufs; i < numBufs; i++)
+    {
+      if (bufDescTable[i].ioPending)
+        waitForRead(i);
+    }
+
+    // check every frame removed before evicting any, and write the dirty
+    // ones back together
+    std::vector<FrameId> dirtyFrames;
+    for (FrameId i = bufs; i < numBufs; i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[i]);
+      if (tmpbuf->valid && tmpbuf->pinCnt > 0)
+        throw PagePinnedException(tmpbuf->file->filename(), tmpbuf->pageNo, i);
+      if (tmpbuf->valid && tmpbuf->dirty)
+        dirtyFrames.push_back(i);
+    }
+    writeBack(dirtyFrames);
+
+    for (FrameId i = bufs; i < numBufs; i++)
+    {
+      BufDesc* tmpbuf = &(bufDescTable[i]);
+      if (tmpbuf->valid)
+      {
+        hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+        clearFrame(i);
+      }
+    }
+    freeFrames.erase(std::remove_if(freeFrames.begin(), freeFrames.end(), [bufs](const FrameId frame) {
+      return frame >= bufs;
+    }), freeFrames.end());
+    if (clockHand >= bufs)
+      clockHand = bufs - 1;
+
+    // the whole huge pages past the frames left are given back, and read
+    // as zeroes if the pool grows again
+    const std::size_t kept = (sizeof(Page) * bufs + HUGEPAGESIZE - 1) / HUGEPAGESIZE * HUGEPAGESIZE;
+    const std::size_t used = std::min(poolMappingBytes,
+                                      (sizeof(Page) * numBufs + HUGEPAGESIZE - 1) / HUGEPAGESIZE * HUGEPAGESIZE);
+    if (kept < used)
+      madvise(static_cast<char*>(poolMapping) + kept, used - kept, MADV_DONTNEED);
+  }
+
+  numBufs = bufs;
+  victimBatch = victimBatchSize(bufs);
+  hashTable->resize(hashTableSize(bufs));
+}
+
 void BufMgr::printSelf(void) 
 {
   BufDesc* tmpbuf;
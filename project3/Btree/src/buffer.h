@@ -9,7 +9,12 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "io_engine.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace badgerdb {
 
@@ -61,6 +66,18 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * True if a read of the page into the frame is in flight. The frame can be neither pinned nor replaced until it completes
+	 */
+  bool ioPending;
+
+	/**
+   * Previous and next frame assigned to the same file, in the list of the frames of the file kept by BufMgr, or
+   * NOFRAME at the ends of the list
+	 */
+  FrameId prevInFile;
+  FrameId nextInFile;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +89,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    ioPending = false;
   };
 
 	/**
@@ -89,6 +107,7 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    ioPending = false;
   }
 
   void Print()
@@ -113,7 +132,15 @@ class BufDesc {
   BufDesc()
 	{
   	Clear();
+    prevInFile = NOFRAME;
+    nextInFile = NOFRAME;
   }
+
+ public:
+	/**
+   * The frame number which ends the lists of frames of a file
+	 */
+  static const FrameId NOFRAME = ~(FrameId) 0;
 };
 
 
@@ -137,12 +164,29 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of clock sweeps run for victims, once the free-frame list has run out
+	 */
+  int sweeps;
+
+	/**
+   * Number of frames the clock hand has passed over in the sweeps, and the most in a single sweep
+	 */
+  int sweptFrames;
+  int longestSweep;
+
+	/**
+   * Number of frames evicted by the sweeps
+	 */
+  int evictions;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
 		accesses = diskreads = diskwrites = 0;
+		sweeps = sweptFrames = longestSweep = evictions = 0;
   }
       
 	/**
@@ -155,6 +199,97 @@ struct BufStats
 };
 
 
+/**
+ * @brief The pages of memory which hold the frames of a BufMgr.
+ */
+enum HugePages
+{
+	HUGEPAGES_NONE,		/* Pages of the default size */
+	HUGEPAGES_TRANSPARENT,	/* Transparent huge pages, asked for with madvise(MADV_HUGEPAGE) */
+	HUGEPAGES_HUGETLB	/* Huge pages reserved in the kernel, mapped with MAP_HUGETLB */
+};
+
+/**
+ * @brief Options of the memory of the frames of a BufMgr. Passed to the BufMgr constructor.
+ */
+struct PoolOptions
+{
+  /**
+   * The pages to map the frames with. HUGEPAGES_HUGETLB falls back to HUGEPAGES_TRANSPARENT when no huge pages are
+   * reserved in the kernel (vm.nr_hugepages). The kernel may still back transparent huge pages with default pages,
+   * see BufMgr::getHugePageBytes().
+   */
+  HugePages hugePages;
+
+  /**
+   * Number of threads which touch every frame in the constructor, so that the pages of memory are faulted in up
+   * front instead of the first time a frame is used. 0 leaves them to be faulted in on first use.
+   */
+  std::uint32_t prefaultThreads;
+
+  /**
+   * Largest number of frames the pool can be grown to by BufMgr::resize(). The address space of that many frames is
+   * reserved up front, but only the frames in use take memory. 0, or fewer than the pool is constructed with, for no
+   * growth beyond that.
+   */
+  std::uint32_t maxFrames;
+
+  PoolOptions() : hugePages(HUGEPAGES_TRANSPARENT), prefaultThreads(0), maxFrames(0) {}
+};
+
+/**
+ * @brief Default number of frames of the ring of a BufferAccessStrategy, 256 KB of pages.
+ */
+const std::uint32_t RINGFRAMES = 32;
+
+/**
+ * @brief The way one bulk operation, like a sequential scan of a relation, takes frames for the pages it reads. Instead
+ * of taking a frame from the whole buffer pool for every page missing from it, which evicts every other page once the
+ * operation has read as many pages as there are frames, the operation reuses a small ring of frames of its own. A
+ * frame of the ring is reused once the operation comes around to it again, unless somebody else has used its page in
+ * the meantime, in which case the page stays in the buffer pool and the ring takes another frame. Passed to
+ * BufMgr::readPage().
+ */
+class BufferAccessStrategy
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Constructor of BufferAccessStrategy class
+	 *
+	 * @param ringFrames	Number of frames of the ring
+	 */
+  explicit BufferAccessStrategy(const std::uint32_t ringFrames = RINGFRAMES)
+    : ring(std::max(ringFrames, (std::uint32_t) 1), BufDesc::NOFRAME), next(0), reused(0)
+  {
+  }
+
+	/**
+   * Get the number of times a frame of the ring has been reused for another page
+	 */
+  std::uint32_t getReused() const
+  {
+		return reused;
+  }
+
+ private:
+	/**
+   * The frames of the ring, NOFRAME for the ones not taken yet
+	 */
+  std::vector<FrameId> ring;
+
+	/**
+   * Position in the ring of the frame the next page missing from the buffer pool is read into
+	 */
+  std::uint32_t next;
+
+	/**
+   * Number of times a frame of the ring has been reused
+	 */
+  std::uint32_t reused;
+};
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
 */
@@ -170,6 +305,11 @@ class BufMgr
    * Number of frames in the buffer pool
 	 */
   std::uint32_t numBufs;
+
+	/**
+   * Number of frames bufPool and bufDescTable have room for, which numBufs can be resized up to
+	 */
+  std::uint32_t maxBufs;
 	
 	/**
    * Hash table mapping (File, page) to frame
@@ -187,7 +327,104 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-	 * Allocate a free frame.  
+   * Carries out the reads of prefetch() and the writes of flushFile() asynchronously
+	 */
+  IOEngine *ioEngine;
+
+	/**
+   * Number of writes submitted to ioEngine and not completed yet
+	 */
+  std::uint32_t writesInFlight;
+
+	/**
+   * The frames of each write submitted to ioEngine by writeBack(), pages consecutive in one file, by the index in
+   * the tag of the write
+	 */
+  std::vector< std::vector<FrameId> > writeRuns;
+
+	/**
+   * The mapping which holds bufPool, and its size
+	 */
+  void* poolMapping;
+  std::size_t poolMappingBytes;
+
+	/**
+   * The pages bufPool is mapped with, after any fallback
+	 */
+  HugePages poolPages;
+
+	/**
+   * Pin counts of the pages of mapped files, see File::mappedPage(), which are handed out where they lie in the
+   * mapping instead of in a frame. A page is in the map while it is pinned
+	 */
+  std::map<std::pair<const File*, PageId>, std::uint32_t> mappedPins;
+
+	/**
+   * First frame of the list of the frames assigned to each file, linked through BufDesc::prevInFile and
+   * BufDesc::nextInFile, so that the frames of a file are found without scanning the whole buffer pool. A file is
+   * in the map while any frame is assigned to it
+	 */
+  std::map<const File*, FrameId> fileFrames;
+
+	/**
+   * The frames assigned to no page, which allocBuf() takes before it sweeps the clock. Every frame which is not
+   * valid is on it, pushed by clearFrame()
+	 */
+  std::vector<FrameId> freeFrames;
+
+	/**
+   * Number of frames a sweep of the clock evicts at once, EVICTBATCH for pools of 64 times as many frames or more,
+   * fewer for smaller pools
+	 */
+  std::uint32_t victimBatch;
+
+	/**
+	 * Assign a frame to a page of a file, with BufDesc::Set(), and add it to the list of the frames of the file.
+	 *
+	 * @param frameNo	Frame number
+	 * @param file		File object
+	 * @param pageNo	Page number in the file
+	 */
+  void setFrame(const FrameId frameNo, File* file, const PageId pageNo);
+
+	/**
+	 * Take the frame off the list of the frames of its file, if it is assigned to one, clear it with BufDesc::Clear(),
+	 * and put it on the free-frame list.
+	 *
+	 * @param frameNo	Frame number
+	 */
+  void clearFrame(const FrameId frameNo);
+
+	/**
+	 * Find the frames assigned to the file once the reads into them in flight have completed, sorted by page number,
+	 * and check that none of them is pinned.
+	 *
+	 * @param file		File object
+	 * @param frames	Returns the frame numbers
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool, or in its mapping
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void unpinnedFileFrames(const File* file, std::vector<FrameId> & frames);
+
+	/**
+	 * Map the memory of bufPool, aligned to huge pages unless HUGEPAGES_NONE is asked for. The memory is only reserved,
+	 * and taken once the frames are used.
+	 *
+	 * @param bufs	Number of frames
+	 * @param hugePages	The pages to map the frames with
+	 * @throws std::bad_alloc If the memory cannot be mapped
+	 */
+  void mapPool(std::uint32_t bufs, HugePages hugePages);
+
+	/**
+	 * Touch every frame of bufPool, with the frames split between threads, so that the memory is faulted in.
+	 *
+	 * @param threads	Number of threads
+	 */
+  void prefaultPool(std::uint32_t threads);
+
+	/**
+	 * Allocate a free frame, from the free-frame list, which evictVictims() refills when it has run out.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
@@ -195,6 +432,25 @@ class BufMgr
   void allocBuf(FrameId & frame);
 
 	/**
+	 * Sweep the clock for up to victimBatch frames neither pinned nor referenced recently, write back the dirty ones
+	 * together, and put them all on the free-frame list.
+	 *
+	 * @throws BufferExceededException If every frame is pinned
+	 */
+  void evictVictims();
+
+	/**
+	 * Take the frame of the ring of a BufferAccessStrategy a page missing from the buffer pool is read into. The frame
+	 * the ring is at is reused if it holds a page nobody has pinned or referenced since the ring took it, otherwise it
+	 * is left to the buffer pool and allocBuf() takes another one.
+	 *
+	 * @param strategy	The strategy
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void allocRingBuf(BufferAccessStrategy * strategy, FrameId & frame);
+
+	/**
    * Advance clock to next frame in the buffer pool
 	 */
   void advanceClock()
@@ -202,17 +458,53 @@ class BufMgr
 		clockHand = (clockHand + 1) % numBufs;
   }
 
+	/**
+	 * Apply a completion of ioEngine. A read makes its frame usable, or empty if it failed, so that the page is read
+	 * again by readPage(). A write marks its frame clean, unless it failed.
+	 *
+	 * @param completion	The completion
+	 */
+  void completeIO(const IOCompletion & completion);
+
+	/**
+	 * Wait for at least one request of ioEngine to complete, and apply all the completions reaped.
+	 */
+  void reapIO();
+
+	/**
+	 * Wait until the read into a frame has completed.
+	 *
+	 * @param frame	Frame number
+	 */
+  void waitForRead(const FrameId frame);
+
+	/**
+	 * Write the pages of dirty frames back to their files, in one batch through ioEngine for the files which allow it,
+	 * and wait until they are all written. The pages are written in the order of their files and page numbers, and the
+	 * pages consecutive in a file are written together, up to WRITERUNPAGES of them, by a single vectored write. A
+	 * write ioEngine could not finish is repeated through File::writePage() for each page.
+	 *
+	 * @param frames	Frame numbers
+	 */
+  void writeBack(const std::vector<FrameId> & frames);
+
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated. Every frame is aligned to File::DIRECT_ALIGNMENT,
+   * so that files opened with direct I/O read and write it without going through the page cache. A frame holds
+   * whatever it held last, zeroes at first, until a page is read into it or allocated in it.
 	 */
   Page* bufPool;
 
 	/**
    * Constructor of BufMgr class
+	 *
+	 * @param bufs	Number of frames
+	 * @param ioOptions	Options of the IOEngine which carries out prefetches and write-backs
+	 * @param poolOptions	Options of the memory of the frames
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, const IOOptions & ioOptions = IOOptions(), const PoolOptions & poolOptions = PoolOptions());
 	
 	/**
    * Destructor of BufMgr class
@@ -223,12 +515,37 @@ class BufMgr
 	 * Reads the given page from the file into a frame and returns the pointer to page.
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
 	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * The pages of a mapped file, like MmapFile, are returned where they lie in the mapping, with no frame and no copy;
+	 * they are pinned and unpinned only to keep count, and must not be written.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param strategy	If not NULL, a page missing from the buffer pool is read into a frame of the ring of the strategy,
+	 * 								and not marked referenced, so that a bulk operation does not evict the rest of the buffer pool
+   * @throws  BufferExceededException If the page is not in the buffer pool and every frame is pinned
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  void readPage(File* file, const PageId PageNo, Page*& page, BufferAccessStrategy * strategy = NULL);
+
+	/**
+	 * Starts reading the given pages of the file into frames, without waiting for the reads to complete and without
+	 * pinning the pages. All the reads are submitted together. A later readPage() of one of the pages waits for its read
+	 * only. Pages already in the buffer pool are skipped.
+	 *
+	 * @param file   	File object
+	 * @param pageNos	Page numbers in the file
+	 */
+  void prefetch(File* file, const std::vector<PageId> & pageNos);
+
+	/**
+	 * Reads the given pages of the file into frames and pins them, like readPage() for each of them, but with all the
+	 * reads of the pages not in the buffer pool in flight together.
+	 *
+	 * @param file   	File object
+	 * @param pageNos	Page numbers in the file
+	 * @param pages		Returns the pointers to the pages, in the order of pageNos
+	 */
+  void readPages(File* file, const std::vector<PageId> & pageNos, std::vector<Page*> & pages);
 
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
@@ -237,6 +554,7 @@ class BufMgr
 	 * @param PageNo  Page number
 	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
    * @throws  PageNotPinnedException If the page is not already pinned
+   * @throws  ReadOnlyFileException If dirty is true for a page of a mapped file
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
 
@@ -247,20 +565,32 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
 	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+   * @throws  BufferExceededException If every frame is pinned
 	 */
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Writes out all dirty pages of the file to disk, in the order of their page numbers, and syncs the file once they
+	 * are all written. Only the frames of the file are touched, not the whole buffer pool.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
 	 * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool, or in its mapping
    * @throws BadBufferException If any frame allocated to the file is found to be invalid
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Drops all the pages of the file from the buffer pool without writing the dirty ones out, for a file about to be
+	 * removed. Like flushFile(), it only touches the frames of the file.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool, or in its mapping
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void dropFile(const File* file);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -271,6 +601,21 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Resizes the buffer pool while it is in use, to any number of frames up to PoolOptions::maxFrames. Frames added
+	 * go on the free-frame list. Frames removed are the last ones: their pages are written back if dirty and dropped
+	 * from the buffer pool, and the memory of the whole huge pages they leave is given back to the kernel. The hash
+	 * table is resized as well, its entries moved to the new table a few at a time by the next lookups, so that no
+	 * readPage() waits for the whole table.
+	 *
+	 * @param bufs	New number of frames
+   * @throws  BadResizeException If bufs is 0 or more than PoolOptions::maxFrames. The buffer pool is left unchanged
+   * @throws  PagePinnedException If a page in any of the frames removed is pinned. The buffer pool is left unchanged
+	 *
+	 * resize() never throws BufferExceededException, which readPage() and allocPage() throw when every frame is pinned.
+	 */
+  void resize(const std::uint32_t bufs);
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
@@ -289,6 +634,73 @@ class BufMgr
   void clearBufStats() 
   {
 		bufStats.clear();
+  }
+
+	/**
+   * Get the statistics and latency histograms of the reads and writes of the IOEngine
+	 */
+  IOStats & getIOStats()
+  {
+		return ioEngine->getStats();
+  }
+
+	/**
+   * Get the backend of the IOEngine, which may be the fallback of the one asked for
+	 */
+  IOBackend getIOBackend() const
+  {
+		return ioEngine->backend();
+  }
+
+	/**
+   * Get the pages the frames are mapped with, which may be the fallback of the ones asked for
+	 */
+  HugePages getPoolPages() const
+  {
+		return poolPages;
+  }
+
+	/**
+   * Get the number of bytes of bufPool actually backed by huge pages, as the kernel reports them in
+   * /proc/self/smaps. Only the frames touched so far are backed by any page.
+	 */
+  std::size_t getHugePageBytes() const;
+
+	/**
+   * Get the number of pages of mapped files pinned, which take no frame
+	 */
+  std::size_t getMappedPinned() const
+  {
+		return mappedPins.size();
+  }
+
+	/**
+   * Get the number of frames assigned to the file, found through the list of its frames
+	 */
+  std::uint32_t getFileFrames(const File* file) const;
+
+	/**
+   * Get the number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
+	/**
+   * Get the number of frames the buffer pool can be resized up to
+	 */
+  std::uint32_t getMaxBufs() const
+  {
+		return maxBufs;
+  }
+
+	/**
+   * Get the number of frames on the free-frame list
+	 */
+  std::uint32_t getFreeFrames() const
+  {
+		return freeFrames.size();
   }
 };
 
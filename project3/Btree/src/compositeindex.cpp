@@ -0,0 +1,639 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compositeindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// CompositeBTreeIndex::CompositeBTreeIndex -- Constructor
+// -----------------------------------------------------------------------------
+/**
+ * Constructor
+ *
+ * The index file name is constructed by concatenating the relation name with
+ * the offsets of all the key attributes, with ".composite" appended. If the
+ * index file exists, it is opened and the key schema in its meta page is
+ * checked. Else, a new index file is created and every tuple of the relation
+ * is inserted.
+ *
+ * @param relationName The name of the relation on which to build the index.
+ * @param outIndexName The name of the index file
+ * @param bufMgrIn The instance of the global buffer manager.
+ * @param keyAttrs The attributes of the key, in the order they are compared.
+ */
+CompositeBTreeIndex::CompositeBTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const std::vector<KeyAttr> & keyAttrs)
+{
+    if(keyAttrs.empty() || keyAttrs.size() > (std::size_t) MAXKEYATTRS){
+        throw BadIndexInfoException("A composite key needs 1 to MAXKEYATTRS attributes.");
+    }
+    this -> bufMgr = bufMgrIn;
+    this -> keyAttrs = keyAttrs;
+
+    // lay out the key and pick the comparison of every attribute
+    this -> keyWidth = 0;
+    this -> comparator.attrCount = keyAttrs.size();
+    for(std::size_t i = 0; i < keyAttrs.size(); i++){
+        this -> comparator.keyOffsets[i] = this -> keyWidth;
+        switch(keyAttrs[i].attrType){
+            case INTEGER:
+                this -> comparator.attrCompare[i] = &AttrTraits<INTEGER>::compare;
+                this -> keyWidth += AttrTraits<INTEGER>::width;
+                break;
+            case DOUBLE:
+                this -> comparator.attrCompare[i] = &AttrTraits<DOUBLE>::compare;
+                this -> keyWidth += AttrTraits<DOUBLE>::width;
+                break;
+            case STRING:
+                this -> comparator.attrCompare[i] = &AttrTraits<STRING>::compare;
+                this -> keyWidth += AttrTraits<STRING>::width;
+                break;
+        }
+    }
+    this -> entryWidth = this -> keyWidth + sizeof(RecordId);
+    this -> leafOccupancy = COMPOSITENODEDATASIZE / this -> entryWidth;
+    this -> nodeOccupancy = (COMPOSITENODEDATASIZE - sizeof(PageId)) / (this -> entryWidth + sizeof(PageId));
+
+    this -> scanExecuting = false;
+    this -> currentPageNum = Page::INVALID_NUMBER;
+    this -> currentPageData = NULL;
+    this -> nextEntry = -1;
+    this -> scanAttrs = 0;
+    this -> highOp = (Operator)-1;
+
+    std::ostringstream idxStr;
+    idxStr << relationName;
+    for(std::size_t i = 0; i < keyAttrs.size(); i++){
+        idxStr << '.' << keyAttrs[i].attrByteOffset;
+    }
+    idxStr << ".composite";
+    std::string indexName = idxStr.str();
+    outIndexName = indexName;
+
+    if(File::exists(indexName)){
+        this -> file = (File *) new BlobFile(outIndexName, false);
+        PageId metaPageId = 1;
+        Page * metaPage;
+        this -> bufMgr -> readPage(this -> file, metaPageId, metaPage);
+        IndexMetaInfo * metaInfo = (IndexMetaInfo *) metaPage;
+        if(metaInfo -> formatVersion != INDEXFORMATVERSION){
+            this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+            this -> bufMgr -> flushFile(this -> file);
+            delete this -> file;
+            throw BadIndexInfoException("Index file exists but its format is not the one of this version.");
+        }
+        bool schemaMatch = metaInfo -> relationName == relationName && metaInfo -> keyCount == (int) keyAttrs.size();
+        for(std::size_t i = 0; schemaMatch && i < keyAttrs.size(); i++){
+            schemaMatch = metaInfo -> keyOffsets[i] == keyAttrs[i].attrByteOffset && metaInfo -> keyTypes[i] == keyAttrs[i].attrType;
+        }
+        if(!schemaMatch){
+            this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+            this -> bufMgr -> flushFile(this -> file);
+            delete this -> file;
+            throw BadIndexInfoException("Index file exists but key schema in metapage not match.");
+        }
+        this -> headerPageNum = metaPageId;
+        this -> rootPageNum = metaInfo -> rootPageNo;
+        this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+        return;
+    }
+
+    this -> file = (File *) new BlobFile(outIndexName, true);
+    PageId metaPageId;
+    Page * metaPage;
+    this -> bufMgr -> allocPage(this -> file, metaPageId, metaPage);
+    IndexMetaInfo * metaInfo = (IndexMetaInfo *) metaPage;
+    strcpy(metaInfo -> relationName, relationName.c_str());
+    // the first key attribute doubles as the attribute of the index
+    metaInfo -> attrByteOffset = keyAttrs[0].attrByteOffset;
+    metaInfo -> attrType = keyAttrs[0].attrType;
+    metaInfo -> includeCount = 0;
+    metaInfo -> statsPageNo = Page::INVALID_NUMBER;
+    metaInfo -> nodeLayout = SORTED_KEYS;
+    metaInfo -> compressedLeaves = false;
+    metaInfo -> formatVersion = INDEXFORMATVERSION;
+    metaInfo -> keyCount = keyAttrs.size();
+    for(std::size_t i = 0; i < keyAttrs.size(); i++){
+        metaInfo -> keyOffsets[i] = keyAttrs[i].attrByteOffset;
+        metaInfo -> keyTypes[i] = keyAttrs[i].attrType;
+    }
+    this -> headerPageNum = metaPageId;
+
+    // the tree starts as a single empty leaf, which is the root
+    Page * rootPage;
+    this -> bufMgr -> allocPage(this -> file, this -> rootPageNum, rootPage);
+    CompositeNode * root = (CompositeNode *) rootPage;
+    root -> isLeaf = 1;
+    root -> slotTaken = 0;
+    root -> rightSibPageNo = Page::INVALID_NUMBER;
+    this -> bufMgr -> unPinPage(this -> file, this -> rootPageNum, true);
+    metaInfo -> rootPageNo = this -> rootPageNum;
+    this -> bufMgr -> unPinPage(this -> file, metaPageId, true);
+
+    // scan the relation and insert into the index file
+    FileScan * fileScan = new FileScan(relationName, bufMgrIn);
+    std::vector<char> key(this -> keyWidth);
+    try
+    {
+        RecordId scanRid;
+        while(1)
+        {
+            fileScan -> scanNext(scanRid);
+            std::string recordStr = fileScan -> getRecord();
+            this -> extractKey(recordStr.c_str(), &key[0]);
+            this -> insertEntry(&key[0], scanRid);
+        }
+    }
+    catch(EndOfFileException e)
+    {
+        // this case means reaching the end of the relation file.
+    }
+    delete fileScan;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeBTreeIndex::~CompositeBTreeIndex -- destructor
+// -----------------------------------------------------------------------------
+/**
+ * Destructor
+ * End the scan still executing, then flush the index file and close it.
+ */
+CompositeBTreeIndex::~CompositeBTreeIndex()
+{
+    if(this -> scanExecuting){
+        this -> endScan();
+    }
+    this -> bufMgr -> flushFile(this -> file);
+    delete this -> file;
+}
+
+/**
+ * Width of the keys of the index.
+ * @return the width in bytes
+ */
+const int CompositeBTreeIndex::getKeyWidth() const
+{
+    return this -> keyWidth;
+}
+
+/**
+ * Build the key of a record, the values of the key attributes one after the other.
+ * @param record The record
+ * @param outKey Returns the key
+ */
+const void CompositeBTreeIndex::extractKey(const void* record, void* outKey) const
+{
+    for(std::size_t i = 0; i < this -> keyAttrs.size(); i++){
+        int width = (i + 1 < this -> keyAttrs.size() ? this -> comparator.keyOffsets[i + 1] : this -> keyWidth) - this -> comparator.keyOffsets[i];
+        memcpy((char *) outKey + this -> comparator.keyOffsets[i], (const char *) record + this -> keyAttrs[i].attrByteOffset, width);
+    }
+}
+
+/**
+ * Find the slot of a leaf node.
+ * @param node: the leaf node
+ * @param slot: the slot
+ * @return a pointer to the key of the slot, which the RecordId follows
+ */
+char * CompositeBTreeIndex::leafSlot(CompositeNode * node, const int slot)
+{
+    return node -> data + (std::size_t) slot * this -> entryWidth;
+}
+
+/**
+ * Find the slot of a non-leaf node.
+ * @param node: the non-leaf node
+ * @param slot: the slot
+ * @return a pointer to the entry of the slot, which the page number of its right child follows
+ */
+char * CompositeBTreeIndex::nonLeafSlot(CompositeNode * node, const int slot)
+{
+    // the page number of the leftmost child comes first
+    return node -> data + sizeof(PageId) + (std::size_t) slot * (this -> entryWidth + sizeof(PageId));
+}
+
+/**
+ * Find a child of a non-leaf node.
+ * @param node: the non-leaf node
+ * @param child: the number of the child, 0 for the leftmost one
+ * @return the page number of the child
+ */
+PageId CompositeBTreeIndex::childPageNo(CompositeNode * node, const int child)
+{
+    PageId pageNo;
+    const char * at = (child == 0) ? node -> data : this -> nonLeafSlot(node, child - 1) + this -> entryWidth;
+    memcpy(&pageNo, at, sizeof(PageId));
+    return pageNo;
+}
+
+/**
+ * Compare two entries by key and then by RecordId.
+ * @param a: the first entry
+ * @param b: the second entry
+ * @return negative, zero or positive if a is smaller than, equal to or larger than b
+ */
+int CompositeBTreeIndex::compareEntries(const char * a, const char * b) const
+{
+    int c = this -> comparator.compare(a, b, this -> comparator.attrCount);
+    if(c != 0){
+        return c;
+    }
+    RecordId ridA;
+    RecordId ridB;
+    memcpy(&ridA, a + this -> keyWidth, sizeof(RecordId));
+    memcpy(&ridB, b + this -> keyWidth, sizeof(RecordId));
+    if(ridA.page_number != ridB.page_number){
+        return ridA.page_number < ridB.page_number ? -1 : 1;
+    }
+    return (ridA.slot_number > ridB.slot_number) - (ridA.slot_number < ridB.slot_number);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeBTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+/**
+ * Insert a new entry using the pair <key,rid>.
+ * The entry goes into the leaf whose range holds it, found by comparing the
+ * whole entry, key and RecordId, against the separators.
+ * @param key The key, built by extractKey
+ * @param rid The corresponding record id of the tuple in the base relation
+ */
+const void CompositeBTreeIndex::insertEntry(const void* key, const RecordId rid)
+{
+    std::vector<char> entry(this -> entryWidth);
+    memcpy(&entry[0], key, this -> keyWidth);
+    memcpy(&entry[this -> keyWidth], &rid, sizeof(RecordId));
+
+    std::vector<PageId> searchPath;
+    PageId pid = this -> rootPageNum;
+    while(1){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, pid, page);
+        CompositeNode * node = (CompositeNode *) page;
+        if(node -> isLeaf){
+            this -> bufMgr -> unPinPage(this -> file, pid, false);
+            break;
+        }
+        // the child right of the last separator not larger than the entry
+        int lo = 0;
+        int hi = node -> slotTaken;
+        while(lo < hi){
+            int mid = (lo + hi) / 2;
+            if(this -> compareEntries(this -> nonLeafSlot(node, mid), &entry[0]) <= 0){
+                lo = mid + 1;
+            }
+            else{
+                hi = mid;
+            }
+        }
+        PageId child = this -> childPageNo(node, lo);
+        this -> bufMgr -> unPinPage(this -> file, pid, false);
+        searchPath.push_back(pid);
+        pid = child;
+    }
+    this -> insertLeafNode(pid, &entry[0], searchPath);
+}
+
+/**
+ * Insert an entry into a leaf node. A full leaf node is split up first, the
+ * new leaf page on its right side taking the larger half of the slots.
+ * @param pid: the page id of the leaf node
+ * @param entry: the entry
+ * @param searchPath: the page ids of the non-leaf nodes on the way to the leaf node
+ */
+const void CompositeBTreeIndex::insertLeafNode(const PageId pid, const char * entry, std::vector<PageId> & searchPath)
+{
+    Page * page;
+    this -> bufMgr -> readPage(this -> file, pid, page);
+    CompositeNode * node = (CompositeNode *) page;
+    CompositeNode * target = node;
+    PageId newPageId = Page::INVALID_NUMBER;
+    CompositeNode * newNode = NULL;
+    if(node -> slotTaken == this -> leafOccupancy){
+        Page * newPage;
+        this -> bufMgr -> allocPage(this -> file, newPageId, newPage);
+        newNode = (CompositeNode *) newPage;
+        newNode -> isLeaf = 1;
+        int leftCount = node -> slotTaken - node -> slotTaken / 2;
+        newNode -> slotTaken = node -> slotTaken - leftCount;
+        memcpy(this -> leafSlot(newNode, 0), this -> leafSlot(node, leftCount), (std::size_t) newNode -> slotTaken * this -> entryWidth);
+        node -> slotTaken = leftCount;
+        newNode -> rightSibPageNo = node -> rightSibPageNo;
+        node -> rightSibPageNo = newPageId;
+        if(this -> compareEntries(entry, this -> leafSlot(newNode, 0)) > 0){
+            target = newNode;
+        }
+    }
+
+    // shift the larger slots up by one and put the entry in between
+    int lo = 0;
+    int hi = target -> slotTaken;
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(this -> compareEntries(this -> leafSlot(target, mid), entry) < 0){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    memmove(this -> leafSlot(target, lo + 1), this -> leafSlot(target, lo), (std::size_t)(target -> slotTaken - lo) * this -> entryWidth);
+    memcpy(this -> leafSlot(target, lo), entry, this -> entryWidth);
+    target -> slotTaken++;
+
+    if(newNode == NULL){
+        this -> bufMgr -> unPinPage(this -> file, pid, true);
+        return;
+    }
+    // the smallest entry of the new leaf page separates it from this one
+    std::vector<char> separator(this -> leafSlot(newNode, 0), this -> leafSlot(newNode, 0) + this -> entryWidth);
+    this -> bufMgr -> unPinPage(this -> file, pid, true);
+    this -> bufMgr -> unPinPage(this -> file, newPageId, true);
+    this -> pushUp(pid, &separator[0], newPageId, searchPath);
+}
+
+/**
+ * Insert a separator and the child on its right side into a non-leaf node.
+ * A full non-leaf node is split up, pushing its middle separator up.
+ * @param pid: the page id of the non-leaf node
+ * @param entry: the separator
+ * @param rightPageId: the page id of the new child
+ * @param searchPath: the page ids of the non-leaf nodes on the way to this node
+ */
+const void CompositeBTreeIndex::insertNonLeafNode(const PageId pid, const char * entry, const PageId rightPageId, std::vector<PageId> & searchPath)
+{
+    Page * page;
+    this -> bufMgr -> readPage(this -> file, pid, page);
+    CompositeNode * node = (CompositeNode *) page;
+    const int slotWidth = this -> entryWidth + sizeof(PageId);
+    int lo = 0;
+    int hi = node -> slotTaken;
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(this -> compareEntries(this -> nonLeafSlot(node, mid), entry) < 0){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    if(node -> slotTaken < this -> nodeOccupancy){
+        memmove(this -> nonLeafSlot(node, lo + 1), this -> nonLeafSlot(node, lo), (std::size_t)(node -> slotTaken - lo) * slotWidth);
+        memcpy(this -> nonLeafSlot(node, lo), entry, this -> entryWidth);
+        memcpy(this -> nonLeafSlot(node, lo) + this -> entryWidth, &rightPageId, sizeof(PageId));
+        node -> slotTaken++;
+        this -> bufMgr -> unPinPage(this -> file, pid, true);
+        return;
+    }
+
+    // merge the new slot into a copy of the slots, then keep the left half
+    // here and move the right half to a new node. The middle separator moves
+    // up, and its child becomes the leftmost child of the new node.
+    const int total = node -> slotTaken + 1;
+    std::vector<char> merged((std::size_t) total * slotWidth);
+    memcpy(&merged[0], this -> nonLeafSlot(node, 0), (std::size_t) lo * slotWidth);
+    memcpy(&merged[(std::size_t) lo * slotWidth], entry, this -> entryWidth);
+    memcpy(&merged[(std::size_t) lo * slotWidth + this -> entryWidth], &rightPageId, sizeof(PageId));
+    memcpy(&merged[(std::size_t)(lo + 1) * slotWidth], this -> nonLeafSlot(node, lo), (std::size_t)(node -> slotTaken - lo) * slotWidth);
+    const int middle = total / 2;
+
+    PageId newPageId;
+    Page * newPage;
+    this -> bufMgr -> allocPage(this -> file, newPageId, newPage);
+    CompositeNode * newNode = (CompositeNode *) newPage;
+    newNode -> isLeaf = 0;
+    newNode -> rightSibPageNo = Page::INVALID_NUMBER;
+    newNode -> slotTaken = total - middle - 1;
+    memcpy(newNode -> data, &merged[(std::size_t) middle * slotWidth + this -> entryWidth], sizeof(PageId));
+    memcpy(this -> nonLeafSlot(newNode, 0), &merged[(std::size_t)(middle + 1) * slotWidth], (std::size_t) newNode -> slotTaken * slotWidth);
+    memcpy(this -> nonLeafSlot(node, 0), &merged[0], (std::size_t) middle * slotWidth);
+    node -> slotTaken = middle;
+    std::vector<char> separator(merged.begin() + (std::size_t) middle * slotWidth, merged.begin() + (std::size_t) middle * slotWidth + this -> entryWidth);
+    this -> bufMgr -> unPinPage(this -> file, pid, true);
+    this -> bufMgr -> unPinPage(this -> file, newPageId, true);
+    this -> pushUp(pid, &separator[0], newPageId, searchPath);
+}
+
+/**
+ * Push up a separator after a split, into the parent node taken from the
+ * search path, or into a new root if the root has been split up.
+ * @param leftPageId: the page id of the node which has been split up
+ * @param entry: the separator
+ * @param rightPageId: the page id of the new node
+ * @param searchPath: the page ids of the non-leaf nodes on the way to the node which has been split up
+ */
+const void CompositeBTreeIndex::pushUp(const PageId leftPageId, const char * entry, const PageId rightPageId, std::vector<PageId> & searchPath)
+{
+    if(!searchPath.empty()){
+        PageId parentId = searchPath.back();
+        searchPath.pop_back();
+        this -> insertNonLeafNode(parentId, entry, rightPageId, searchPath);
+        return;
+    }
+    PageId rootId;
+    Page * rootPage;
+    this -> bufMgr -> allocPage(this -> file, rootId, rootPage);
+    CompositeNode * root = (CompositeNode *) rootPage;
+    root -> isLeaf = 0;
+    root -> slotTaken = 1;
+    root -> rightSibPageNo = Page::INVALID_NUMBER;
+    memcpy(root -> data, &leftPageId, sizeof(PageId));
+    memcpy(this -> nonLeafSlot(root, 0), entry, this -> entryWidth);
+    memcpy(this -> nonLeafSlot(root, 0) + this -> entryWidth, &rightPageId, sizeof(PageId));
+    this -> bufMgr -> unPinPage(this -> file, rootId, true);
+    this -> rootPageNum = rootId;
+
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    ((IndexMetaInfo *) metaPage) -> rootPageNo = rootId;
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeBTreeIndex::startScan
+// -----------------------------------------------------------------------------
+/**
+ * Begin a filtered scan of the index on the leading prefixAttrs key
+ * attributes. Only those attributes of the separators and entries are
+ * compared with the bounds, so that the scan descends to the first entry
+ * whose prefix satisfies the low bound.
+ *
+ * @param lowPrefix The low bound of the prefix.
+ * @param lowOpParm The operation to be used in testing the low range.
+ * @param highPrefix The high bound of the prefix.
+ * @param highOpParm The operation to be used in testing the high range.
+ * @param prefixAttrs The number of leading key attributes in the bounds.
+ */
+const void CompositeBTreeIndex::startScan(const void* lowPrefix,
+				   const Operator lowOpParm,
+				   const void* highPrefix,
+				   const Operator highOpParm,
+				   const int prefixAttrs)
+{
+    if(lowOpParm != GT && lowOpParm != GTE){
+        throw BadOpcodesException();
+    }
+    if(highOpParm != LT && highOpParm != LTE){
+        throw BadOpcodesException();
+    }
+    if(prefixAttrs < 1 || prefixAttrs > this -> comparator.attrCount
+       || this -> comparator.compare((const char *) lowPrefix, (const char *) highPrefix, prefixAttrs) > 0){
+        throw BadScanrangeException();
+    }
+    // If another scan is already executing, that needs to be ended here.
+    if(this -> scanExecuting == true){
+        this -> endScan();
+    }
+    this -> scanAttrs = prefixAttrs;
+    this -> highOp = highOpParm;
+    int prefixWidth = (prefixAttrs < this -> comparator.attrCount) ? this -> comparator.keyOffsets[prefixAttrs] : this -> keyWidth;
+    this -> highKey.assign((const char *) highPrefix, (const char *) highPrefix + prefixWidth);
+    this -> scanExecuting = true;
+
+    // an entry satisfies the low bound if its prefix compares above limit
+    const char * low = (const char *) lowPrefix;
+    const int limit = (lowOpParm == GT) ? 0 : -1;
+    PageId pid = this -> rootPageNum;
+    while(1){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, pid, page);
+        CompositeNode * node = (CompositeNode *) page;
+        if(node -> isLeaf){
+            this -> currentPageNum = pid;
+            this -> currentPageData = page;
+            break;
+        }
+        // skip the children whose separators on the right side do not satisfy
+        // the low bound, since all their entries are below those separators
+        int lo = 0;
+        int hi = node -> slotTaken;
+        while(lo < hi){
+            int mid = (lo + hi) / 2;
+            if(this -> comparator.compare(this -> nonLeafSlot(node, mid), low, prefixAttrs) <= limit){
+                lo = mid + 1;
+            }
+            else{
+                hi = mid;
+            }
+        }
+        PageId child = this -> childPageNo(node, lo);
+        this -> bufMgr -> unPinPage(this -> file, pid, false);
+        pid = child;
+    }
+    this -> nextEntry = -1;
+    this -> advanceLeafCursor();
+    while(this -> currentPageNum != Page::INVALID_NUMBER
+          && this -> comparator.compare(this -> leafSlot((CompositeNode *) this -> currentPageData, this -> nextEntry), low, prefixAttrs) <= limit){
+        this -> advanceLeafCursor();
+    }
+
+    bool found = false;
+    if(this -> currentPageNum != Page::INVALID_NUMBER){
+        int c = this -> comparator.compare(this -> leafSlot((CompositeNode *) this -> currentPageData, this -> nextEntry), &this -> highKey[0], prefixAttrs);
+        found = c < 0 || (c == 0 && this -> highOp == LTE);
+    }
+    if(!found){
+        this -> endScan();
+        throw NoSuchKeyFoundException();
+    }
+}
+
+/**
+ * Move the leaf cursor of the scan to the next entry, skipping empty leaf
+ * pages. The page left behind is unpinned, and the next one stays pinned.
+ */
+const void CompositeBTreeIndex::advanceLeafCursor()
+{
+    this -> nextEntry++;
+    CompositeNode * node = (CompositeNode *) this -> currentPageData;
+    while(this -> nextEntry >= node -> slotTaken){
+        PageId next = node -> rightSibPageNo;
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        this -> currentPageNum = next;
+        this -> nextEntry = 0;
+        if(next == Page::INVALID_NUMBER){
+            this -> currentPageData = NULL;
+            return;
+        }
+        this -> bufMgr -> readPage(this -> file, next, this -> currentPageData);
+        node = (CompositeNode *) this -> currentPageData;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// CompositeBTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+/**
+ * Fetch the record id of the next index entry that matches the scan.
+ * @param outRid RecordId of next record found that satisfies the scan criteria returned in this
+ * @param outKey If not NULL, returns the whole key of the entry
+ * @throws ScanNotInitializedException If no scan has been initialized.
+ * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+ */
+const void CompositeBTreeIndex::scanNext(RecordId& outRid, void* outKey)
+{
+    if(this -> scanExecuting == false){
+        throw ScanNotInitializedException();
+    }
+    if(this -> currentPageNum == Page::INVALID_NUMBER){
+        throw IndexScanCompletedException();
+    }
+    const char * slot = this -> leafSlot((CompositeNode *) this -> currentPageData, this -> nextEntry);
+    int c = this -> comparator.compare(slot, &this -> highKey[0], this -> scanAttrs);
+    if(c > 0 || (c == 0 && this -> highOp == LT)){
+        // the rest of the entries are above the high bound
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+        this -> currentPageNum = Page::INVALID_NUMBER;
+        this -> currentPageData = NULL;
+        throw IndexScanCompletedException();
+    }
+    memcpy(&outRid, slot + this -> keyWidth, sizeof(RecordId));
+    if(outKey != NULL){
+        memcpy(outKey, slot, this -> keyWidth);
+    }
+    this -> advanceLeafCursor();
+}
+
+// -----------------------------------------------------------------------------
+// CompositeBTreeIndex::endScan
+// -----------------------------------------------------------------------------
+/**
+ * This method terminates the current scan and unpins the leaf page still
+ * pinned by the scan.
+ * It throws ScanNotInitializedException when called before a successful
+ * startScan call.
+ */
+const void CompositeBTreeIndex::endScan()
+{
+    if(this -> scanExecuting == false){
+        throw ScanNotInitializedException();
+    }
+    if(this -> currentPageNum != Page::INVALID_NUMBER){
+        this -> bufMgr -> unPinPage(this -> file, this -> currentPageNum, false);
+    }
+    this -> scanExecuting = false;
+    this -> currentPageNum = Page::INVALID_NUMBER;
+    this -> currentPageData = NULL;
+    this -> nextEntry = -1;
+    this -> scanAttrs = 0;
+    this -> highKey.clear();
+    this -> highOp = (Operator)-1;
+}
+
+}
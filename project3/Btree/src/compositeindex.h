@@ -0,0 +1,398 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief An attribute of the key of a CompositeBTreeIndex.
+*/
+struct KeyAttr{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute, which gives its width: an int, a double or a char[64] string.
+   */
+	Datatype attrType;
+
+	KeyAttr(int attrByteOffset, Datatype attrType) : attrByteOffset(attrByteOffset), attrType(attrType) {}
+};
+
+/**
+ * @brief Width and comparison of the values of an attribute of type T inside a composite key, specialized for
+ * every Datatype at compile time. The values are copied out before comparing, since they need not be aligned.
+*/
+template <Datatype T>
+struct AttrTraits;
+
+template <>
+struct AttrTraits<INTEGER>{
+	static const int width = sizeof(int);
+
+	static int compare(const char * a, const char * b)
+	{
+		int x, y;
+		memcpy(&x, a, sizeof(int));
+		memcpy(&y, b, sizeof(int));
+		return (x > y) - (x < y);
+	}
+};
+
+template <>
+struct AttrTraits<DOUBLE>{
+	static const int width = sizeof(double);
+
+	static int compare(const char * a, const char * b)
+	{
+		double x, y;
+		memcpy(&x, a, sizeof(double));
+		memcpy(&y, b, sizeof(double));
+		return (x > y) - (x < y);
+	}
+};
+
+template <>
+struct AttrTraits<STRING>{
+	// the size of string record is provided in the instruction file
+	static const int width = 64;
+
+	static int compare(const char * a, const char * b)
+	{
+		return strncmp(a, b, 64);
+	}
+};
+
+/**
+ * @brief Lexicographic comparison of composite keys, which are the values of the key attributes one after the other.
+ * The comparison of every attribute is the one of AttrTraits for its type, picked once when the key schema is known.
+*/
+struct KeyComparator{
+  /**
+   * Number of attributes of the key.
+   */
+	int attrCount;
+
+  /**
+   * Offsets of the attributes inside the key.
+   */
+	int keyOffsets[ MAXKEYATTRS ];
+
+  /**
+   * Comparison function of every attribute.
+   */
+	int (*attrCompare[ MAXKEYATTRS ])(const char *, const char *);
+
+  /**
+   * Compare the leading attributes of two keys.
+   * @param a: the first key
+   * @param b: the second key
+   * @param attrs: the number of leading attributes to compare
+   * @return negative, zero or positive if a is smaller than, equal to or larger than b
+   */
+	int compare(const char * a, const char * b, const int attrs) const
+	{
+		for(int i = 0; i < attrs; i++){
+			int c = this -> attrCompare[i](a + this -> keyOffsets[i], b + this -> keyOffsets[i]);
+			if(c != 0){
+				return c;
+			}
+		}
+		return 0;
+	}
+};
+
+/**
+ * @brief Size of the data area of a CompositeNode.
+ */
+//                                                  isLeaf, slotTaken, rightSibPageNo
+const int COMPOSITENODEDATASIZE = Page::SIZE - 2 * sizeof( int ) - sizeof( PageId );
+
+/**
+ * @brief Structure of all the nodes of a CompositeBTreeIndex. As the width of the keys is only known at runtime, the
+ * slots are laid out in the data area by the index. A slot of a leaf node is a key followed by the RecordId of the
+ * entry. A non-leaf node starts with the page number of its leftmost child, and a slot of it is the smallest entry
+ * below the child on its right side, i.e. a key and a RecordId, followed by the page number of that child.
+*/
+struct CompositeNode{
+  /**
+   * 1 for a leaf node, 0 for a non-leaf node.
+   */
+	int isLeaf;
+
+  /**
+   * Number of slots taken up in the node.
+   */
+	int slotTaken;
+
+  /**
+   * Page number of the leaf on the right side, INVALID_NUMBER for the last leaf and for non-leaf nodes.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Slots of the node.
+   */
+	char data[ COMPOSITENODEDATASIZE ];
+};
+
+
+/**
+ * @brief CompositeBTreeIndex class. It implements a B+ Tree index on a composite key of several attributes of a
+ * relation, compared lexicographically, on the same BlobFile and BufMgr substrate as BTreeIndex. Entries are ordered
+ * by key and then by RecordId, so that the same key may occur many times. Scans may bound any number of the leading
+ * key attributes, e.g. all the entries with a given first attribute, or a range of the second attribute for a given
+ * first attribute. The key schema is kept in the IndexMetaInfo of the meta page. This index supports only one scan at a time.
+*/
+class CompositeBTreeIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Page number of root page of the tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Attributes of the key, in the order they are compared.
+   */
+	std::vector<KeyAttr>	keyAttrs;
+
+  /**
+   * Comparison of the keys.
+   */
+	KeyComparator	comparator;
+
+  /**
+   * Width of a key.
+   */
+	int			keyWidth;
+
+  /**
+   * Width of a leaf slot, a key followed by a RecordId.
+   */
+	int			entryWidth;
+
+  /**
+   * Number of slots in leaf node.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Number of slots in non-leaf node.
+   */
+	int			nodeOccupancy;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Page number of current leaf page being scanned, INVALID_NUMBER once the scan is complete.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current leaf page being scanned. It stays pinned until the scan moves on or ends.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Index of next entry to be scanned in current leaf page.
+   */
+	int			nextEntry;
+
+  /**
+   * Number of leading key attributes bounded by the scan.
+   */
+	int			scanAttrs;
+
+  /**
+   * High value of the leading key attributes for scan.
+   */
+	std::vector<char>	highKey;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+    /**
+     * Find the slot of a leaf node.
+     * @param node: the leaf node
+     * @param slot: the slot
+     * @return a pointer to the key of the slot, which the RecordId follows
+     */
+    char * leafSlot(CompositeNode * node, const int slot);
+
+    /**
+     * Find the slot of a non-leaf node.
+     * @param node: the non-leaf node
+     * @param slot: the slot
+     * @return a pointer to the entry of the slot, which the page number of its right child follows
+     */
+    char * nonLeafSlot(CompositeNode * node, const int slot);
+
+    /**
+     * Find a child of a non-leaf node.
+     * @param node: the non-leaf node
+     * @param child: the number of the child, 0 for the leftmost one
+     * @return the page number of the child
+     */
+    PageId childPageNo(CompositeNode * node, const int child);
+
+    /**
+     * Compare two entries by key and then by RecordId.
+     * @param a: the first entry, a key followed by a RecordId
+     * @param b: the second entry, a key followed by a RecordId
+     * @return negative, zero or positive if a is smaller than, equal to or larger than b
+     */
+    int compareEntries(const char * a, const char * b) const;
+
+    /**
+     * Insert an entry into a leaf node, splitting it up if it is full.
+     * @param pid: the page id of the leaf node
+     * @param entry: the entry, a key followed by a RecordId
+     * @param searchPath: the page ids of the non-leaf nodes on the way to the leaf node, from the root
+     */
+    const void insertLeafNode(const PageId pid, const char * entry, std::vector<PageId> & searchPath);
+
+    /**
+     * Insert a separator and the child on its right side into a non-leaf node, splitting it up if it is full.
+     * @param pid: the page id of the non-leaf node
+     * @param entry: the separator, the smallest entry below the new child
+     * @param rightPageId: the page id of the new child
+     * @param searchPath: the page ids of the non-leaf nodes on the way to this node, from the root
+     */
+    const void insertNonLeafNode(const PageId pid, const char * entry, const PageId rightPageId, std::vector<PageId> & searchPath);
+
+    /**
+     * Push up a separator after a split, into the parent node or into a new root.
+     * @param leftPageId: the page id of the node which has been split up
+     * @param entry: the separator, the smallest entry below the new node
+     * @param rightPageId: the page id of the new node
+     * @param searchPath: the page ids of the non-leaf nodes on the way to the node which has been split up
+     */
+    const void pushUp(const PageId leftPageId, const char * entry, const PageId rightPageId, std::vector<PageId> & searchPath);
+
+    /**
+     * Move the leaf cursor of the scan to the next entry, on the next non empty leaf page if needed.
+     * The current page is unpinned when the cursor leaves it. currentPageNum becomes INVALID_NUMBER after the last leaf page.
+     */
+    const void advanceLeafCursor();
+
+ public:
+
+  /**
+   * CompositeBTreeIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param keyAttrs						Attributes of the key, in the order they are compared
+   * @throws  BadIndexInfoException     If there are no or too many key attributes, or if the index file already exists for the corresponding attributes, but values in metapage(relationName, key attributes) do not match with values received through constructor parameters.
+   */
+	CompositeBTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn, const std::vector<KeyAttr> & keyAttrs);
+
+  /**
+   * CompositeBTreeIndex Destructor.
+	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * and delete file instance thereby closing the index file.
+	 * */
+	~CompositeBTreeIndex();
+
+  /**
+   * Width of the keys of the index.
+   * @return the width in bytes
+   */
+	const int getKeyWidth() const;
+
+  /**
+	 * Build the key of a record, the values of the key attributes one after the other.
+   * @param record		The record
+   * @param outKey		Returns the key, getKeyWidth() bytes
+	**/
+	const void extractKey(const void* record, void* outKey) const;
+
+  /**
+	 * Insert a new entry using the pair <key,rid>. The same key may be inserted many times.
+   * @param key			Key to insert, built by extractKey
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Begin a filtered scan of the index on the leading key attributes. The bounds are keys made of the values
+	 * of the leading prefixAttrs attributes only, e.g. (ItemID = 5) with prefixAttrs 1, or (ItemID = 5, Amount < 20.0)
+	 * as the low bound (5, -inf) GTE and the high bound (5, 20.0) LT with prefixAttrs 2.
+	 * If lowPrefix = 2, highPrefix = 5, lowOp = GT and highOp = LTE, then the scan should seek all entries
+	 * whose prefix is greater than 2 and less than or equal to 5.
+   * @param lowPrefix	Low bound of the prefix of the keys
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highPrefix	High bound of the prefix of the keys
+   * @param highOp		High operator (LT/LTE)
+   * @param prefixAttrs	Number of leading key attributes in the bounds
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowPrefix > highPrefix, or prefixAttrs is not between 1 and the number of key attributes
+	 * @throws  NoSuchKeyFoundException If there is no key in the index which satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowPrefix, const Operator lowOp, const void* highPrefix, const Operator highOp, const int prefixAttrs);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outKey	If not NULL, returns the whole key of the entry
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid, void* outKey = NULL);
+
+  /**
+	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+};
+
+}
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bad_resize_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+BadResizeException::BadResizeException(const std::uint32_t requested, const std::uint32_t maximum)
+    : BadgerDbException(""), requested_(requested), maximum_(maximum) {
+  std::stringstream ss;
+  ss << "Cannot resize the buffer pool to " << requested_
+     << " frames, it can have from 1 to " << maximum_;
+  message_.assign(ss.str());
+}
+
+}
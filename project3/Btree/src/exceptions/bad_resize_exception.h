@@ -0,0 +1,53 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a buffer pool is to be resized to
+ *        no frames, or to more frames than it has room for.
+ */
+class BadResizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a bad resize exception for the given sizes.
+   *
+   * @param requested  Number of frames asked for.
+   * @param maximum    Largest number of frames the buffer pool can have.
+   */
+  BadResizeException(const std::uint32_t requested, const std::uint32_t maximum);
+
+  /**
+   * Returns the number of frames asked for.
+   */
+  virtual std::uint32_t requested() const { return requested_; }
+
+  /**
+   * Returns the largest number of frames the buffer pool can have.
+   */
+  virtual std::uint32_t maximum() const { return maximum_; }
+
+ protected:
+  /**
+   * Number of frames asked for.
+   */
+  const std::uint32_t requested_;
+
+  /**
+   * Largest number of frames the buffer pool can have.
+   */
+  const std::uint32_t maximum_;
+};
+
+}
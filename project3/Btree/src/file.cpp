@@ -13,11 +13,20 @@
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/read_only_file_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
@@ -25,6 +34,21 @@ namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::DescriptorMap File::open_descriptors_;
+File::DescriptorMap File::open_direct_descriptors_;
+File::LayoutMap File::open_layouts_;
+const std::size_t File::DIRECT_ALIGNMENT;
+const std::uint64_t File::ALIGNED_LAYOUT_MARK;
+
+/**
+ * Returns true if a transfer of bytes can go through an O_DIRECT descriptor.
+ */
+static bool directAligned(const std::uint64_t offset, const void* buffer,
+                          const std::size_t length) {
+  return offset % File::DIRECT_ALIGNMENT == 0 &&
+         length % File::DIRECT_ALIGNMENT == 0 &&
+         reinterpret_cast<std::uintptr_t>(buffer) % File::DIRECT_ALIGNMENT == 0;
+}
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -64,21 +88,75 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+PageId File::getNumPages() {
+  const FileHeader& header = readHeader();
+  return header.num_pages;
+}
+
+std::shared_ptr<std::ifstream> File::openReadStream() const {
+  std::shared_ptr<std::ifstream> in(
+      new std::ifstream(filename_, std::ifstream::in | std::ifstream::binary));
+  if (!*in) {
+    throw FileNotFoundException(filename_);
+  }
+  return in;
+}
+
+Page File::readPageFromStream(std::istream& in, const PageId page_number,
+                              const bool aligned_layout) {
+  Page page;
+  in.seekg(pagePosition(page_number, aligned_layout), std::ios::beg);
+  in.read(reinterpret_cast<char*>(&page), Page::SIZE);
+  return page;
+}
+
+std::shared_ptr<std::ofstream> File::openWriteStream() const {
+  // without in, the file would be truncated on open
+  std::shared_ptr<std::ofstream> out(
+      new std::ofstream(filename_, std::ofstream::in | std::ofstream::out |
+                                       std::ofstream::binary));
+  if (!*out) {
+    throw FileNotFoundException(filename_);
+  }
+  return out;
+}
+
+void File::writePageToStream(std::ostream& out, const PageId page_number,
+                             const Page& new_page, const bool aligned_layout) {
+  out.seekp(pagePosition(page_number, aligned_layout), std::ios::beg);
+  out.write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
+}
+
+File::File(const std::string& name, const bool create_new,
+           const bool direct_io)
+    : filename_(name), direct_io_(direct_io) {
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
                          0 /* num_free_pages */, 0 /* first_free_page */};
-    writeHeader(header);
+    if (aligned_) {
+      // the header takes the whole first page, followed by the mark of the
+      // layout
+      std::unique_ptr<char[]> first_page(new char[Page::SIZE]());
+      std::memcpy(first_page.get(), &header, sizeof(FileHeader));
+      std::memcpy(first_page.get() + sizeof(FileHeader), &ALIGNED_LAYOUT_MARK,
+                  sizeof(ALIGNED_LAYOUT_MARK));
+      writeBytes(0 /* offset */, first_page.get(), Page::SIZE);
+    } else {
+      writeHeader(header);
+    }
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
+  direct_descriptor_ = -1;
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    descriptor_ = open_descriptors_[filename_];
+    aligned_ = open_layouts_[filename_];
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -97,9 +175,34 @@ void File::openIfNeeded(const bool create_new) {
       }
     }
     stream_.reset(new std::fstream(filename_, mode));
+    descriptor_ = ::open(filename_.c_str(), O_RDWR);
+    if (create_new) {
+      aligned_ = direct_io_;
+    } else {
+      std::uint64_t mark = 0;
+      readBytes(sizeof(FileHeader), &mark, sizeof(mark));
+      aligned_ = (mark == ALIGNED_LAYOUT_MARK);
+    }
     open_streams_[filename_] = stream_;
+    open_descriptors_[filename_] = descriptor_;
+    open_layouts_[filename_] = aligned_;
     open_counts_[filename_] = 1;
   }
+
+  // the pages of a file with the other layout are not aligned for O_DIRECT
+  if (direct_io_ && aligned_) {
+    DescriptorMap::iterator fd = open_direct_descriptors_.find(filename_);
+    if (fd != open_direct_descriptors_.end()) {
+      direct_descriptor_ = fd->second;
+    } else {
+      // a filesystem which does not support O_DIRECT rejects it here with
+      // EINVAL, and the file is read and written with buffered I/O
+      direct_descriptor_ = ::open(filename_.c_str(), O_RDWR | O_DIRECT);
+      if (direct_descriptor_ >= 0) {
+        open_direct_descriptors_[filename_] = direct_descriptor_;
+      }
+    }
+  }
 }
 
 void File::close() {
@@ -107,9 +210,24 @@ void File::close() {
   	--open_counts_[filename_];
 
   stream_.reset();
+  descriptor_ = -1;
+  direct_descriptor_ = -1;
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
+    DescriptorMap::iterator fd = open_descriptors_.find(filename_);
+    if (fd != open_descriptors_.end()) {
+      if (fd->second >= 0) {
+        ::close(fd->second);
+      }
+      open_descriptors_.erase(fd);
+    }
+    fd = open_direct_descriptors_.find(filename_);
+    if (fd != open_direct_descriptors_.end()) {
+      ::close(fd->second);
+      open_direct_descriptors_.erase(fd);
+    }
+    open_layouts_.erase(filename_);
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
   }
@@ -117,31 +235,103 @@ void File::close() {
 
 FileHeader File::readHeader() const {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+  readBytes(0 /* offset */, &header, sizeof(FileHeader));
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
-  stream_->flush();
+  writeBytes(0 /* offset */, &header, sizeof(FileHeader));
+}
+
+void File::readBytes(const std::uint64_t offset, void* buffer,
+                     const std::size_t length) const {
+  char* bytes = static_cast<char*>(buffer);
+  std::size_t done = 0;
+  int fd = descriptor_;
+  if (direct_descriptor_ >= 0 && directAligned(offset, buffer, length)) {
+    // the kernel keeps the page cache coherent with O_DIRECT transfers, so
+    // the header read through the other descriptor is up to date
+    fd = direct_descriptor_;
+  }
+  if (fd >= 0) {
+    // the stream is flushed after every write and drops what it has buffered
+    // whenever it seeks, so the descriptor sees everything written through it
+    while (done < length) {
+      const ssize_t count =
+          ::pread(fd, bytes + done, length - done, offset + done);
+      if (count < 0 && errno == EINTR) {
+        continue;
+      }
+      if (count < 0 && errno == EINVAL && fd == direct_descriptor_) {
+        // the filesystem rejects O_DIRECT transfers: switch back to
+        // buffered I/O
+        direct_descriptor_ = -1;
+        fd = descriptor_;
+        continue;
+      }
+      if (count <= 0) {
+        break;
+      }
+      done += count;
+    }
+  } else {
+    stream_->clear();
+    stream_->seekg(offset, std::ios::beg);
+    stream_->read(bytes, length);
+    done = stream_->gcount();
+    stream_->clear();
+  }
+  // past the end of the file
+  std::memset(bytes + done, 0, length - done);
+}
+
+void File::writeBytes(const std::uint64_t offset, const void* buffer,
+                      const std::size_t length) const {
+  const char* bytes = static_cast<const char*>(buffer);
+  int fd = descriptor_;
+  if (direct_descriptor_ >= 0 && directAligned(offset, buffer, length)) {
+    fd = direct_descriptor_;
+  }
+  if (fd >= 0) {
+    std::size_t done = 0;
+    while (done < length) {
+      const ssize_t count =
+          ::pwrite(fd, bytes + done, length - done, offset + done);
+      if (count < 0 && errno == EINTR) {
+        continue;
+      }
+      if (count < 0 && errno == EINVAL && fd == direct_descriptor_) {
+        direct_descriptor_ = -1;
+        fd = descriptor_;
+        continue;
+      }
+      if (count <= 0) {
+        break;
+      }
+      done += count;
+    }
+  } else {
+    stream_->seekp(offset, std::ios::beg);
+    stream_->write(bytes, length);
+    stream_->flush();
+  }
 }
 
 
 
 
 
-PageFile PageFile::create(const std::string& filename) {
-  return PageFile(filename, true /* create_new */);
+PageFile PageFile::create(const std::string& filename, const bool direct_io) {
+  return PageFile(filename, true /* create_new */, direct_io);
 }
 
-PageFile PageFile::open(const std::string& filename) {
-  return PageFile(filename, false /* create_new */);
+PageFile PageFile::open(const std::string& filename, const bool direct_io) {
+  return PageFile(filename, false /* create_new */, direct_io);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const bool direct_io)
+: File(name, create_new, direct_io)
 {
 }
 
@@ -149,7 +339,7 @@ PageFile::~PageFile() {
 }
 
 PageFile::PageFile(const PageFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */, other.direct_io_)
 {
 }
 
@@ -158,16 +348,22 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
+  direct_io_ = rhs.direct_io_;
   openIfNeeded(false /* create_new */);
   return *this;
 }
 
 Page PageFile::allocatePage(PageId &new_page_number) {
-  FileHeader header = readHeader();
   Page new_page;
+  allocatePageInto(new_page_number, new_page);
+  return new_page;
+}
+
+void PageFile::allocatePageInto(PageId &new_page_number, Page& new_page) {
+  FileHeader header = readHeader();
   Page existing_page;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
+    readPageInto(header.first_free_page, new_page, true /* allow_free */);
     new_page.set_page_number(header.first_free_page);
 		new_page_number = new_page.page_number();
     header.first_free_page = new_page.next_page_number();
@@ -202,6 +398,7 @@ Page PageFile::allocatePage(PageId &new_page_number) {
   }
 	else
 	{
+    new_page.initialize();
     new_page.set_page_number(header.num_pages);
 		new_page_number = new_page.page_number();
 
@@ -231,30 +428,31 @@ Page PageFile::allocatePage(PageId &new_page_number) {
     writePage(existing_page.page_number(), existing_page.header_, existing_page);
   }
   writeHeader(header);
-
-  return new_page;
 }
 
 Page PageFile::readPage(const PageId page_number) const {
+  Page page;
+  readPageInto(page_number, page);
+  return page;
+}
+
+void PageFile::readPageInto(const PageId page_number, Page& page) const {
   FileHeader header = readHeader();
 
 	if (page_number >= header.num_pages)
 	{
 		throw InvalidPageException(page_number, filename_);
 	}
-	return readPage(page_number, false /* allow_free */);
+	readPageInto(page_number, page, false /* allow_free */);
 }
 
-Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+void PageFile::readPageInto(const PageId page_number, Page& page,
+                            const bool allow_free) const {
+  // the header and the data are laid out in the file as in the page
+  readBytes(pageOffset(page_number), &page, Page::SIZE);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
-
-  return page;
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
@@ -268,11 +466,21 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	// we don't modify that, but we do keep all the other modifications to the
 	// page header.
 	const PageId next_page_number = header.next_page_number;
+	if (next_page_number == new_page.next_page_number())
+	{
+		// the page is written as it is, in one transfer
+		writePage(new_page_number, new_page.header_, new_page);
+		return;
+	}
 	header = new_page.header_;
 	header.next_page_number = next_page_number;
 	writePage(new_page_number, header, new_page);
 }
 
+bool PageFile::checkPage(const PageId page_number, const Page& page) const {
+  return page.isUsed();
+}
+
 void PageFile::deletePage(const PageId page_number) {
   FileHeader header = readHeader();
 
@@ -315,40 +523,53 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  if (&header == &new_page.header_) {
+    writeBytes(pageOffset(page_number), &new_page, Page::SIZE);
+  } else if (direct_descriptor_ >= 0) {
+    // an O_DIRECT transfer takes the whole page from aligned memory
+    void* aligned_page = NULL;
+    if (posix_memalign(&aligned_page, DIRECT_ALIGNMENT, Page::SIZE) != 0) {
+      throw std::bad_alloc();
+    }
+    std::memcpy(aligned_page, &header, sizeof(PageHeader));
+    std::memcpy(static_cast<char*>(aligned_page) + sizeof(PageHeader),
+                &new_page.data_[0], Page::DATA_SIZE);
+    writeBytes(pageOffset(page_number), aligned_page, Page::SIZE);
+    std::free(aligned_page);
+  } else {
+    writeBytes(pageOffset(page_number), &header, sizeof(PageHeader));
+    writeBytes(pageOffset(page_number) + sizeof(PageHeader),
+               &new_page.data_[0], Page::DATA_SIZE);
+  }
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
+  readBytes(pageOffset(page_number), &header, sizeof(PageHeader));
   return header;
 }
 
 
 
 
-BlobFile BlobFile::create(const std::string& filename) {
-  return BlobFile(filename, true /* create_new */);
+BlobFile BlobFile::create(const std::string& filename, const bool direct_io) {
+  return BlobFile(filename, true /* create_new */, direct_io);
 }
 
-BlobFile BlobFile::open(const std::string& filename) {
-  return BlobFile(filename, false /* create_new */);
+BlobFile BlobFile::open(const std::string& filename, const bool direct_io) {
+  return BlobFile(filename, false /* create_new */, direct_io);
 }
 
-BlobFile::BlobFile(const std::string& name, const bool create_new)
-: File(name, create_new) {
+BlobFile::BlobFile(const std::string& name, const bool create_new,
+                   const bool direct_io)
+: File(name, create_new, direct_io) {
 }
 
 BlobFile::~BlobFile() {
 }
 
 BlobFile::BlobFile(const BlobFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */, other.direct_io_)
 {
 }
 
@@ -357,13 +578,20 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
+  direct_io_ = rhs.direct_io_;
   openIfNeeded(false /* create_new */);
   return *this;
 }
 
 Page BlobFile::allocatePage(PageId &new_page_number) {
-  FileHeader header = readHeader();
 	Page new_page;
+	allocatePageInto(new_page_number, new_page);
+	return new_page;
+}
+
+void BlobFile::allocatePageInto(PageId &new_page_number, Page& new_page) {
+  FileHeader header = readHeader();
+	new_page.initialize();
 
 	new_page_number = header.num_pages;
 
@@ -375,21 +603,33 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 	writePage(new_page_number, new_page);
 	writeHeader(header);
+}
 
-	return new_page;
+PageId BlobFile::allocatePageRange(const PageId count) {
+  FileHeader header = readHeader();
+  const PageId first_page_number = header.num_pages;
+
+  if (header.first_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = first_page_number;
+  }
+  header.num_pages += count;
+  writeHeader(header);
+
+  return first_page_number;
 }
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	readPageInto(page_number, page);
 	return page;
 }
 
+void BlobFile::readPageInto(const PageId page_number, Page& page) const {
+	readBytes(pageOffset(page_number), &page, Page::SIZE);
+}
+
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+	writeBytes(pageOffset(new_page_number), &new_page, Page::SIZE);
 }
 
 //delePage should not be called for a blob_file, not supported
@@ -397,4 +637,99 @@ void BlobFile::deletePage(const PageId page_number) {
 	throw InvalidPageException(page_number, filename_);
 }
 
+MmapFile MmapFile::open(const std::string& filename) {
+  return MmapFile(filename);
+}
+
+MmapFile::MmapFile(const std::string& name)
+: File(name, false /* create_new */) {
+  map();
+}
+
+MmapFile::MmapFile(const MmapFile& other)
+: File(other.filename_, false /* create_new */) {
+  map();
+}
+
+MmapFile& MmapFile::operator=(const MmapFile& rhs) {
+  if (this == &rhs) {
+    return *this;
+  }
+  unmap();
+  close();	//close my file and associate me with the new one
+  filename_ = rhs.filename_;
+  openIfNeeded(false /* create_new */);
+  map();
+  return *this;
+}
+
+MmapFile::~MmapFile() {
+  unmap();
+}
+
+void MmapFile::map() {
+  mapping_ = NULL;
+  mapping_bytes_ = 0;
+  num_pages_ = 0;
+
+  struct stat st;
+  if (descriptor_ < 0 || ::fstat(descriptor_, &st) != 0 || st.st_size <= 0) {
+    return;
+  }
+  void* mapping = ::mmap(NULL, static_cast<std::size_t>(st.st_size), PROT_READ,
+                         MAP_SHARED, descriptor_, 0);
+  if (mapping == MAP_FAILED) {
+    return;
+  }
+  mapping_ = static_cast<char*>(mapping);
+  mapping_bytes_ = static_cast<std::size_t>(st.st_size);
+  if (mapping_bytes_ >= sizeof(FileHeader)) {
+    num_pages_ = reinterpret_cast<const FileHeader*>(mapping_)->num_pages;
+  }
+}
+
+void MmapFile::unmap() {
+  if (mapping_ != NULL) {
+    ::munmap(mapping_, mapping_bytes_);
+  }
+  mapping_ = NULL;
+  mapping_bytes_ = 0;
+  num_pages_ = 0;
+}
+
+Page* MmapFile::mappedPage(const PageId page_number) const {
+  // pages allocated by the header but never written lie past the end of the
+  // file, like the ones allocated after the file was mapped
+  const std::uint64_t offset = pageOffset(page_number);
+  if (page_number == Page::INVALID_NUMBER || page_number >= num_pages_ ||
+      offset + Page::SIZE > mapping_bytes_) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return reinterpret_cast<Page*>(mapping_ + offset);
+}
+
+Page MmapFile::allocatePage(PageId &new_page_number) {
+  throw ReadOnlyFileException(filename_);
+}
+
+void MmapFile::allocatePageInto(PageId &new_page_number, Page& new_page) {
+  throw ReadOnlyFileException(filename_);
+}
+
+Page MmapFile::readPage(const PageId page_number) const {
+  return *mappedPage(page_number);
+}
+
+void MmapFile::readPageInto(const PageId page_number, Page& page) const {
+  std::memcpy(&page, mappedPage(page_number), Page::SIZE);
+}
+
+void MmapFile::writePage(const PageId page_number, const Page& new_page) {
+  throw ReadOnlyFileException(filename_);
+}
+
+void MmapFile::deletePage(const PageId page_number) {
+  throw ReadOnlyFileException(filename_);
+}
+
 }
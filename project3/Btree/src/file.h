@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <map>
@@ -80,12 +81,16 @@ class File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to read and write pages with O_DIRECT.  A new
+   *                    file is then created with the aligned layout, see
+   *                    directIO().
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const bool direct_io = false);
 
   /**
    * Deletes an existing file.
@@ -124,6 +129,15 @@ class File {
    */
   virtual Page allocatePage(PageId &new_page_number) = 0;
 
+  /**
+   * Allocates a new page in the file, building it in place in the given page
+   * rather than returning a copy, as BufMgr does with its frames.
+   *
+   * @param new_page_number   Set to the number of the new page.
+   * @param new_page          Set to the new page.
+   */
+  virtual void allocatePageInto(PageId &new_page_number, Page& new_page) = 0;
+
   /**
    * Reads an existing page from the file.
    *
@@ -135,7 +149,21 @@ class File {
   virtual Page readPage(const PageId page_number) const = 0;
 
   /**
-   * Writes a page into the file at the given page number.
+   * Reads an existing page from the file straight into the given page, with
+   * a single copy from the kernel, rather than returning a copy.  BufMgr
+   * reads its frames this way.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.  Its contents are undefined if an
+   *                      exception is thrown.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  virtual void readPageInto(const PageId page_number, Page& page) const = 0;
+
+  /**
+   * Writes a page into the file at the given page number, straight from the
+   * given page with a single copy into the kernel.
    * No bounds checking is performed.
    *
    * @param page_number Number of page whose contents to replace.
@@ -164,18 +192,168 @@ class File {
    */
 	PageId getFirstPageNo();
 
+ 	/**
+   * Returns the number of pages allocated in the file, including the header.
+   * Valid page numbers are therefore below this number.
+   *
+   * @return  Number of pages in the file.
+   */
+	PageId getNumPages();
+
+  /**
+   * Opens a private input stream over the underlying file. Unlike the shared
+   * stream of this object, one such stream can be used per thread to read
+   * pages concurrently through readPageFromStream(), as long as nobody writes
+   * the pages being read at the same time.
+   *
+   * @return  The new input stream.
+   */
+  std::shared_ptr<std::ifstream> openReadStream() const;
+
+  /**
+   * Reads the page with the given number from a stream returned by
+   * openReadStream().  No bounds checking is performed.
+   *
+   * @param in              Stream to read from.
+   * @param page_number     Number of page to read.
+   * @param aligned_layout  Whether the file has the aligned layout, see
+   *                        alignedLayout().
+   * @return  The page.
+   */
+  static Page readPageFromStream(std::istream& in, const PageId page_number,
+                                 const bool aligned_layout = false);
+
+  /**
+   * Opens a private output stream over the underlying file, the counterpart
+   * of openReadStream() for pages which only one thread writes, and nobody
+   * reads through this object until that thread is done.
+   *
+   * @return  The new output stream.
+   */
+  std::shared_ptr<std::ofstream> openWriteStream() const;
+
+  /**
+   * Writes the page with the given number to a stream returned by
+   * openWriteStream().  The page has to be allocated in the file already.
+   *
+   * @param out             Stream to write to.
+   * @param page_number     Number of page to write.
+   * @param new_page        Page to write.
+   * @param aligned_layout  Whether the file has the aligned layout, see
+   *                        alignedLayout().
+   */
+  static void writePageToStream(std::ostream& out, const PageId page_number,
+                                const Page& new_page,
+                                const bool aligned_layout = false);
+
+  /**
+   * Returns a POSIX file descriptor of the underlying file, shared by all the
+   * File objects of the file like the stream.  Pages can be read and written
+   * through it at pageOffset() with pread()/pwrite() or asynchronously, as
+   * BufMgr does through its IOEngine.  The stream never holds pages written
+   * but not flushed, and drops what it has buffered whenever it seeks.
+   * With direct I/O, it is the O_DIRECT descriptor, and the memory of a
+   * transfer has to be aligned to DIRECT_ALIGNMENT, like the BufMgr frames.
+   *
+   * @return  The file descriptor, -1 if the file could not be opened.
+   */
+  int descriptor() const {
+    return direct_descriptor_ >= 0 ? direct_descriptor_ : descriptor_;
+  }
+
+  /**
+   * Returns the offset of the page with the given number in the file.
+   *
+   * @param page_number   Number of page.
+   * @return  Offset of page in file.
+   */
+  std::uint64_t pageOffset(const PageId page_number) const {
+    return static_cast<std::uint64_t>(pagePosition(page_number, aligned_));
+  }
+
+  /**
+   * Returns true if the pages of the file are read and written with O_DIRECT,
+   * bypassing the page cache of the kernel, so that they are only cached in
+   * the BufMgr pool.  This needs direct I/O to be asked for, a file with the
+   * aligned layout, and a filesystem which accepts O_DIRECT; otherwise, or
+   * once a transfer has been rejected, the file switches back to buffered I/O.
+   * Only whole pages in memory aligned to DIRECT_ALIGNMENT bypass the page
+   * cache: the file header and the page headers read alone do not.
+   */
+  bool directIO() const { return direct_descriptor_ >= 0; }
+
+  /**
+   * Returns true if the file has the aligned layout, which files created with
+   * direct I/O have: the file header takes a whole page, so that page n starts
+   * at n * Page::SIZE, aligned for O_DIRECT.  The layout is recorded in the
+   * file, and a file is opened with its own layout whether direct I/O is
+   * asked for or not.
+   */
+  bool alignedLayout() const { return aligned_; }
+
+  /**
+   * Alignment of the memory, offsets and lengths of O_DIRECT transfers.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+  /**
+   * Checks a page read through descriptor(), as readPage() would.
+   *
+   * @param page_number   Number of page read.
+   * @param page          The page.
+   * @return  False if readPage() would throw InvalidPageException for it.
+   */
+  virtual bool checkPage(const PageId page_number, const Page& page) const {
+    return true;
+  }
+
+  /**
+   * Returns whether a page can be written through descriptor() as it is, in
+   * place of writePage().
+   */
+  virtual bool rawPageWrites() const { return false; }
+
+  /**
+   * Returns the page with the given number where it lies in a memory mapping
+   * of the file, for files which are mapped like MmapFile.  BufMgr hands such
+   * pages out as they are instead of reading them into its frames.
+   *
+   * @param page_number   Number of page.
+   * @return  The page in the mapping, NULL if the file is not mapped.
+   * @throws  InvalidPageException  If the file is mapped and the page doesn't
+   *                                exist in it.
+   */
+  virtual Page* mappedPage(const PageId page_number) const { return NULL; }
+
+  /**
+   * Returns true if the pages of the file are served from a memory mapping
+   * by mappedPage(), and the file is read-only.
+   */
+  virtual bool mapped() const { return false; }
+
  protected:
   /**
    * Returns the position of the page with the given number in the file (as an
    * offset from the beginning of the file).
    *
-   * @param page_number   Number of page.
+   * @param page_number     Number of page.
+   * @param aligned_layout  Whether the file has the aligned layout.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
+  static std::streampos pagePosition(const PageId page_number,
+                                     const bool aligned_layout = false) {
+    if (aligned_layout) {
+      return static_cast<std::streamoff>(page_number) * Page::SIZE;
+    }
     return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
   }
 
+  /**
+   * Marks the files with the aligned layout.  It follows the file header,
+   * where the first page of a file with the other layout starts.
+   */
+  static const std::uint64_t ALIGNED_LAYOUT_MARK = 0xd1ec7b0a1196edbbULL;
+
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
@@ -210,8 +388,33 @@ class File {
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Reads bytes of the file straight into memory with pread() on <descriptor_>,
+   * or through <stream_> if the file has no descriptor.  Bytes past the end of
+   * the file are zeroed.
+   *
+   * @param offset  Offset in the file.
+   * @param buffer  Memory to read into.
+   * @param length  Number of bytes to read.
+   */
+  void readBytes(const std::uint64_t offset, void* buffer,
+                 const std::size_t length) const;
+
+  /**
+   * Writes bytes into the file straight from memory with pwrite() on
+   * <descriptor_>, or through <stream_> if the file has no descriptor.
+   *
+   * @param offset  Offset in the file.
+   * @param buffer  Memory to write from.
+   * @param length  Number of bytes to write.
+   */
+  void writeBytes(const std::uint64_t offset, const void* buffer,
+                  const std::size_t length) const;
+
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, int> DescriptorMap;
+  typedef std::map<std::string, bool> LayoutMap;
 
   /**
    * Streams for opened files.
@@ -223,6 +426,22 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * File descriptors for opened files.
+   */
+  static DescriptorMap open_descriptors_;
+
+  /**
+   * O_DIRECT file descriptors for opened files, opened when a File object of
+   * the file first asks for direct I/O.
+   */
+  static DescriptorMap open_direct_descriptors_;
+
+  /**
+   * Whether opened files have the aligned layout.
+   */
+  static LayoutMap open_layouts_;
+
   /**
    * Name of the file this object represents.
    */
@@ -233,6 +452,27 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * File descriptor for underlying filesystem object.
+   */
+  int descriptor_;
+
+  /**
+   * O_DIRECT file descriptor for underlying filesystem object, -1 without
+   * direct I/O.  Set to -1 when a transfer through it is rejected.
+   */
+  mutable int direct_descriptor_;
+
+  /**
+   * Whether direct I/O has been asked for.
+   */
+  bool direct_io_;
+
+  /**
+   * Whether the file has the aligned layout.
+   */
+  bool aligned_;
+
   friend class FileIterator;
 };
 
@@ -243,9 +483,11 @@ class PageFile : public File {
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to read and write pages with O_DIRECT, in the
+   *                  aligned layout, see File::directIO().
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static PageFile create(const std::string& filename);
+  static PageFile create(const std::string& filename, const bool direct_io = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
@@ -255,21 +497,25 @@ class PageFile : public File {
 	 * open_streams_ map.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to read and write pages with O_DIRECT, if the
+   *                  file has the aligned layout, see File::directIO().
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
-  static PageFile open(const std::string& filename);
+  static PageFile open(const std::string& filename, const bool direct_io = false);
 
   /**
    * Constructs a file object representing a file on the filesystem.
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to read and write pages with O_DIRECT.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+           const bool direct_io = false);
 
   /**
    * Copy constructor.
@@ -300,6 +546,14 @@ class PageFile : public File {
    */
   Page allocatePage(PageId &new_page_number);
 
+  /**
+   * Allocates a new page in the file, building it in place in the given page.
+   *
+   * @param new_page_number   Set to the number of the new page.
+   * @param new_page          Set to the new page.
+   */
+  void allocatePageInto(PageId &new_page_number, Page& new_page);
+
   /**
    * Reads an existing page from the file.
    *
@@ -310,6 +564,16 @@ class PageFile : public File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file straight into the given page.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page& page) const;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -326,6 +590,15 @@ class PageFile : public File {
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Checks a page read through descriptor(), which has to be in use.
+   *
+   * @param page_number   Number of page read.
+   * @param page          The page.
+   * @return  False if the page is free (unused).
+   */
+  bool checkPage(const PageId page_number, const Page& page) const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -344,19 +617,21 @@ class PageFile : public File {
  private:
 
   /**
-   * Reads a page from the file.  If <allow_free> is not set, an exception
-   * will be thrown if the page read from disk is not currently in use.
+   * Reads a page from the file into the given page.  If <allow_free> is not
+   * set, an exception will be thrown if the page read from disk is not
+   * currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file is read
+   * as zeroes, which is not in use.
    *
    * @param page_number   Number of page to read.
+   * @param page          Page to read into.
    * @param allow_free    Whether to allow reading a free (unused) page.
-   * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  void readPageInto(const PageId page_number, Page& page,
+                    const bool allow_free) const;
 
   /**
    * Writes a page into the file at the given page number with the given header.
@@ -389,9 +664,11 @@ class BlobFile : public File {
    * Creates a new BlobFile.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to read and write pages with O_DIRECT, in the
+   *                  aligned layout, see File::directIO().
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static BlobFile create(const std::string& filename);
+  static BlobFile create(const std::string& filename, const bool direct_io = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
@@ -401,9 +678,11 @@ class BlobFile : public File {
 	 * open_streams_ map.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to read and write pages with O_DIRECT, if the
+   *                  file has the aligned layout, see File::directIO().
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
-  static BlobFile open(const std::string& filename);
+  static BlobFile open(const std::string& filename, const bool direct_io = false);
 
   /**
    * Constructs a file object representing a file on the filesystem.
@@ -412,12 +691,14 @@ class BlobFile : public File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to read and write pages with O_DIRECT.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  BlobFile(const std::string& name, const bool create_new);
+  BlobFile(const std::string& name, const bool create_new,
+           const bool direct_io = false);
 
   /**
    * Copy constructor.
@@ -448,6 +729,24 @@ class BlobFile : public File {
    */
   Page allocatePage(PageId &new_page_number);
 
+  /**
+   * Allocates a new page in the file, building it in place in the given page.
+   *
+   * @param new_page_number   Set to the number of the new page.
+   * @param new_page          Set to the new page.
+   */
+  void allocatePageInto(PageId &new_page_number, Page& new_page);
+
+  /**
+   * Allocates a range of consecutive pages at the end of the file with a
+   * single header update.  The pages are not written; the caller must write
+   * every page of the range before reading it.
+   *
+   * @param count   Number of pages to allocate.
+   * @return  Number of the first page of the range.
+   */
+  PageId allocatePageRange(const PageId count);
+
   /**
    * Reads an existing page from the file.
    *
@@ -458,6 +757,16 @@ class BlobFile : public File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file straight into the given page.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page& page) const;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -473,6 +782,163 @@ class BlobFile : public File {
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number);
+
+  /**
+   * Returns true: a page of a BlobFile is written as it is.  PageFile keeps
+   * the next page numbers of its used and free lists from the disk instead.
+   */
+  bool rawPageWrites() const { return true; }
+};
+
+/**
+ * @brief A read-only view of an existing file, PageFile or BlobFile, which
+ * maps the file into memory instead of reading its pages with pread().
+ *
+ * The file is mapped with PROT_READ and MAP_SHARED once, when it is opened,
+ * up to its size at that time, so that the pages handed out by mappedPage()
+ * stay valid as long as the MmapFile object.  They are the pages of the page
+ * cache of the kernel: a read-mostly index is not copied into the BufMgr
+ * pool, and a page missing from the page cache is read by a page fault.
+ *
+ * Writes are rejected: writePage(), allocatePage() and deletePage() throw
+ * ReadOnlyFileException, and the mapping faults on any store into it.  Pages
+ * written to the file afterwards through another File object show through
+ * the mapping, but pages allocated afterwards are past its end and are
+ * invalid for this object.
+ */
+class MmapFile : public File {
+ public:
+
+  /**
+   * Opens an existing file read-only and maps it.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   */
+  static MmapFile open(const std::string& filename);
+
+  /**
+   * Constructs a read-only, mapped file object representing an existing file
+   * on the filesystem.
+   *
+   * @param name  Name of file.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist.
+   */
+  explicit MmapFile(const std::string& name);
+
+  /**
+   * Copy constructor.  The copy maps the file again, as it is now.
+   *
+   * @param other File object to copy.
+   */
+  MmapFile(const MmapFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  MmapFile& operator=(const MmapFile& rhs);
+
+  /**
+   * Destructor that unmaps the file, and closes the underlying file if no
+   * other File objects are using it.
+   */
+  ~MmapFile();
+
+  /**
+   * Not supported: the file is read-only.
+   *
+   * @throws  ReadOnlyFileException   Always.
+   */
+  Page allocatePage(PageId &new_page_number);
+
+  /**
+   * Not supported: the file is read-only.
+   *
+   * @throws  ReadOnlyFileException   Always.
+   */
+  void allocatePageInto(PageId &new_page_number, Page& new_page);
+
+  /**
+   * Reads an existing page from the file, by copying it out of the mapping.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the mapping.
+   */
+  Page readPage(const PageId page_number) const;
+
+  /**
+   * Reads an existing page from the file straight into the given page, by
+   * copying it out of the mapping.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the mapping.
+   */
+  void readPageInto(const PageId page_number, Page& page) const;
+
+  /**
+   * Not supported: the file is read-only.
+   *
+   * @throws  ReadOnlyFileException   Always.
+   */
+  void writePage(const PageId page_number, const Page& new_page);
+
+  /**
+   * Not supported: the file is read-only.
+   *
+   * @throws  ReadOnlyFileException   Always.
+   */
+  void deletePage(const PageId page_number);
+
+  /**
+   * Returns the page with the given number in the mapping.  It must not be
+   * written.
+   *
+   * @param page_number   Number of page.
+   * @return  The page in the mapping.
+   * @throws  InvalidPageException  If the page doesn't exist in the mapping.
+   */
+  Page* mappedPage(const PageId page_number) const;
+
+  /**
+   * Returns true.
+   */
+  bool mapped() const { return true; }
+
+  /**
+   * Returns the number of bytes of the file mapped.
+   */
+  std::size_t mappedBytes() const { return mapping_bytes_; }
+
+ private:
+  /**
+   * Maps the file as it is now.
+   */
+  void map();
+
+  /**
+   * Unmaps the file.
+   */
+  void unmap();
+
+  /**
+   * Start of the mapping, NULL if the file is empty.
+   */
+  char* mapping_;
+
+  /**
+   * Number of bytes mapped.
+   */
+  std::size_t mapping_bytes_;
+
+  /**
+   * Number of pages of the file, including the header, when it was mapped.
+   */
+  PageId num_pages_;
 };
 
 }
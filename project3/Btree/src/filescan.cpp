@@ -10,12 +10,13 @@
 
 namespace badgerdb { 
 
-FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
+FileScan::FileScan(const std::string &name, BufMgr *bufferMgr, const bool bulkRead)
 {
   file = new PageFile(name, false);	//dont create new file
 	bufMgr = bufferMgr;
 	curDirtyFlag = false;
   curPage = NULL;
+  strategy = bulkRead ? new BufferAccessStrategy() : NULL;
 	filePageIter = file->begin();
 }
 
@@ -31,6 +32,7 @@ FileScan::~FileScan()
   }
   bufMgr->flushFile(file);
   delete file;
+  delete strategy;
 }
 
 void FileScan::scanNext(RecordId& outRid)
@@ -53,7 +55,7 @@ void FileScan::scanNext(RecordId& outRid)
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    bufMgr->readPage(file, (*filePageIter).page_number(), curPage, strategy);
 		curDirtyFlag = false;
 
 		// get the first record off the page
@@ -88,7 +90,7 @@ void FileScan::scanNext(RecordId& outRid)
     }
 
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    bufMgr->readPage(file, (*filePageIter).page_number(), curPage, strategy);
 
     // get the first record off the page
     pageRecordIter = curPage->begin(); 
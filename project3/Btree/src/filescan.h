@@ -24,7 +24,15 @@ class FileScan
 {
  public:
 
-  FileScan(const std::string &name, BufMgr *bufMgr);
+  /**
+   * Constructor of FileScan class.
+   *
+   * @param name      Name of the relation to scan
+   * @param bufMgr    Buffer Manager instance to read the pages through
+   * @param bulkRead  Whether the pages are read through a ring of RINGFRAMES frames of a BufferAccessStrategy, so
+   *                  that a scan of a relation larger than the buffer pool does not evict the rest of it
+   */
+  FileScan(const std::string &name, BufMgr *bufMgr, const bool bulkRead = true);
 
   ~FileScan();
 
@@ -60,6 +68,11 @@ class FileScan
    * True if page has been updated
    */
   bool  	      curDirtyFlag;
+
+  /**
+   * Ring of frames the pages are read through, NULL to read them through the whole buffer pool.
+   */
+  BufferAccessStrategy *strategy;
 };
 
 }
@@ -0,0 +1,547 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "hashindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+// an entry of the relation, with its hash value, collected by bulkBuild
+struct HashBuildEntry{
+    std::uint32_t hash;
+    int key;
+    RecordId rid;
+};
+
+// -----------------------------------------------------------------------------
+// HashIndex::HashIndex -- Constructor
+// -----------------------------------------------------------------------------
+/**
+ * Constructor
+ *
+ * The index file name is constructed like the one of BTreeIndex, with
+ * ".hash" appended. If the index file exists, it is opened and the directory
+ * is read into memory. Else, a new index file is built from the relation.
+ *
+ * @param relationName The name of the relation on which to build the index.
+ * @param outIndexName The name of the index file
+ * @param bufMgrIn The instance of the global buffer manager.
+ * @param attrByteOffset The byte offset of the attribute in the tuple on which to build the index.
+ * @param attrType The data type of the attribute we are indexing.
+ */
+HashIndex::HashIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+    this -> bufMgr = bufMgrIn;
+    this -> attributeType = attrType;
+    this -> attrByteOffset = attrByteOffset;
+
+    std::ostringstream idxStr;
+    idxStr << relationName << '.' << attrByteOffset << ".hash";
+    std::string indexName = idxStr.str();
+    outIndexName = indexName;
+
+    if(File::exists(indexName)){
+        this -> file = (File *) new BlobFile(outIndexName, false);
+        PageId metaPageId = 1;
+        Page * metaPage;
+        this -> bufMgr -> readPage(this -> file, metaPageId, metaPage);
+        HashMetaInfo * metaInfo = (HashMetaInfo *) metaPage;
+        if(!(metaInfo -> relationName == relationName
+           && metaInfo -> attrByteOffset == attrByteOffset
+           && metaInfo -> attrType == attrType)){
+            this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+            throw BadIndexInfoException("Index file exists but values in metapage not match.");
+        }
+        this -> headerPageNum = metaPageId;
+        this -> globalDepth = metaInfo -> globalDepth;
+        int directoryPageCount = ((1 << this -> globalDepth) + HASHDIRPAGESIZE - 1) / HASHDIRPAGESIZE;
+        this -> directoryPages.assign(metaInfo -> directoryPageArray, metaInfo -> directoryPageArray + directoryPageCount);
+        this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+
+        // read the directory into memory
+        this -> directory.resize(1 << this -> globalDepth);
+        for(int p = 0; p < directoryPageCount; p++){
+            Page * directoryPage;
+            this -> bufMgr -> readPage(this -> file, this -> directoryPages[p], directoryPage);
+            std::size_t first = (std::size_t) p * HASHDIRPAGESIZE;
+            std::size_t last = std::min(first + HASHDIRPAGESIZE, this -> directory.size());
+            std::copy((PageId *) directoryPage, (PageId *) directoryPage + (last - first), this -> directory.begin() + first);
+            this -> bufMgr -> unPinPage(this -> file, this -> directoryPages[p], false);
+        }
+        return;
+    }
+
+    this -> file = (File *) new BlobFile(outIndexName, true);
+    PageId metaPageId;
+    Page * metaPage;
+    this -> bufMgr -> allocPage(this -> file, metaPageId, metaPage);
+    HashMetaInfo * metaInfo = (HashMetaInfo *) metaPage;
+    strcpy(metaInfo -> relationName, relationName.c_str());
+    metaInfo -> attrByteOffset = attrByteOffset;
+    metaInfo -> attrType = attrType;
+    metaInfo -> globalDepth = 0;
+    metaInfo -> freePageNo = Page::INVALID_NUMBER;
+    this -> headerPageNum = metaPageId;
+    this -> bufMgr -> unPinPage(this -> file, metaPageId, true);
+
+    this -> bulkBuild(relationName);
+}
+
+/**
+ * Build a new index from the tuples of the base relation. The global depth is
+ * chosen so that the buckets are filled to about three quarters on average,
+ * then the entries are grouped by bucket and every bucket page is written
+ * once, directly to the file. Entries which do not fit into their bucket are
+ * inserted one at a time at the end, splitting their bucket.
+ * @param relationName: the name of the base relation
+ */
+const void HashIndex::bulkBuild(const std::string & relationName)
+{
+    std::vector<HashBuildEntry> entries;
+    FileScan * fileScan = new FileScan(relationName, this -> bufMgr);
+    try
+    {
+        RecordId scanRid;
+        while(1)
+        {
+            fileScan -> scanNext(scanRid);
+            std::string recordStr = fileScan -> getRecord();
+            const char *record = recordStr.c_str();
+            HashBuildEntry entry;
+            entry.key = *((int *)(record + this -> attrByteOffset));
+            entry.hash = hashKey(entry.key);
+            entry.rid = scanRid;
+            entries.push_back(entry);
+        }
+    }
+    catch(EndOfFileException e)
+    {
+        // this case means reaching the end of the relation file.
+    }
+    delete fileScan;
+
+    this -> globalDepth = 0;
+    while(this -> globalDepth < HASHMAXDEPTH
+          && (std::size_t) (1 << this -> globalDepth) * (INTARRAYBUCKETSIZE * 3 / 4) < entries.size()){
+        this -> globalDepth++;
+    }
+    const std::uint32_t mask = (1u << this -> globalDepth) - 1;
+    std::sort(entries.begin(), entries.end(), [mask](const HashBuildEntry & e1, const HashBuildEntry & e2){
+        return (e1.hash & mask) < (e2.hash & mask);
+    });
+
+    const int bucketCount = 1 << this -> globalDepth;
+    PageId firstBucketPageNo = ((BlobFile *) this -> file) -> allocatePageRange(bucketCount);
+    this -> directory.resize(bucketCount);
+    std::vector<HashBuildEntry> overflow;
+    std::size_t next = 0;
+    for(int b = 0; b < bucketCount; b++){
+        Page page;
+        HashBucketInt * bucket = (HashBucketInt *) &page;
+        bucket -> localDepth = this -> globalDepth;
+        bucket -> slotTaken = 0;
+        bucket -> overflowPageNo = Page::INVALID_NUMBER;
+        for(; next < entries.size() && (entries[next].hash & mask) == (std::uint32_t) b; next++){
+            if(bucket -> slotTaken == INTARRAYBUCKETSIZE){
+                overflow.push_back(entries[next]);
+                continue;
+            }
+            bucket -> keyArray[bucket -> slotTaken] = entries[next].key;
+            bucket -> ridArray[bucket -> slotTaken] = entries[next].rid;
+            bucket -> slotTaken++;
+        }
+        this -> file -> writePage(firstBucketPageNo + b, page);
+        this -> directory[b] = firstBucketPageNo + b;
+    }
+    this -> writeDirectory(0, bucketCount);
+
+    for(std::size_t i = 0; i < overflow.size(); i++){
+        this -> insertEntry(&overflow[i].key, overflow[i].rid);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::~HashIndex -- destructor
+// -----------------------------------------------------------------------------
+/**
+ * Destructor
+ * Flush the index file and close it. The directory is written through on
+ * every change, so there is nothing else to save.
+ */
+HashIndex::~HashIndex()
+{
+    this -> bufMgr -> flushFile(this -> file);
+    delete this -> file;
+}
+
+/**
+ * Hash an integer key, mixing all its bits into the low ones.
+ * @param key: the key
+ * @return the hash value
+ */
+std::uint32_t HashIndex::hashKey(const int key)
+{
+    std::uint32_t h = (std::uint32_t) key;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * Write a range of the directory into its directory pages. At a small global
+ * depth the only directory page is partly used, and doubling the directory
+ * allocates the directory pages it grows into.
+ * @param first: the first directory entry changed
+ * @param last: one past the last directory entry changed
+ */
+const void HashIndex::writeDirectory(const std::size_t first, const std::size_t last)
+{
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    HashMetaInfo * metaInfo = (HashMetaInfo *) metaPage;
+    for(std::size_t p = first / HASHDIRPAGESIZE; p <= (last - 1) / HASHDIRPAGESIZE; p++){
+        PageId directoryPageId;
+        Page * directoryPage;
+        if(p < this -> directoryPages.size()){
+            directoryPageId = this -> directoryPages[p];
+            this -> bufMgr -> readPage(this -> file, directoryPageId, directoryPage);
+        }
+        else{
+            this -> bufMgr -> allocPage(this -> file, directoryPageId, directoryPage);
+            this -> directoryPages.push_back(directoryPageId);
+            metaInfo -> directoryPageArray[p] = directoryPageId;
+        }
+        std::size_t pageFirst = p * HASHDIRPAGESIZE;
+        std::size_t pageLast = std::min(pageFirst + HASHDIRPAGESIZE, this -> directory.size());
+        std::copy(this -> directory.begin() + pageFirst, this -> directory.begin() + pageLast, (PageId *) directoryPage);
+        this -> bufMgr -> unPinPage(this -> file, directoryPageId, true);
+    }
+    metaInfo -> globalDepth = this -> globalDepth;
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+}
+
+/**
+ * Take a page for a bucket or overflow page, from the free list kept in the
+ * meta page if possible. The caller initializes the page.
+ * @param pid: returns the page number
+ * @param page: returns the pinned page
+ */
+const void HashIndex::allocBucketPage(PageId & pid, Page *& page)
+{
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    HashMetaInfo * metaInfo = (HashMetaInfo *) metaPage;
+    if(metaInfo -> freePageNo == Page::INVALID_NUMBER){
+        this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, false);
+        this -> bufMgr -> allocPage(this -> file, pid, page);
+        return;
+    }
+    pid = metaInfo -> freePageNo;
+    this -> bufMgr -> readPage(this -> file, pid, page);
+    metaInfo -> freePageNo = ((HashBucketInt *) page) -> overflowPageNo;
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+}
+
+/**
+ * Split a full bucket into two buckets with one more bit of local depth. The
+ * new bucket takes the entries whose hash value has that bit set, and the
+ * directory entries pointing at the bucket with that bit set now point at the
+ * new bucket. If the local depth equals the global depth, the directory is
+ * doubled first.
+ * @param pid: the page number of the bucket
+ * @param hash: the hash value of a key of the bucket
+ */
+const void HashIndex::splitBucket(const PageId pid, const std::uint32_t hash)
+{
+    // collect the entries of the bucket and its overflow pages
+    std::vector<int> keys;
+    std::vector<RecordId> rids;
+    std::vector<PageId> spare;
+    int localDepth = 0;
+    PageId currPageId = pid;
+    while(currPageId != Page::INVALID_NUMBER){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, currPageId, page);
+        HashBucketInt * bucket = (HashBucketInt *) page;
+        if(currPageId == pid){
+            localDepth = bucket -> localDepth;
+        }
+        else{
+            spare.push_back(currPageId);
+        }
+        keys.insert(keys.end(), bucket -> keyArray, bucket -> keyArray + bucket -> slotTaken);
+        rids.insert(rids.end(), bucket -> ridArray, bucket -> ridArray + bucket -> slotTaken);
+        PageId nextPageId = bucket -> overflowPageNo;
+        this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+        currPageId = nextPageId;
+    }
+
+    if(localDepth == this -> globalDepth){
+        std::size_t size = this -> directory.size();
+        this -> directory.resize(2 * size);
+        std::copy(this -> directory.begin(), this -> directory.begin() + size, this -> directory.begin() + size);
+        this -> globalDepth++;
+        this -> writeDirectory(size, 2 * size);
+    }
+
+    const std::uint32_t bit = 1u << localDepth;
+    std::vector<int> lowKeys, highKeys;
+    std::vector<RecordId> lowRids, highRids;
+    for(std::size_t i = 0; i < keys.size(); i++){
+        if(hashKey(keys[i]) & bit){
+            highKeys.push_back(keys[i]);
+            highRids.push_back(rids[i]);
+        }
+        else{
+            lowKeys.push_back(keys[i]);
+            lowRids.push_back(rids[i]);
+        }
+    }
+    PageId newPageId;
+    Page * newPage;
+    this -> allocBucketPage(newPageId, newPage);
+    this -> bufMgr -> unPinPage(this -> file, newPageId, true);
+    this -> writeBucketChain(pid, localDepth + 1, lowKeys, lowRids, spare);
+    this -> writeBucketChain(newPageId, localDepth + 1, highKeys, highRids, spare);
+
+    // put the overflow pages not needed any more on the free list
+    if(!spare.empty()){
+        Page * metaPage;
+        this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+        HashMetaInfo * metaInfo = (HashMetaInfo *) metaPage;
+        for(std::size_t i = 0; i < spare.size(); i++){
+            Page * page;
+            this -> bufMgr -> readPage(this -> file, spare[i], page);
+            ((HashBucketInt *) page) -> slotTaken = 0;
+            ((HashBucketInt *) page) -> overflowPageNo = metaInfo -> freePageNo;
+            metaInfo -> freePageNo = spare[i];
+            this -> bufMgr -> unPinPage(this -> file, spare[i], true);
+        }
+        this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+    }
+
+    // every directory entry ending in the low bits of the bucket, followed by the new bit
+    std::size_t first = (hash & (bit - 1)) | bit;
+    std::size_t last = first;
+    for(std::size_t i = first; i < this -> directory.size(); i += 2 * bit){
+        this -> directory[i] = newPageId;
+        last = i;
+    }
+    this -> writeDirectory(first, last + 1);
+}
+
+/**
+ * Write entries into a bucket and as many overflow pages as needed.
+ * @param pid: the page number of the bucket
+ * @param localDepth: the local depth of the bucket
+ * @param keys: the keys
+ * @param rids: the record ids
+ * @param spare: pages to use as overflow pages first
+ */
+const void HashIndex::writeBucketChain(const PageId pid, const int localDepth, const std::vector<int> & keys,
+                                       const std::vector<RecordId> & rids, std::vector<PageId> & spare)
+{
+    std::size_t done = 0;
+    PageId currPageId = pid;
+    while(1){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, currPageId, page);
+        HashBucketInt * bucket = (HashBucketInt *) page;
+        std::size_t count = std::min((std::size_t) INTARRAYBUCKETSIZE, keys.size() - done);
+        bucket -> localDepth = localDepth;
+        bucket -> slotTaken = count;
+        std::copy(keys.begin() + done, keys.begin() + done + count, bucket -> keyArray);
+        std::copy(rids.begin() + done, rids.begin() + done + count, bucket -> ridArray);
+        done += count;
+
+        PageId nextPageId = Page::INVALID_NUMBER;
+        if(done < keys.size()){
+            if(!spare.empty()){
+                nextPageId = spare.back();
+                spare.pop_back();
+            }
+            else{
+                Page * nextPage;
+                this -> allocBucketPage(nextPageId, nextPage);
+                this -> bufMgr -> unPinPage(this -> file, nextPageId, true);
+            }
+        }
+        bucket -> overflowPageNo = nextPageId;
+        this -> bufMgr -> unPinPage(this -> file, currPageId, true);
+        if(nextPageId == Page::INVALID_NUMBER){
+            break;
+        }
+        currPageId = nextPageId;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::insertEntry
+// -----------------------------------------------------------------------------
+/**
+ * Insert a new entry using the pair <value,rid>.
+ *
+ * If the bucket of the key has room, the entry is appended to it. Else the
+ * bucket is split, and the insert tried again. Splitting does not help if
+ * every key of the bucket has the same hash value as the new key, e.g. for a
+ * key occurring many times, or if the maximum depth is reached. Then the
+ * entry goes into the first overflow page with room, or a new one.
+ * @param key			A pointer to the value(integer we want to insert)
+ * @param rid			The corresponding record id of the tuple in the base relation
+ **/
+const void HashIndex::insertEntry(const void *key, const RecordId rid)
+{
+    const int intKey = *((int *) key);
+    const std::uint32_t hash = hashKey(intKey);
+    const std::uint32_t maxMask = (1u << HASHMAXDEPTH) - 1;
+    while(1){
+        PageId pid = this -> directory[hash & ((1u << this -> globalDepth) - 1)];
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, pid, page);
+        HashBucketInt * bucket = (HashBucketInt *) page;
+        if(bucket -> slotTaken < INTARRAYBUCKETSIZE){
+            bucket -> keyArray[bucket -> slotTaken] = intKey;
+            bucket -> ridArray[bucket -> slotTaken] = rid;
+            bucket -> slotTaken++;
+            this -> bufMgr -> unPinPage(this -> file, pid, true);
+            return;
+        }
+        int localDepth = bucket -> localDepth;
+        this -> bufMgr -> unPinPage(this -> file, pid, false);
+
+        // look for a key a split could tell apart from the new one, and for
+        // the first overflow page with room on the way
+        bool sameHash = true;
+        PageId roomPageId = Page::INVALID_NUMBER;
+        PageId lastPageId = pid;
+        PageId currPageId = pid;
+        while(currPageId != Page::INVALID_NUMBER){
+            this -> bufMgr -> readPage(this -> file, currPageId, page);
+            bucket = (HashBucketInt *) page;
+            for(int i = 0; i < bucket -> slotTaken && sameHash; i++){
+                sameHash = ((hashKey(bucket -> keyArray[i]) ^ hash) & maxMask) == 0;
+            }
+            if(roomPageId == Page::INVALID_NUMBER && bucket -> slotTaken < INTARRAYBUCKETSIZE){
+                roomPageId = currPageId;
+            }
+            lastPageId = currPageId;
+            PageId nextPageId = bucket -> overflowPageNo;
+            this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+            currPageId = nextPageId;
+        }
+        if(!sameHash && localDepth < HASHMAXDEPTH){
+            this -> splitBucket(pid, hash);
+            continue;
+        }
+
+        if(roomPageId == Page::INVALID_NUMBER){
+            // link a new overflow page at the end of the chain
+            Page * lastPage;
+            this -> allocBucketPage(roomPageId, page);
+            bucket = (HashBucketInt *) page;
+            bucket -> localDepth = localDepth;
+            bucket -> slotTaken = 0;
+            bucket -> overflowPageNo = Page::INVALID_NUMBER;
+            this -> bufMgr -> unPinPage(this -> file, roomPageId, true);
+            this -> bufMgr -> readPage(this -> file, lastPageId, lastPage);
+            ((HashBucketInt *) lastPage) -> overflowPageNo = roomPageId;
+            this -> bufMgr -> unPinPage(this -> file, lastPageId, true);
+        }
+        this -> bufMgr -> readPage(this -> file, roomPageId, page);
+        bucket = (HashBucketInt *) page;
+        bucket -> keyArray[bucket -> slotTaken] = intKey;
+        bucket -> ridArray[bucket -> slotTaken] = rid;
+        bucket -> slotTaken++;
+        this -> bufMgr -> unPinPage(this -> file, roomPageId, true);
+        return;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::lookup
+// -----------------------------------------------------------------------------
+/**
+ * Find the record ids of all the entries with a key. The directory is in
+ * memory, so this reads the bucket page of the key and its overflow pages,
+ * if any.
+ * @param key			A pointer to the value(integer we want to look up)
+ * @param outRids	Record ids of the entries found are appended here
+ * @throws  NoSuchKeyFoundException If there is no entry with the key.
+ **/
+const void HashIndex::lookup(const void *key, std::vector<RecordId> & outRids)
+{
+    const int intKey = *((int *) key);
+    std::size_t found = outRids.size();
+    PageId currPageId = this -> directory[hashKey(intKey) & ((1u << this -> globalDepth) - 1)];
+    while(currPageId != Page::INVALID_NUMBER){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, currPageId, page);
+        HashBucketInt * bucket = (HashBucketInt *) page;
+        for(int i = 0; i < bucket -> slotTaken; i++){
+            if(bucket -> keyArray[i] == intKey){
+                outRids.push_back(bucket -> ridArray[i]);
+            }
+        }
+        PageId nextPageId = bucket -> overflowPageNo;
+        this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+        currPageId = nextPageId;
+    }
+    if(outRids.size() == found){
+        throw NoSuchKeyFoundException();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::deleteEntry
+// -----------------------------------------------------------------------------
+/**
+ * Delete the entry with the pair <value,rid>. The last entry of its page
+ * takes its slot. Buckets are never merged, and empty overflow pages stay
+ * in the chain to take later inserts.
+ * @param key			A pointer to the value(integer we want to delete)
+ * @param rid			The record id of the entry
+ * @throws  NoSuchKeyFoundException If there is no such entry.
+ **/
+const void HashIndex::deleteEntry(const void *key, const RecordId rid)
+{
+    const int intKey = *((int *) key);
+    PageId currPageId = this -> directory[hashKey(intKey) & ((1u << this -> globalDepth) - 1)];
+    while(currPageId != Page::INVALID_NUMBER){
+        Page * page;
+        this -> bufMgr -> readPage(this -> file, currPageId, page);
+        HashBucketInt * bucket = (HashBucketInt *) page;
+        for(int i = 0; i < bucket -> slotTaken; i++){
+            if(bucket -> keyArray[i] == intKey
+               && bucket -> ridArray[i].page_number == rid.page_number
+               && bucket -> ridArray[i].slot_number == rid.slot_number){
+                bucket -> slotTaken--;
+                bucket -> keyArray[i] = bucket -> keyArray[bucket -> slotTaken];
+                bucket -> ridArray[i] = bucket -> ridArray[bucket -> slotTaken];
+                this -> bufMgr -> unPinPage(this -> file, currPageId, true);
+                return;
+            }
+        }
+        PageId nextPageId = bucket -> overflowPageNo;
+        this -> bufMgr -> unPinPage(this -> file, currPageId, false);
+        currPageId = nextPageId;
+    }
+    throw NoSuchKeyFoundException();
+}
+
+}
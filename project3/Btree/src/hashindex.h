@@ -0,0 +1,257 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of entries in a bucket page of the hash index for INTEGER key.
+ */
+//                                                  localDepth, slotTaken, overflow            key               rid
+const int INTARRAYBUCKETSIZE = ( Page::SIZE - 2 * sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of directory entries in a directory page of the hash index.
+ */
+const int HASHDIRPAGESIZE = Page::SIZE / sizeof( PageId );
+
+/**
+ * @brief Maximum global depth of the hash index. A bucket which can not be split any more gets overflow pages instead.
+ */
+const int HASHMAXDEPTH = 20;
+
+/**
+ * @brief Number of directory pages needed at the maximum global depth.
+ */
+const int HASHMAXDIRPAGES = ( 1 << HASHMAXDEPTH ) / HASHDIRPAGESIZE;
+
+/**
+ * @brief The meta page of the hash index, which is the first page of the index file.
+*/
+struct HashMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of hash bits used to index the directory. The directory has 2^globalDepth entries.
+   */
+	int globalDepth;
+
+  /**
+   * First page of the list of unused bucket pages, linked through overflowPageNo.
+   */
+	PageId freePageNo;
+
+  /**
+   * Page numbers of the directory pages, in order.
+   */
+	PageId directoryPageArray[ HASHMAXDIRPAGES ];
+};
+
+/**
+ * @brief Structure for the bucket pages of the hash index when the key is of INTEGER type.
+ * The overflow pages of a bucket use the same structure.
+*/
+struct HashBucketInt{
+  /**
+   * Number of hash bits all the keys of the bucket have in common. 2^(globalDepth - localDepth) directory entries point at the bucket.
+   */
+	int localDepth;
+
+  /**
+   * Number of entries in the page.
+   */
+	int slotTaken;
+
+  /**
+   * Page number of the next overflow page of the bucket, INVALID_NUMBER if there is none.
+   */
+	PageId overflowPageNo;
+
+  /**
+   * Stores keys.
+   */
+	int keyArray[ INTARRAYBUCKETSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ INTARRAYBUCKETSIZE ];
+};
+
+
+/**
+ * @brief HashIndex class. It implements a disk based extendible hash index on a single attribute of a relation,
+ * for equality lookups. The directory is stored in directory pages and also kept in memory, so that a lookup
+ * reads a single bucket page, unless the bucket has overflow pages. A full bucket is split, doubling the directory
+ * if needed. Only buckets whose entries all share the same hash value, which splits can not tell apart, get
+ * overflow pages. Unlike BTreeIndex, the key may occur many times. Deleting entries never merges buckets.
+*/
+class HashIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records.
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Number of hash bits used to index the directory.
+   */
+	int			globalDepth;
+
+  /**
+   * In memory copy of the directory, mapping the low globalDepth bits of the hash value to a bucket page.
+   */
+	std::vector<PageId> directory;
+
+  /**
+   * Page numbers of the directory pages.
+   */
+	std::vector<PageId> directoryPages;
+
+    /**
+     * Hash an integer key.
+     * @param key: the key
+     * @return the hash value, whose low bits index the directory
+     */
+    static std::uint32_t hashKey(const int key);
+
+    /**
+     * Write a range of the directory into its directory pages, allocating the missing directory pages.
+     * The meta page is updated too.
+     * @param first: the first directory entry changed
+     * @param last: one past the last directory entry changed
+     */
+    const void writeDirectory(const std::size_t first, const std::size_t last);
+
+    /**
+     * Take a page for a bucket or overflow page, from the free list if possible.
+     * @param pid: returns the page number
+     * @param page: returns the pinned page
+     */
+    const void allocBucketPage(PageId & pid, Page *& page);
+
+    /**
+     * Split a full bucket into two buckets with one more bit of local depth, doubling the directory first if needed.
+     * The entries of the overflow pages are redistributed too, and the overflow pages not needed any more are freed.
+     * @param pid: the page number of the bucket
+     * @param hash: the hash value of a key of the bucket
+     */
+    const void splitBucket(const PageId pid, const std::uint32_t hash);
+
+    /**
+     * Write entries into a bucket and as many overflow pages as needed.
+     * @param pid: the page number of the bucket
+     * @param localDepth: the local depth of the bucket
+     * @param keys: the keys
+     * @param rids: the record ids
+     * @param spare: pages to use as overflow pages first. The ones left over are freed.
+     */
+    const void writeBucketChain(const PageId pid, const int localDepth, const std::vector<int> & keys,
+                                const std::vector<RecordId> & rids, std::vector<PageId> & spare);
+
+    /**
+     * Build a new index from the tuples of the base relation. The directory is sized for the number of tuples up front,
+     * and the buckets are written in one pass. Entries of buckets that overflow are inserted one at a time afterwards.
+     * @param relationName: the name of the base relation
+     */
+    const void bulkBuild(const std::string & relationName);
+
+ public:
+
+  /**
+   * HashIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * If not, create it and build it from every tuple in the base relation, read through FileScan.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   */
+	HashIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+
+  /**
+   * HashIndex Destructor.
+	 * Flush index file and delete file instance thereby closing the index file.
+	 * */
+	~HashIndex();
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Find the record ids of all the entries with a key.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRids	Record ids of the entries found, appended in no particular order
+   * @throws  NoSuchKeyFoundException If there is no entry with the key.
+	**/
+	const void lookup(const void* key, std::vector<RecordId> & outRids);
+
+  /**
+	 * Delete the entry with the pair <value,rid>.
+   * @param key			Key of the entry, pointer to integer/double/char string
+   * @param rid			Record ID of the entry.
+   * @throws  NoSuchKeyFoundException If there is no such entry.
+	**/
+	const void deleteEntry(const void* key, const RecordId rid);
+};
+
+}
@@ -0,0 +1,513 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// io_uring is used through its system calls, so that nothing but the kernel
+// headers is needed for it
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define BADGERDB_IO_URING 1
+#endif
+#endif
+
+namespace badgerdb {
+
+void IOStats::clear()
+{
+  reads = writes = submits = 0;
+  memset(readLatency, 0, sizeof(readLatency));
+  memset(writeLatency, 0, sizeof(writeLatency));
+}
+
+std::uint64_t IOStats::percentile(const std::uint64_t * histogram, const double fraction)
+{
+  std::uint64_t total = 0;
+  for (int b = 0; b < IOLATENCYBUCKETS; b++)
+  {
+    total += histogram[b];
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+  const std::uint64_t rank = std::max((std::uint64_t) 1, (std::uint64_t) std::ceil(fraction * total));
+  std::uint64_t seen = 0;
+  for (int b = 0; b < IOLATENCYBUCKETS; b++)
+  {
+    seen += histogram[b];
+    if (seen >= rank)
+    {
+      return (std::uint64_t) 2 << b;
+    }
+  }
+  return (std::uint64_t) 2 << (IOLATENCYBUCKETS - 1);
+}
+
+IOEngine::IOEngine(const IOOptions & options)
+  : options_(options), backend_(options.backend), inFlight_(0), ringFd_(-1), sqRing_(NULL), cqRing_(NULL),
+    sqes_(NULL), sqRingSize_(0), cqRingSize_(0), sqesSize_(0), stopping_(false)
+{
+  options_.queueDepth = std::max(options_.queueDepth, (std::uint32_t) 1);
+  options_.submitBatch = std::max(std::min(options_.submitBatch, options_.queueDepth), (std::uint32_t) 1);
+  options_.threads = std::max(options_.threads, (std::uint32_t) 1);
+  if (backend_ == IO_URING && !setupRing())
+  {
+    backend_ = IO_THREADS;
+  }
+  if (backend_ == IO_THREADS)
+  {
+    for (std::uint32_t i = 0; i < options_.threads; i++)
+    {
+      threads_.push_back(std::thread(&IOEngine::work, this));
+    }
+  }
+}
+
+IOEngine::~IOEngine()
+{
+  // the requests not submitted yet are dropped, but the ones in flight
+  // still use their buffers, which may be freed as soon as this returns
+  queued_.clear();
+  collect(inFlight_);
+  if (backend_ == IO_THREADS)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    workReady_.notify_all();
+    for (std::size_t i = 0; i < threads_.size(); i++)
+    {
+      threads_[i].join();
+    }
+  }
+  if (sqes_ != NULL)
+  {
+    munmap(sqes_, sqesSize_);
+  }
+  if (cqRing_ != NULL && cqRing_ != sqRing_)
+  {
+    munmap(cqRing_, cqRingSize_);
+  }
+  if (sqRing_ != NULL)
+  {
+    munmap(sqRing_, sqRingSize_);
+  }
+  if (ringFd_ >= 0)
+  {
+    ::close(ringFd_);
+  }
+}
+
+void IOEngine::read(const int fd, const std::uint64_t offset, void * buffer, const std::size_t length, const std::uint64_t tag)
+{
+  Request request;
+  request.fd = fd;
+  request.write = false;
+  request.offset = offset;
+  request.buffer = static_cast<char *>(buffer);
+  request.length = length;
+  request.iov = NULL;
+  request.iovcnt = 0;
+  request.tag = tag;
+  enqueue(request);
+}
+
+void IOEngine::write(const int fd, const std::uint64_t offset, const void * buffer, const std::size_t length, const std::uint64_t tag)
+{
+  Request request;
+  request.fd = fd;
+  request.write = true;
+  request.offset = offset;
+  request.buffer = const_cast<char *>(static_cast<const char *>(buffer));
+  request.length = length;
+  request.iov = NULL;
+  request.iovcnt = 0;
+  request.tag = tag;
+  enqueue(request);
+}
+
+void IOEngine::write(const int fd, const std::uint64_t offset, const struct iovec * iov, const int iovcnt, const std::uint64_t tag)
+{
+  Request request;
+  request.fd = fd;
+  request.write = true;
+  request.offset = offset;
+  request.buffer = NULL;
+  request.length = 0;
+  for (int i = 0; i < iovcnt; i++)
+  {
+    request.length += iov[i].iov_len;
+  }
+  request.iov = iov;
+  request.iovcnt = iovcnt;
+  request.tag = tag;
+  enqueue(request);
+}
+
+void IOEngine::enqueue(const Request & request)
+{
+  if (queued_.size() + inFlight_ >= options_.queueDepth)
+  {
+    // fewer than submitBatch requests are queued, or they would have been
+    // submitted. Rather than submit a part of a batch, wait until a whole
+    // batch fits beside the requests in flight. The completions are kept in
+    // completed_ until they are reaped.
+    collect(inFlight_ - (options_.queueDepth - options_.submitBatch));
+  }
+  queued_.push_back(request);
+  if (queued_.size() >= options_.submitBatch)
+  {
+    submit();
+  }
+}
+
+void IOEngine::submit()
+{
+  if (queued_.empty())
+  {
+    return;
+  }
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < queued_.size(); i++)
+  {
+    queued_[i].start = now;
+  }
+  stats_.submits++;
+  if (backend_ == IO_SYNC)
+  {
+    for (std::size_t i = 0; i < queued_.size(); i++)
+    {
+      const std::int64_t result = perform(queued_[i]);
+      queued_[i].end = std::chrono::steady_clock::now();
+      complete(queued_[i], result);
+    }
+  }
+  else if (backend_ == IO_THREADS)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      work_.insert(work_.end(), queued_.begin(), queued_.end());
+    }
+    inFlight_ += queued_.size();
+    workReady_.notify_all();
+  }
+  else
+  {
+    submitRing();
+  }
+  queued_.clear();
+}
+
+std::size_t IOEngine::reap(std::vector<IOCompletion> & out, const std::size_t minimum)
+{
+  submit();
+  std::size_t missing = 0;
+  if (minimum > completed_.size())
+  {
+    missing = std::min(minimum - completed_.size(), inFlight_);
+  }
+  collect(missing);
+  const std::size_t count = completed_.size();
+  out.insert(out.end(), completed_.begin(), completed_.end());
+  completed_.clear();
+  return count;
+}
+
+std::int64_t IOEngine::perform(const Request & request)
+{
+  if (request.iov != NULL)
+  {
+    ssize_t result;
+    do
+    {
+      result = ::pwritev(request.fd, request.iov, request.iovcnt, request.offset);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0)
+    {
+      return -errno;
+    }
+    // a short transfer is finished buffer by buffer
+    std::size_t done = result;
+    std::size_t start = 0;
+    for (int i = 0; i < request.iovcnt && done < request.length; i++)
+    {
+      const std::size_t end = start + request.iov[i].iov_len;
+      if (done < end)
+      {
+        Request part = request;
+        part.iov = NULL;
+        part.buffer = static_cast<char *>(request.iov[i].iov_base) + (done - start);
+        part.length = end - done;
+        part.offset = request.offset + done;
+        const std::int64_t written = perform(part);
+        if (written < 0)
+        {
+          return written;
+        }
+        done += written;
+        if ((std::size_t) written < part.length)
+        {
+          break;
+        }
+      }
+      start = end;
+    }
+    return done;
+  }
+
+  std::size_t done = 0;
+  while (done < request.length)
+  {
+    ssize_t result;
+    if (request.write)
+    {
+      result = ::pwrite(request.fd, request.buffer + done, request.length - done, request.offset + done);
+    }
+    else
+    {
+      result = ::pread(request.fd, request.buffer + done, request.length - done, request.offset + done);
+    }
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return -errno;
+    }
+    if (result == 0)
+    {
+      // the end of the file
+      break;
+    }
+    done += result;
+  }
+  return done;
+}
+
+void IOEngine::complete(const Request & request, const std::int64_t result)
+{
+  const std::int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(request.end - request.start).count();
+  int bucket = 0;
+  while (bucket < IOLATENCYBUCKETS - 1 && ((std::int64_t) 2 << bucket) <= micros)
+  {
+    bucket++;
+  }
+  if (request.write)
+  {
+    stats_.writes++;
+    stats_.writeLatency[bucket]++;
+  }
+  else
+  {
+    stats_.reads++;
+    stats_.readLatency[bucket]++;
+  }
+  IOCompletion completion;
+  completion.tag = request.tag;
+  completion.result = result;
+  completed_.push_back(completion);
+}
+
+void IOEngine::work()
+{
+  while (1)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    workReady_.wait(lock, [this] { return stopping_ || !work_.empty(); });
+    if (work_.empty())
+    {
+      return;
+    }
+    Request request = work_.front();
+    work_.pop_front();
+    lock.unlock();
+
+    const std::int64_t result = perform(request);
+    request.end = std::chrono::steady_clock::now();
+    lock.lock();
+    done_.push_back(std::make_pair(request, result));
+    lock.unlock();
+    doneReady_.notify_one();
+  }
+}
+
+void IOEngine::collect(const std::size_t minimum)
+{
+  if (backend_ == IO_THREADS)
+  {
+    std::deque<std::pair<Request, std::int64_t> > done;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      doneReady_.wait(lock, [this, minimum] { return done_.size() >= minimum; });
+      done.swap(done_);
+    }
+    for (std::size_t i = 0; i < done.size(); i++)
+    {
+      inFlight_--;
+      complete(done[i].first, done[i].second);
+    }
+    return;
+  }
+#ifdef BADGERDB_IO_URING
+  if (backend_ == IO_URING)
+  {
+    std::size_t collected = 0;
+    while (1)
+    {
+      // only this thread consumes completions, so the head is not raced on
+      std::uint32_t head = *cqHead_;
+      const std::uint32_t tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+      const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      for (; head != tail; head++)
+      {
+        const struct io_uring_cqe * cqe = static_cast<const struct io_uring_cqe *>(cqes_) + (head & *cqMask_);
+        const std::uint32_t slot = cqe->user_data;
+        Request & request = slots_[slot];
+        request.end = now;
+        inFlight_--;
+        complete(request, cqe->res);
+        freeSlots_.push_back(slot);
+        collected++;
+      }
+      __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+      if (collected >= minimum)
+      {
+        return;
+      }
+      const int result = syscall(__NR_io_uring_enter, ringFd_, 0, minimum - collected, IORING_ENTER_GETEVENTS, NULL, 0);
+      if (result < 0 && errno != EINTR)
+      {
+        throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+      }
+    }
+  }
+#endif
+}
+
+void IOEngine::submitRing()
+{
+#ifdef BADGERDB_IO_URING
+  // queueDepth bounds the requests queued and in flight, and the rings have
+  // at least as many entries, so there is room for every queued request
+  std::uint32_t tail = *sqTail_;
+  for (std::size_t i = 0; i < queued_.size(); i++)
+  {
+    const std::uint32_t slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    slots_[slot] = queued_[i];
+    const std::uint32_t index = tail & *sqMask_;
+    struct io_uring_sqe * sqe = static_cast<struct io_uring_sqe *>(sqes_) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = queued_[i].write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = queued_[i].fd;
+    sqe->off = queued_[i].offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(queued_[i].buffer);
+    sqe->len = queued_[i].length;
+    if (queued_[i].iov != NULL)
+    {
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->addr = reinterpret_cast<std::uint64_t>(queued_[i].iov);
+      sqe->len = queued_[i].iovcnt;
+    }
+    sqe->user_data = slot;
+    sqArray_[index] = index;
+    tail++;
+  }
+  __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+  inFlight_ += queued_.size();
+  std::size_t left = queued_.size();
+  while (left > 0)
+  {
+    const int result = syscall(__NR_io_uring_enter, ringFd_, left, 0, 0, NULL, 0);
+    if (result >= 0)
+    {
+      left -= result;
+    }
+    else if (errno == EAGAIN || errno == EBUSY)
+    {
+      // the kernel is short of resources until some requests complete
+      syscall(__NR_io_uring_enter, ringFd_, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+    else if (errno != EINTR)
+    {
+      throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+    }
+  }
+#endif
+}
+
+bool IOEngine::setupRing()
+{
+#ifdef BADGERDB_IO_URING
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int fd = syscall(__NR_io_uring_setup, options_.queueDepth, &params);
+  if (fd < 0)
+  {
+    return false;
+  }
+  // IORING_OP_READ and IORING_OP_WRITE came with the same kernel as this feature
+  if (!(params.features & IORING_FEAT_RW_CUR_POS))
+  {
+    ::close(fd);
+    return false;
+  }
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMap)
+  {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+  sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void * sqRing = mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  void * cqRing = singleMap ? sqRing : mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  void * sqes = mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  sqRing_ = (sqRing == MAP_FAILED) ? NULL : sqRing;
+  cqRing_ = (cqRing == MAP_FAILED) ? NULL : cqRing;
+  sqes_ = (sqes == MAP_FAILED) ? NULL : sqes;
+  ringFd_ = fd;
+  if (sqRing_ == NULL || cqRing_ == NULL || sqes_ == NULL)
+  {
+    // the destructor unmaps whatever has been mapped
+    return false;
+  }
+  char * sq = static_cast<char *>(sqRing_);
+  char * cq = static_cast<char *>(cqRing_);
+  sqHead_ = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.head);
+  sqTail_ = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.tail);
+  sqMask_ = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.array);
+  cqHead_ = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.head);
+  cqTail_ = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.tail);
+  cqMask_ = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  slots_.resize(params.sq_entries);
+  for (std::uint32_t i = params.sq_entries; i > 0; i--)
+  {
+    freeSlots_.push_back(i - 1);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+}
@@ -0,0 +1,369 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+
+namespace badgerdb {
+
+/**
+ * @brief The way an IOEngine carries out its requests.
+ */
+enum IOBackend
+{
+	IO_SYNC,	/* Every request is carried out by pread()/pwrite() when it is submitted */
+	IO_THREADS,	/* A pool of threads carries out the requests by pread()/pwrite() */
+	IO_URING	/* The requests are submitted to the kernel through an io_uring submission queue */
+};
+
+/**
+ * @brief Options of an IOEngine. Passed to the BufMgr constructor.
+ */
+struct IOOptions
+{
+  /**
+   * Largest number of requests queued or in flight at a time. It is the number of entries of the io_uring.
+   */
+  std::uint32_t queueDepth;
+
+  /**
+   * Number of requests queued before they are submitted together, with a single system call for io_uring.
+   * Requests are also submitted whenever completions are waited for.
+   */
+  std::uint32_t submitBatch;
+
+  /**
+   * Number of threads of the IO_THREADS backend.
+   */
+  std::uint32_t threads;
+
+  /**
+   * The backend to use. IO_URING falls back to IO_THREADS when the kernel does not support io_uring, or does
+   * not support the read and write operations of io_uring (before Linux 5.6).
+   */
+  IOBackend backend;
+
+  IOOptions() : queueDepth(64), submitBatch(16), threads(4), backend(IO_URING) {}
+};
+
+/**
+ * @brief Number of buckets of the latency histograms of IOStats.
+ */
+const int IOLATENCYBUCKETS = 24;
+
+/**
+ * @brief Statistics of the requests of an IOEngine.
+ */
+struct IOStats
+{
+  /**
+   * Number of read requests completed.
+   */
+  std::uint64_t reads;
+
+  /**
+   * Number of write requests completed.
+   */
+  std::uint64_t writes;
+
+  /**
+   * Number of times queued requests have been submitted, i.e. the number of io_uring_enter() system calls which
+   * submitted requests for io_uring.
+   */
+  std::uint64_t submits;
+
+  /**
+   * Latencies of the read requests, from submission to completion. Bucket 0 counts the requests which took less than
+   * 2 microseconds, bucket b > 0 the ones which took from 2^b up to 2^(b+1) microseconds, and the last bucket the
+   * slower ones too.
+   */
+  std::uint64_t readLatency[IOLATENCYBUCKETS];
+
+  /**
+   * Latencies of the write requests, bucketed like readLatency.
+   */
+  std::uint64_t writeLatency[IOLATENCYBUCKETS];
+
+  /**
+   * Clear all values
+   */
+  void clear();
+
+  /**
+   * Estimate a percentile of the latencies of a histogram, as the upper end of the bucket which holds it.
+   *
+   * @param histogram   readLatency or writeLatency
+   * @param fraction    The percentile, from 0 to 1
+   * @return  The latency in microseconds, 0 if the histogram is empty
+   */
+  static std::uint64_t percentile(const std::uint64_t * histogram, const double fraction);
+
+  IOStats()
+  {
+    clear();
+  }
+};
+
+/**
+ * @brief A request completed by an IOEngine.
+ */
+struct IOCompletion
+{
+  /**
+   * Tag the request has been queued with.
+   */
+  std::uint64_t tag;
+
+  /**
+   * Number of bytes read or written, or a negative errno.
+   */
+  std::int64_t result;
+};
+
+/**
+ * @brief Carries out page reads and writes asynchronously. Requests are queued with read() and write(), submitted in
+ * batches, and their completions reaped with reap(), in any order. The buffers of a request have to stay valid until
+ * it is reaped.
+ *
+ * @warning Only one thread may use an IOEngine at a time.
+ */
+class IOEngine
+{
+ public:
+  /**
+   * Constructor of IOEngine class. Sets up the io_uring or starts the threads.
+   *
+   * @param options   Options of the engine
+   */
+  IOEngine(const IOOptions & options);
+
+  /**
+   * Destructor of IOEngine class. Waits for the requests in flight, whose completions are dropped.
+   */
+  ~IOEngine();
+
+  /**
+   * Returns the backend in use, which may be the fallback of the one asked for.
+   */
+  IOBackend backend() const
+  {
+    return backend_;
+  }
+
+  /**
+   * Queue a read request. Requests are submitted once submitBatch of them are queued.
+   *
+   * @param fd        File descriptor to read from
+   * @param offset    Offset in the file
+   * @param buffer    Buffer to read into
+   * @param length    Number of bytes to read
+   * @param tag       Tag of the completion
+   */
+  void read(const int fd, const std::uint64_t offset, void * buffer, const std::size_t length, const std::uint64_t tag);
+
+  /**
+   * Queue a write request. Requests are submitted once submitBatch of them are queued.
+   *
+   * @param fd        File descriptor to write to
+   * @param offset    Offset in the file
+   * @param buffer    Buffer to write from
+   * @param length    Number of bytes to write
+   * @param tag       Tag of the completion
+   */
+  void write(const int fd, const std::uint64_t offset, const void * buffer, const std::size_t length, const std::uint64_t tag);
+
+  /**
+   * Queue a vectored write request, which writes the buffers one after the other from the offset with a single
+   * pwritev(), or a single IORING_OP_WRITEV for io_uring. The iovec array has to stay valid until the request is
+   * reaped, like the buffers.
+   *
+   * @param fd        File descriptor to write to
+   * @param offset    Offset in the file
+   * @param iov       Buffers to write from
+   * @param iovcnt    Number of buffers, at most IOV_MAX
+   * @param tag       Tag of the completion
+   */
+  void write(const int fd, const std::uint64_t offset, const struct iovec * iov, const int iovcnt, const std::uint64_t tag);
+
+  /**
+   * Submit the queued requests.
+   */
+  void submit();
+
+  /**
+   * Submit the queued requests, and reap completions, waiting until there are at least a given number of them.
+   *
+   * @param out       The completions are appended to it
+   * @param minimum   Number of completions to wait for, at most the number of requests not reaped yet
+   * @return  Number of completions appended
+   */
+  std::size_t reap(std::vector<IOCompletion> & out, const std::size_t minimum);
+
+  /**
+   * Returns the number of requests not reaped yet.
+   */
+  std::size_t outstanding() const
+  {
+    return queued_.size() + inFlight_ + completed_.size();
+  }
+
+  /**
+   * Get the statistics of the requests
+   */
+  IOStats & getStats()
+  {
+    return stats_;
+  }
+
+ private:
+  /**
+   * A read or write request.
+   */
+  struct Request
+  {
+    int fd;
+    bool write;
+    std::uint64_t offset;
+    char * buffer;
+    std::size_t length;
+    const struct iovec * iov;
+    int iovcnt;
+    std::uint64_t tag;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+  };
+
+  /**
+   * Queue a request, making room for it first if queueDepth requests are not reaped yet.
+   */
+  void enqueue(const Request & request);
+
+  /**
+   * Carry out a request with pread()/pwrite(), or pwritev() for a vectored write, repeating short transfers until the
+   * end of the file.
+   *
+   * @return  Number of bytes transferred, or a negative errno
+   */
+  static std::int64_t perform(const Request & request);
+
+  /**
+   * Count a completed request in the statistics, and give back its completion.
+   */
+  void complete(const Request & request, const std::int64_t result);
+
+  /**
+   * Set up the io_uring.
+   *
+   * @return  False if the kernel does not support it
+   */
+  bool setupRing();
+
+  /**
+   * Submit the queued requests to the io_uring.
+   */
+  void submitRing();
+
+  /**
+   * Move the completions of requests in flight to completed_, waiting until at least a given number of them have
+   * been moved.
+   */
+  void collect(const std::size_t minimum);
+
+  /**
+   * Body of the threads of the IO_THREADS backend.
+   */
+  void work();
+
+  /**
+   * Options of the engine.
+   */
+  IOOptions options_;
+
+  /**
+   * Backend in use.
+   */
+  IOBackend backend_;
+
+  /**
+   * Requests queued and not submitted yet.
+   */
+  std::vector<Request> queued_;
+
+  /**
+   * Number of requests submitted and not completed yet.
+   */
+  std::size_t inFlight_;
+
+  /**
+   * Completions not reaped yet.
+   */
+  std::deque<IOCompletion> completed_;
+
+  /**
+   * Statistics of the requests.
+   */
+  IOStats stats_;
+
+  /**
+   * The requests in flight on the io_uring, by slot. The slot is the user data of the submission queue entry.
+   */
+  std::vector<Request> slots_;
+
+  /**
+   * Slots not in use.
+   */
+  std::vector<std::uint32_t> freeSlots_;
+
+  /**
+   * File descriptor of the io_uring, -1 if there is none.
+   */
+  int ringFd_;
+
+  /**
+   * Mappings of the submission queue ring, the completion queue ring and the submission queue entries.
+   */
+  void * sqRing_;
+  void * cqRing_;
+  void * sqes_;
+  std::size_t sqRingSize_;
+  std::size_t cqRingSize_;
+  std::size_t sqesSize_;
+
+  /**
+   * Fields of the rings, inside the mappings.
+   */
+  std::uint32_t * sqHead_;
+  std::uint32_t * sqTail_;
+  std::uint32_t * sqMask_;
+  std::uint32_t * sqArray_;
+  std::uint32_t * cqHead_;
+  std::uint32_t * cqTail_;
+  std::uint32_t * cqMask_;
+  void * cqes_;
+
+  /**
+   * Threads of the IO_THREADS backend, and the requests they take and the completions they give back, guarded by
+   * mutex_.
+   */
+  std::vector<std::thread> threads_;
+  std::deque<Request> work_;
+  std::deque<std::pair<Request, std::int64_t> > done_;
+  std::mutex mutex_;
+  std::condition_variable workReady_;
+  std::condition_variable doneReady_;
+  bool stopping_;
+};
+
+}
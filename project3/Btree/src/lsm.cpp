@@ -0,0 +1,773 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "lsm.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+// hash a key for the Bloom filters, two seeds give the two hashes
+// combined into LSMBLOOMHASHES bit positions
+static std::uint32_t bloomHash(const int key, const std::uint32_t seed)
+{
+    std::uint32_t h = ((std::uint32_t) key) * 0x9e3779b1u ^ seed;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+bool LSMRun::mayContain(const int key) const
+{
+    std::uint32_t h1 = bloomHash(key, 0);
+    std::uint32_t h2 = bloomHash(key, 0x5bd1e995u) | 1;
+    for(int i = 0; i < LSMBLOOMHASHES; i++){
+        std::uint32_t bit = (h1 + i * h2) % this -> info.bloomBitCount;
+        if(!(this -> bloom[bit / 8] & (1 << (bit % 8)))){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes the pages of a run through a stream, from entries added in key order.
+ * Page 1 gets the LSMRunInfo, the data pages follow from page 2, then the
+ * fence pages and the Bloom filter pages. The fences and the Bloom filter are
+ * also kept in the run, so it does not have to be read back.
+ */
+class LSMRunWriter{
+public:
+    LSMRunWriter(std::ostream & out, LSMRun * run)
+    : out(out), run(run), pageIndex(0)
+    {
+        this -> leaf = (LeafNodeInt *) &this -> page;
+        this -> leaf -> slotTaken = 0;
+        this -> run -> fences.clear();
+        this -> run -> bloom.assign((this -> run -> info.bloomBitCount + 7) / 8, 0);
+    }
+
+    void add(const int key, const RecordId & rid)
+    {
+        if(this -> leaf -> slotTaken == INTARRAYLEAFSIZE){
+            this -> writeDataPage();
+        }
+        if(this -> leaf -> slotTaken == 0){
+            this -> run -> fences.push_back(key);
+        }
+        this -> leaf -> keyArray[this -> leaf -> slotTaken] = key;
+        this -> leaf -> ridArray[this -> leaf -> slotTaken] = rid;
+        this -> leaf -> slotTaken++;
+
+        std::uint32_t h1 = bloomHash(key, 0);
+        std::uint32_t h2 = bloomHash(key, 0x5bd1e995u) | 1;
+        for(int i = 0; i < LSMBLOOMHASHES; i++){
+            std::uint32_t bit = (h1 + i * h2) % this -> run -> info.bloomBitCount;
+            this -> run -> bloom[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+
+    void finish()
+    {
+        if(this -> leaf -> slotTaken > 0){
+            this -> writeDataPage();
+        }
+        const LSMRunInfo & info = this -> run -> info;
+        Page infoPage;
+        *((LSMRunInfo *) &infoPage) = info;
+        File::writePageToStream(this -> out, 1, infoPage);
+
+        PageId pageNo = 2 + info.dataPageCount;
+        for(int i = 0; i < info.fencePageCount; i++, pageNo++){
+            Page fencePage;
+            int first = i * LSMFENCESPERPAGE;
+            int last = std::min(first + LSMFENCESPERPAGE, (int) this -> run -> fences.size());
+            std::copy(this -> run -> fences.begin() + first, this -> run -> fences.begin() + last, (int *) &fencePage);
+            File::writePageToStream(this -> out, pageNo, fencePage);
+        }
+        for(int i = 0; i < info.bloomPageCount; i++, pageNo++){
+            Page bloomPage;
+            std::size_t first = (std::size_t) i * Page::SIZE;
+            std::size_t last = std::min(first + Page::SIZE, this -> run -> bloom.size());
+            std::copy(this -> run -> bloom.begin() + first, this -> run -> bloom.begin() + last, (unsigned char *) &bloomPage);
+            File::writePageToStream(this -> out, pageNo, bloomPage);
+        }
+        this -> out.flush();
+    }
+
+private:
+    void writeDataPage()
+    {
+        PageId pageNo = 2 + this -> pageIndex;
+        this -> pageIndex++;
+        // the data pages are linked like the leaves of BTreeIndex
+        this -> leaf -> rightSibPageNo = this -> pageIndex < this -> run -> info.dataPageCount ? pageNo + 1 : Page::INVALID_NUMBER;
+        File::writePageToStream(this -> out, pageNo, this -> page);
+        this -> leaf -> slotTaken = 0;
+    }
+
+    std::ostream & out;
+    LSMRun * run;
+    Page page;
+    LeafNodeInt * leaf;
+    int pageIndex;
+};
+
+// -----------------------------------------------------------------------------
+// LSMTreeIndex::LSMTreeIndex -- Constructor
+// -----------------------------------------------------------------------------
+/**
+ * Constructor
+ *
+ * The index file is a manifest listing the runs, named like the file of a
+ * BTreeIndex with ".lsm" appended. If it exists, the runs it lists are opened
+ * and the run files left over by an interrupted compaction are removed.
+ * Else, a new index is created from the tuples of the relation.
+ *
+ * @param relationName The name of the relation on which to build the index.
+ * @param outIndexName The name of the index file
+ * @param bufMgrIn The instance of the global buffer manager.
+ * @param attrByteOffset The byte offset of the attribute in the tuple on which to build the index.
+ * @param attrType The data type of the attribute we are indexing.
+ * @param options The options of the index, only memtableSize is used.
+ */
+LSMTreeIndex::LSMTreeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType,
+		const IndexOptions & options)
+{
+    this -> bufMgr = bufMgrIn;
+    this -> attributeType = attrType;
+    this -> attrByteOffset = attrByteOffset;
+    this -> memtableSize = std::max(1, options.memtableSize);
+    this -> nextRunId = 0;
+
+    this -> compactionRunning = false;
+    this -> compactionDone = false;
+    this -> compactionOutput = NULL;
+
+    // initialize all the variables for the scanning
+    this -> scanExecuting = false;
+    this -> nextMemtableEntry = 0;
+    this -> lowValInt = -1;
+    this -> highValInt = -1;
+    this -> lowOp = (Operator)-1;
+    this -> highOp = (Operator)-1;
+
+    // find the index file name
+    std::ostringstream idxStr;
+    idxStr << relationName << '.' << attrByteOffset << ".lsm";
+    this -> indexName = idxStr.str();
+    outIndexName = this -> indexName;
+
+    if(File::exists(this -> indexName)){
+        this -> file = (File *) new BlobFile(this -> indexName, false);
+        PageId metaPageId = 1;
+        Page * metaPage;
+        this -> bufMgr -> readPage(this -> file, metaPageId, metaPage);
+        LSMMetaInfo * metaInfo = (LSMMetaInfo *) metaPage;
+        if(!(metaInfo -> relationName == relationName
+           && metaInfo -> attrByteOffset == attrByteOffset
+           && metaInfo -> attrType == attrType)){
+            this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+            throw BadIndexInfoException("Index file exists but values in metapage not match.");
+        }
+        this -> headerPageNum = metaPageId;
+        this -> nextRunId = metaInfo -> nextRunId;
+        std::vector<int> runIds(metaInfo -> runIdArray, metaInfo -> runIdArray + metaInfo -> runCount);
+        std::vector<int> runTiers(metaInfo -> runTierArray, metaInfo -> runTierArray + metaInfo -> runCount);
+        this -> bufMgr -> unPinPage(this -> file, metaPageId, false);
+
+        for(std::size_t i = 0; i < runIds.size(); i++){
+            this -> runs.push_back(this -> openRun(runIds[i], runTiers[i]));
+        }
+        // run files not listed are the output of a compaction which did not finish
+        for(int runId = 0; runId < this -> nextRunId; runId++){
+            if(std::find(runIds.begin(), runIds.end(), runId) == runIds.end()
+               && File::exists(runFileName(this -> indexName, runId))){
+                File::remove(runFileName(this -> indexName, runId));
+            }
+        }
+        return;
+    }
+
+    this -> file = (File *) new BlobFile(this -> indexName, true);
+    PageId metaPageId;
+    Page * metaPage;
+    this -> bufMgr -> allocPage(this -> file, metaPageId, metaPage);
+    LSMMetaInfo * metaInfo = (LSMMetaInfo *) metaPage;
+    strcpy(metaInfo -> relationName, relationName.c_str());
+    metaInfo -> attrByteOffset = attrByteOffset;
+    metaInfo -> attrType = attrType;
+    metaInfo -> nextRunId = 0;
+    metaInfo -> runCount = 0;
+    this -> headerPageNum = metaPageId;
+    this -> bufMgr -> unPinPage(this -> file, metaPageId, true);
+
+    // scan the relation and insert into the index file
+    FileScan * fileScan = new FileScan(relationName, bufMgrIn);
+    try
+    {
+        RecordId scanRid;
+        while(1)
+        {
+            fileScan -> scanNext(scanRid);
+            std::string recordStr = fileScan -> getRecord();
+            const char *record = recordStr.c_str();
+            int key = *((int *)(record + attrByteOffset));
+            this -> insertEntry(&key, scanRid);
+        }
+    }
+    catch(EndOfFileException e)
+    {
+        // this case means reaching the end of the relation file.
+    }
+    delete fileScan;
+}
+
+// -----------------------------------------------------------------------------
+// LSMTreeIndex::~LSMTreeIndex -- destructor
+// -----------------------------------------------------------------------------
+/**
+ * Destructor
+ * End the scan, if any, and install a running compaction. The memtable is
+ * written out as a run, so that no entry is lost. Then the manifest is
+ * flushed and all files are closed.
+ */
+LSMTreeIndex::~LSMTreeIndex()
+{
+    if(this -> scanExecuting) this -> endScan();
+    if(this -> compactionRunning) this -> installCompaction();
+    if(!this -> memtable.empty()) this -> flushMemtable();
+
+    this -> bufMgr -> flushFile(this -> file);
+    delete this -> file;
+    for(std::size_t i = 0; i < this -> runs.size(); i++){
+        this -> bufMgr -> flushFile(this -> runs[i] -> file);
+        delete this -> runs[i] -> file;
+        delete this -> runs[i];
+    }
+}
+
+/**
+ * Remove the manifest file and every run file named after it.
+ * @param indexName Name of the index file.
+ */
+void LSMTreeIndex::remove(const std::string & indexName)
+{
+    int nextRunId = 0;
+    {
+        BlobFile manifest(indexName, false);
+        Page metaPage = manifest.readPage(1);
+        nextRunId = ((LSMMetaInfo *) &metaPage) -> nextRunId;
+    }
+    for(int runId = 0; runId < nextRunId; runId++){
+        if(File::exists(runFileName(indexName, runId))){
+            File::remove(runFileName(indexName, runId));
+        }
+    }
+    File::remove(indexName);
+}
+
+std::string LSMTreeIndex::runFileName(const std::string & indexName, const int runId)
+{
+    std::ostringstream runStr;
+    runStr << indexName << '.' << runId;
+    return runStr.str();
+}
+
+/**
+ * Open a run file and load its fence keys and Bloom filter. The pages are
+ * read from the file directly, they are kept in memory for as long as the
+ * run is open anyway.
+ * @param runId: the id of the run
+ * @param tier: the tier of the run
+ * @return the run
+ */
+LSMRun * LSMTreeIndex::openRun(const int runId, const int tier)
+{
+    LSMRun * run = new LSMRun();
+    run -> runId = runId;
+    run -> tier = tier;
+    run -> file = (File *) new BlobFile(runFileName(this -> indexName, runId), false);
+    Page infoPage = run -> file -> readPage(1);
+    run -> info = *((LSMRunInfo *) &infoPage);
+
+    PageId pageNo = 2 + run -> info.dataPageCount;
+    for(int i = 0; i < run -> info.fencePageCount; i++, pageNo++){
+        Page fencePage = run -> file -> readPage(pageNo);
+        int count = std::min(LSMFENCESPERPAGE, run -> info.dataPageCount - i * LSMFENCESPERPAGE);
+        run -> fences.insert(run -> fences.end(), (int *) &fencePage, (int *) &fencePage + count);
+    }
+    std::size_t bloomBytes = (run -> info.bloomBitCount + 7) / 8;
+    for(int i = 0; i < run -> info.bloomPageCount; i++, pageNo++){
+        Page bloomPage = run -> file -> readPage(pageNo);
+        std::size_t count = std::min((std::size_t) Page::SIZE, bloomBytes - (std::size_t) i * Page::SIZE);
+        run -> bloom.insert(run -> bloom.end(), (unsigned char *) &bloomPage, (unsigned char *) &bloomPage + count);
+    }
+    return run;
+}
+
+/**
+ * Create a run file with all its pages allocated, so that they can be
+ * written through a private stream in any order.
+ * @param entryCount: the number of entries of the run
+ * @param tier: the tier of the run
+ * @return the run, whose fences and Bloom filter are still empty
+ */
+LSMRun * LSMTreeIndex::createRun(const int entryCount, const int tier)
+{
+    LSMRun * run = new LSMRun();
+    run -> runId = this -> nextRunId++;
+    run -> tier = tier;
+    run -> info.entryCount = entryCount;
+    run -> info.dataPageCount = (entryCount + INTARRAYLEAFSIZE - 1) / INTARRAYLEAFSIZE;
+    run -> info.fencePageCount = (run -> info.dataPageCount + LSMFENCESPERPAGE - 1) / LSMFENCESPERPAGE;
+    run -> info.bloomBitCount = std::max(64, entryCount * LSMBLOOMBITSPERKEY);
+    run -> info.bloomPageCount = ((run -> info.bloomBitCount + 7) / 8 + Page::SIZE - 1) / Page::SIZE;
+
+    BlobFile * runFile = new BlobFile(runFileName(this -> indexName, run -> runId), true);
+    runFile -> allocatePageRange(1 + run -> info.dataPageCount + run -> info.fencePageCount + run -> info.bloomPageCount);
+    run -> file = (File *) runFile;
+    return run;
+}
+
+/**
+ * Close a run file, drop its pages from the buffer pool and remove it.
+ * @param run: the run, which gets deleted
+ */
+const void LSMTreeIndex::removeRun(LSMRun * run)
+{
+    std::string name = run -> file -> filename();
+    this -> bufMgr -> flushFile(run -> file);
+    delete run -> file;
+    delete run;
+    File::remove(name);
+}
+
+/**
+ * Write the list of runs into the meta page and flush the manifest file, so
+ * that the list on disk never names a run file which was removed.
+ */
+const void LSMTreeIndex::writeManifest()
+{
+    Page * metaPage;
+    this -> bufMgr -> readPage(this -> file, this -> headerPageNum, metaPage);
+    LSMMetaInfo * metaInfo = (LSMMetaInfo *) metaPage;
+    metaInfo -> nextRunId = this -> nextRunId;
+    metaInfo -> runCount = this -> runs.size();
+    for(std::size_t i = 0; i < this -> runs.size(); i++){
+        metaInfo -> runIdArray[i] = this -> runs[i] -> runId;
+        metaInfo -> runTierArray[i] = this -> runs[i] -> tier;
+    }
+    this -> bufMgr -> unPinPage(this -> file, this -> headerPageNum, true);
+    this -> bufMgr -> flushFile(this -> file);
+}
+
+/**
+ * Write the memtable out as a new run of tier 0 and clear it. When the
+ * manifest is full and a scan keeps the compaction from being installed,
+ * the memtable is kept, and grows, until the next insert after the scan.
+ */
+const void LSMTreeIndex::flushMemtable()
+{
+    if(!this -> makeRoomForRun()){
+        return;
+    }
+    LSMRun * run = this -> createRun(this -> memtable.size(), 0);
+    std::shared_ptr<std::ofstream> out = run -> file -> openWriteStream();
+    LSMRunWriter writer(*out, run);
+    for(std::map<int, RecordId>::iterator it = this -> memtable.begin(); it != this -> memtable.end(); ++it){
+        writer.add(it -> first, it -> second);
+    }
+    writer.finish();
+    out -> close();
+    this -> memtable.clear();
+    this -> runs.push_back(run);
+    this -> writeManifest();
+}
+
+/**
+ * Make room in the manifest for one more run. Tier 0 runs pile up while a
+ * merge falls behind the memtable flushes, so the merge is waited for and
+ * installed, and the next one started, until fewer than LSMMAXRUNS runs are
+ * listed. Some tier always holds LSMTIERFANOUT runs by then, so there is
+ * always a merge to wait for.
+ * @return false if the manifest is full and a scan is running
+ */
+bool LSMTreeIndex::makeRoomForRun()
+{
+    while((int) this -> runs.size() >= LSMMAXRUNS){
+        if(this -> scanExecuting){
+            return false;
+        }
+        this -> maybeStartCompaction();
+        this -> installCompaction();
+    }
+    return true;
+}
+
+/**
+ * Start a compaction thread for the lowest tier holding LSMTIERFANOUT runs,
+ * unless one is running already. The output run file is created here, and
+ * the streams are opened here, so the thread does not touch the shared
+ * state of File or BufMgr.
+ */
+const void LSMTreeIndex::maybeStartCompaction()
+{
+    if(this -> compactionRunning){
+        return;
+    }
+    for(int tier = 0; ; tier++){
+        std::vector<LSMRun *> inputs;
+        bool higherTier = false;
+        for(std::size_t i = 0; i < this -> runs.size(); i++){
+            if(this -> runs[i] -> tier == tier){
+                inputs.push_back(this -> runs[i]);
+            }
+            else if(this -> runs[i] -> tier > tier){
+                higherTier = true;
+            }
+        }
+        if((int) inputs.size() >= LSMTIERFANOUT){
+            this -> compactionInputs = inputs;
+            break;
+        }
+        if(!higherTier){
+            return;
+        }
+    }
+
+    int entryCount = 0;
+    std::vector< std::shared_ptr<std::ifstream> > inputStreams;
+    std::vector<int> dataPageCounts;
+    for(std::size_t i = 0; i < this -> compactionInputs.size(); i++){
+        entryCount += this -> compactionInputs[i] -> info.entryCount;
+        inputStreams.push_back(this -> compactionInputs[i] -> file -> openReadStream());
+        dataPageCounts.push_back(this -> compactionInputs[i] -> info.dataPageCount);
+    }
+    this -> compactionOutput = this -> createRun(entryCount, this -> compactionInputs[0] -> tier + 1);
+    // record the new run id, so that a left over output file gets removed on reopen
+    this -> writeManifest();
+
+    this -> compactionRunning = true;
+    this -> compactionDone = false;
+    this -> compactionThread = std::thread(&LSMTreeIndex::mergeRuns, inputStreams, dataPageCounts,
+                                           this -> compactionOutput -> file -> openWriteStream(),
+                                           this -> compactionOutput, &this -> compactionDone);
+}
+
+/**
+ * Wait for the compaction thread, then replace its input runs by its output
+ * run. The manifest is written before the input files are removed. Must not
+ * be called while a scan is running, since the scan may hold pages of the
+ * input runs.
+ */
+const void LSMTreeIndex::installCompaction()
+{
+    this -> compactionThread.join();
+    for(std::size_t i = 0; i < this -> compactionInputs.size(); i++){
+        this -> runs.erase(std::find(this -> runs.begin(), this -> runs.end(), this -> compactionInputs[i]));
+    }
+    this -> runs.push_back(this -> compactionOutput);
+    this -> writeManifest();
+    for(std::size_t i = 0; i < this -> compactionInputs.size(); i++){
+        this -> removeRun(this -> compactionInputs[i]);
+    }
+    this -> compactionInputs.clear();
+    this -> compactionOutput = NULL;
+    this -> compactionRunning = false;
+}
+
+/**
+ * Merge runs into one, reading every input sequentially. The number of
+ * inputs is small, so the smallest head is found by a linear search.
+ * @param inputs: private read streams of the input run files
+ * @param dataPageCounts: the number of data pages of each input run
+ * @param output: private write stream of the output run file
+ * @param result: the output run, whose fences and Bloom filter are filled in
+ * @param done: set when the output run is complete
+ */
+void LSMTreeIndex::mergeRuns(std::vector< std::shared_ptr<std::ifstream> > inputs, std::vector<int> dataPageCounts,
+                             std::shared_ptr<std::ofstream> output, LSMRun * result, std::atomic<bool> * done)
+{
+    std::size_t count = inputs.size();
+    std::vector<Page> pages(count);
+    std::vector<int> pageIndexes(count, 0);
+    std::vector<int> nextEntries(count, 0);
+    for(std::size_t i = 0; i < count; i++){
+        pages[i] = File::readPageFromStream(*inputs[i], 2);
+    }
+
+    LSMRunWriter writer(*output, result);
+    while(1){
+        int smallest = -1;
+        for(std::size_t i = 0; i < count; i++){
+            if(pageIndexes[i] == dataPageCounts[i]){
+                continue;
+            }
+            LeafNodeInt * leaf = (LeafNodeInt *) &pages[i];
+            if(smallest < 0 || leaf -> keyArray[nextEntries[i]] < ((LeafNodeInt *) &pages[smallest]) -> keyArray[nextEntries[smallest]]){
+                smallest = i;
+            }
+        }
+        if(smallest < 0){
+            break;
+        }
+        LeafNodeInt * leaf = (LeafNodeInt *) &pages[smallest];
+        writer.add(leaf -> keyArray[nextEntries[smallest]], leaf -> ridArray[nextEntries[smallest]]);
+        nextEntries[smallest]++;
+        if(nextEntries[smallest] == leaf -> slotTaken){
+            pageIndexes[smallest]++;
+            nextEntries[smallest] = 0;
+            if(pageIndexes[smallest] < dataPageCounts[smallest]){
+                pages[smallest] = File::readPageFromStream(*inputs[smallest], 2 + pageIndexes[smallest]);
+            }
+        }
+    }
+    writer.finish();
+    output -> close();
+    done -> store(true);
+}
+
+// -----------------------------------------------------------------------------
+// LSMTreeIndex::insertEntry
+// -----------------------------------------------------------------------------
+/**
+ * Insert a new entry using the pair <value,rid> into the memtable. A full
+ * memtable is written out as a run, which may start a compaction. A finished
+ * compaction is installed first, unless a scan is running.
+ * @param key			A pointer to the value(integer we want to insert)
+ * @param rid			The corresponding record id of the tuple in the base relation
+ **/
+const void LSMTreeIndex::insertEntry(const void *key, const RecordId rid)
+{
+    if(this -> compactionRunning && this -> compactionDone && !this -> scanExecuting){
+        this -> installCompaction();
+        this -> maybeStartCompaction();
+    }
+    this -> memtable[*((int *) key)] = rid;
+    if((int) this -> memtable.size() >= this -> memtableSize){
+        this -> flushMemtable();
+        this -> maybeStartCompaction();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// LSMTreeIndex::startScan
+// -----------------------------------------------------------------------------
+/**
+ * Begin a filtered scan of the index, with the same arguments and exceptions
+ * as BTreeIndex::startScan.
+ *
+ * The entries of the memtable in the scan range are copied. Every run gets a
+ * cursor on its first entry satisfying the low bound, found through its fence
+ * keys. If the scan range is a single key, runs whose Bloom filter rules the
+ * key out get no cursor at all.
+ *
+ * @param lowValParm The low value to be tested.
+ * @param lowOpParm The operation to be used in testing the low range.
+ * @param highValParm The high value to be tested.
+ * @param highOpParm The operation to be used in testing the high range.
+ */
+const void LSMTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+    if(lowOpParm != GT && lowOpParm != GTE){
+        throw BadOpcodesException();
+    }
+    if(highOpParm != LT && highOpParm != LTE){
+        throw BadOpcodesException();
+    }
+    // If another scan is already executing, that needs to be ended here.
+    if(this -> scanExecuting == true){
+        this -> endScan();
+    }
+    this -> lowValInt = *((int*) lowValParm);
+    this -> highValInt = *((int*) highValParm);
+    if(this -> lowValInt > this -> highValInt){
+        throw BadScanrangeException();
+    }
+    if(this -> compactionRunning && this -> compactionDone){
+        this -> installCompaction();
+        this -> maybeStartCompaction();
+    }
+    this -> lowOp = lowOpParm;
+    this -> highOp = highOpParm;
+    this -> scanExecuting = true;
+
+    this -> memtableEntries.clear();
+    this -> nextMemtableEntry = 0;
+    std::map<int, RecordId>::iterator it = this -> lowOp == GT ? this -> memtable.upper_bound(this -> lowValInt)
+                                                                : this -> memtable.lower_bound(this -> lowValInt);
+    for(; it != this -> memtable.end() && this -> satisfiesHigh(it -> first); ++it){
+        RIDKeyPair<int> entry;
+        entry.set(it -> second, it -> first);
+        this -> memtableEntries.push_back(entry);
+    }
+
+    // a single key, which the Bloom filters can rule out
+    long firstKey = this -> lowOp == GT ? (long) this -> lowValInt + 1 : this -> lowValInt;
+    long lastKey = this -> highOp == LT ? (long) this -> highValInt - 1 : this -> highValInt;
+    bool pointScan = firstKey == lastKey;
+
+    this -> cursors.clear();
+    for(std::size_t i = 0; i < this -> runs.size(); i++){
+        LSMRun * run = this -> runs[i];
+        if(pointScan && !run -> mayContain(firstKey)){
+            continue;
+        }
+        // the last data page whose first key is not above the low value
+        int pageIndex = std::upper_bound(run -> fences.begin(), run -> fences.end(), this -> lowValInt) - run -> fences.begin() - 1;
+        LSMRunCursor cursor;
+        cursor.run = run;
+        cursor.pageNo = 2 + std::max(0, pageIndex);
+        this -> bufMgr -> readPage(run -> file, cursor.pageNo, cursor.page);
+        LeafNodeInt * leaf = (LeafNodeInt *) cursor.page;
+        int * first = this -> lowOp == GT ? std::upper_bound(leaf -> keyArray, leaf -> keyArray + leaf -> slotTaken, this -> lowValInt)
+                                          : std::lower_bound(leaf -> keyArray, leaf -> keyArray + leaf -> slotTaken, this -> lowValInt);
+        cursor.nextEntry = first - leaf -> keyArray - 1;
+        this -> advanceCursor(cursor);
+        if(cursor.pageNo != Page::INVALID_NUMBER){
+            this -> cursors.push_back(cursor);
+        }
+    }
+
+    if(this -> cursors.empty() && this -> memtableEntries.empty()){
+        this -> endScan();
+        throw NoSuchKeyFoundException();
+    }
+}
+
+bool LSMTreeIndex::satisfiesLow(const int key) const{
+    return this -> lowOp == GT ? key > this -> lowValInt : key >= this -> lowValInt;
+}
+
+bool LSMTreeIndex::satisfiesHigh(const int key) const{
+    return this -> highOp == LT ? key < this -> highValInt : key <= this -> highValInt;
+}
+
+/**
+ * Move a run cursor to the next entry, following the data pages. The data
+ * page is unpinned when the cursor leaves it. The cursor is dropped once the
+ * run is used up or its key no longer satisfies the high bound.
+ * @param cursor: the run cursor
+ */
+const void LSMTreeIndex::advanceCursor(LSMRunCursor & cursor)
+{
+    cursor.nextEntry++;
+    LeafNodeInt * leaf = (LeafNodeInt *) cursor.page;
+    while(cursor.nextEntry >= leaf -> slotTaken){
+        PageId rightSibPageNo = leaf -> rightSibPageNo;
+        this -> bufMgr -> unPinPage(cursor.run -> file, cursor.pageNo, false);
+        cursor.pageNo = rightSibPageNo;
+        cursor.page = NULL;
+        cursor.nextEntry = 0;
+        if(rightSibPageNo == Page::INVALID_NUMBER){
+            return;
+        }
+        this -> bufMgr -> readPage(cursor.run -> file, rightSibPageNo, cursor.page);
+        leaf = (LeafNodeInt *) cursor.page;
+    }
+    if(!this -> satisfiesHigh(leaf -> keyArray[cursor.nextEntry])){
+        this -> bufMgr -> unPinPage(cursor.run -> file, cursor.pageNo, false);
+        cursor.pageNo = Page::INVALID_NUMBER;
+        cursor.page = NULL;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// LSMTreeIndex::scanNext
+// -----------------------------------------------------------------------------
+/**
+ * Fetch the record id of the next index entry that matches the scan, taking
+ * the smallest key among the memtable entries and the run cursors.
+ * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+ * @throws ScanNotInitializedException If no scan has been initialized.
+ * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+ */
+const void LSMTreeIndex::scanNext(RecordId& outRid)
+{
+    if(this -> scanExecuting == false){
+        throw ScanNotInitializedException();
+    }
+    // -1 stands for the memtable
+    int smallest = -2;
+    int smallestKey = 0;
+    if(this -> nextMemtableEntry < this -> memtableEntries.size()){
+        smallest = -1;
+        smallestKey = this -> memtableEntries[this -> nextMemtableEntry].key;
+    }
+    for(std::size_t i = 0; i < this -> cursors.size(); i++){
+        if(this -> cursors[i].pageNo == Page::INVALID_NUMBER){
+            continue;
+        }
+        int key = ((LeafNodeInt *) this -> cursors[i].page) -> keyArray[this -> cursors[i].nextEntry];
+        if(smallest == -2 || key < smallestKey){
+            smallest = i;
+            smallestKey = key;
+        }
+    }
+    if(smallest == -2){
+        throw IndexScanCompletedException();
+    }
+    if(smallest == -1){
+        outRid = this -> memtableEntries[this -> nextMemtableEntry].rid;
+        this -> nextMemtableEntry++;
+        return;
+    }
+    LSMRunCursor & cursor = this -> cursors[smallest];
+    outRid = ((LeafNodeInt *) cursor.page) -> ridArray[cursor.nextEntry];
+    this -> advanceCursor(cursor);
+}
+
+// -----------------------------------------------------------------------------
+// LSMTreeIndex::endScan
+// -----------------------------------------------------------------------------
+/**
+ * This method terminates the current scan and unpins the data pages still
+ * pinned by the run cursors.
+ * It throws ScanNotInitializedException when called before a successful
+ * startScan call.
+ */
+const void LSMTreeIndex::endScan()
+{
+    if(this -> scanExecuting == false){
+        throw ScanNotInitializedException();
+    }
+    for(std::size_t i = 0; i < this -> cursors.size(); i++){
+        if(this -> cursors[i].pageNo != Page::INVALID_NUMBER){
+            this -> bufMgr -> unPinPage(this -> cursors[i].run -> file, this -> cursors[i].pageNo, false);
+        }
+    }
+    this -> cursors.clear();
+    this -> memtableEntries.clear();
+    this -> nextMemtableEntry = 0;
+    this -> scanExecuting = false;
+    this -> lowValInt = -1;
+    this -> highValInt = -1;
+    this -> lowOp = (Operator)-1;
+    this -> highOp = (Operator)-1;
+}
+
+}
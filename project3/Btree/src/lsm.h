@@ -0,0 +1,486 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of runs of the same tier which get merged into one run of the next tier.
+ */
+const int LSMTIERFANOUT = 4;
+
+/**
+ * @brief Number of bits of a run's Bloom filter per entry. Together with LSMBLOOMHASHES this gives a false positive rate below 1%.
+ */
+const int LSMBLOOMBITSPERKEY = 10;
+
+/**
+ * @brief Number of bits set per entry in the Bloom filter of a run.
+ */
+const int LSMBLOOMHASHES = 7;
+
+/**
+ * @brief Number of fence keys held by one fence page of a run.
+ */
+const int LSMFENCESPERPAGE = Page::SIZE / sizeof( int );
+
+/**
+ * @brief Maximum number of runs the manifest page can list.
+ */
+//                                        relationName,       attrByteOffset, attrType, nextRunId, runCount       runId, tier
+const int LSMMAXRUNS = ( Page::SIZE - sizeof( char[20] ) - 2 * sizeof( int ) - sizeof( Datatype ) - 2 * sizeof( int ) ) / ( 2 * sizeof( int ) );
+
+/**
+ * @brief The meta page of an LSM tree index, which is page 1 of the manifest file. Lists the runs making up the index.
+*/
+struct LSMMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Id the next run file will get. Run files with smaller ids which are not listed are left overs to be removed.
+   */
+	int nextRunId;
+
+  /**
+   * Number of runs listed.
+   */
+	int runCount;
+
+  /**
+   * Ids of the runs. The run with id i is stored in the file "<index file name>.<i>".
+   */
+	int runIdArray[ LSMMAXRUNS ];
+
+  /**
+   * Tier of each run, 0 for runs written out from the memtable.
+   */
+	int runTierArray[ LSMMAXRUNS ];
+};
+
+/**
+ * @brief Page 1 of a run file. It is followed by the data pages, starting at page 2, then the fence pages and the Bloom filter pages.
+ * The data pages are packed LeafNodeInt pages, linked through rightSibPageNo. The fence pages hold the first key of every data page.
+*/
+struct LSMRunInfo{
+  /**
+   * Number of entries in the run.
+   */
+	int entryCount;
+
+  /**
+   * Number of data pages.
+   */
+	int dataPageCount;
+
+  /**
+   * Number of fence pages.
+   */
+	int fencePageCount;
+
+  /**
+   * Number of Bloom filter pages.
+   */
+	int bloomPageCount;
+
+  /**
+   * Number of bits of the Bloom filter.
+   */
+	int bloomBitCount;
+};
+
+/**
+ * @brief An immutable sorted run of an LSM tree index. The fence keys and the Bloom filter are kept in memory.
+*/
+struct LSMRun{
+  /**
+   * Id of the run, which names its file.
+   */
+	int runId;
+
+  /**
+   * Tier of the run.
+   */
+	int tier;
+
+  /**
+   * File object for the run file.
+   */
+	File *file;
+
+  /**
+   * Copy of page 1 of the run file.
+   */
+	LSMRunInfo info;
+
+  /**
+   * First key of every data page.
+   */
+	std::vector<int> fences;
+
+  /**
+   * Bits of the Bloom filter.
+   */
+	std::vector<unsigned char> bloom;
+
+  /**
+   * Check the Bloom filter.
+   * @param key: the key to look for
+   * @return false if the key is surely not in the run
+   */
+	bool mayContain(const int key) const;
+};
+
+/**
+ * @brief Position of a scan in one run. The data page being scanned stays pinned.
+*/
+struct LSMRunCursor{
+  /**
+   * The run being scanned.
+   */
+	LSMRun *run;
+
+  /**
+   * Page number of the current data page, INVALID_NUMBER once the run is used up for this scan.
+   */
+	PageId pageNo;
+
+  /**
+   * Current data page.
+   */
+	Page *page;
+
+  /**
+   * Index of next entry to be scanned in the current data page.
+   */
+	int nextEntry;
+};
+
+
+/**
+ * @brief LSMTreeIndex class. It implements a log structured merge tree index on a single attribute of a relation,
+ * for write heavy workloads. Inserts go into a sorted in memory memtable, which is written out as an immutable sorted
+ * run into its own BlobFile once it holds IndexOptions::memtableSize entries. Runs are compacted by tiers: as soon as
+ * LSMTIERFANOUT runs of the same tier exist, a background thread merges them into one run of the next tier. The
+ * compaction thread reads and writes the run files through private streams only, since the buffer manager is not
+ * threadsafe. The merged run replaces its inputs the next time the index is used without a scan running.
+ * Scans merge the memtable with a cursor per run. Fence keys find the first page to read in a run, and the Bloom
+ * filters let single key scans skip runs. The scan interface is the same as the one of BTreeIndex.
+ * This index supports only one scan at a time.
+*/
+class LSMTreeIndex {
+
+ private:
+
+  /**
+   * File object for the manifest file, which is the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Name of the manifest file, which prefixes the names of the run files.
+   */
+	std::string	indexName;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records.
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Number of entries the memtable holds before it is written out.
+   */
+	int			memtableSize;
+
+  /**
+   * Entries not written out into a run yet.
+   */
+	std::map<int, RecordId> memtable;
+
+  /**
+   * Runs making up the index, in the order of the manifest.
+   */
+	std::vector<LSMRun *> runs;
+
+  /**
+   * Id the next run file will get.
+   */
+	int			nextRunId;
+
+
+	// MEMBERS SPECIFIC TO COMPACTION
+
+  /**
+   * True if a compaction thread has been started and its result is not installed yet.
+   */
+	bool		compactionRunning;
+
+  /**
+   * Set by the compaction thread when it is done.
+   */
+	std::atomic<bool>	compactionDone;
+
+  /**
+   * The compaction thread.
+   */
+	std::thread	compactionThread;
+
+  /**
+   * Runs being merged.
+   */
+	std::vector<LSMRun *> compactionInputs;
+
+  /**
+   * Run being written by the compaction thread. The thread fills its fences and Bloom filter.
+   */
+	LSMRun		*compactionOutput;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Entries of the memtable satisfying the scan criteria, copied when the scan started.
+   */
+	std::vector< RIDKeyPair<int> > memtableEntries;
+
+  /**
+   * Index of next entry to be scanned in memtableEntries.
+   */
+	std::size_t	nextMemtableEntry;
+
+  /**
+   * Cursors of the runs which may hold entries satisfying the scan criteria.
+   */
+	std::vector<LSMRunCursor> cursors;
+
+  /**
+   * Low INTEGER value for scan.
+   */
+	int			lowValInt;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+    /**
+     * Name of the file of a run.
+     * @param indexName: the name of the manifest file
+     * @param runId: the id of the run
+     */
+    static std::string runFileName(const std::string & indexName, const int runId);
+
+    /**
+     * Open a run file and load its fence keys and Bloom filter.
+     * @param runId: the id of the run
+     * @param tier: the tier of the run
+     * @return the run
+     */
+    LSMRun * openRun(const int runId, const int tier);
+
+    /**
+     * Create a run file with room for a number of entries. The pages are filled in through a stream afterwards.
+     * @param entryCount: the number of entries of the run
+     * @param tier: the tier of the run
+     * @return the run, whose fences and Bloom filter are still empty
+     */
+    LSMRun * createRun(const int entryCount, const int tier);
+
+    /**
+     * Close a run file, drop its pages from the buffer pool and remove it.
+     * @param run: the run, which gets deleted
+     */
+    const void removeRun(LSMRun * run);
+
+    /**
+     * Write the list of runs into the meta page and flush the manifest file.
+     */
+    const void writeManifest();
+
+    /**
+     * Write the memtable out as a new run of tier 0 and clear it, once the manifest has room for the run.
+     */
+    const void flushMemtable();
+
+    /**
+     * Make room in the manifest for one more run, by installing compactions until fewer than LSMMAXRUNS runs are
+     * listed. Waits for the compaction thread if it is not done yet.
+     * @return false if the manifest is full and a scan running keeps the compaction from being installed
+     */
+    bool makeRoomForRun();
+
+    /**
+     * Start a compaction thread, unless one is running already, for the lowest tier holding LSMTIERFANOUT runs.
+     */
+    const void maybeStartCompaction();
+
+    /**
+     * Wait for the compaction thread, then replace its input runs by its output run.
+     */
+    const void installCompaction();
+
+    /**
+     * Merge runs into one. Runs on a compaction thread, so it touches nothing but the streams passed in and the output run.
+     * @param inputs: private read streams of the input run files
+     * @param dataPageCounts: the number of data pages of each input run
+     * @param output: private write stream of the output run file
+     * @param result: the output run, whose fences and Bloom filter are filled in
+     * @param done: set when the output run is complete
+     */
+    static void mergeRuns(std::vector< std::shared_ptr<std::ifstream> > inputs, std::vector<int> dataPageCounts,
+                          std::shared_ptr<std::ofstream> output, LSMRun * result, std::atomic<bool> * done);
+
+    /**
+     * Check whether a key satisfies the low bound of the scan.
+     */
+    bool satisfiesLow(const int key) const;
+
+    /**
+     * Check whether a key satisfies the high bound of the scan.
+     */
+    bool satisfiesHigh(const int key) const;
+
+    /**
+     * Move a run cursor to the next entry, following the data pages. Sets the page number of the cursor
+     * to INVALID_NUMBER when the run is used up or the high bound is passed.
+     * @param cursor: the run cursor
+     */
+    const void advanceCursor(LSMRunCursor & cursor);
+
+ public:
+
+  /**
+   * LSMTreeIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, open the file and the runs it lists,
+	 * and remove left over run files. If not, create it and insert entries for every tuple in the base relation
+	 * using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param options							Options of the index, only memtableSize is used
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   */
+	LSMTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexOptions & options = IndexOptions());
+
+  /**
+   * LSMTreeIndex Destructor.
+	 * End any initialized scan, wait for a running compaction, write the memtable out as a run,
+	 * flush the index file and close all the files.
+	 * */
+	~LSMTreeIndex();
+
+  /**
+   * Remove the index file and all its run files.
+   * @param indexName           Name of the index file.
+   */
+	static void remove(const std::string & indexName);
+
+  /**
+	 * Insert a new entry using the pair <value,rid>. The entry goes into the memtable, which is written out as a run when full.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	const void insertEntry(const void* key, const RecordId rid);
+
+  /**
+	 * Begin a filtered scan of the index. Same as BTreeIndex::startScan.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  NoSuchKeyFoundException If there is no key in the tree that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan, in key order.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+
+  /**
+	 * Get the number of runs making up the index, which is at most LSMMAXRUNS.
+	**/
+	int getRunCount() const
+	{
+		return this -> runs.size();
+	}
+};
+
+}
@@ -5,8 +5,13 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cmath>
 #include <vector>
 #include "btree.h"
+#include "betree.h"
+#include "lsm.h"
+#include "hashindex.h"
+#include "compositeindex.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -19,6 +24,14 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "exceptions/read_only_file_exception.h"
+#include "exceptions/bad_resize_exception.h"
+#include "exceptions/hash_not_found_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -64,11 +77,12 @@ BufMgr * bufMgr = new BufMgr(100);
 // Forward declarations
 // -----------------------------------------------------------------------------
 
-void createRelationForward(int rel = relationSize);
+void createRelationForward(int rel = relationSize, bool directIO = false);
 void createRelationBackward(int rel = relationSize);
 void createRelationRandom(int rel = relationSize);
 void intTests();
-int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+template <class IndexType>
+int intScan(IndexType *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
 void indexTests();
 void boundaryTests();
 void test1();
@@ -80,6 +94,64 @@ void test6_boundTest_Backward();
 void test7_int_CreateMoreRelation_Forward();
 void test8_int_CreateMoreRelation_Backward();
 void test9_int_CreateMoreRelation_Random();
+void test10_insertBatch();
+void batchTests();
+void test11_parallelBuild();
+void parallelBuildTests(int relationSize);
+void test12_betree();
+void betreeTests(int relationSize);
+void test13_lsm();
+void lsmTests(int relationSize);
+void test14_hashIndex();
+void hashTests(int relationSize);
+int hashLookup(HashIndex *index, int key, bool checkRecords);
+void test15_countRank();
+void countRankTests(int relationSize, int buildThreads);
+int rankLookup(BTreeIndex *index, int rank);
+void test16_descendingScan();
+void descendingScanTests(int relationSize, int buildThreads);
+int intScanDescending(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int limit, bool checkOrder);
+void test17_multiRangeScan();
+void multiRangeScanTests(int relationSize);
+int intMultiScan(BTreeIndex *index, const std::vector<ScanRange> & ranges);
+void test18_covering();
+void coveringTests(int relationSize, int buildThreads);
+int intCoveringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order);
+void test19_composite();
+void compositeTests(int relationSize);
+int intDoubleScan(CompositeBTreeIndex *index, int lowI, double lowD, Operator lowOp, int highI, double highD, Operator highOp, int prefixAttrs);
+int compositeScan(CompositeBTreeIndex *index, const void *low, Operator lowOp, const void *high, Operator highOp, int prefixAttrs);
+void test20_statistics();
+void statisticsTests(int relationSize, int buildThreads);
+int estimateWithin(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, int expected, double tolerance);
+void test21_compaction();
+void compactionTests(int relationSize);
+void test22_nodeLayout();
+void nodeLayoutTests(int buildThreads);
+void test23_compressedLeaves();
+void compressedLeavesTests(int buildThreads);
+void test24_interpolationSearch();
+void interpolationSearchTests(int buildThreads, bool compressLeaves);
+void test25_asyncIO();
+void asyncIOTests(IOBackend backend);
+void test26_readInto();
+void readIntoTests();
+void test27_directIO();
+void directIOTests();
+void test28_hugePages();
+void hugePagesTests(HugePages hugePages);
+void test29_mmapFile();
+void mmapFileTests();
+void test30_fileFrames();
+void fileFramesTests();
+void test31_writeBack();
+void writeBackTests(IOBackend backend);
+void test32_freeFrames();
+void freeFramesTests();
+void test33_accessStrategy();
+void accessStrategyTests();
+void test34_resizePool();
+void resizePoolTests();
 void errorTests();
 void boundTests();
 void deleteRelation();
@@ -154,6 +226,31 @@ int main(int argc, char **argv)
   test7_int_CreateMoreRelation_Forward();
   test8_int_CreateMoreRelation_Backward();
   test9_int_CreateMoreRelation_Random();
+  test10_insertBatch();
+  test11_parallelBuild();
+  test12_betree();
+  test13_lsm();
+  test14_hashIndex();
+  test15_countRank();
+  test16_descendingScan();
+  test17_multiRangeScan();
+  test18_covering();
+  test19_composite();
+  test20_statistics();
+  test21_compaction();
+  test22_nodeLayout();
+  test23_compressedLeaves();
+  test24_interpolationSearch();
+  test25_asyncIO();
+  test26_readInto();
+  test27_directIO();
+  test28_hugePages();
+  test29_mmapFile();
+  test30_fileFrames();
+  test31_writeBack();
+  test32_freeFrames();
+  test33_accessStrategy();
+  test34_resizePool();
 	errorTests();
 
   return 1;
@@ -259,11 +356,474 @@ void test9_int_CreateMoreRelation_Random()
   indexTests();
 	deleteRelation();
 }
+// -----------------------------------------------------------------------------
+// Batched Insert Test
+// -----------------------------------------------------------------------------
+void test10_insertBatch()
+{
+  // Create a relation with tuples valued 0 to relationSize in random order, build the index on it
+  // and then insert another relationSize keys through insertBatch in batches of different sizes
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test10_insertBatch" << std::endl;
+  createRelationRandom();
+  batchTests();
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Parallel Index Build Test
+// -----------------------------------------------------------------------------
+void test11_parallelBuild()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, build the index
+  // bottom up with several threads and perform index tests on it
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test11_parallelBuild" << std::endl;
+  createRelationRandom(200000);
+  parallelBuildTests(200000);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// B-epsilon Tree Test
+// -----------------------------------------------------------------------------
+void test12_betree()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, so that
+  // the message buffers get flushed and the leaf and non-leaf nodes split, and perform index tests
+  // on the B-epsilon tree index built on it
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test12_betree" << std::endl;
+  createRelationRandom(100000);
+  betreeTests(100000);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// LSM Tree Test
+// -----------------------------------------------------------------------------
+void test13_lsm()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, and build an
+  // LSM tree index on it with a small memtable, so that many runs are written and compacted
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test13_lsm" << std::endl;
+  createRelationRandom(100000);
+  lsmTests(100000);
+  try
+  {
+    LSMTreeIndex::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Hash Index Test
+// -----------------------------------------------------------------------------
+void test14_hashIndex()
+{
+  // Create a relation with tuples valued 0 to relationSize in random order, build a hash index
+  // on it, and look up, insert and delete entries, including a key occurring many times
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test14_hashIndex" << std::endl;
+  createRelationRandom(20000);
+  hashTests(20000);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Counted B+ Tree Test
+// -----------------------------------------------------------------------------
+void test15_countRank()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in backward order, so that the
+  // half full leaves make the root split, and count ranges and find entries by rank, both on the
+  // index built through insertEntry and on the one built bottom up
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test15_countRank" << std::endl;
+  createRelationBackward(300000);
+  countRankTests(300000, 0);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  countRankTests(300000, 4);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Descending Scan Test
+// -----------------------------------------------------------------------------
+void test16_descendingScan()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, and scan
+  // the index built on it from the high value down, both on the index built through insertEntry
+  // and insertBatch and on the one built bottom up
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test16_descendingScan" << std::endl;
+  createRelationRandom(100000);
+  descendingScanTests(100000, 0);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  descendingScanTests(100000, 4);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Multi-Range Scan Test
+// -----------------------------------------------------------------------------
+void test17_multiRangeScan()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, and scan
+  // several ranges and IN-lists of keys of the index built on it in single scans
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test17_multiRangeScan" << std::endl;
+  createRelationRandom(100000);
+  multiRangeScanTests(100000);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Covering Index Test
+// -----------------------------------------------------------------------------
+void test18_covering()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, and scan
+  // a covering index built on it, which returns the double and string fields along with the
+  // record ids, both on the index built through insertEntry and on the one built bottom up
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test18_covering" << std::endl;
+  createRelationRandom(50000);
+  coveringTests(50000, 0);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  coveringTests(50000, 4);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Composite Key Test
+// -----------------------------------------------------------------------------
+void test19_composite()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, and scan
+  // indexes on composite keys of its fields by leading prefixes of the keys
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test19_composite" << std::endl;
+  createRelationRandom(20000);
+  compositeTests(20000);
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Index Statistics Test
+// -----------------------------------------------------------------------------
+void test20_statistics()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, and check the
+  // statistics of the index built on it against the real numbers, both on the index built through
+  // insertEntry and on the one built bottom up
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test20_statistics" << std::endl;
+  createRelationRandom(100000);
+  statisticsTests(100000, 0);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  statisticsTests(100000, 4);
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Compaction Test
+// -----------------------------------------------------------------------------
+void test21_compaction()
+{
+  // Create a relation with tuples valued 0 to a larger relationSize in random order, so that the
+  // leaf pages of the index built through insertEntry are partially filled, and compact the index
+  // while a scan is executing on it
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test21_compaction" << std::endl;
+  createRelationRandom(20000);
+  compactionTests(20000);
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Non-leaf Page Layout Test
+// -----------------------------------------------------------------------------
+void test22_nodeLayout()
+{
+  // Create a relation with tuples valued 0 to relationSize in random order, and index it with the
+  // KEY_BLOCKS layout of the non-leaf pages, both through insertEntry and bottom up. Then insert
+  // enough keys for the non-leaf pages to split.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test22_nodeLayout" << std::endl;
+  createRelationRandom();
+  nodeLayoutTests(0);
+  nodeLayoutTests(2);
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Compressed Leaf Pages Test
+// -----------------------------------------------------------------------------
+void test23_compressedLeaves()
+{
+  // Create a relation with tuples valued 0 to relationSize in random order, and index it with
+  // compressed leaf pages, both through insertEntry and bottom up. Then insert enough keys for
+  // the compressed leaf pages to split many times.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test23_compressedLeaves" << std::endl;
+  createRelationRandom();
+  compressedLeavesTests(0);
+  compressedLeavesTests(2);
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Interpolation Search Test
+// -----------------------------------------------------------------------------
+void test24_interpolationSearch()
+{
+  // Create a relation with tuples valued 0 to relationSize in random order, and search the leaf
+  // pages of its index by interpolation. Then insert keys in clusters far from each other, whose
+  // slots the first and the last key of a leaf page predict badly.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test24_interpolationSearch" << std::endl;
+  createRelationRandom();
+  interpolationSearchTests(0, false);
+  interpolationSearchTests(2, true);
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Asynchronous I/O Test
+// -----------------------------------------------------------------------------
+void test25_asyncIO()
+{
+  // Write a BlobFile through buffer pools whose IOEngine uses each of the backends, write it back
+  // with flushFile, and read it back through prefetches and multi-page reads. Then prefetch pages
+  // of the relation, a PageFile, and one past its end.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test25_asyncIO" << std::endl;
+  createRelationForward();
+  asyncIOTests(IO_SYNC);
+  asyncIOTests(IO_THREADS);
+  asyncIOTests(IO_URING);
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Read Into Test
+// -----------------------------------------------------------------------------
+void test26_readInto()
+{
+  // Read pages of the relation into pages full of garbage and compare them with the pages returned
+  // by value, allocate pages of a PageFile and a BlobFile in place, and write back and read again
+  // pages evicted from a small buffer pool, which reads its frames in place.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test26_readInto" << std::endl;
+  createRelationForward();
+  readIntoTests();
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Direct I/O Test
+// -----------------------------------------------------------------------------
+void test27_directIO()
+{
+  // Create the relation with direct I/O, in the aligned layout, build indexes on it with and without
+  // build threads, and write back a page whose next page number changed on disk. Then write a
+  // BlobFile with direct I/O through a small buffer pool and read it back with buffered I/O.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test27_directIO" << std::endl;
+  createRelationForward(relationSize, true);
+  directIOTests();
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Huge Pages Test
+// -----------------------------------------------------------------------------
+void test28_hugePages()
+{
+  // Map buffer pools with each kind of pages, pre-faulted by several threads, and write pages of a
+  // BlobFile through them and read them back.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test28_hugePages" << std::endl;
+  hugePagesTests(HUGEPAGES_NONE);
+  hugePagesTests(HUGEPAGES_TRANSPARENT);
+  hugePagesTests(HUGEPAGES_HUGETLB);
+}
+
+// -----------------------------------------------------------------------------
+// Memory-Mapped File Test
+// -----------------------------------------------------------------------------
+void test29_mmapFile()
+{
+  // Build indexes opened mapped, with and without build threads, and open them again mapped and
+  // not. Pin pages of a MmapFile through the buffer pool, and check that every write is rejected.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test29_mmapFile" << std::endl;
+  createRelationForward();
+  mmapFileTests();
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Per-File Frame Lists Test
+// -----------------------------------------------------------------------------
+void test30_fileFrames()
+{
+  // Write pages of two BlobFiles through a small buffer pool, so that frames move between the files,
+  // then flush one file and drop the other, and check what each one finds on disk.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test30_fileFrames" << std::endl;
+  fileFramesTests();
+}
+
+// -----------------------------------------------------------------------------
+// Coalesced Write-Back Test
+// -----------------------------------------------------------------------------
+void test31_writeBack()
+{
+  // Flush runs of consecutive dirty pages of a BlobFile, which are written by one vectored write
+  // each, and evict dirty pages through a small buffer pool, with every IOEngine backend.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test31_writeBack" << std::endl;
+  writeBackTests(IO_SYNC);
+  writeBackTests(IO_THREADS);
+  writeBackTests(IO_URING);
+}
+
+// -----------------------------------------------------------------------------
+// Free-Frame List Test
+// -----------------------------------------------------------------------------
+void test32_freeFrames()
+{
+  // Take frames from the free-frame list and give them back by flushing and disposing of pages,
+  // then read more pages than there are frames, so that the clock evicts victims in batches.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test32_freeFrames" << std::endl;
+  freeFramesTests();
+}
+
+// -----------------------------------------------------------------------------
+// Buffer Access Strategy Test
+// -----------------------------------------------------------------------------
+void test33_accessStrategy()
+{
+  // Read a few hot pages, then read a file larger than the buffer pool through a ring of frames, and
+  // scan the relation with and without one, and check which of the hot pages are still in the pool.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test33_accessStrategy" << std::endl;
+  createRelationForward();
+  accessStrategyTests();
+  deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// Buffer Pool Resize Test
+// -----------------------------------------------------------------------------
+void test34_resizePool()
+{
+  // Grow a buffer pool in use so that a whole file fits in it, then shrink it back while pages are
+  // pinned, dirty, or being prefetched, and check that no page is lost.
+  std::cout << "--------------------" << std::endl;
+	std::cout << "test34_resizePool" << std::endl;
+  resizePoolTests();
+}
+
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
 
-void createRelationForward(int relationSize)
+void createRelationForward(int relationSize, bool directIO)
 {
 	std::vector<RecordId> ridVec;
   // destroy any old copies of relation file
@@ -275,7 +835,7 @@ void createRelationForward(int relationSize)
 	{
 	}
 
-  file1 = new PageFile(relationName, true);
+  file1 = new PageFile(relationName, true, directIO);
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
@@ -491,7 +1051,2499 @@ void boundTests()
   checkPassFail(intScan(&index, -5000, GT, 10, LTE), 11)
   checkPassFail(intScan(&index, -5000, GT, 100, LT), 100)
 }
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+void batchTests()
+{
+  std::cout << "Create a B+ Tree index on the integer field and insert batches" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+  // the new keys relationSize .. 2 * relationSize - 1 point at the existing records,
+  // so that intScan can still fetch a record for every entry found
+  std::vector<RecordId> rids;
+  {
+    FileScan fscan(relationName, bufMgr);
+    try
+    {
+      RecordId scanRid;
+      while(1)
+      {
+        fscan.scanNext(scanRid);
+        rids.push_back(scanRid);
+      }
+    }
+    catch(EndOfFileException e)
+    {
+    }
+  }
+
+  // shuffle the new keys and insert them in batches of growing size
+  std::vector<int> keys(relationSize);
+  for(int i = 0; i < relationSize; i++)
+  {
+    keys[i] = relationSize + i;
+  }
+  for(int i = relationSize - 1; i > 0; i--)
+  {
+    std::swap(keys[i], keys[random() % (i + 1)]);
+  }
+  std::vector<RecordId> batchRids(relationSize);
+  for(int i = 0; i < relationSize; i++)
+  {
+    batchRids[i] = rids[keys[i] - relationSize];
+  }
+  int batchSize = 1;
+  for(int done = 0; done < relationSize; batchSize *= 4)
+  {
+    int n = std::min(batchSize, relationSize - done);
+    index.insertBatch(&keys[done], &batchRids[done], n);
+    done += n;
+  }
+
+  checkPassFail(intScan(&index,0,GTE,2 * relationSize,LT), 2 * relationSize)
+  checkPassFail(intScan(&index,relationSize - 10,GTE,relationSize + 10,LT), 20)
+  checkPassFail(intScan(&index,2 * relationSize - 5,GT,3 * relationSize,LT), 4)
+  checkPassFail(intScan(&index,300,GT,400,LT), 99)
+}
+
+void parallelBuildTests(int relationSize)
+{
+  std::cout << "Create a B+ Tree index on the integer field with 4 build threads" << std::endl;
+  IndexOptions options;
+  options.buildThreads = 4;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+  checkPassFail(intScan(&index,25,GT,40,LT), 14)
+  checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+  checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+  checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+  checkPassFail(intScan(&index,0,GT,1,LT), 0)
+  checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+  checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+
+  // the bulk loaded leaves are full, so inserting into them splits them
+  RecordId firstRid;
+  {
+    FileScan fscan(relationName, bufMgr);
+    fscan.scanNext(firstRid);
+  }
+  for(int i = relationSize; i < relationSize + 1000; i++)
+  {
+    int key = i;
+    index.insertEntry(&key, firstRid);
+  }
+  checkPassFail(intScan(&index,relationSize - 10,GTE,relationSize + 10,LT), 20)
+  checkPassFail(intScan(&index,0,GTE,relationSize + 1000,LT), relationSize + 1000)
+}
+
+void betreeTests(int relationSize)
+{
+  {
+    std::cout << "Create a B-epsilon Tree index on the integer field" << std::endl;
+    BeTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScan(&index,relationSize - 5,GT,relationSize + 5,LT), 4)
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+  }
+
+  // the messages still buffered when the index was closed are found again
+  std::cout << "Reopen the B-epsilon Tree index" << std::endl;
+  BeTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  checkPassFail(intScan(&index,300,GT,400,LT), 99)
+  checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+}
+
+void lsmTests(int relationSize)
+{
+  {
+    std::cout << "Create an LSM Tree index on the integer field with a memtable of 4096 entries" << std::endl;
+    IndexOptions options;
+    options.memtableSize = 4096;
+    LSMTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScan(&index,4242,GTE,4242,LTE), 1)
+    checkPassFail(intScan(&index,relationSize + 7,GTE,relationSize + 7,LTE), 0)
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+  }
+
+  // the memtable was written out when the index was closed
+  {
+    std::cout << "Reopen the LSM Tree index" << std::endl;
+    LSMTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(intScan(&index,300,GT,400,LT), 99)
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+  }
+
+  // with a memtable of one entry, every insert writes a run, and while a scan runs the merge
+  // started by the first runs can not be installed, so tier 0 runs pile up to more than the
+  // manifest can list. Once the scan ends, the inserts wait for the merges instead
+  const int scanInserts = LSMMAXRUNS + 100;
+  const int extra = scanInserts + 200;
+  {
+    std::cout << "Write more runs than the manifest lists while a merge is pending" << std::endl;
+    IndexOptions options;
+    options.memtableSize = 1;
+    LSMTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    // the new keys point at the first record, which intScan() reads
+    RecordId rid;
+    {
+      FileScan fscan(relationName, bufMgr);
+      fscan.scanNext(rid);
+    }
+    int low = 0;
+    int high = 10;
+    int mostRuns = 0;
+    index.startScan(&low, GTE, &high, LT);
+    for(int i = 0; i < scanInserts; i++)
+    {
+      int key = relationSize + i;
+      index.insertEntry(&key, rid);
+      mostRuns = std::max(mostRuns, index.getRunCount());
+    }
+    checkPassFail(mostRuns, LSMMAXRUNS)
+    index.endScan();
+    for(int i = scanInserts; i < extra; i++)
+    {
+      int key = relationSize + i;
+      index.insertEntry(&key, rid);
+      mostRuns = std::max(mostRuns, index.getRunCount());
+    }
+    checkPassFail(mostRuns, LSMMAXRUNS)
+    checkPassFail(intScan(&index,0,GTE,relationSize + extra,LT), relationSize + extra)
+  }
+
+  std::cout << "Reopen the LSM Tree index" << std::endl;
+  LSMTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  checkPassFail((int) (index.getRunCount() <= LSMMAXRUNS), 1)
+  checkPassFail(intScan(&index,relationSize,GTE,relationSize + extra,LT), extra)
+  checkPassFail(intScan(&index,0,GTE,relationSize + extra,LT), relationSize + extra)
+}
+
+void hashTests(int relationSize)
+{
+  RecordId firstRid;
+  {
+    FileScan fscan(relationName, bufMgr);
+    fscan.scanNext(firstRid);
+  }
+  {
+    std::cout << "Create a Hash index on the integer field" << std::endl;
+    HashIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+    // every key is found once, pointing at its record
+    int found = 0;
+    for(int i = 0; i < relationSize; i++)
+    {
+      found += hashLookup(&index, i, true);
+    }
+    checkPassFail(found, relationSize)
+    checkPassFail(hashLookup(&index, relationSize + 5, false), 0)
+
+    // the new keys point at the first record, they make the buckets split
+    for(int i = relationSize; i < 2 * relationSize; i++)
+    {
+      index.insertEntry(&i, firstRid);
+    }
+    found = 0;
+    for(int i = 0; i < 2 * relationSize; i++)
+    {
+      found += hashLookup(&index, i, false);
+    }
+    checkPassFail(found, 2 * relationSize)
+
+    // a key occurring more often than a bucket holds gets overflow pages
+    int key = 7;
+    for(int i = 0; i < 2000; i++)
+    {
+      index.insertEntry(&key, firstRid);
+    }
+    checkPassFail(hashLookup(&index, 7, false), 2001)
+    for(int i = 0; i < 2000; i++)
+    {
+      index.deleteEntry(&key, firstRid);
+    }
+    checkPassFail(hashLookup(&index, 7, true), 1)
+
+    bool thrown = false;
+    try
+    {
+      index.deleteEntry(&key, firstRid);
+    }
+    catch(NoSuchKeyFoundException e)
+    {
+      thrown = true;
+    }
+    checkPassFail(thrown, true)
+  }
+
+  std::cout << "Reopen the Hash index" << std::endl;
+  HashIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  int found = 0;
+  for(int i = 0; i < 2 * relationSize; i++)
+  {
+    found += hashLookup(&index, i, false);
+  }
+  checkPassFail(found, 2 * relationSize)
+}
+
+// Return the number of entries found for the key. If checkRecords is set, only the entries
+// pointing at a record with the key are counted.
+void countRankTests(int relationSize, int buildThreads)
+{
+  std::cout << "Create a B+ Tree index on the integer field with " << buildThreads << " build threads and count entries" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+  int low = 25, high = 40;
+  checkPassFail(index.countRange(&low, GT, &high, LT), 14)
+  low = 20; high = 35;
+  checkPassFail(index.countRange(&low, GTE, &high, LTE), 16)
+  low = -3; high = 3;
+  checkPassFail(index.countRange(&low, GT, &high, LT), 3)
+  low = 5; high = 5;
+  checkPassFail(index.countRange(&low, GT, &high, LT), 0)
+  low = 0; high = relationSize;
+  checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize)
+  low = 1000; high = 250000;
+  checkPassFail(index.countRange(&low, GTE, &high, LT), intScan(&index, 1000, GTE, 250000, LT))
+
+  checkPassFail(rankLookup(&index, 0), 0)
+  checkPassFail(rankLookup(&index, 123457), 123457)
+  checkPassFail(rankLookup(&index, relationSize - 1), relationSize - 1)
+  checkPassFail(rankLookup(&index, relationSize), -1)
+
+  // the odd keys relationSize + 1, relationSize + 3, ... and then the even keys in between are
+  // inserted, pointing at the first record. Every new key shifts the ranks of the larger keys.
+  RecordId firstRid;
+  {
+    FileScan fscan(relationName, bufMgr);
+    fscan.scanNext(firstRid);
+  }
+  for(int i = relationSize + 1; i < relationSize + 20000; i += 2)
+  {
+    index.insertEntry(&i, firstRid);
+  }
+  std::vector<int> keys;
+  std::vector<RecordId> rids;
+  for(int i = relationSize; i < relationSize + 20000; i += 2)
+  {
+    keys.push_back(i);
+    rids.push_back(firstRid);
+  }
+  index.insertBatch(&keys[0], &rids[0], keys.size());
+  low = relationSize - 10; high = relationSize + 10;
+  checkPassFail(index.countRange(&low, GT, &high, LTE), 20)
+  low = 0; high = relationSize + 20000;
+  checkPassFail(index.countRange(&low, GTE, &high, LT), relationSize + 20000)
+  checkPassFail(rankLookup(&index, 77777), 77777)
+  checkPassFail(rankLookup(&index, relationSize + 20000), -1)
+}
+
+void descendingScanTests(int relationSize, int buildThreads)
+{
+  std::cout << "Create a B+ Tree index on the integer field with " << buildThreads << " build threads and scan it descending" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+  checkPassFail(intScanDescending(&index,25,GT,40,LT,relationSize, true), 14)
+  checkPassFail(intScanDescending(&index,20,GTE,35,LTE,relationSize, true), 16)
+  checkPassFail(intScanDescending(&index,-3,GT,3,LT,relationSize, true), 3)
+  checkPassFail(intScanDescending(&index,996,GT,1001,LT,relationSize, true), 4)
+  checkPassFail(intScanDescending(&index,0,GT,1,LT,relationSize, true), 0)
+  checkPassFail(intScanDescending(&index,relationSize - 5,GT,relationSize + 5,LT,relationSize, true), 4)
+  checkPassFail(intScanDescending(&index,0,GTE,relationSize,LT,relationSize, true), relationSize)
+  // the top 10 entries only
+  checkPassFail(intScanDescending(&index,0,GTE,relationSize,LT,10, true), 10)
+
+  // the new keys relationSize .. relationSize + 19999 make the leaf pages split, on the
+  // insertBatch path, and they point at the first record
+  RecordId firstRid;
+  {
+    FileScan fscan(relationName, bufMgr);
+    fscan.scanNext(firstRid);
+  }
+  std::vector<int> keys;
+  std::vector<RecordId> rids;
+  for(int i = relationSize + 19999; i >= relationSize; i--)
+  {
+    keys.push_back(i);
+    rids.push_back(firstRid);
+  }
+  index.insertBatch(&keys[0], &rids[0], keys.size());
+  checkPassFail(intScanDescending(&index,relationSize - 10,GTE,relationSize + 10,LT,relationSize, false), 20)
+  checkPassFail(intScanDescending(&index,0,GTE,relationSize + 20000,LT,relationSize + 20000, false), relationSize + 20000)
+}
+
+int intScanDescending(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int limit, bool checkOrder)
+{
+  RecordId scanRid;
+
+  std::cout << "Descending scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << ", at most " << limit << " entries" << std::endl;
+
+  int numResults = 0;
+  try
+  {
+    index->startScan(&lowVal, lowOp, &highVal, highOp, DESCENDING);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  // the keys of the records found have to be strictly decreasing and within the range,
+  // unless the entries point at records with other keys
+  int lastKey = 0;
+  bool ordered = true;
+  while(numResults < limit)
+  {
+    try
+    {
+      index->scanNext(scanRid);
+    }
+    catch(IndexScanCompletedException e)
+    {
+      break;
+    }
+    Page *curPage;
+    bufMgr->readPage(file1, scanRid.page_number, curPage);
+    RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+    bufMgr->unPinPage(file1, scanRid.page_number, false);
+    if(checkOrder)
+    {
+      if((numResults > 0 && myRec.i >= lastKey) || myRec.i > highVal || myRec.i < lowVal ||
+         (myRec.i == highVal && highOp == LT) || (myRec.i == lowVal && lowOp == GT))
+      {
+        ordered = false;
+      }
+      lastKey = myRec.i;
+    }
+    numResults++;
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl << std::endl;
+
+  return ordered ? numResults : -1;
+}
+
+void multiRangeScanTests(int relationSize)
+{
+  std::cout << "Create a B+ Tree index on the integer field and scan several ranges at once" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+  std::vector<ScanRange> ranges;
+  ranges.push_back(ScanRange(25, GT, 40, LT));
+  ranges.push_back(ScanRange(40, GTE, 40, LTE));
+  ranges.push_back(ScanRange(50, GTE, 60, LTE));
+  ranges.push_back(ScanRange(996, GT, 1001, LT));
+  ranges.push_back(ScanRange(relationSize - 5, GT, relationSize + 5, LT));
+  checkPassFail(intMultiScan(&index, ranges), 14 + 1 + 11 + 4 + 4)
+
+  // an IN-list with keys close to each other, far from each other and missing
+  std::vector<ScanRange> keys;
+  keys.push_back(ScanRange(-7));
+  keys.push_back(ScanRange(3));
+  keys.push_back(ScanRange(4));
+  keys.push_back(ScanRange(700));
+  keys.push_back(ScanRange(50000));
+  keys.push_back(ScanRange(relationSize - 1));
+  keys.push_back(ScanRange(relationSize + 5));
+  checkPassFail(intMultiScan(&index, keys), 5)
+
+  // every 37th key, so that most of the leaf pages are visited
+  keys.clear();
+  for(int i = 0; i < relationSize; i += 37)
+  {
+    keys.push_back(ScanRange(i));
+  }
+  checkPassFail(intMultiScan(&index, keys), (relationSize + 36) / 37)
+
+  // none of the ranges has an entry
+  ranges.clear();
+  ranges.push_back(ScanRange(-20, GT, -10, LT));
+  ranges.push_back(ScanRange(5, GT, 6, LT));
+  ranges.push_back(ScanRange(relationSize, GTE, relationSize + 100, LT));
+  checkPassFail(intMultiScan(&index, ranges), 0)
+
+  // the ranges have to be sorted and must not overlap
+  ranges.clear();
+  ranges.push_back(ScanRange(20, GT, 30, LTE));
+  ranges.push_back(ScanRange(30, GTE, 40, LT));
+  int thrown = 0;
+  try
+  {
+    index.startMultiScan(ranges);
+  }
+  catch(BadScanrangeException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+}
+
+void coveringTests(int relationSize, int buildThreads)
+{
+  std::cout << "Create a covering B+ Tree index on the integer field including the double and string fields" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  options.includes.push_back(IncludeAttr(offsetof(tuple,d), DOUBLE));
+  options.includes.push_back(IncludeAttr(offsetof(tuple,s), STRING));
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+
+    checkPassFail(intCoveringScan(&index,0,GTE,relationSize,LT,ASCENDING), relationSize)
+    checkPassFail(intCoveringScan(&index,25,GT,40,LT,ASCENDING), 14)
+    checkPassFail(intCoveringScan(&index,100,GTE,200,LTE,DESCENDING), 101)
+
+    // the new keys relationSize .. relationSize + 4999 point at the existing records, and the
+    // included values are taken from those records
+    std::vector<RecordId> rids;
+    std::vector<std::string> records;
+    {
+      FileScan fscan(relationName, bufMgr);
+      try
+      {
+        RecordId scanRid;
+        while(1)
+        {
+          fscan.scanNext(scanRid);
+          rids.push_back(scanRid);
+          records.push_back(fscan.getRecord());
+        }
+      }
+      catch(EndOfFileException e)
+      {
+      }
+    }
+    for(int i = 0; i < 1000; i++)
+    {
+      int key = relationSize + i;
+      index.insertEntry(&key, rids[i], records[i].data());
+    }
+    std::vector<int> keys(4000);
+    std::vector<RecordId> batchRids(4000);
+    std::vector<const void*> batchRecords(4000);
+    for(int i = 0; i < 4000; i++)
+    {
+      keys[i] = relationSize + 1000 + (i * 7919) % 4000;
+      batchRids[i] = rids[keys[i] - relationSize];
+      batchRecords[i] = records[keys[i] - relationSize].data();
+    }
+    index.insertBatch(&keys[0], &batchRids[0], 4000, &batchRecords[0]);
+    checkPassFail(intCoveringScan(&index,relationSize - 10,GTE,relationSize + 5000,LT,ASCENDING), 5010)
+    checkPassFail(intCoveringScan(&index,relationSize + 3000,GT,relationSize + 3100,LT,DESCENDING), 99)
+
+    // a covering index needs the record to take the included values from
+    int thrown = 0;
+    try
+    {
+      int key = 2 * relationSize;
+      index.insertEntry(&key, rids[0]);
+    }
+    catch(BadIndexInfoException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+  }
+
+  // an existing index file keeps its included attributes
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(intCoveringScan(&index,0,GTE,relationSize + 5000,LT,ASCENDING), relationSize + 5000)
+  }
+  IndexOptions other;
+  other.includes.push_back(IncludeAttr(offsetof(tuple,d), DOUBLE));
+  int thrown = 0;
+  try
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, other);
+  }
+  catch(BadIndexInfoException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+}
+
+void asyncIOTests(IOBackend backend)
+{
+  std::cout << "Read and write pages through an IOEngine with backend " << backend << std::endl;
+  IOOptions options;
+  options.backend = backend;
+  // a short queue, so that requests wait for room in it
+  options.queueDepth = 4;
+  options.submitBatch = 3;
+  options.threads = 2;
+  BufMgr * pool = new BufMgr(32, options);
+  // io_uring falls back to threads on kernels without it
+  checkPassFail((int) (pool->getIOBackend() == backend || (backend == IO_URING && pool->getIOBackend() == IO_THREADS)), 1)
+
+  const std::string blobName = relationName + ".io";
+  const int pages = 100;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  std::vector<PageId> pageNos;
+  {
+    BlobFile blob(blobName, true);
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      int * words = reinterpret_cast<int *>(page);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    // the pages still dirty are written back through the IOEngine
+    pool->getIOStats().clear();
+    pool->flushFile(&blob);
+    checkPassFail((int) (pool->getIOStats().writes > 0), 1)
+
+    // prefetch more pages than there are frames, then read them all
+    pool->prefetch(&blob, pageNos);
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(&blob, pageNos[i], page);
+      int * words = reinterpret_cast<int *>(page);
+      matching += (words[0] == i && words[lastWord] == -i);
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    checkPassFail(matching, pages)
+
+    // every other page of the first half in one batch
+    std::vector<PageId> batch;
+    for(int i = 0; i < pages / 2; i += 2)
+    {
+      batch.push_back(pageNos[i]);
+    }
+    std::vector<Page *> read;
+    pool->readPages(&blob, batch, read);
+    matching = 0;
+    for(std::size_t j = 0; j < batch.size(); j++)
+    {
+      int * words = reinterpret_cast<int *>(read[j]);
+      matching += (words[0] == (int) (2 * j) && words[lastWord] == -(int) (2 * j));
+      pool->unPinPage(&blob, batch[j], false);
+    }
+    checkPassFail(matching, (int) batch.size())
+
+    // every read completed is in the latency histogram
+    IOStats & stats = pool->getIOStats();
+    std::uint64_t counted = 0;
+    for(int b = 0; b < IOLATENCYBUCKETS; b++)
+    {
+      counted += stats.readLatency[b];
+    }
+    checkPassFail((int) (stats.reads > 0 && counted == stats.reads), 1)
+    checkPassFail((int) (IOStats::percentile(stats.readLatency, 0.5) <= IOStats::percentile(stats.readLatency, 0.99)), 1)
+    pool->flushFile(&blob);
+  }
+  File::remove(blobName);
+
+  // the pages of a PageFile read through the IOEngine are the ones read
+  // through the file, and a page past its end is not read
+  std::vector<PageId> relationPages;
+  for(PageId pageNo = 1; pageNo <= 5; pageNo++)
+  {
+    relationPages.push_back(pageNo);
+  }
+  const PageId pastEnd = file1->getNumPages() + 10;
+  relationPages.push_back(pastEnd);
+  pool->prefetch(file1, relationPages);
+  int same = 0;
+  for(PageId pageNo = 1; pageNo <= 5; pageNo++)
+  {
+    Page * page;
+    pool->readPage(file1, pageNo, page);
+    Page direct = file1->readPage(pageNo);
+    same += (memcmp(page, &direct, Page::SIZE) == 0);
+    pool->unPinPage(file1, pageNo, false);
+  }
+  checkPassFail(same, 5)
+  int thrown = 0;
+  try
+  {
+    Page * page;
+    pool->readPage(file1, pastEnd, page);
+  }
+  catch(InvalidPageException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+  pool->flushFile(file1);
+  delete pool;
+}
+
+void readIntoTests()
+{
+  std::cout << "Read and allocate pages in place" << std::endl;
+  Page fresh;
+  const char * freshData = reinterpret_cast<const char *>(&fresh) + sizeof(PageHeader);
+
+  // the pages of the relation read in place are the ones returned by value
+  int same = 0;
+  for(PageId pageNo = 1; pageNo <= 5; pageNo++)
+  {
+    Page page;
+    memset(reinterpret_cast<char *>(&page), 0x5a, Page::SIZE);
+    file1->readPageInto(pageNo, page);
+    Page direct = file1->readPage(pageNo);
+    same += (memcmp(&page, &direct, Page::SIZE) == 0);
+  }
+  checkPassFail(same, 5)
+  int thrown = 0;
+  try
+  {
+    Page page;
+    file1->readPageInto(file1->getNumPages(), page);
+  }
+  catch(InvalidPageException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+
+  // a page allocated in place is initialized, whether it is new or comes from the free list
+  const std::string pageFileName = relationName + ".into";
+  try
+  {
+    File::remove(pageFileName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  {
+    PageFile pageFile = PageFile::create(pageFileName);
+    Page page;
+    PageId first;
+    PageId second;
+    memset(reinterpret_cast<char *>(&page), 0x5a, Page::SIZE);
+    pageFile.allocatePageInto(first, page);
+    checkPassFail((int) (page.page_number() == first && page.getFreeSpace() == Page::DATA_SIZE), 1)
+    checkPassFail(memcmp(reinterpret_cast<char *>(&page) + sizeof(PageHeader), freshData, Page::DATA_SIZE), 0)
+    pageFile.allocatePageInto(second, page);
+    RecordId rid = page.insertRecord("in place");
+    pageFile.writePage(second, page);
+    checkPassFail((int) (pageFile.readPage(second).getRecord(rid) == "in place"), 1)
+    pageFile.deletePage(first);
+    memset(reinterpret_cast<char *>(&page), 0x5a, Page::SIZE);
+    PageId reused;
+    pageFile.allocatePageInto(reused, page);
+    checkPassFail((int) reused, (int) first)
+    checkPassFail((int) (page.page_number() == first && page.getFreeSpace() == Page::DATA_SIZE), 1)
+  }
+  File::remove(pageFileName);
+
+  // a BlobFile page allocated in place is zeroed past its header, and pages are written back from
+  // the frames of a pool smaller than the file and read into them again
+  const std::string blobName = relationName + ".into";
+  {
+    BlobFile blob = BlobFile::create(blobName);
+    Page page;
+    PageId pageNo;
+    memset(reinterpret_cast<char *>(&page), 0x5a, Page::SIZE);
+    blob.allocatePageInto(pageNo, page);
+    checkPassFail(memcmp(&page, &fresh, Page::SIZE), 0)
+
+    const int pages = 20;
+    const int lastWord = Page::SIZE / sizeof(int) - 1;
+    BufMgr * pool = new BufMgr(3);
+    std::vector<PageId> pageNos;
+    for(int i = 0; i < pages; i++)
+    {
+      Page * framePage;
+      pool->allocPage(&blob, pageNo, framePage);
+      int * words = reinterpret_cast<int *>(framePage);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page * framePage;
+      pool->readPage(&blob, pageNos[i], framePage);
+      int * words = reinterpret_cast<int *>(framePage);
+      matching += (words[0] == i && words[lastWord] == -i);
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    checkPassFail(matching, pages)
+    pool->flushFile(&blob);
+    delete pool;
+  }
+  File::remove(blobName);
+}
+
+void directIOTests()
+{
+  std::cout << "Read and write pages with direct I/O" << std::endl;
+  checkPassFail((int) file1->alignedLayout(), 1)
+
+  // the relation is read through the buffer pool, and through streams by the build threads
+  for(int buildThreads = 0; buildThreads <= 4; buildThreads += 4)
+  {
+    {
+      IndexOptions options;
+      options.buildThreads = buildThreads;
+      BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+      checkPassFail(intScan(&index,25,GT,40,LT), 14)
+      checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+    }
+    File::remove(intIndexName);
+  }
+
+  // the layout is found when the file is opened, with or without direct I/O
+  const PageId lastPageNo = file1->getNumPages() - 1;
+  {
+    PageFile buffered = PageFile::open(relationName);
+    checkPassFail((int) (buffered.alignedLayout() && !buffered.directIO()), 1)
+    Page direct = file1->readPage(lastPageNo);
+    Page page = buffered.readPage(lastPageNo);
+    checkPassFail(memcmp(&page, &direct, Page::SIZE), 0)
+  }
+
+  // a page whose next page number changed on disk since it was read is written back with the new one
+  Page * lastPage;
+  bufMgr->readPage(file1, lastPageNo, lastPage);
+  checkPassFail((int) (reinterpret_cast<std::uintptr_t>(lastPage) % File::DIRECT_ALIGNMENT), 0)
+  bufMgr->unPinPage(file1, lastPageNo, true);
+  PageId appendedPageNo;
+  file1->allocatePage(appendedPageNo);
+  bufMgr->flushFile(file1);
+  checkPassFail((int) file1->readPage(lastPageNo).next_page_number(), (int) appendedPageNo)
+
+  // a file with the other layout is never read with direct I/O
+  const std::string legacyName = relationName + ".legacy";
+  try
+  {
+    File::remove(legacyName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  {
+    BlobFile::create(legacyName);
+    BlobFile legacy = BlobFile::open(legacyName, true);
+    checkPassFail((int) (legacy.alignedLayout() || legacy.directIO()), 0)
+  }
+  File::remove(legacyName);
+
+  const std::string blobName = relationName + ".direct";
+  const int pages = 40;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  std::vector<PageId> pageNos;
+  {
+    BlobFile blob = BlobFile::create(blobName, true);
+    BufMgr * pool = new BufMgr(8);
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      int * words = reinterpret_cast<int *>(page);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    pool->flushFile(&blob);
+    delete pool;
+  }
+  {
+    BlobFile blob = BlobFile::open(blobName);
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page page = blob.readPage(pageNos[i]);
+      int * words = reinterpret_cast<int *>(&page);
+      matching += (words[0] == i && words[lastWord] == -i);
+    }
+    checkPassFail(matching, pages)
+  }
+  File::remove(blobName);
+}
+
+void hugePagesTests(HugePages hugePages)
+{
+  std::cout << "Map a buffer pool with pages " << hugePages << std::endl;
+  const std::uint32_t frames = 768;
+  const std::size_t hugePageSize = 2 << 20;
+  PoolOptions poolOptions;
+  poolOptions.hugePages = hugePages;
+  poolOptions.prefaultThreads = 3;
+  BufMgr * pool = new BufMgr(frames, IOOptions(), poolOptions);
+  // reserved huge pages fall back to transparent ones on kernels without any
+  checkPassFail((int) (pool->getPoolPages() == hugePages || (hugePages == HUGEPAGES_HUGETLB && pool->getPoolPages() == HUGEPAGES_TRANSPARENT)), 1)
+  if(hugePages != HUGEPAGES_NONE)
+  {
+    checkPassFail((int) (reinterpret_cast<std::uintptr_t>(pool->bufPool) % hugePageSize), 0)
+  }
+  // whether the kernel backs the pool with huge pages depends on its settings, but only whole ones
+  const std::size_t hugeBytes = pool->getHugePageBytes();
+  checkPassFail((int) (hugeBytes % hugePageSize == 0 && hugeBytes <= (frames * Page::SIZE + hugePageSize - 1) / hugePageSize * hugePageSize), 1)
+
+  // every frame has been constructed by the threads which pre-faulted it
+  std::uint32_t empty = 0;
+  for(std::uint32_t i = 0; i < frames; i++)
+  {
+    empty += (pool->bufPool[i].getFreeSpace() == Page::DATA_SIZE);
+  }
+  checkPassFail((int) empty, (int) frames)
+
+  const std::string blobName = relationName + ".huge";
+  const int pages = 1000;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  {
+    BlobFile blob = BlobFile::create(blobName);
+    std::vector<PageId> pageNos;
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      int * words = reinterpret_cast<int *>(page);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(&blob, pageNos[i], page);
+      int * words = reinterpret_cast<int *>(page);
+      matching += (words[0] == i && words[lastWord] == -i);
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    checkPassFail(matching, pages)
+    pool->flushFile(&blob);
+  }
+  File::remove(blobName);
+  delete pool;
+}
+
+void mmapFileTests()
+{
+  std::cout << "Read an index file through a memory mapping" << std::endl;
+  for(int buildThreads = 0; buildThreads <= 4; buildThreads += 4)
+  {
+    IndexOptions options;
+    options.buildThreads = buildThreads;
+    options.mmapIndex = true;
+    {
+      BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+      checkPassFail(intScan(&index,25,GT,40,LT), 14)
+      checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+      checkPassFail((int) bufMgr->getMappedPinned(), 0)
+      IndexStatistics stats;
+      index.getStatistics(stats);
+      checkPassFail((int) stats.entryCount, relationSize)
+
+      // inserts and compaction are rejected before any page is touched
+      int thrown = 0;
+      try
+      {
+        int key = relationSize;
+        RecordId rid = {1, 1};
+        index.insertEntry(&key, rid);
+      }
+      catch(ReadOnlyFileException e)
+      {
+        thrown = 1;
+      }
+      checkPassFail(thrown, 1)
+      thrown = 0;
+      try
+      {
+        index.compact();
+      }
+      catch(ReadOnlyFileException e)
+      {
+        thrown = 1;
+      }
+      checkPassFail(thrown, 1)
+    }
+    // the existing index file is opened mapped, and buffered again
+    {
+      BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+      checkPassFail(intScan(&index,0,GTE,20,LT), 20)
+    }
+    {
+      BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+      checkPassFail(intScan(&index,relationSize - 10,GTE,relationSize,LT), 10)
+    }
+    if(buildThreads == 0)
+    {
+      File::remove(intIndexName);
+    }
+  }
+
+  // the pages of a mapped file are pinned where they lie in the mapping, and only counted
+  {
+    MmapFile mapped = MmapFile::open(intIndexName);
+    BlobFile blob = BlobFile::open(intIndexName);
+    const PageId lastPageNo = mapped.getNumPages() - 1;
+    Page * page;
+    Page * again;
+    bufMgr->readPage(&mapped, lastPageNo, page);
+    bufMgr->readPage(&mapped, lastPageNo, again);
+    checkPassFail((int) (page == mapped.mappedPage(lastPageNo) && again == page), 1)
+    checkPassFail((int) bufMgr->getMappedPinned(), 1)
+    Page copy = blob.readPage(lastPageNo);
+    checkPassFail(memcmp(&copy, page, Page::SIZE), 0)
+
+    int thrown = 0;
+    try
+    {
+      bufMgr->flushFile(&mapped);
+    }
+    catch(PagePinnedException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    bufMgr->unPinPage(&mapped, lastPageNo, false);
+    thrown = 0;
+    try
+    {
+      bufMgr->unPinPage(&mapped, lastPageNo, true);
+    }
+    catch(ReadOnlyFileException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    thrown = 0;
+    try
+    {
+      bufMgr->unPinPage(&mapped, lastPageNo, false);
+    }
+    catch(PageNotPinnedException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    checkPassFail((int) bufMgr->getMappedPinned(), 0)
+    bufMgr->flushFile(&mapped);
+
+    // every write is rejected, and pages past the mapping do not exist
+    thrown = 0;
+    try
+    {
+      PageId pageNo;
+      bufMgr->allocPage(&mapped, pageNo, page);
+    }
+    catch(ReadOnlyFileException e)
+    {
+      thrown++;
+    }
+    try
+    {
+      mapped.writePage(lastPageNo, copy);
+    }
+    catch(ReadOnlyFileException e)
+    {
+      thrown++;
+    }
+    try
+    {
+      bufMgr->disposePage(&mapped, lastPageNo);
+    }
+    catch(ReadOnlyFileException e)
+    {
+      thrown++;
+    }
+    try
+    {
+      mapped.readPage(lastPageNo + 1);
+    }
+    catch(InvalidPageException e)
+    {
+      thrown++;
+    }
+    checkPassFail(thrown, 4)
+
+    // pages written through another File object show through the mapping
+    int * words = reinterpret_cast<int *>(&copy);
+    words[Page::SIZE / sizeof(int) - 1] ^= -1;
+    blob.writePage(lastPageNo, copy);
+    checkPassFail(memcmp(&copy, mapped.mappedPage(lastPageNo), Page::SIZE), 0)
+    words[Page::SIZE / sizeof(int) - 1] ^= -1;
+    blob.writePage(lastPageNo, copy);
+  }
+
+  // a PageFile is mapped with its own layout
+  {
+    bufMgr->flushFile(file1);
+    MmapFile mapped = MmapFile::open(relationName);
+    const PageId pageNo = file1->getFirstPageNo();
+    Page page = file1->readPage(pageNo);
+    Page copy = mapped.readPage(pageNo);
+    checkPassFail(memcmp(&copy, &page, Page::SIZE), 0)
+  }
+  File::remove(intIndexName);
+}
+
+void fileFramesTests()
+{
+  std::cout << "Keep the frames of each file in a list of their own" << std::endl;
+  const std::uint32_t frames = 50;
+  const int pages = 120;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  const std::string names[2] = {relationName + ".frames0", relationName + ".frames1"};
+  for(int f = 0; f < 2; f++)
+  {
+    try
+    {
+      File::remove(names[f]);
+    }
+    catch(FileNotFoundException e)
+    {
+    }
+  }
+  BufMgr * pool = new BufMgr(frames);
+  {
+    BlobFile blobs[2] = {BlobFile::create(names[0]), BlobFile::create(names[1])};
+    std::vector<PageId> pageNos[2];
+    for(int i = 0; i < pages; i++)
+    {
+      for(int f = 0; f < 2; f++)
+      {
+        PageId pageNo;
+        Page * page;
+        pool->allocPage(&blobs[f], pageNo, page);
+        int * words = reinterpret_cast<int *>(page);
+        words[0] = f;
+        words[lastWord] = i;
+        pool->unPinPage(&blobs[f], pageNo, true);
+        pageNos[f].push_back(pageNo);
+      }
+    }
+    // random reads move frames between the files, and every frame stays on the list of one
+    srand(30);
+    for(int i = 0; i < 1000; i++)
+    {
+      const int f = rand() % 2;
+      const PageId pageNo = pageNos[f][rand() % pages];
+      Page * page;
+      pool->readPage(&blobs[f], pageNo, page);
+      pool->unPinPage(&blobs[f], pageNo, rand() % 4 == 0);
+    }
+    checkPassFail((int) (pool->getFileFrames(&blobs[0]) + pool->getFileFrames(&blobs[1])), (int) frames)
+
+    // a pinned page stops the flush before anything is written
+    Page * pinned;
+    pool->readPage(&blobs[0], pageNos[0][0], pinned);
+    int thrown = 0;
+    try
+    {
+      pool->flushFile(&blobs[0]);
+    }
+    catch(PagePinnedException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    pool->unPinPage(&blobs[0], pageNos[0][0], false);
+
+    const std::uint32_t others = pool->getFileFrames(&blobs[1]);
+    pool->flushFile(&blobs[0]);
+    checkPassFail((int) pool->getFileFrames(&blobs[0]), 0)
+    checkPassFail((int) pool->getFileFrames(&blobs[1]), (int) others)
+
+    // a change of the second file is dropped with its frames
+    Page * page;
+    const PageId lastPageNo = pageNos[1][pages - 1];
+    pool->readPage(&blobs[1], lastPageNo, page);
+    const int stored = reinterpret_cast<int *>(page)[lastWord];
+    reinterpret_cast<int *>(page)[lastWord] = -1;
+    pool->unPinPage(&blobs[1], lastPageNo, true);
+    pool->dropFile(&blobs[1]);
+    checkPassFail((int) pool->getFileFrames(&blobs[1]), 0)
+    Page dropped = blobs[1].readPage(lastPageNo);
+    checkPassFail(reinterpret_cast<int *>(&dropped)[lastWord], stored)
+
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page copy = blobs[0].readPage(pageNos[0][i]);
+      int * words = reinterpret_cast<int *>(&copy);
+      matching += (words[0] == 0 && words[lastWord] == i);
+    }
+    checkPassFail(matching, pages)
+  }
+  delete pool;
+  File::remove(names[0]);
+  File::remove(names[1]);
+}
+
+void writeBackTests(IOBackend backend)
+{
+  std::cout << "Write back sorted and coalesced pages with backend " << backend << std::endl;
+  IOOptions options;
+  options.backend = backend;
+  // a short queue, so that the runs wait for room in it
+  options.queueDepth = 4;
+  options.submitBatch = 3;
+  options.threads = 2;
+  const int pages = 200;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  const std::string blobName = relationName + ".writeback";
+  try
+  {
+    File::remove(blobName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  std::vector<PageId> pageNos;
+  {
+    BlobFile blob = BlobFile::create(blobName);
+    BufMgr * pool = new BufMgr(256, options);
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      int * words = reinterpret_cast<int *>(page);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    // all the pages are consecutive, and written by runs of 64
+    pool->getIOStats().clear();
+    pool->flushFile(&blob);
+    checkPassFail((int) pool->getIOStats().writes, (pages + 63) / 64)
+
+    // two pages out of three are dirty, in runs of two, changed in an order other than the file's
+    int dirty = 0;
+    for(int i = pages - 1; i >= 0; i--)
+    {
+      Page * page;
+      pool->readPage(&blob, pageNos[i], page);
+      if(i % 3 != 2)
+      {
+        reinterpret_cast<int *>(page)[1] = 7 * i;
+        dirty++;
+      }
+      pool->unPinPage(&blob, pageNos[i], i % 3 != 2);
+    }
+    pool->getIOStats().clear();
+    pool->flushFile(&blob);
+    checkPassFail((int) pool->getIOStats().writes, (pages + 2) / 3)
+    delete pool;
+
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page page = blob.readPage(pageNos[i]);
+      int * words = reinterpret_cast<int *>(&page);
+      matching += (words[0] == i && words[lastWord] == -i && words[1] == (i % 3 != 2 ? 7 * i : 0));
+    }
+    checkPassFail(matching, pages)
+    checkPassFail(dirty, pages - pages / 3)
+  }
+  File::remove(blobName);
+
+  // the frames evicted take the dirty frames after them along, in fewer writes than pages
+  {
+    BlobFile blob = BlobFile::create(blobName);
+    BufMgr * pool = new BufMgr(24, options);
+    pageNos.clear();
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      int * words = reinterpret_cast<int *>(page);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    pool->flushFile(&blob);
+    checkPassFail((int) (pool->getIOStats().writes < (std::uint64_t) pages / 4), 1)
+    delete pool;
+
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page page = blob.readPage(pageNos[i]);
+      int * words = reinterpret_cast<int *>(&page);
+      matching += (words[0] == i && words[lastWord] == -i);
+    }
+    checkPassFail(matching, pages)
+  }
+  File::remove(blobName);
+}
+
+void freeFramesTests()
+{
+  std::cout << "Allocate frames from the free-frame list and evict victims in batches" << std::endl;
+  const std::uint32_t frames = 640;
+  const int pages = 2000;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  const std::string fileName = relationName + ".free";
+  try
+  {
+    File::remove(fileName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  BufMgr * pool = new BufMgr(frames);
+  checkPassFail((int) pool->getFreeFrames(), (int) frames)
+  {
+    PageFile file = PageFile::create(fileName);
+    std::vector<PageId> pageNos;
+    for(int i = 0; i < 100; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&file, pageNo, page);
+      pool->unPinPage(&file, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    checkPassFail((int) pool->getFreeFrames(), (int) frames - 100)
+
+    // a page disposed of gives its frame back, and so does a page which can not be read
+    pool->disposePage(&file, pageNos[0]);
+    checkPassFail((int) pool->getFreeFrames(), (int) frames - 99)
+    int thrown = 0;
+    try
+    {
+      Page * page;
+      pool->readPage(&file, pageNos[0], page);
+    }
+    catch(InvalidPageException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    checkPassFail((int) pool->getFreeFrames(), (int) frames - 99)
+    pool->flushFile(&file);
+    checkPassFail((int) pool->getFreeFrames(), (int) frames)
+  }
+  File::remove(fileName);
+
+  {
+    BlobFile blob = BlobFile::create(fileName);
+    std::vector<PageId> pageNos;
+    for(int i = 0; i < pages; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      int * words = reinterpret_cast<int *>(page);
+      words[0] = i;
+      words[lastWord] = -i;
+      pool->unPinPage(&blob, pageNo, true);
+      pageNos.push_back(pageNo);
+    }
+    // no frame is pinned, so every sweep finds a whole batch of victims
+    BufStats & stats = pool->getBufStats();
+    checkPassFail((int) (stats.sweeps > 0 && stats.evictions == stats.sweeps * (int) (frames / 64)), 1)
+    checkPassFail((int) (stats.evictions >= pages - (int) frames && stats.longestSweep <= 2 * (int) frames), 1)
+
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(&blob, pageNos[i], page);
+      int * words = reinterpret_cast<int *>(page);
+      matching += (words[0] == i && words[lastWord] == -i);
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    checkPassFail(matching, pages)
+    pool->flushFile(&blob);
+    checkPassFail((int) pool->getFreeFrames(), (int) frames)
+  }
+  File::remove(fileName);
+  delete pool;
+
+  // with every frame pinned, there is no victim
+  pool = new BufMgr(10);
+  {
+    BlobFile blob = BlobFile::create(fileName);
+    std::vector<PageId> pageNos;
+    for(int i = 0; i < 10; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      pageNos.push_back(pageNo);
+    }
+    int thrown = 0;
+    try
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+    }
+    catch(BufferExceededException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    for(int i = 0; i < 10; i++)
+    {
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    pool->flushFile(&blob);
+  }
+  File::remove(fileName);
+  delete pool;
+
+  // with all but one or two frames pinned, a sweep finds fewer victims than a batch, and must
+  // not take the ones it found again on its second revolution
+  pool = new BufMgr(128);
+  {
+    BlobFile blob = BlobFile::create(fileName);
+    std::vector<PageId> pageNos;
+    for(int i = 0; i < 128; i++)
+    {
+      PageId pageNo;
+      Page * page;
+      pool->allocPage(&blob, pageNo, page);
+      pageNos.push_back(pageNo);
+    }
+    // the pages before the first one still pinned are unpinned, and evicted
+    std::size_t firstPinned = 0;
+    int cycles = 0;
+    int thrown = 0;
+    try
+    {
+      for(int i = 0; i < 200; i++)
+      {
+        // one page unpinned and allocated at a time, then two
+        const int unpinned = 1 + i % 2;
+        for(int j = 0; j < unpinned; j++)
+        {
+          pool->unPinPage(&blob, pageNos[firstPinned++], j == 0);
+        }
+        for(int j = 0; j < unpinned; j++)
+        {
+          PageId pageNo;
+          Page * page;
+          pool->allocPage(&blob, pageNo, page);
+          pageNos.push_back(pageNo);
+        }
+        cycles++;
+      }
+    }
+    catch(HashNotFoundException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 0)
+    checkPassFail(cycles, 200)
+    checkPassFail((int) pool->getFreeFrames(), 0)
+    checkPassFail((int) (pageNos.size() - firstPinned), 128)
+    for(std::size_t i = firstPinned; i < pageNos.size(); i++)
+    {
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    pool->flushFile(&blob);
+  }
+  File::remove(fileName);
+  delete pool;
+}
+
+// Read the pages of a file through a buffer pool, and return the number of them which were not in it.
+int readMissing(BufMgr * pool, File * file, const std::vector<PageId> & pageNos)
+{
+  const int before = pool->getBufStats().diskreads;
+  for(std::size_t i = 0; i < pageNos.size(); i++)
+  {
+    Page * page;
+    pool->readPage(file, pageNos[i], page);
+    pool->unPinPage(file, pageNos[i], false);
+  }
+  return pool->getBufStats().diskreads - before;
+}
+
+void accessStrategyTests()
+{
+  std::cout << "Read pages in bulk through a ring of frames" << std::endl;
+  const int hotPages = 40;
+  const int coldPages = 400;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  const std::string hotName = relationName + ".hot";
+  const std::string coldName = relationName + ".cold";
+  for(int f = 0; f < 2; f++)
+  {
+    try
+    {
+      File::remove(f ? coldName : hotName);
+    }
+    catch(FileNotFoundException e)
+    {
+    }
+  }
+  std::vector<PageId> hotPageNos;
+  BufMgr * pool = new BufMgr(64);
+  {
+    BlobFile hot = BlobFile::create(hotName);
+    BlobFile cold = BlobFile::create(coldName);
+    std::vector<PageId> coldPageNos;
+    const PageId firstHot = hot.allocatePageRange(hotPages);
+    const PageId firstCold = cold.allocatePageRange(coldPages);
+    Page page;
+    int * words = reinterpret_cast<int *>(&page);
+    for(int i = 0; i < hotPages; i++)
+    {
+      words[0] = i;
+      words[lastWord] = -i;
+      hot.writePage(firstHot + i, page);
+      hotPageNos.push_back(firstHot + i);
+    }
+    for(int i = 0; i < coldPages; i++)
+    {
+      words[0] = i;
+      words[lastWord] = -i;
+      cold.writePage(firstCold + i, page);
+      coldPageNos.push_back(firstCold + i);
+    }
+    std::vector<PageId> someHotPageNos(hotPageNos.begin(), hotPageNos.begin() + 24);
+    checkPassFail(readMissing(pool, &hot, someHotPageNos), 24)
+
+    // a scan through a ring of 8 frames reuses them, and leaves the hot pages in the pool
+    {
+      BufferAccessStrategy ring(8);
+      const int before = pool->getBufStats().diskreads;
+      int matching = 0;
+      for(int i = 0; i < coldPages; i++)
+      {
+        Page * coldPage;
+        pool->readPage(&cold, coldPageNos[i], coldPage, &ring);
+        int * coldWords = reinterpret_cast<int *>(coldPage);
+        matching += (coldWords[0] == i && coldWords[lastWord] == -i);
+        pool->unPinPage(&cold, coldPageNos[i], false);
+      }
+      checkPassFail(matching, coldPages)
+      checkPassFail(pool->getBufStats().diskreads - before, coldPages)
+      checkPassFail((int) ring.getReused(), coldPages - 8)
+      checkPassFail((int) pool->getFreeFrames(), 64 - 24 - 8)
+    }
+    checkPassFail(readMissing(pool, &hot, someHotPageNos), 0)
+
+    // a frame of the ring which is still pinned is not reused
+    {
+      BufferAccessStrategy ring(2);
+      Page * pinned;
+      pool->readPage(&cold, coldPageNos[0], pinned, &ring);
+      std::vector<PageId> next(coldPageNos.begin() + 1, coldPageNos.begin() + 4);
+      for(std::size_t i = 0; i < next.size(); i++)
+      {
+        Page * coldPage;
+        pool->readPage(&cold, next[i], coldPage, &ring);
+        pool->unPinPage(&cold, next[i], false);
+      }
+      checkPassFail((int) ring.getReused(), 1)
+      checkPassFail(reinterpret_cast<int *>(pinned)[0], 0)
+      pool->unPinPage(&cold, coldPageNos[0], false);
+    }
+
+    // the same scan without a strategy pushes the hot pages out
+    pool->flushFile(&cold);
+    checkPassFail(readMissing(pool, &cold, coldPageNos), coldPages)
+    checkPassFail((int) (readMissing(pool, &hot, someHotPageNos) > 0), 1)
+    pool->flushFile(&cold);
+    pool->flushFile(&hot);
+  }
+  delete pool;
+
+  // a FileScan reads the relation through a ring by default
+  pool = new BufMgr(80);
+  {
+    BlobFile hot = BlobFile::open(hotName);
+    checkPassFail(readMissing(pool, &hot, hotPageNos), hotPages)
+    int records = 0;
+    {
+      FileScan scan(relationName, pool);
+      try
+      {
+        RecordId rid;
+        while(1)
+        {
+          scan.scanNext(rid);
+          records++;
+        }
+      }
+      catch(EndOfFileException e)
+      {
+      }
+    }
+    checkPassFail(records, relationSize)
+    checkPassFail(readMissing(pool, &hot, hotPageNos), 0)
+    checkPassFail((int) pool->getFreeFrames(), 80 - hotPages)
+    pool->flushFile(&hot);
+  }
+  delete pool;
+  File::remove(hotName);
+  File::remove(coldName);
+}
+
+void resizePoolTests()
+{
+  std::cout << "Grow and shrink the buffer pool while it is in use" << std::endl;
+  const int pages = 600;
+  const int lastWord = Page::SIZE / sizeof(int) - 1;
+  const std::string fileName = relationName + ".resize";
+  try
+  {
+    File::remove(fileName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+  PoolOptions poolOptions;
+  poolOptions.maxFrames = 1024;
+  BufMgr * pool = new BufMgr(64, IOOptions(), poolOptions);
+  checkPassFail((int) pool->getNumBufs(), 64)
+  checkPassFail((int) pool->getMaxBufs(), 1024)
+  {
+    BlobFile blob = BlobFile::create(fileName);
+    std::vector<PageId> pageNos;
+    const PageId first = blob.allocatePageRange(pages);
+    Page empty;
+    int * words = reinterpret_cast<int *>(&empty);
+    for(int i = 0; i < pages; i++)
+    {
+      words[0] = i;
+      words[lastWord] = -i;
+      blob.writePage(first + i, empty);
+      pageNos.push_back(first + i);
+    }
+    checkPassFail(readMissing(pool, &blob, pageNos), pages)
+    checkPassFail((int) pool->getFreeFrames(), 0)
+
+    // once grown, the pool holds the whole file, and keeps the pages it held
+    pool->resize(1024);
+    checkPassFail((int) pool->getNumBufs(), 1024)
+    checkPassFail((int) pool->getFreeFrames(), 1024 - 64)
+    checkPassFail(readMissing(pool, &blob, pageNos), pages - 64)
+    checkPassFail(readMissing(pool, &blob, pageNos), 0)
+
+    // the pool is not shrunk while a page it would drop is pinned
+    std::vector<Page *> pinned;
+    pool->readPages(&blob, pageNos, pinned);
+    int thrown = 0;
+    try
+    {
+      pool->resize(100);
+    }
+    catch(PagePinnedException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+    checkPassFail((int) pool->getNumBufs(), 1024)
+    checkPassFail((int) pool->getFileFrames(&blob), pages)
+
+    // the dirty pages it drops are written back first
+    for(int i = 0; i < pages; i++)
+    {
+      reinterpret_cast<int *>(pinned[i])[1] = 2 * i;
+      pool->unPinPage(&blob, pageNos[i], true);
+    }
+    const int writes = pool->getBufStats().diskwrites;
+    pool->resize(100);
+    checkPassFail((int) pool->getNumBufs(), 100)
+    checkPassFail(pool->getBufStats().diskwrites - writes, pages - 100)
+    checkPassFail((int) pool->getFileFrames(&blob), 100)
+    checkPassFail((int) pool->getFreeFrames(), 0)
+    pool->flushFile(&blob);
+    checkPassFail((int) pool->getFreeFrames(), 100)
+
+    // the prefetches in flight into the frames dropped complete first
+    pool->resize(300);
+    std::vector<PageId> prefetched(pageNos.begin(), pageNos.begin() + 300);
+    pool->prefetch(&blob, prefetched);
+    pool->resize(50);
+    checkPassFail((int) (pool->getFileFrames(&blob) <= 50), 1)
+
+    int matching = 0;
+    for(int i = 0; i < pages; i++)
+    {
+      Page * page;
+      pool->readPage(&blob, pageNos[i], page);
+      int * pageWords = reinterpret_cast<int *>(page);
+      matching += (pageWords[0] == i && pageWords[1] == 2 * i && pageWords[lastWord] == -i);
+      pool->unPinPage(&blob, pageNos[i], false);
+    }
+    checkPassFail(matching, pages)
+
+    for(int bufs = 0; bufs <= 1025; bufs += 1025)
+    {
+      thrown = 0;
+      try
+      {
+        pool->resize(bufs);
+      }
+      catch(BadResizeException e)
+      {
+        thrown = 1;
+      }
+      checkPassFail(thrown, 1)
+    }
+    checkPassFail((int) pool->getNumBufs(), 50)
+    pool->flushFile(&blob);
+  }
+  delete pool;
+  File::remove(fileName);
+}
+
+void interpolationSearchTests(int buildThreads, bool compressLeaves)
+{
+  std::cout << "Create a B+ Tree index on the integer field searching its leaf pages by interpolation" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  options.compressLeaves = compressLeaves;
+  options.leafSearch = INTERPOLATION_SEARCH;
+  const int inserted = 200000;
+  const int clusterSize = 256;
+  const int clusterGap = 100000;
+  // ranges counted by both searches, with bounds in the clusters and in the gaps
+  std::vector<int> lows;
+  std::vector<int> highs;
+  srand(24);
+  for(int i = 0; i < 500; i++)
+  {
+    int low = rand() % (relationSize + inserted / clusterSize * clusterGap);
+    lows.push_back(low);
+    highs.push_back(low + rand() % (3 * clusterGap));
+  }
+  std::vector<int> counts;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,300,GT,400,LT), 99)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScanDescending(&index,1000,GT,3000,LTE,relationSize,true), 2000)
+    std::vector<ScanRange> ranges;
+    ranges.push_back(ScanRange(25, GT, 40, LT));
+    ranges.push_back(ScanRange(40, GTE, 40, LTE));
+    ranges.push_back(ScanRange(996, GT, 1001, LT));
+    checkPassFail(intMultiScan(&index, ranges), 14 + 1 + 4)
+    int low = 1234;
+    int high = 4321;
+    checkPassFail(index.countRange(&low,GT,&high,LTE), 4321 - 1234)
+
+    std::vector<int> keys(inserted);
+    std::vector<RecordId> rids(inserted);
+    for(int i = 0; i < inserted; i++)
+    {
+      keys[i] = relationSize + i / clusterSize * clusterGap + i % clusterSize;
+      rids[i].page_number = 1 + (i / 50) % 40;
+      rids[i].slot_number = 1 + i % 50;
+    }
+    for(int i = 0; i < inserted; i += 10000)
+    {
+      index.insertBatch(&keys[i], &rids[i], 10000);
+    }
+    // every key is found, and none of the keys in the gaps
+    int found = 0;
+    int missing = 0;
+    for(int i = 0; i < inserted; i += 997)
+    {
+      found += intScan(&index,keys[i],GTE,keys[i],LTE);
+      missing += index.countRange(&keys[i],GT,&keys[i],LT);
+      int gap = relationSize + i / clusterSize * clusterGap + clusterSize;
+      missing += intScan(&index,gap,GTE,gap + clusterGap - clusterSize,LT);
+    }
+    checkPassFail(found, (inserted + 996) / 997)
+    checkPassFail(missing, 0)
+    checkPassFail(intScan(&index,relationSize,GTE,relationSize + 5 * clusterGap,LT), 5 * clusterSize)
+    for(std::size_t r = 0; r < lows.size(); r++)
+    {
+      counts.push_back(index.countRange(&lows[r],GTE,&highs[r],LT));
+    }
+  }
+
+  // binary search counts the same
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    int same = 0;
+    for(std::size_t r = 0; r < lows.size(); r++)
+    {
+      same += (index.countRange(&lows[r],GTE,&highs[r],LT) == counts[r]);
+    }
+    checkPassFail(same, (int) lows.size())
+  }
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+}
+
+void compressedLeavesTests(int buildThreads)
+{
+  std::cout << "Create a B+ Tree index on the integer field with compressed leaf pages" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  options.compressLeaves = true;
+  const int inserted = 600000;
+  IndexStatistics stats;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    // the keys and record ids of the whole relation fit into a few leaf pages
+    index.getStatistics(stats);
+    checkPassFail((int) (stats.leafCount <= 3), 1)
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,300,GT,400,LT), 99)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+    checkPassFail(intScanDescending(&index,1000,GTE,3000,LT,relationSize,true), 2000)
+    std::vector<ScanRange> ranges;
+    ranges.push_back(ScanRange(25, GT, 40, LT));
+    ranges.push_back(ScanRange(996, GT, 1001, LT));
+    ranges.push_back(ScanRange(relationSize - 5, GT, relationSize + 5, LT));
+    checkPassFail(intMultiScan(&index, ranges), 14 + 4 + 4)
+    // the record ids are decoded right
+    checkPassFail(rankLookup(&index, 0), 0)
+    checkPassFail(rankLookup(&index, 2345), 2345)
+    checkPassFail(rankLookup(&index, relationSize - 1), relationSize - 1)
+
+    std::vector<int> keys(inserted);
+    std::vector<RecordId> rids(inserted);
+    for(int i = 0; i < inserted; i++)
+    {
+      keys[i] = relationSize + i;
+      // record ids of the relation, so that the scans can read them
+      rids[i].page_number = 1 + (i / 50) % 40;
+      rids[i].slot_number = 1 + i % 50;
+    }
+    for(int i = 0; i < inserted; i += 10000)
+    {
+      index.insertBatch(&keys[i], &rids[i], 10000);
+    }
+    index.getStatistics(stats);
+    checkPassFail(stats.entryCount, relationSize + inserted)
+    checkPassFail(intScan(&index,0,GTE,relationSize + inserted,LT), relationSize + inserted)
+    checkPassFail(intScan(&index,relationSize + 123456,GTE,relationSize + 123466,LT), 10)
+    checkPassFail(intScanDescending(&index,relationSize + 300000,GT,relationSize + 310000,LTE,20000,false), 10000)
+    int low = 4000;
+    int high = relationSize + 300000;
+    checkPassFail(index.countRange(&low,GTE,&high,LT), relationSize + 300000 - 4000)
+    // a key of every leaf page
+    int found = 0;
+    for(int key = 0; key < relationSize + inserted; key += 337)
+    {
+      found += intScan(&index,key,GTE,key,LTE);
+    }
+    checkPassFail(found, (relationSize + inserted + 336) / 337)
+  }
+
+  // the leaf format is kept in the meta page, and the compacted tree gets it too
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(intScan(&index,relationSize - 10,GTE,relationSize + 10,LT), 20)
+    index.compact();
+    IndexStatistics compacted;
+    index.getStatistics(compacted);
+    checkPassFail((int) (compacted.leafCount <= stats.leafCount), 1)
+    checkPassFail(intScan(&index,0,GTE,relationSize + inserted,LT), relationSize + inserted)
+    checkPassFail(intScan(&index,relationSize + 500000,GT,relationSize + 500100,LTE), 100)
+    checkPassFail(rankLookup(&index, 2345), 2345)
+  }
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+
+  // compressed leaf pages have no room for included attributes
+  options.includes.push_back(IncludeAttr(offsetof(tuple,d), DOUBLE));
+  int thrown = 0;
+  try
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+  }
+  catch(BadIndexInfoException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+}
+
+void nodeLayoutTests(int buildThreads)
+{
+  std::cout << "Create a B+ Tree index on the integer field with the KEY_BLOCKS layout" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  options.nodeLayout = KEY_BLOCKS;
+  // sequential inserts leave the leaf pages half full, which gives more
+  // leaf pages than the root page holds
+  const int inserted = 600000;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+    checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+    checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+    checkPassFail(intScan(&index,0,GT,1,LT), 0)
+    checkPassFail(intScan(&index,300,GT,400,LT), 99)
+    checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+    std::vector<int> keys(inserted);
+    std::vector<RecordId> rids(inserted);
+    for(int i = 0; i < inserted; i++)
+    {
+      keys[i] = relationSize + i;
+      rids[i].page_number = 1;
+      rids[i].slot_number = 1;
+    }
+    for(int i = 0; i < inserted; i += 10000)
+    {
+      index.insertBatch(&keys[i], &rids[i], 10000);
+    }
+    IndexStatistics stats;
+    index.getStatistics(stats);
+    checkPassFail(stats.height, 3)
+    checkPassFail(intScan(&index,0,GTE,relationSize + inserted,LT), relationSize + inserted)
+    checkPassFail(intScan(&index,relationSize + 123456,GTE,relationSize + 123466,LT), 10)
+    int low = 4000;
+    int high = relationSize + 300000;
+    checkPassFail(index.countRange(&low,GTE,&high,LT), relationSize + 300000 - 4000)
+    // a key of every leaf page
+    int found = 0;
+    for(int key = 0; key < relationSize + inserted; key += 337)
+    {
+      found += intScan(&index,key,GTE,key,LTE);
+    }
+    checkPassFail(found, (relationSize + inserted + 336) / 337)
+  }
+
+  // the layout is kept in the meta page, and the bulk loaded tree gets it too
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(intScan(&index,relationSize - 10,GTE,relationSize + 10,LT), 20)
+    index.compact();
+    checkPassFail(intScan(&index,0,GTE,relationSize + inserted,LT), relationSize + inserted)
+    checkPassFail(intScan(&index,relationSize + 500000,GT,relationSize + 500100,LTE), 100)
+  }
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+}
+
+void compactionTests(int relationSize)
+{
+  std::cout << "Create a B+ Tree index on the integer field and compact it" << std::endl;
+  const int perLeaf = (int) (INTARRAYLEAFSIZE * 0.9);
+  IndexStatistics stats;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    index.getStatistics(stats);
+    checkPassFail(stats.height, 2)
+    int oldLeafCount = stats.leafCount;
+
+    // the scan started before the compaction keeps reading the leaf pages of the old tree
+    int lowVal = 1000;
+    int highVal = 3000;
+    RecordId scanRid;
+    int scanned = 0;
+    index.startScan(&lowVal, GTE, &highVal, LT);
+    for(; scanned < 500; scanned++)
+    {
+      index.scanNext(scanRid);
+    }
+    // the old tree is the root page and the leaf pages
+    checkPassFail(index.compact(0.9), oldLeafCount + 1)
+    try
+    {
+      while(1)
+      {
+        index.scanNext(scanRid);
+        scanned++;
+      }
+    }
+    catch(IndexScanCompletedException e)
+    {
+    }
+    index.endScan();
+    checkPassFail(scanned, 2000)
+
+    index.getStatistics(stats);
+    checkPassFail(stats.leafCount, (relationSize + perLeaf - 1) / perLeaf)
+    checkPassFail(stats.height, 2)
+    checkPassFail((int) (stats.fillFactor > 0.85 && stats.fillFactor <= 0.9), 1)
+    checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+    checkPassFail(intScan(&index,25,GT,40,LT), 14)
+    checkPassFail(intScan(&index,relationSize - 100,GTE,relationSize,LT), 100)
+    checkPassFail(index.countRange(&lowVal,GTE,&highVal,LT), 2000)
+    checkPassFail(intScanDescending(&index,lowVal,GTE,highVal,LT,relationSize,true), 2000)
+
+    // the free slots left by the fill factor take inserts
+    for(int i = relationSize; i < relationSize + 1000; i++)
+    {
+      RecordId newRid;
+      newRid.page_number = 1;
+      newRid.slot_number = 1;
+      index.insertEntry(&i, newRid);
+    }
+    checkPassFail(intScan(&index,0,GTE,relationSize + 1000,LT), relationSize + 1000)
+    index.getStatistics(stats);
+  }
+
+  // the new root is kept in the meta page
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    IndexStatistics reopened;
+    index.getStatistics(reopened);
+    checkPassFail(reopened.leafCount, stats.leafCount)
+    checkPassFail(intScan(&index,0,GTE,relationSize + 1000,LT), relationSize + 1000)
+
+    int thrown = 0;
+    try
+    {
+      index.compact(0);
+    }
+    catch(BadIndexInfoException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+
+    // compacting again fills the leaf pages up
+    index.compact();
+    index.getStatistics(reopened);
+    checkPassFail(reopened.leafCount, (relationSize + 1000 + INTARRAYLEAFSIZE - 1) / INTARRAYLEAFSIZE)
+    checkPassFail(intScan(&index,0,GTE,relationSize + 1000,LT), relationSize + 1000)
+  }
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+
+  // the included values of a covering index move along with the entries
+  IndexOptions options;
+  options.includes.push_back(IncludeAttr(offsetof(tuple,d), DOUBLE));
+  options.includes.push_back(IncludeAttr(offsetof(tuple,s), STRING));
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    index.compact(0.75);
+    checkPassFail(intCoveringScan(&index,0,GTE,relationSize,LT,ASCENDING), relationSize)
+    checkPassFail(intCoveringScan(&index,100,GTE,200,LTE,DESCENDING), 101)
+  }
+  try
+  {
+    File::remove(intIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+}
+
+void statisticsTests(int relationSize, int buildThreads)
+{
+  std::cout << "Create a B+ Tree index on the integer field and check its statistics" << std::endl;
+  IndexOptions options;
+  options.buildThreads = buildThreads;
+  IndexStatistics stats;
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+    index.getStatistics(stats);
+    checkPassFail((int) stats.entryCount, relationSize)
+    checkPassFail(stats.height, 2)
+    // a bottom up build fills up the leaf pages, inserts leave them at least half full
+    checkPassFail((int) (stats.fillFactor > (buildThreads > 0 ? 0.99 : 0.5) && stats.fillFactor <= 1), 1)
+    checkPassFail((int) (std::fabs(stats.distinctKeys - relationSize) < 0.05 * relationSize), 1)
+    checkPassFail(estimateWithin(&index,1000,GTE,31000,LT,30000,0.02), 1)
+    checkPassFail(estimateWithin(&index,500,GT,600,LTE,100,0.2), 1)
+    checkPassFail(estimateWithin(&index,-100,GT,-1,LTE,0,0), 1)
+
+    // the inserted keys relationSize .. relationSize + 19999 widen the last bucket
+    std::vector<int> keys(20000);
+    std::vector<RecordId> rids(20000);
+    for(int i = 0; i < 20000; i++)
+    {
+      keys[i] = relationSize + i;
+      rids[i].page_number = 1;
+      rids[i].slot_number = 1;
+    }
+    index.insertBatch(&keys[0], &rids[0], 10000);
+    for(int i = 10000; i < 20000; i++)
+    {
+      index.insertEntry(&keys[i], rids[i]);
+    }
+    index.getStatistics(stats);
+    checkPassFail((int) stats.entryCount, relationSize + 20000)
+    checkPassFail(estimateWithin(&index,relationSize,GTE,relationSize + 20000,LT,20000,0.05), 1)
+    checkPassFail((int) (std::fabs(stats.distinctKeys - relationSize - 20000) < 0.05 * (relationSize + 20000)), 1)
+
+    // the leaf count after the inserts is the one found by reading the leaf pages
+    int leafCount = stats.leafCount;
+    index.rebuildStatistics();
+    index.getStatistics(stats);
+    checkPassFail(stats.leafCount, leafCount)
+    checkPassFail(estimateWithin(&index,relationSize,GTE,relationSize + 20000,LT,20000,0.02), 1)
+  }
+
+  // the statistics are kept in the index file
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    IndexStatistics reopened;
+    index.getStatistics(reopened);
+    checkPassFail((int) reopened.entryCount, relationSize + 20000)
+    checkPassFail(reopened.leafCount, stats.leafCount)
+    checkPassFail(intScan(&index,relationSize - 5,GTE,relationSize + 5,LT), 10)
+  }
+
+  // an index file of another format, like one written before the statistics page was added, is not opened
+  {
+    BlobFile indexFile = BlobFile::open(intIndexName);
+    Page metaPage = indexFile.readPage(1);
+    ((IndexMetaInfo *) &metaPage) -> formatVersion = INDEXFORMATVERSION - 1;
+    indexFile.writePage(1, metaPage);
+  }
+  int thrown = 0;
+  try
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  }
+  catch(BadIndexInfoException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+
+  // the rejected file is left closed and untouched, so it opens again once its format is the current one
+  {
+    BlobFile indexFile = BlobFile::open(intIndexName);
+    Page metaPage = indexFile.readPage(1);
+    ((IndexMetaInfo *) &metaPage) -> formatVersion = INDEXFORMATVERSION;
+    indexFile.writePage(1, metaPage);
+  }
+  {
+    BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+    checkPassFail(intScan(&index,relationSize - 5,GTE,relationSize + 5,LT), 10)
+  }
+}
+
+int estimateWithin(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, int expected, double tolerance)
+{
+  double estimate = index->estimateRange(&lowVal, lowOp, &highVal, highOp);
+  std::cout << "Estimated " << estimate << " entries, expected " << expected << std::endl;
+  return std::fabs(estimate - expected) <= tolerance * expected + 1 ? 1 : 0;
+}
+
+void compositeTests(int relationSize)
+{
+  std::cout << "Create a B+ Tree index on the composite key (integer field, double field)" << std::endl;
+  std::vector<KeyAttr> keyAttrs;
+  keyAttrs.push_back(KeyAttr(offsetof(tuple,i), INTEGER));
+  keyAttrs.push_back(KeyAttr(offsetof(tuple,d), DOUBLE));
+  std::string compositeIndexName;
+  {
+    CompositeBTreeIndex index(relationName, compositeIndexName, bufMgr, keyAttrs);
+
+    checkPassFail(intDoubleScan(&index,100,0,GTE,200,0,LT,1), 100)
+    checkPassFail(intDoubleScan(&index,100,100,GT,200,200,LTE,2), 100)
+    checkPassFail(intDoubleScan(&index,0,0,GTE,relationSize,0,LT,1), relationSize)
+
+    // many entries sharing the leading attribute 7, and the same key (7, 7.0) three times
+    std::vector<RecordId> rids;
+    {
+      FileScan fscan(relationName, bufMgr);
+      try
+      {
+        RecordId scanRid;
+        while(1)
+        {
+          fscan.scanNext(scanRid);
+          rids.push_back(scanRid);
+        }
+      }
+      catch(EndOfFileException e)
+      {
+      }
+    }
+    RECORD key;
+    memset(&key, 0, sizeof(key));
+    key.i = 7;
+    std::vector<char> keyBytes(index.getKeyWidth());
+    for(int k = 0; k < 3000; k++)
+    {
+      key.d = 0.5 * k;
+      index.extractKey(&key, &keyBytes[0]);
+      index.insertEntry(&keyBytes[0], rids[k]);
+    }
+    key.d = 7;
+    index.extractKey(&key, &keyBytes[0]);
+    index.insertEntry(&keyBytes[0], rids[3000]);
+    checkPassFail(intDoubleScan(&index,7,0,GTE,7,0,LTE,1), 3002)
+    checkPassFail(intDoubleScan(&index,7,100,GTE,7,200,LT,2), 200)
+    checkPassFail(intDoubleScan(&index,7,7,GTE,7,7,LTE,2), 3)
+    checkPassFail(intDoubleScan(&index,6,0,GT,8,0,LT,1), 3002)
+    checkPassFail(intDoubleScan(&index,6,0,GTE,8,0,LTE,1), 3004)
+
+    int thrown = 0;
+    try
+    {
+      int low = 5;
+      int high = 3;
+      index.startScan(&low, GTE, &high, LTE, 1);
+    }
+    catch(BadScanrangeException e)
+    {
+      thrown = 1;
+    }
+    checkPassFail(thrown, 1)
+  }
+
+  // an existing index file is opened with its key schema, which has to match
+  {
+    CompositeBTreeIndex index(relationName, compositeIndexName, bufMgr, keyAttrs);
+    checkPassFail(intDoubleScan(&index,7,0,GTE,7,0,LTE,1), 3002)
+  }
+  std::vector<KeyAttr> otherAttrs;
+  otherAttrs.push_back(KeyAttr(offsetof(tuple,i), INTEGER));
+  otherAttrs.push_back(KeyAttr(offsetof(tuple,d), INTEGER));
+  int thrown = 0;
+  try
+  {
+    CompositeBTreeIndex index(relationName, compositeIndexName, bufMgr, otherAttrs);
+  }
+  catch(BadIndexInfoException e)
+  {
+    thrown = 1;
+  }
+  checkPassFail(thrown, 1)
+  try
+  {
+    File::remove(compositeIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+
+  std::cout << "Create a B+ Tree index on the composite key (string field, integer field)" << std::endl;
+  keyAttrs.clear();
+  keyAttrs.push_back(KeyAttr(offsetof(tuple,s), STRING));
+  keyAttrs.push_back(KeyAttr(offsetof(tuple,i), INTEGER));
+  {
+    CompositeBTreeIndex index(relationName, compositeIndexName, bufMgr, keyAttrs);
+    char low[64];
+    char high[64];
+    memset(low, 0, sizeof(low));
+    memset(high, 0, sizeof(high));
+    sprintf(low, "%05d string record", 42);
+    checkPassFail(compositeScan(&index,low,GTE,low,LTE,1), 1)
+    sprintf(high, "%05d string record", 142);
+    checkPassFail(compositeScan(&index,low,GT,high,LT,1), 99)
+    // every string starts with a digit, so ("0", "1") holds the keys 0 .. 9999
+    sprintf(low, "0");
+    sprintf(high, "1");
+    checkPassFail(compositeScan(&index,low,GT,high,LT,1), std::min(relationSize, 10000))
+  }
+  try
+  {
+    File::remove(compositeIndexName);
+  }
+  catch(FileNotFoundException e)
+  {
+  }
+}
+
+int intDoubleScan(CompositeBTreeIndex * index, int lowI, double lowD, Operator lowOp, int highI, double highD, Operator highOp, int prefixAttrs)
+{
+  // the keys of the (integer field, double field) index are an int followed by a double
+  char low[sizeof(int) + sizeof(double)];
+  char high[sizeof(int) + sizeof(double)];
+  memcpy(low, &lowI, sizeof(int));
+  memcpy(low + sizeof(int), &lowD, sizeof(double));
+  memcpy(high, &highI, sizeof(int));
+  memcpy(high + sizeof(int), &highD, sizeof(double));
+
+  std::cout << "Composite scan for " << prefixAttrs << " attributes";
+  if( lowOp == GT ) { std::cout << " ("; } else { std::cout << " ["; }
+  std::cout << lowI << ":" << lowD << "," << highI << ":" << highD;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  try
+  {
+    index->startScan(low, lowOp, high, highOp, prefixAttrs);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  // the keys found have to be in lexicographic order
+  int numResults = 0;
+  bool ordered = true;
+  int lastI = 0;
+  double lastD = 0;
+  while(1)
+  {
+    RecordId scanRid;
+    char key[sizeof(int) + sizeof(double)];
+    try
+    {
+      index->scanNext(scanRid, key);
+    }
+    catch(IndexScanCompletedException e)
+    {
+      break;
+    }
+    int keyI;
+    double keyD;
+    memcpy(&keyI, key, sizeof(int));
+    memcpy(&keyD, key + sizeof(int), sizeof(double));
+    if(numResults > 0 && (keyI < lastI || (keyI == lastI && keyD < lastD)))
+    {
+      ordered = false;
+    }
+    lastI = keyI;
+    lastD = keyD;
+    numResults++;
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl << std::endl;
+
+  return ordered ? numResults : -1;
+}
+
+int compositeScan(CompositeBTreeIndex * index, const void * low, Operator lowOp, const void * high, Operator highOp, int prefixAttrs)
+{
+  try
+  {
+    index->startScan(low, lowOp, high, highOp, prefixAttrs);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    return 0;
+  }
+  int numResults = 0;
+  while(1)
+  {
+    RecordId scanRid;
+    try
+    {
+      index->scanNext(scanRid);
+    }
+    catch(IndexScanCompletedException e)
+    {
+      break;
+    }
+    numResults++;
+  }
+  index->endScan();
+  std::cout << "Composite scan for " << prefixAttrs << " attributes, number of results: " << numResults << std::endl << std::endl;
+  return numResults;
+}
+
+int intCoveringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, ScanOrder order)
+{
+  RecordId scanRid;
+  // the double field followed by the string field
+  char included[sizeof(double) + 64];
+
+  std::cout << "Covering scan for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+  int numResults = 0;
+  try
+  {
+    index->startScan(&lowVal, lowOp, &highVal, highOp, order);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  // the included values have to be the ones of the record the entry points at
+  bool matching = true;
+  while(1)
+  {
+    try
+    {
+      index->scanNext(scanRid, included);
+    }
+    catch(IndexScanCompletedException e)
+    {
+      break;
+    }
+    Page *curPage;
+    bufMgr->readPage(file1, scanRid.page_number, curPage);
+    RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+    bufMgr->unPinPage(file1, scanRid.page_number, false);
+    double d;
+    memcpy(&d, included, sizeof(double));
+    if(d != myRec.d || memcmp(included + sizeof(double), myRec.s, 64) != 0)
+    {
+      matching = false;
+    }
+    numResults++;
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl << std::endl;
+
+  return matching ? numResults : -1;
+}
+
+int intMultiScan(BTreeIndex * index, const std::vector<ScanRange> & ranges)
+{
+  RecordId scanRid;
+
+  std::cout << "Multi-range scan for " << ranges.size() << " ranges" << std::endl;
+
+  int numResults = 0;
+  try
+  {
+    index->startMultiScan(ranges);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+    return 0;
+  }
+
+  // the keys of the records found have to be increasing and within the ranges, in order
+  std::size_t range = 0;
+  int lastKey = 0;
+  bool ordered = true;
+  while(1)
+  {
+    try
+    {
+      index->scanNext(scanRid);
+    }
+    catch(IndexScanCompletedException e)
+    {
+      break;
+    }
+    Page *curPage;
+    bufMgr->readPage(file1, scanRid.page_number, curPage);
+    RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+    bufMgr->unPinPage(file1, scanRid.page_number, false);
+    while(range < ranges.size() && (myRec.i > ranges[range].highVal || (myRec.i == ranges[range].highVal && ranges[range].highOp == LT)))
+    {
+      range++;
+    }
+    if(range == ranges.size() || myRec.i < ranges[range].lowVal || (myRec.i == ranges[range].lowVal && ranges[range].lowOp == GT)
+       || (numResults > 0 && myRec.i <= lastKey))
+    {
+      ordered = false;
+    }
+    lastKey = myRec.i;
+    numResults++;
+  }
+  index->endScan();
+  std::cout << "Number of results: " << numResults << std::endl << std::endl;
+
+  return ordered ? numResults : -1;
+}
+
+int rankLookup(BTreeIndex *index, int rank)
+{
+  RecordId rid;
+  try
+  {
+    index->selectByRank(rank, rid);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    return -1;
+  }
+  Page *curPage;
+  bufMgr->readPage(file1, rid.page_number, curPage);
+  RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rid).data()));
+  bufMgr->unPinPage(file1, rid.page_number, false);
+  return myRec.i;
+}
+
+int hashLookup(HashIndex * index, int key, bool checkRecords)
+{
+  std::vector<RecordId> rids;
+  try
+  {
+    index->lookup(&key, rids);
+  }
+  catch(NoSuchKeyFoundException e)
+  {
+    return 0;
+  }
+  if(!checkRecords)
+  {
+    return rids.size();
+  }
+  int found = 0;
+  for(unsigned int i = 0; i < rids.size(); i++)
+  {
+    Page *curPage;
+    bufMgr->readPage(file1, rids[i].page_number, curPage);
+    RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rids[i]).data()));
+    bufMgr->unPinPage(file1, rids[i].page_number, false);
+    if(myRec.i == key)
+    {
+      found++;
+    }
+  }
+  return found;
+}
+
+template <class IndexType>
+int intScan(IndexType * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
 	Page *curPage;